@@ -92,6 +92,7 @@ public:
     void SetBadgeImage(const std::string& sFilename);
 
     Condition& GetCondition(size_t nCondGroup, size_t i) { return m_vConditions.GetGroup(nCondGroup).GetAt(i); }
+    const Condition& GetCondition(size_t nCondGroup, size_t i) const { return m_vConditions.GetGroup(nCondGroup).GetAt(i); }
 
     std::string CreateMemString() const;
     std::string CreateStateString(const std::string& sSalt) const;
@@ -12,6 +12,7 @@
 #include "RA_RichPresence.h"
 #include "RA_md5factory.h"
 #include "RA_GameData.h"
+#include "services\FrameProfiler.h"
 
 #include "services\IConfiguration.hh"
 #include "services\ILeaderboardManager.hh"
@@ -182,7 +183,13 @@ void AchievementSet::Test()
         if (!ach.Active())
             continue;
 
-        if (ach.Test() == TRUE)
+        BOOL bTriggered;
+        {
+            RA_PROFILE_ACHIEVEMENT(ach.ID());
+            bTriggered = ach.Test();
+        }
+
+        if (bTriggered == TRUE)
         {
             //	Award. If can award or have already awarded, set inactive:
             ach.SetActive(FALSE);
@@ -473,7 +480,7 @@ BOOL AchievementSet::LoadFromFile(ra::GameID nGameID)
             oss << g_sHomeDir << RA_DIR_DATA << nGameID << L"-Rich.txt";
             _WriteBufferToFile(oss.str(), g_pCurrentGameData->RichPresencePatch());
         }
-        g_RichPresenceInterpreter.ParseFromString(g_pCurrentGameData->RichPresencePatch().c_str());
+        g_RichPresenceInterpreter.ParseFromString(g_pCurrentGameData->RichPresencePatch());
 
         const auto& AchievementsData{ doc["Achievements"] };
         for (const auto& achData : AchievementsData.GetArray())
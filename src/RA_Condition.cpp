@@ -1,9 +1,12 @@
 #include "RA_Condition.h"
+#include "RA_ConditionBatch.h"
 #include "RA_MemManager.h"
 
+#include <algorithm>
 #include <cctype>
 
-const char* COMPARISONVARIABLESIZE_STR[] = { "Bit0", "Bit1", "Bit2", "Bit3", "Bit4", "Bit5", "Bit6", "Bit7", "Lower4", "Upper4", "8-bit", "16-bit", "32-bit" };
+const char* COMPARISONVARIABLESIZE_STR[] = { "Bit0", "Bit1", "Bit2", "Bit3", "Bit4", "Bit5", "Bit6", "Bit7", "Lower4", "Upper4", "8-bit", "16-bit", "32-bit",
+    "16-bit BE", "32-bit BE", "8-bit signed", "16-bit signed", "32-bit signed", "Float" };
 static_assert(SIZEOF_ARRAY(COMPARISONVARIABLESIZE_STR) == NumComparisonVariableSizeTypes, "Must match!");
 const char* COMPARISONVARIABLETYPE_STR[] = { "Memory", "Value", "Delta", "DynVar" };
 static_assert(SIZEOF_ARRAY(COMPARISONVARIABLETYPE_STR) == NumComparisonVariableTypes, "Must match!");
@@ -12,6 +15,10 @@ static_assert(SIZEOF_ARRAY(COMPARISONTYPE_STR) == NumComparisonTypes, "Must matc
 const char* CONDITIONTYPE_STR[] = { "", "Pause If", "Reset If", "Add Source", "Sub Source", "Add Hits" };
 static_assert(SIZEOF_ARRAY(CONDITIONTYPE_STR) == Condition::NumConditionTypes, "Must match!");
 
+// evaluation walks every condition of every active achievement each frame. keep them small.
+static_assert(sizeof(CompVariable) == 12, "CompVariable should pack into 12 bytes");
+static_assert(sizeof(Condition) == 36, "Condition should pack into 36 bytes");
+
 static ComparisonVariableSize PrefixToComparisonSize(char cPrefix)
 {
     //	Careful not to use ABCDEF here, this denotes part of an actual variable!
@@ -29,6 +36,11 @@ static ComparisonVariableSize PrefixToComparisonSize(char cPrefix)
         case 'U':	return Nibble_Upper;
         case 'H':	return EightBit;
         case 'X':	return ThirtyTwoBit;
+        case 'I':	return SixteenBitBE;
+        case 'G':	return ThirtyTwoBitBE;
+        case 'Y':	return SignedEightBit;
+        case 'Z':	return SignedSixteenBit;
+        case 'V':	return SignedThirtyTwoBit;
         default:
         case ' ':	return SixteenBit;
     }
@@ -50,6 +62,11 @@ static const char* ComparisonSizeToPrefix(ComparisonVariableSize nSize)
         case Nibble_Upper:	return "U";
         case EightBit:		return "H";
         case ThirtyTwoBit:	return "X";
+        case SixteenBitBE:	return "I";
+        case ThirtyTwoBitBE:	return "G";
+        case SignedEightBit:	return "Y";
+        case SignedSixteenBit:	return "Z";
+        case SignedThirtyTwoBit:	return "V";
         default:
         case SixteenBit:	return " ";
     }
@@ -168,6 +185,13 @@ bool Condition::ParseFromString(const char*& pBuffer)
     if (!m_nCompTarget.ParseVariable(pBuffer))
         return false;
 
+    //	Conditions compare integers - a float would only be compared by its integer part. Only MemValue reads floats.
+    if ((m_nCompSource.Type() != ValueComparison && m_nCompSource.Size() == ComparisonVariableSize::Float) ||
+        (m_nCompTarget.Type() != ValueComparison && m_nCompTarget.Size() == ComparisonVariableSize::Float))
+    {
+        return false;
+    }
+
     ResetHits();
     m_nRequiredHits = ReadHits(pBuffer);
 
@@ -230,6 +254,7 @@ bool CompVariable::ParseVariable(const char*& pBufferInOut)
 {
     char* nNextChar = nullptr;
     unsigned int nBase = 16;	//	Assume hex address
+    bool bFloat = false;
 
     if (toupper(pBufferInOut[0]) == 'D' && pBufferInOut[1] == '0' && toupper(pBufferInOut[2]) == 'X')
     {
@@ -237,12 +262,26 @@ bool CompVariable::ParseVariable(const char*& pBufferInOut)
         pBufferInOut += 3;
         m_nVarType = ComparisonVariableType::DeltaMem;
     }
+    else if (toupper(pBufferInOut[0]) == 'D' && pBufferInOut[1] == 'f' && toupper(pBufferInOut[2]) == 'F')
+    {
+        //	'dfF' and hex: the previous value of a float
+        pBufferInOut += 3;
+        m_nVarType = ComparisonVariableType::DeltaMem;
+        bFloat = true;
+    }
     else if (pBufferInOut[0] == '0' && toupper(pBufferInOut[1]) == 'X')
     {
         //	Assume '0x' and four hex following it.
         pBufferInOut += 2;
         m_nVarType = ComparisonVariableType::Address;
     }
+    else if (pBufferInOut[0] == 'f' && toupper(pBufferInOut[1]) == 'F')
+    {
+        //	'fF' and hex: a float. the 'F' can't be a size prefix as it would be read as part of the address.
+        pBufferInOut += 2;
+        m_nVarType = ComparisonVariableType::Address;
+        bFloat = true;
+    }
     else
     {
         m_nVarType = ComparisonVariableType::ValueComparison;
@@ -264,6 +303,10 @@ bool CompVariable::ParseVariable(const char*& pBufferInOut)
     {
         //	Values don't have a size!
     }
+    else if (bFloat)
+    {
+        m_nVarSize = ComparisonVariableSize::Float;
+    }
     else
     {
         m_nVarSize = PrefixToComparisonSize(static_cast<char>(std::toupper(pBufferInOut[0])));
@@ -292,9 +335,15 @@ void CompVariable::SerializeAppend(std::string& buffer) const
             // explicit fallthrough to Address
 
         case Address:
-            buffer.append("0x");
-
-            buffer.append(ComparisonSizeToPrefix(m_nVarSize));
+            if (m_nVarSize == ComparisonVariableSize::Float)
+            {
+                buffer.append("fF");
+            }
+            else
+            {
+                buffer.append("0x");
+                buffer.append(ComparisonSizeToPrefix(m_nVarSize));
+            }
 
             if (m_nVal >= 0x10000)
                 sprintf_s(valueBuffer, sizeof(valueBuffer), "%06x", m_nVal);
@@ -337,8 +386,30 @@ unsigned int CompVariable::GetValue()
     }
 }
 
+template<typename T>
+static bool CompareValues(T nLeft, T nRight, ComparisonType nCompareType)
+{
+    switch (nCompareType)
+    {
+        case Equals:                return nLeft == nRight;
+        case LessThan:              return nLeft < nRight;
+        case LessThanOrEqual:       return nLeft <= nRight;
+        case GreaterThan:           return nLeft > nRight;
+        case GreaterThanOrEqual:    return nLeft >= nRight;
+        case NotEqualTo:            return nLeft != nRight;
+        default:                    return true;
+    }
+}
+
 bool Condition::Compare(unsigned int nAddBuffer)
 {
+    //	if either side is signed, both are compared as signed
+    if (IsSignedSize(m_nCompSource.Size()) || IsSignedSize(m_nCompTarget.Size()))
+    {
+        return CompareValues(static_cast<int>(m_nCompSource.GetValue() + nAddBuffer),
+            static_cast<int>(m_nCompTarget.GetValue()), m_nCompareType);
+    }
+
     switch (m_nCompareType)
     {
         case Equals:
@@ -358,30 +429,31 @@ bool Condition::Compare(unsigned int nAddBuffer)
     }
 }
 
-bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll)
+void ConditionGroup::UpdatePauseChains()
 {
-    const unsigned int nNumConditions = m_Conditions.size();
-    if (nNumConditions == 0)
-        return true; // important: empty group must evaluate true
+    if (!m_bPauseChainsDirty)
+        return;
 
     // identify any Pause conditions and their dependent AddSource/AddHits
-    std::vector<bool> vPauseConditions(nNumConditions, false);
+    const size_t nNumConditions = m_Conditions.size();
+    m_vPauseChains.assign(nNumConditions, false);
+    m_bHasPause = false;
+
     bool bInPause = false;
-    bool bHasPause = false;
-    for (int i = nNumConditions - 1; i >= 0; --i)
+    for (size_t i = nNumConditions; i-- > 0;)
     {
         switch (m_Conditions[i].GetConditionType())
         {
             case Condition::PauseIf:
-                bHasPause = true;
+                m_bHasPause = true;
                 bInPause = true;
-                vPauseConditions[i] = true;
+                m_vPauseChains[i] = true;
                 break;
 
             case Condition::AddSource:
             case Condition::SubSource:
             case Condition::AddHits:
-                vPauseConditions[i] = bInPause;
+                m_vPauseChains[i] = bInPause;
                 break;
 
             default:
@@ -390,18 +462,28 @@ bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll)
         }
     }
 
-    if (bHasPause)
+    m_bPauseChainsDirty = false;
+}
+
+bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll)
+{
+    if (m_Conditions.empty())
+        return true; // important: empty group must evaluate true
+
+    UpdatePauseChains();
+
+    if (m_bHasPause)
     {
         // one or more Pause conditions exists, if any of them are true, stop processing this group
-        if (Test(bDirtyConditions, bResetAll, vPauseConditions, true))
+        if (Test(bDirtyConditions, bResetAll, true))
             return false;
     }
 
     // process the non-Pause conditions to see if the group is true
-    return Test(bDirtyConditions, bResetAll, vPauseConditions, false);
+    return Test(bDirtyConditions, bResetAll, false);
 }
 
-bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll, const std::vector<bool>& vPauseConditions, bool bProcessingPauseIfs)
+bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll, bool bProcessingPauseIfs)
 {
     unsigned int nAddBuffer = 0;
     unsigned int nAddHits = 0;
@@ -409,7 +491,7 @@ bool ConditionGroup::Test(bool& bDirtyConditions, bool& bResetAll, const std::ve
                           
     for (size_t i = 0; i < m_Conditions.size(); ++i)
     {
-        if (vPauseConditions[i] != bProcessingPauseIfs)
+        if (m_vPauseChains[i] != bProcessingPauseIfs)
             continue;
 
         Condition* pNextCond = &m_Conditions[i];
@@ -530,6 +612,7 @@ void ConditionGroup::RemoveAt(size_t nID)
         if (nCount == nID)
         {
             iter = m_Conditions.erase(iter);
+            m_bPauseChainsDirty = true;
             break;
         }
 
@@ -555,6 +638,7 @@ bool ConditionSet::ParseFromString(const char*& sSerialized)
 {
     ConditionGroup* group = nullptr;
     m_vConditionGroups.clear();
+    Invalidate();
 
     // if string starts with 'S', there's no Core group. generate an empty one and leave 'group' as null
     // so the alt group will get created by the first condition.
@@ -625,7 +709,53 @@ void ConditionSet::Serialize(std::string& buffer) const
     }
 }
 
+ConditionSet::ConditionSet(ConditionSet&& other) noexcept
+    : m_vConditionGroups(std::move(other.m_vConditionGroups)), m_program(std::move(other.m_program))
+{
+}
+
+ConditionSet& ConditionSet::operator=(ConditionSet&& other) noexcept
+{
+    // moving the groups doesn't move the Conditions, so the compiled form still points at them
+    m_vConditionGroups = std::move(other.m_vConditionGroups);
+    m_program = std::move(other.m_program);
+    return *this;
+}
+
+ConditionSet& ConditionSet::operator=(const ConditionSet& other)
+{
+    m_vConditionGroups = other.m_vConditionGroups;
+
+    // the compiled form points at the Conditions it was built from - don't share it
+    Invalidate();
+    return *this;
+}
+
 bool ConditionSet::Test(bool& bDirtyConditions, bool& bResetConditions)
+{
+    std::lock_guard<std::mutex> lock(m_mtxProgram);
+
+    if (!m_program.IsCompiled() || m_program.ReadPlanGeneration() != g_MemManager.ReadPlanGeneration())
+        m_program.Compile(m_vConditionGroups);
+
+    bDirtyConditions = false;
+    bResetConditions = false;
+
+    // use local variable for tracking need to reset in case caller passes the same address for
+    // both variables when they don't care about the result
+    bool bNeedsReset = false;
+    bool bResult = m_program.Test(bDirtyConditions, bNeedsReset);
+
+    if (bNeedsReset)
+    {
+        bResetConditions = true;
+        bDirtyConditions = Reset();
+    }
+
+    return bResult;
+}
+
+bool ConditionSet::TestInterpreted(bool& bDirtyConditions, bool& bResetConditions)
 {
     // bDirtyConditions is set if any condition's HitCount changes
     bDirtyConditions = false;
@@ -680,6 +810,8 @@ void ConditionSet::SetAlwaysFalse()
 
 bool ConditionSet::Reset()
 {
+    m_program.ResetIncrementalState();
+
     bool bWasReset = false;
     for (ConditionGroup& group : m_vConditionGroups)
     {
@@ -689,3 +821,445 @@ bool ConditionSet::Reset()
 
     return bWasReset;
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+bool ConditionProgram::s_bIncrementalEvaluation = false;
+bool ConditionProgram::s_bBatchEvaluation = false;
+
+ConditionProgram& ConditionProgram::operator=(ConditionProgram&& other) noexcept
+{
+    if (this != &other)
+    {
+        Clear();
+
+        m_vInstructions.swap(other.m_vInstructions);
+        m_vGroups.swap(other.m_vGroups);
+        m_vInputs.swap(other.m_vInputs);
+        m_vLastIncrements.swap(other.m_vLastIncrements);
+        m_nReadPlanGeneration = other.m_nReadPlanGeneration;
+        m_bCompiled = other.m_bCompiled;
+        m_bUseBatch = other.m_bUseBatch;
+        m_bHasAllInputs = other.m_bHasAllInputs;
+        m_bRecording = other.m_bRecording;
+        m_bReplayable = other.m_bReplayable;
+        m_bLastResult = other.m_bLastResult;
+
+        // other now has no instructions, so it has no references to release
+        other.Clear();
+    }
+
+    return *this;
+}
+
+void ConditionProgram::Clear()
+{
+    for (const auto& pInstruction : m_vInstructions)
+    {
+        for (const Operand* pOperand : { &pInstruction.source, &pInstruction.target })
+        {
+            if (pOperand->nReadIndex != NO_READ_INDEX)
+                g_MemManager.ReleaseFromReadPlan(pOperand->nReadIndex, m_nReadPlanGeneration);
+        }
+
+        if (pInstruction.nBatchLane != NO_BATCH_LANE)
+            g_ConditionBatch.ReleaseLane(pInstruction.nBatchLane, m_nReadPlanGeneration);
+    }
+
+    m_vInstructions.clear();
+    m_vGroups.clear();
+    m_vInputs.clear();
+    m_vLastIncrements.clear();
+    m_bHasAllInputs = false;
+    m_bReplayable = false;
+    m_bCompiled = false;
+}
+
+void ConditionProgram::Compile(std::vector<ConditionGroup>& vGroups)
+{
+    Clear();
+
+    size_t nConditions = 0;
+    for (const auto& group : vGroups)
+        nConditions += group.Count();
+
+    m_vInstructions.reserve(nConditions);
+    m_vGroups.reserve(vGroups.size());
+    m_nReadPlanGeneration = g_MemManager.ReadPlanGeneration();
+
+    for (auto& group : vGroups)
+    {
+        const size_t nNumConditions = group.Count();
+
+        // the conditions are accessed directly - the non-const GetAt would mark the pause chains dirty again
+        group.UpdatePauseChains();
+        const std::vector<bool>& vPauseConditions = group.m_vPauseChains;
+
+        // the PauseIf chains are emitted first, followed by everything else. relative order within
+        // each range is preserved, so each range can be processed as a single pass.
+        GroupRange& range = m_vGroups.emplace_back();
+        range.nPauseStart = static_cast<unsigned int>(m_vInstructions.size());
+
+        for (int nPass = 0; nPass < 2; ++nPass)
+        {
+            const bool bProcessingPauseIfs = (nPass == 0);
+            if (!bProcessingPauseIfs)
+                range.nStart = static_cast<unsigned int>(m_vInstructions.size());
+
+            bool bAfterAddSource = false;
+
+            for (size_t i = 0; i < nNumConditions; ++i)
+            {
+                if (vPauseConditions[i] != bProcessingPauseIfs)
+                    continue;
+
+                Condition& condition = group.m_Conditions[i];
+                Instruction& instruction = m_vInstructions.emplace_back();
+                switch (condition.GetConditionType())
+                {
+                    case Condition::AddSource:  instruction.nOpcode = Opcode::AddSource; break;
+                    case Condition::SubSource:  instruction.nOpcode = Opcode::SubSource; break;
+                    case Condition::AddHits:    instruction.nOpcode = Opcode::AddHits; break;
+                    case Condition::PauseIf:    instruction.nOpcode = Opcode::PauseIf; break;
+                    case Condition::ResetIf:    instruction.nOpcode = Opcode::ResetIf; break;
+                    default:                    instruction.nOpcode = Opcode::Standard; break;
+                }
+
+                instruction.nCompareType = condition.CompareType();
+                instruction.nRequiredHits = condition.RequiredHits();
+                instruction.pCondition = &condition;
+                CompileOperand(condition.CompSource(), instruction.source);
+                CompileOperand(condition.CompTarget(), instruction.target);
+
+                // an unsigned memory value compared to a constant can be evaluated by the batch, unless an AddSource
+                // or SubSource chain modifies the memory value first. AddHits conditions don't use the chain, but
+                // don't end it either - it's applied to the next condition that isn't an AddHits.
+                const bool bUsesAddSource = bAfterAddSource && instruction.nOpcode != Opcode::AddHits;
+                instruction.nBatchLane = NO_BATCH_LANE;
+                if (!bUsesAddSource && instruction.nOpcode != Opcode::AddSource && instruction.nOpcode != Opcode::SubSource &&
+                    instruction.source.nKind == OperandKind::Memory && instruction.source.nReadIndex != NO_READ_INDEX &&
+                    instruction.target.nKind == OperandKind::Value && !IsSignedSize(instruction.source.nSize) &&
+                    !IsSignedSize(instruction.target.nSize))
+                {
+                    instruction.nBatchLane = g_ConditionBatch.AddLane(instruction.source.nReadIndex,
+                        instruction.nCompareType, instruction.target.nValue);
+                }
+
+                if (instruction.nOpcode == Opcode::AddSource || instruction.nOpcode == Opcode::SubSource)
+                    bAfterAddSource = true;
+                else if (instruction.nOpcode != Opcode::AddHits)
+                    bAfterAddSource = false;
+            }
+        }
+
+        range.nEnd = static_cast<unsigned int>(m_vInstructions.size());
+    }
+
+    // collect the unique memory inputs. if any operand isn't in the read plan, changes can't be detected.
+    m_bHasAllInputs = true;
+    for (const auto& pInstruction : m_vInstructions)
+    {
+        for (const Operand* pOperand : { &pInstruction.source, &pInstruction.target })
+        {
+            if (pOperand->nKind == OperandKind::Value)
+                continue;
+
+            if (pOperand->nReadIndex == NO_READ_INDEX)
+            {
+                m_bHasAllInputs = false;
+                continue;
+            }
+
+            if (std::find_if(m_vInputs.begin(), m_vInputs.end(), [pOperand](const std::pair<unsigned int, unsigned int>& pInput)
+                { return pInput.first == pOperand->nReadIndex; }) == m_vInputs.end())
+            {
+                m_vInputs.emplace_back(pOperand->nReadIndex, 0U);
+            }
+        }
+    }
+
+    if (!m_bHasAllInputs)
+        m_vInputs.clear();
+
+    m_bCompiled = true;
+}
+
+void ConditionProgram::CompileOperand(CompVariable& variable, Operand& operand)
+{
+    operand.nValue = variable.RawValue();
+    operand.nReadIndex = NO_READ_INDEX;
+    operand.nSize = variable.Size();
+
+    switch (variable.Type())
+    {
+        case Address:
+            operand.nKind = OperandKind::Memory;
+            break;
+
+        case DeltaMem:
+            operand.nKind = OperandKind::Delta;
+            break;
+
+        case ValueComparison:
+            operand.nKind = OperandKind::Value;
+            break;
+
+        default:
+            // CompVariable::GetValue returns 0 for unsupported types
+            operand.nKind = OperandKind::Value;
+            operand.nValue = 0;
+            return;
+    }
+
+    // the read plan is only maintained by the thread processing frames. anything compiled elsewhere reads directly.
+    if (operand.nKind != OperandKind::Value && g_MemManager.IsFrameThread())
+        operand.nReadIndex = g_MemManager.AddToReadPlan(operand.nValue, operand.nSize);
+}
+
+unsigned int ConditionProgram::ReadOperand(const Operand& operand)
+{
+    if (operand.nReadIndex != NO_READ_INDEX)
+        return g_MemManager.ReadPlanValue(operand.nReadIndex, operand.nValue, operand.nSize);
+
+    return g_MemManager.ActiveBankRAMRead(operand.nValue, operand.nSize);
+}
+
+unsigned int ConditionProgram::GetValue(const Operand& operand, CompVariable& variable)
+{
+    switch (operand.nKind)
+    {
+        case OperandKind::Value:
+            return operand.nValue;
+
+        case OperandKind::Memory:
+            return ReadOperand(operand);
+
+        default:
+        {
+            //	Return the backed up (last frame) value, but store the new one for the next frame!
+            const unsigned int nPreviousVal = variable.m_nPreviousVal;
+            variable.m_nPreviousVal = ReadOperand(operand);
+
+            // the next evaluation would see a different delta value, so this one can't be replayed
+            if (nPreviousVal != variable.m_nPreviousVal)
+                m_bReplayable = false;
+
+            return nPreviousVal;
+        }
+    }
+}
+
+bool ConditionProgram::Compare(Instruction& instruction, unsigned int nAddBuffer)
+{
+    // the lane compares the memory value by itself
+    if (m_bUseBatch && instruction.nBatchLane != NO_BATCH_LANE && nAddBuffer == 0)
+        return g_ConditionBatch.GetResult(instruction.nBatchLane);
+
+    const unsigned int nLeft = GetValue(instruction.source, instruction.pCondition->CompSource()) + nAddBuffer;
+    const unsigned int nRight = GetValue(instruction.target, instruction.pCondition->CompTarget());
+
+    if (IsSignedSize(instruction.source.nSize) || IsSignedSize(instruction.target.nSize))
+        return CompareValues(static_cast<int>(nLeft), static_cast<int>(nRight), instruction.nCompareType);
+
+    return CompareValues(nLeft, nRight, instruction.nCompareType);
+}
+
+bool ConditionProgram::InputsUnchanged()
+{
+    for (const auto& pInput : m_vInputs)
+    {
+        if (g_MemManager.ReadFrameValue(pInput.first) != pInput.second)
+            return false;
+    }
+
+    return true;
+}
+
+void ConditionProgram::IncrHits(const Instruction& instruction)
+{
+    instruction.pCondition->IncrHits();
+
+    if (m_bRecording)
+    {
+        if (instruction.nRequiredHits != 0 || instruction.nOpcode == Opcode::AddHits)
+            m_bReplayable = false;
+        else
+            m_vLastIncrements.push_back(instruction.pCondition);
+    }
+}
+
+bool ConditionProgram::Test(bool& bDirtyConditions, bool& bNeedsReset)
+{
+    if (m_vGroups.empty())
+        return false;
+
+    const bool bIsFrameThread = g_MemManager.IsFrameThread();
+    m_bUseBatch = s_bBatchEvaluation && bIsFrameThread;
+    m_bRecording = s_bIncrementalEvaluation && m_bHasAllInputs && bIsFrameThread;
+    if (m_bRecording)
+    {
+        // nothing the last evaluation depended on has changed. evaluating again would have the same
+        // result and add the same hits.
+        if (m_bReplayable && InputsUnchanged())
+        {
+            for (Condition* pCondition : m_vLastIncrements)
+                pCondition->IncrHits();
+
+            bDirtyConditions |= !m_vLastIncrements.empty();
+            return m_bLastResult;
+        }
+
+        m_vLastIncrements.clear();
+        m_bReplayable = true;
+    }
+    else
+    {
+        m_bReplayable = false;
+    }
+
+    const bool bResult = TestGroups(bDirtyConditions, bNeedsReset);
+
+    if (m_bRecording)
+    {
+        if (bNeedsReset)
+        {
+            m_bReplayable = false;
+        }
+        else if (m_bReplayable)
+        {
+            for (auto& pInput : m_vInputs)
+                pInput.second = g_MemManager.ReadFrameValue(pInput.first);
+
+            m_bLastResult = bResult;
+        }
+
+        m_bRecording = false;
+    }
+
+    return bResult;
+}
+
+bool ConditionProgram::TestGroups(bool& bDirtyConditions, bool& bNeedsReset)
+{
+
+    // for a set to be true, the first group (core) must be true. if any additional groups (alt)
+    // exist, at least one of them must also be true.
+    bool bResult = TestGroup(m_vGroups[0], bDirtyConditions, bNeedsReset);
+    if (m_vGroups.size() > 1)
+    {
+        bool bAltResult = false;
+        for (size_t i = 1; i < m_vGroups.size(); ++i)
+        {
+            if (TestGroup(m_vGroups[i], bDirtyConditions, bNeedsReset))
+                bAltResult = true;
+        }
+
+        if (!bAltResult || bNeedsReset)
+            bResult = false;
+    }
+
+    return bResult;
+}
+
+bool ConditionProgram::TestGroup(const GroupRange& group, bool& bDirtyConditions, bool& bNeedsReset)
+{
+    if (group.nPauseStart == group.nEnd)
+        return true; // important: empty group must evaluate true
+
+    // if any of the PauseIf conditions are true, stop processing this group
+    if (group.nPauseStart != group.nStart && TestRange(group.nPauseStart, group.nStart, bDirtyConditions, bNeedsReset))
+        return false;
+
+    return TestRange(group.nStart, group.nEnd, bDirtyConditions, bNeedsReset);
+}
+
+bool ConditionProgram::TestRange(unsigned int nStart, unsigned int nEnd, bool& bDirtyConditions, bool& bNeedsReset)
+{
+    unsigned int nAddBuffer = 0;
+    unsigned int nAddHits = 0;
+    bool bSetValid = true; // must start true so AND logic works
+
+    Instruction* pInstruction = &m_vInstructions[nStart];
+    Instruction* const pEnd = pInstruction + (nEnd - nStart);
+    for (; pInstruction < pEnd; ++pInstruction)
+    {
+        Condition* pCondition = pInstruction->pCondition;
+        switch (pInstruction->nOpcode)
+        {
+            case Opcode::AddSource:
+                nAddBuffer += GetValue(pInstruction->source, pInstruction->pCondition->CompSource());
+                continue;
+
+            case Opcode::SubSource:
+                nAddBuffer -= GetValue(pInstruction->source, pInstruction->pCondition->CompSource());
+                continue;
+
+            case Opcode::AddHits:
+                if (Compare(*pInstruction, 0))
+                {
+                    if (pInstruction->nRequiredHits == 0 || pCondition->CurrentHits() < pInstruction->nRequiredHits)
+                    {
+                        IncrHits(*pInstruction);
+                        bDirtyConditions = true;
+                    }
+                }
+
+                nAddHits += pCondition->CurrentHits();
+                continue;
+
+            default:
+                break;
+        }
+
+        // always evaluate the condition to ensure delta values get tracked correctly
+        bool bConditionValid = Compare(*pInstruction, nAddBuffer);
+
+        // if the condition has a target hit count that has already been met, it's automatically true, even if not currently true.
+        const unsigned int nRequiredHits = pInstruction->nRequiredHits;
+        if (nRequiredHits != 0 && (pCondition->CurrentHits() + nAddHits >= nRequiredHits))
+        {
+            bConditionValid = true;
+        }
+        else if (bConditionValid)
+        {
+            IncrHits(*pInstruction);
+            bDirtyConditions = true;
+
+            // HitCount target has not yet been met, condition is not yet valid
+            if (nRequiredHits != 0 && pCondition->CurrentHits() + nAddHits < nRequiredHits)
+                bConditionValid = false;
+        }
+
+        nAddBuffer = 0;
+        nAddHits = 0;
+
+        switch (pInstruction->nOpcode)
+        {
+            case Opcode::PauseIf:
+                // as soon as we find a PauseIf that evaluates to true, stop processing the rest of the group
+                if (bConditionValid)
+                    return true;
+
+                bSetValid = false;
+
+                // PauseIf didn't evaluate true, and doesn't have a HitCount, reset the HitCount to indicate the condition didn't match
+                if (nRequiredHits == 0 && pCondition->ResetHits())
+                    bDirtyConditions = true;
+                break;
+
+            case Opcode::ResetIf:
+                if (bConditionValid)
+                {
+                    bNeedsReset = true; // let caller know to reset all hit counts
+                    bSetValid = false;  // cannot be valid if we've hit a reset condition
+                }
+                break;
+
+            default:
+                bSetValid &= bConditionValid;
+                break;
+        }
+    }
+
+    return bSetValid;
+}
@@ -3,7 +3,10 @@
 #pragma once
 #include "RA_Defs.h"
 
-enum ComparisonVariableSize
+#include <mutex>
+
+// the enums are stored in a single byte to keep Condition and ConditionProgram::Instruction compact
+enum ComparisonVariableSize : unsigned char
 {
     Bit_0,
     Bit_1,
@@ -19,12 +22,31 @@ enum ComparisonVariableSize
     EightBit,//=Byte,  
     SixteenBit,
     ThirtyTwoBit,
+    SixteenBitBE,
+    ThirtyTwoBitBE,
+    SignedEightBit,
+    SignedSixteenBit,
+    SignedThirtyTwoBit,
+    Float,              //  IEEE 754 single precision. read as the integer part of the value. not valid in conditions.
 
     NumComparisonVariableSizeTypes
 };
 extern const char* COMPARISONVARIABLESIZE_STR[];
 
-enum ComparisonVariableType
+//	Signed values are sign extended to 32 bits when read, and compared as signed integers.
+inline constexpr bool IsSignedSize(ComparisonVariableSize nSize)
+{
+    return (nSize == SignedEightBit || nSize == SignedSixteenBit || nSize == SignedThirtyTwoBit || nSize == Float);
+}
+
+//	The number of bytes that have to be read to get a value of the specified size.
+inline constexpr unsigned int BytesForSize(ComparisonVariableSize nSize)
+{
+    return (nSize <= EightBit || nSize == SignedEightBit) ? 1 :
+        (nSize == SixteenBit || nSize == SixteenBitBE || nSize == SignedSixteenBit) ? 2 : 4;
+}
+
+enum ComparisonVariableType : unsigned char
 {
     Address,			//	compare to the value of a live address in RAM
     ValueComparison,	//	a number. assume 32 bit 
@@ -35,7 +57,7 @@ enum ComparisonVariableType
 };
 extern const char* COMPARISONVARIABLETYPE_STR[];
 
-enum ComparisonType
+enum ComparisonType : unsigned char
 {
     Equals,
     LessThan,
@@ -95,17 +117,19 @@ public:
     inline unsigned int RawPreviousValue() const { return m_nPreviousVal; }
 
 private:
-    ComparisonVariableSize m_nVarSize;
-    ComparisonVariableType m_nVarType;
+    friend class ConditionProgram; // updates m_nPreviousVal when evaluating DeltaMem operands
+
     unsigned int m_nVal;
     unsigned int m_nPreviousVal;
+    ComparisonVariableSize m_nVarSize;
+    ComparisonVariableType m_nVarType;
 };
 
 
 class Condition
 {
 public:
-    enum ConditionType
+    enum ConditionType : unsigned char
     {
         Standard,
         PauseIf,
@@ -119,10 +143,10 @@ public:
 
 public:
     Condition()
-        : m_nConditionType(Standard),
-        m_nCompareType(Equals),
-        m_nRequiredHits(0),
-        m_nCurrentHits(0)
+        : m_nRequiredHits(0),
+        m_nCurrentHits(0),
+        m_nConditionType(Standard),
+        m_nCompareType(Equals)
     {
     }
 
@@ -167,14 +191,15 @@ public:
 
 
 private:
-    ConditionType	m_nConditionType;
-
+    // ordered largest to smallest so the one-byte fields pack together
     CompVariable	m_nCompSource;
-    ComparisonType	m_nCompareType;
     CompVariable	m_nCompTarget;
 
     unsigned int	m_nRequiredHits;
     unsigned int	m_nCurrentHits;
+
+    ConditionType	m_nConditionType;
+    ComparisonType	m_nCompareType;
 };
 
 class ConditionGroup
@@ -185,41 +210,187 @@ public:
     bool Test(bool& bDirtyConditions, bool& bResetRead);
     size_t Count() const { return m_Conditions.size(); }
 
-    void Add(const Condition& newCond) { m_Conditions.push_back(newCond); }
-    void Insert(size_t i, const Condition& newCond) { m_Conditions.insert(m_Conditions.begin() + i, newCond); }
-    Condition& GetAt(size_t i) { return m_Conditions[i]; }
+    void Add(const Condition& newCond) { m_Conditions.push_back(newCond); m_bPauseChainsDirty = true; }
+    void Insert(size_t i, const Condition& newCond) { m_Conditions.insert(m_Conditions.begin() + i, newCond); m_bPauseChainsDirty = true; }
+    Condition& GetAt(size_t i) { m_bPauseChainsDirty = true; return m_Conditions[i]; } // caller may change the condition type
     const Condition& GetAt(size_t i) const { return m_Conditions[i]; }
-    void Clear() { m_Conditions.clear(); }
+    void Clear() { m_Conditions.clear(); m_bPauseChainsDirty = true; }
     void RemoveAt(size_t i);
     bool Reset(bool bIncludingDeltas);	//	Returns dirty
 
 protected:
-    bool Test(bool& bDirtyConditions, bool& bResetRead, const std::vector<bool>& vPauseConditions, bool bProcessingPauseIfs);
+    friend class ConditionProgram; // compiles the conditions without marking the pause chains dirty
+
+    bool Test(bool& bDirtyConditions, bool& bResetRead, bool bProcessingPauseIfs);
+    void UpdatePauseChains();
 
     std::vector<Condition> m_Conditions;
+
+    // pause chain membership is only recalculated after the conditions change, so Test doesn't allocate.
+    // true if the condition is a PauseIf, or an AddSource/SubSource/AddHits chained into a PauseIf.
+    std::vector<bool> m_vPauseChains;
+    bool m_bHasPause = false;
+    bool m_bPauseChainsDirty = false;
+};
+
+// Flattened form of a ConditionSet. The conditions of every group are stored in one contiguous
+// instruction stream with the operand kinds resolved and the PauseIf chains moved to the front of
+// each group, so evaluation doesn't have to rediscover them every frame. Hit counts and delta values
+// are still stored in the source Conditions so the editor and the state strings continue to see them.
+class ConditionProgram
+{
+public:
+    ConditionProgram() = default;
+    ~ConditionProgram() { Clear(); }
+
+    // the program holds references to read plan entries - they can be moved, but not shared
+    ConditionProgram(const ConditionProgram&) = delete;
+    ConditionProgram& operator=(const ConditionProgram&) = delete;
+    ConditionProgram(ConditionProgram&& other) noexcept { *this = std::move(other); }
+    ConditionProgram& operator=(ConditionProgram&& other) noexcept;
+
+    void Compile(std::vector<ConditionGroup>& vGroups);
+    void Clear();
+    bool IsCompiled() const { return m_bCompiled; }
+    unsigned int ReadPlanGeneration() const { return m_nReadPlanGeneration; }
+
+    //	Evaluates the core and alt groups. Does not reset hit counts - bNeedsReset is set if a ResetIf was true.
+    bool Test(bool& bDirtyConditions, bool& bNeedsReset);
+
+    //	When enabled, a program whose memory inputs haven't changed since its last evaluation replays
+    //	that evaluation instead of processing the conditions again. Only applies within a MemManager frame.
+    static void SetIncrementalEvaluation(bool bEnabled) { s_bIncrementalEvaluation = bEnabled; }
+    static bool IsIncrementalEvaluation() { return s_bIncrementalEvaluation; }
+
+    //	When enabled, comparisons of a memory value to a constant are read from g_ConditionBatch, which
+    //	evaluates them for every program at once. Only applies within a MemManager frame.
+    static void SetBatchEvaluation(bool bEnabled) { s_bBatchEvaluation = bEnabled; }
+    static bool IsBatchEvaluation() { return s_bBatchEvaluation; }
+
+    //	Must be called if hit counts or delta values are modified outside of Test.
+    void ResetIncrementalState() { m_bReplayable = false; }
+
+protected:
+    enum class Opcode : unsigned char
+    {
+        AddSource,
+        SubSource,
+        AddHits,
+        Standard,
+        PauseIf,
+        ResetIf,
+    };
+
+    enum class OperandKind : unsigned char
+    {
+        Value,
+        Memory,
+        Delta,
+    };
+
+    struct Operand
+    {
+        unsigned int nValue;                // value, or address for Memory/Delta
+        unsigned int nReadIndex;            // index into the MemManager read plan, or NO_READ_INDEX
+        ComparisonVariableSize nSize;
+        OperandKind nKind;
+    };
+
+    // everything needed to evaluate the condition is packed ahead of the pointer back to the source
+    // Condition, which is only followed to update hit counts and delta values.
+    struct Instruction
+    {
+        Opcode nOpcode;
+        ComparisonType nCompareType;
+        unsigned int nRequiredHits;
+        Operand source;
+        Operand target;
+        unsigned int nBatchLane;            // lane in g_ConditionBatch, or NO_BATCH_LANE
+        Condition* pCondition;              // owner of the hit count and delta values
+    };
+
+    struct GroupRange
+    {
+        unsigned int nPauseStart;           // [nPauseStart, nStart) are the PauseIf chains
+        unsigned int nStart;                // [nStart, nEnd) are everything else
+        unsigned int nEnd;
+    };
+
+    static constexpr unsigned int NO_READ_INDEX = 0xFFFFFFFF;
+    static constexpr unsigned int NO_BATCH_LANE = 0xFFFFFFFF;
+
+    static void CompileOperand(CompVariable& variable, Operand& operand);
+    static unsigned int ReadOperand(const Operand& operand);
+    unsigned int GetValue(const Operand& operand, CompVariable& variable);
+    bool Compare(Instruction& instruction, unsigned int nAddBuffer);
+    bool TestGroups(bool& bDirtyConditions, bool& bNeedsReset);
+    bool TestGroup(const GroupRange& group, bool& bDirtyConditions, bool& bNeedsReset);
+    bool TestRange(unsigned int nStart, unsigned int nEnd, bool& bDirtyConditions, bool& bNeedsReset);
+    void IncrHits(const Instruction& instruction);
+    bool InputsUnchanged();
+
+    std::vector<Instruction> m_vInstructions;
+    std::vector<GroupRange> m_vGroups;
+    unsigned int m_nReadPlanGeneration = 0;
+    bool m_bCompiled = false;
+    bool m_bUseBatch = false;
+
+    // incremental evaluation: the read plan values seen by the last evaluation, and the hits it added. the
+    // evaluation can only be replayed if it didn't reset, didn't see a changing delta, and only added hits
+    // to conditions whose hit counts don't affect the logic (no target, not AddHits).
+    std::vector<std::pair<unsigned int, unsigned int>> m_vInputs;
+    std::vector<Condition*> m_vLastIncrements;
+    bool m_bHasAllInputs = false;
+    bool m_bRecording = false;
+    bool m_bReplayable = false;
+    bool m_bLastResult = false;
+
+    static bool s_bIncrementalEvaluation;
+    static bool s_bBatchEvaluation;
 };
 
 class ConditionSet
 {
 public:
+    ConditionSet() = default;
+    ConditionSet(const ConditionSet& other) : m_vConditionGroups(other.m_vConditionGroups) {}
+    ConditionSet& operator=(const ConditionSet& other);
+    ConditionSet(ConditionSet&& other) noexcept;
+    ConditionSet& operator=(ConditionSet&& other) noexcept;
+
     bool ParseFromString(const char*& sSerialized);
     void Serialize(std::string& buffer) const;
 
     bool Test(bool& bDirtyConditions, bool& bWasReset);
+    bool TestInterpreted(bool& bDirtyConditions, bool& bWasReset); // walks the groups directly - reference for the compiled form
     bool Reset();
 
+    //	Discards the compiled form. Called by everything that hands out or modifies the conditions.
+    void Invalidate()
+    {
+        std::lock_guard<std::mutex> lock(m_mtxProgram);
+        m_program.Clear();
+    }
+
     void SetAlwaysTrue();
     void SetAlwaysFalse();
 
-    void Clear() { m_vConditionGroups.clear(); }
+    void Clear() { m_vConditionGroups.clear(); Invalidate(); }
     size_t GroupCount() const { return m_vConditionGroups.size(); }
-    void AddGroup() { m_vConditionGroups.emplace_back(); }
-    void RemoveLastGroup() { m_vConditionGroups.pop_back(); }
-    ConditionGroup& GetGroup(size_t i) { return m_vConditionGroups[i]; }
+    void AddGroup() { m_vConditionGroups.emplace_back(); Invalidate(); }
+    void RemoveLastGroup() { m_vConditionGroups.pop_back(); Invalidate(); }
+
+    // the caller may modify the group, so the compiled form has to be rebuilt before the next Test
+    ConditionGroup& GetGroup(size_t i) { Invalidate(); return m_vConditionGroups[i]; }
     const ConditionGroup& GetGroup(size_t i) const { return m_vConditionGroups[i]; }
 
 protected:
     std::vector<ConditionGroup> m_vConditionGroups;
+    ConditionProgram m_program;
+
+    // the rich presence is tested by both the emulator and the http threads. compiling and evaluating both
+    // modify the program, so they have to be serialized.
+    std::mutex m_mtxProgram;
 };
 
 
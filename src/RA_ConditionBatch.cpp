@@ -0,0 +1,340 @@
+#include "RA_ConditionBatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RA_BATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RA_TARGET_AVX2
+#else
+#define RA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+ConditionBatch g_ConditionBatch;
+
+ConditionBatch::~ConditionBatch()
+{
+    // programs destroyed after the batch must not try to release their lanes
+    m_nReadPlanGeneration.store(0, std::memory_order_release);
+}
+
+unsigned int ConditionBatch::AddLane(unsigned int nReadIndex, ComparisonType nCompareType, unsigned int nConstant)
+{
+    // lanes refer to read plan indices - if the plan was rebuilt, so are the lanes
+    const unsigned int nGeneration = g_MemManager.ReadPlanGeneration();
+    if (m_nReadPlanGeneration.load(std::memory_order_relaxed) != nGeneration)
+    {
+        Clear();
+        m_nReadPlanGeneration.store(nGeneration, std::memory_order_release);
+    }
+    else
+    {
+        ApplyReleases();
+    }
+
+    const unsigned long long nKey = (static_cast<unsigned long long>(nReadIndex) << 32) | nConstant;
+    auto& mLaneIndices = m_mLaneIndices[nCompareType];
+    const auto iter = mLaneIndices.find(nKey);
+    if (iter != mLaneIndices.end())
+    {
+        ++m_vLanes[iter->second].nReferences;
+        return iter->second;
+    }
+
+    Bucket& pBucket = m_vBuckets[nCompareType];
+    const Lane pLane{ nKey, 1U, static_cast<unsigned int>(pBucket.vReadIndices.size()), nCompareType };
+
+    unsigned int nLane;
+    if (!m_vFreeLanes.empty())
+    {
+        nLane = m_vFreeLanes.back();
+        m_vFreeLanes.pop_back();
+        m_vLanes[nLane] = pLane;
+        m_vResults[nLane] = 0;
+    }
+    else
+    {
+        nLane = static_cast<unsigned int>(m_vLanes.size());
+        m_vLanes.push_back(pLane);
+        m_vResults.push_back(0);
+    }
+
+    mLaneIndices.emplace(nKey, nLane);
+
+    pBucket.vReadIndices.push_back(nReadIndex);
+    pBucket.vConstants.push_back(nConstant);
+    pBucket.vLanes.push_back(nLane);
+    pBucket.vValues.resize(pBucket.vReadIndices.size());
+    pBucket.vResults.resize(pBucket.vReadIndices.size());
+
+    m_bNeedsEvaluate = true;
+    return nLane;
+}
+
+void ConditionBatch::ReleaseLane(unsigned int nLane, unsigned int nGeneration)
+{
+    // the lanes of an older plan have already been discarded
+    if (nGeneration != m_nReadPlanGeneration.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mtxReleases);
+    m_vReleases.emplace_back(nLane, nGeneration);
+}
+
+void ConditionBatch::ApplyReleases()
+{
+    std::lock_guard<std::mutex> lock(m_mtxReleases);
+
+    const unsigned int nGeneration = m_nReadPlanGeneration.load(std::memory_order_relaxed);
+    for (const auto& pRelease : m_vReleases)
+    {
+        if (pRelease.second == nGeneration && --m_vLanes[pRelease.first].nReferences == 0)
+            RemoveLane(pRelease.first);
+    }
+
+    m_vReleases.clear();
+}
+
+void ConditionBatch::RemoveLane(unsigned int nLane)
+{
+    const Lane& pLane = m_vLanes[nLane];
+    Bucket& pBucket = m_vBuckets[pLane.nCompareType];
+
+    // keep the bucket dense by moving its last entry into the removed one
+    const unsigned int nLast = static_cast<unsigned int>(pBucket.vReadIndices.size() - 1);
+    if (pLane.nPosition != nLast)
+    {
+        pBucket.vReadIndices[pLane.nPosition] = pBucket.vReadIndices[nLast];
+        pBucket.vConstants[pLane.nPosition] = pBucket.vConstants[nLast];
+        pBucket.vLanes[pLane.nPosition] = pBucket.vLanes[nLast];
+        m_vLanes[pBucket.vLanes[nLast]].nPosition = pLane.nPosition;
+    }
+
+    pBucket.vReadIndices.pop_back();
+    pBucket.vConstants.pop_back();
+    pBucket.vLanes.pop_back();
+    pBucket.vValues.pop_back();
+    pBucket.vResults.pop_back();
+
+    m_mLaneIndices[pLane.nCompareType].erase(pLane.nKey);
+    m_vFreeLanes.push_back(nLane);
+}
+
+void ConditionBatch::Clear()
+{
+    for (auto& pBucket : m_vBuckets)
+    {
+        pBucket.vReadIndices.clear();
+        pBucket.vValues.clear();
+        pBucket.vConstants.clear();
+        pBucket.vResults.clear();
+        pBucket.vLanes.clear();
+    }
+
+    for (auto& mLaneIndices : m_mLaneIndices)
+        mLaneIndices.clear();
+
+    m_vLanes.clear();
+    m_vFreeLanes.clear();
+    m_vResults.clear();
+    m_bNeedsEvaluate = false;
+
+    std::lock_guard<std::mutex> lock(m_mtxReleases);
+    m_vReleases.clear();
+}
+
+void ConditionBatch::Evaluate()
+{
+    ApplyReleases();
+
+    for (int nCompareType = 0; nCompareType < NumComparisonTypes; ++nCompareType)
+    {
+        Bucket& pBucket = m_vBuckets[nCompareType];
+        const size_t nCount = pBucket.vReadIndices.size();
+        if (nCount == 0)
+            continue;
+
+        for (size_t i = 0; i < nCount; ++i)
+            pBucket.vValues[i] = g_MemManager.ReadFrameValue(pBucket.vReadIndices[i]);
+
+        CompareLanes(m_nInstructionSet, static_cast<ComparisonType>(nCompareType),
+            pBucket.vValues.data(), pBucket.vConstants.data(), pBucket.vResults.data(), nCount);
+
+        for (size_t i = 0; i < nCount; ++i)
+            m_vResults[pBucket.vLanes[i]] = pBucket.vResults[i];
+    }
+
+    m_nEvaluatedFrame = g_MemManager.FrameNumber();
+    m_bNeedsEvaluate = false;
+}
+
+ConditionBatch::InstructionSet ConditionBatch::DetectInstructionSet()
+{
+#ifdef RA_BATCH_X86
+#ifdef _MSC_VER
+    int nInfo[4];
+    __cpuid(nInfo, 0);
+    const int nMaxId = nInfo[0];
+
+    __cpuid(nInfo, 1);
+    const bool bSSE2 = (nInfo[3] & (1 << 26)) != 0;
+    const bool bOSXSave = (nInfo[2] & (1 << 27)) != 0;
+    const bool bAVX = (nInfo[2] & (1 << 28)) != 0;
+
+    if (nMaxId >= 7 && bOSXSave && bAVX)
+    {
+        // the OS must also preserve the YMM registers
+        if ((_xgetbv(0) & 0x06) == 0x06)
+        {
+            __cpuidex(nInfo, 7, 0);
+            if (nInfo[1] & (1 << 5))
+                return InstructionSet::AVX2;
+        }
+    }
+
+    if (bSSE2)
+        return InstructionSet::SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return InstructionSet::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return InstructionSet::SSE2;
+#endif
+#endif
+
+    return InstructionSet::Scalar;
+}
+
+static void CompareLanesScalar(ComparisonType nCompareType, const unsigned int* nValues, const unsigned int* nConstants,
+    unsigned char* nResults, size_t nStart, size_t nCount)
+{
+    for (size_t i = nStart; i < nCount; ++i)
+    {
+        const unsigned int nLeft = nValues[i];
+        const unsigned int nRight = nConstants[i];
+
+        bool bResult;
+        switch (nCompareType)
+        {
+            case Equals:                bResult = (nLeft == nRight); break;
+            case LessThan:              bResult = (nLeft < nRight); break;
+            case LessThanOrEqual:       bResult = (nLeft <= nRight); break;
+            case GreaterThan:           bResult = (nLeft > nRight); break;
+            case GreaterThanOrEqual:    bResult = (nLeft >= nRight); break;
+            case NotEqualTo:            bResult = (nLeft != nRight); break;
+            default:                    bResult = true; break;
+        }
+
+        nResults[i] = bResult ? 1 : 0;
+    }
+}
+
+#ifdef RA_BATCH_X86
+
+// there are no unsigned 32-bit compares before AVX-512. flipping the sign bit of both sides maps the
+// unsigned ordering onto the signed ordering.
+static size_t CompareLanesSSE2(ComparisonType nCompareType, const unsigned int* nValues, const unsigned int* nConstants,
+    unsigned char* nResults, size_t nCount)
+{
+    const __m128i nBias = _mm_set1_epi32(static_cast<int>(0x80000000));
+    const int nInvert = (nCompareType == NotEqualTo || nCompareType == LessThanOrEqual || nCompareType == GreaterThanOrEqual) ? 0x0F : 0;
+
+    size_t i = 0;
+    for (; i + 4 <= nCount; i += 4)
+    {
+        const __m128i nLeft = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nValues + i)), nBias);
+        const __m128i nRight = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nConstants + i)), nBias);
+
+        __m128i nMask;
+        switch (nCompareType)
+        {
+            case Equals:
+            case NotEqualTo:
+                nMask = _mm_cmpeq_epi32(nLeft, nRight);
+                break;
+            case LessThan:
+            case GreaterThanOrEqual:
+                nMask = _mm_cmpgt_epi32(nRight, nLeft);
+                break;
+            default: // GreaterThan, LessThanOrEqual
+                nMask = _mm_cmpgt_epi32(nLeft, nRight);
+                break;
+        }
+
+        const int nBits = _mm_movemask_ps(_mm_castsi128_ps(nMask)) ^ nInvert;
+        nResults[i] = nBits & 1;
+        nResults[i + 1] = (nBits >> 1) & 1;
+        nResults[i + 2] = (nBits >> 2) & 1;
+        nResults[i + 3] = (nBits >> 3) & 1;
+    }
+
+    return i;
+}
+
+RA_TARGET_AVX2 static size_t CompareLanesAVX2(ComparisonType nCompareType, const unsigned int* nValues, const unsigned int* nConstants,
+    unsigned char* nResults, size_t nCount)
+{
+    const __m256i nBias = _mm256_set1_epi32(static_cast<int>(0x80000000));
+    const int nInvert = (nCompareType == NotEqualTo || nCompareType == LessThanOrEqual || nCompareType == GreaterThanOrEqual) ? 0xFF : 0;
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        const __m256i nLeft = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(nValues + i)), nBias);
+        const __m256i nRight = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(nConstants + i)), nBias);
+
+        __m256i nMask;
+        switch (nCompareType)
+        {
+            case Equals:
+            case NotEqualTo:
+                nMask = _mm256_cmpeq_epi32(nLeft, nRight);
+                break;
+            case LessThan:
+            case GreaterThanOrEqual:
+                nMask = _mm256_cmpgt_epi32(nRight, nLeft);
+                break;
+            default: // GreaterThan, LessThanOrEqual
+                nMask = _mm256_cmpgt_epi32(nLeft, nRight);
+                break;
+        }
+
+        const int nBits = _mm256_movemask_ps(_mm256_castsi256_ps(nMask)) ^ nInvert;
+        for (int j = 0; j < 8; ++j)
+            nResults[i + j] = (nBits >> j) & 1;
+    }
+
+    return i;
+}
+
+#endif // RA_BATCH_X86
+
+void ConditionBatch::CompareLanes(InstructionSet nInstructionSet, ComparisonType nCompareType,
+    const unsigned int* nValues, const unsigned int* nConstants, unsigned char* nResults, size_t nCount)
+{
+    size_t nProcessed = 0;
+
+    if (nCompareType < NumComparisonTypes)
+    {
+#ifdef RA_BATCH_X86
+        switch (nInstructionSet)
+        {
+            case InstructionSet::AVX2:
+                nProcessed = CompareLanesAVX2(nCompareType, nValues, nConstants, nResults, nCount);
+                break;
+            case InstructionSet::SSE2:
+                nProcessed = CompareLanesSSE2(nCompareType, nValues, nConstants, nResults, nCount);
+                break;
+            default:
+                break;
+        }
+#else
+        (void)nInstructionSet;
+#endif
+    }
+
+    // anything that didn't fill a vector
+    CompareLanesScalar(nCompareType, nValues, nConstants, nResults, nProcessed, nCount);
+}
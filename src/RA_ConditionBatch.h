@@ -0,0 +1,102 @@
+#ifndef RA_CONDITIONBATCH_H
+#define RA_CONDITIONBATCH_H
+#pragma once
+
+#include "RA_Condition.h" // ComparisonType
+#include "RA_MemManager.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+// Evaluates the simple comparisons (a memory value compared to a constant) of every compiled ConditionSet
+// at once. The comparisons are stored as structure-of-arrays lanes, bucketed by operator, and compared with
+// SIMD instructions when the CPU supports them. Lanes are identified by their (read plan index, operator,
+// constant) so identical comparisons from multiple achievements share a lane.
+class ConditionBatch
+{
+public:
+    ConditionBatch() = default;
+    ~ConditionBatch();
+    ConditionBatch(const ConditionBatch&) = delete;
+    ConditionBatch& operator=(const ConditionBatch&) = delete;
+
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    //	Returns the lane index for the comparison and adds a reference to it. Lane indices are valid until the
+    //	read plan generation changes or the reference is released.
+    unsigned int AddLane(unsigned int nReadIndex, ComparisonType nCompareType, unsigned int nConstant);
+
+    //	Releases a reference returned by AddLane. May be called from any thread - the release is applied before
+    //	the next lane is added or the batch is evaluated. nGeneration is the read plan generation the lane was
+    //	added in.
+    void ReleaseLane(unsigned int nLane, unsigned int nGeneration);
+
+    //	Returns the result of the comparison for the current MemManager frame, evaluating the batch if necessary.
+    //	Only valid on the frame thread.
+    bool GetResult(unsigned int nLane)
+    {
+        if (m_bNeedsEvaluate || m_nEvaluatedFrame != g_MemManager.FrameNumber())
+            Evaluate();
+
+        return m_vResults[nLane] != 0;
+    }
+
+    //	Reads the current values from the read plan and evaluates all lanes.
+    void Evaluate();
+
+    void Clear();
+    size_t NumLanes() const { return m_vLanes.size() - m_vFreeLanes.size(); }
+
+    static InstructionSet DetectInstructionSet();
+    InstructionSet GetInstructionSet() const { return m_nInstructionSet; }
+    void SetInstructionSet(InstructionSet nInstructionSet) { m_nInstructionSet = nInstructionSet; }
+
+    //	Compares each nValues[i] to nConstants[i] and writes 0 or 1 to nResults[i].
+    static void CompareLanes(InstructionSet nInstructionSet, ComparisonType nCompareType,
+        const unsigned int* nValues, const unsigned int* nConstants, unsigned char* nResults, size_t nCount);
+
+private:
+    struct Bucket
+    {
+        std::vector<unsigned int> vReadIndices;
+        std::vector<unsigned int> vValues;
+        std::vector<unsigned int> vConstants;
+        std::vector<unsigned char> vResults;
+        std::vector<unsigned int> vLanes;       //	lane index for each entry
+    };
+
+    struct Lane
+    {
+        unsigned long long nKey;                //	key in m_mLaneIndices[nCompareType]
+        unsigned int nReferences;
+        unsigned int nPosition;                 //	index of the lane's entry in its bucket
+        ComparisonType nCompareType;
+    };
+
+    void ApplyReleases();
+    void RemoveLane(unsigned int nLane);
+
+    Bucket m_vBuckets[NumComparisonTypes];
+    std::vector<Lane> m_vLanes;
+    std::vector<unsigned int> m_vFreeLanes;     //	removed lanes available for reuse
+    std::vector<unsigned char> m_vResults;      //	result for each lane
+    std::unordered_map<unsigned long long, unsigned int> m_mLaneIndices[NumComparisonTypes];
+
+    std::mutex m_mtxReleases;
+    std::vector<std::pair<unsigned int, unsigned int>> m_vReleases; //	lane, generation
+
+    std::atomic<unsigned int> m_nReadPlanGeneration{ 0 };
+    unsigned int m_nEvaluatedFrame = 0;
+    bool m_bNeedsEvaluate = false;
+    InstructionSet m_nInstructionSet = DetectInstructionSet();
+};
+
+extern ConditionBatch g_ConditionBatch;
+
+#endif // !RA_CONDITIONBATCH_H
@@ -12,6 +12,7 @@
 #include "RA_Interface.h"
 #include "RA_md5factory.h"
 #include "RA_MemManager.h"
+#include "RA_MemValue.h"
 #include "RA_PopupWindows.h"
 #include "RA_Resource.h"
 #include "RA_RichPresence.h"
@@ -30,6 +31,8 @@
 #include "RA_Dlg_RomChecksum.h"
 #include "RA_Dlg_MemBookmark.h"
 
+#include "services\FrameProfiler.h"
+#include "services\SearchSampler.h"
 #include "services\IConfiguration.hh"
 #include "services\ILeaderboardManager.hh"
 #include "services\Initialization.hh"
@@ -278,6 +281,7 @@ API int CCONV _RA_Shutdown()
     SAFE_DELETE(g_pLocalAchievements);
 
     RAWeb::RA_KillHTTPThreads();
+    g_SearchSampler.Stop();
 
     if (g_AchievementsDialog.GetHWND() != nullptr)
     {
@@ -540,6 +544,12 @@ API void CCONV _RA_InstallMemoryBank(int nBankID, void* pReader, void* pWriter,
     g_MemoryDialog.AddBank(nBankID);
 }
 
+API void CCONV _RA_InstallMemoryBankBlock(int nBankID, void* pData, int nBankSize)
+{
+    g_MemManager.AddMemoryBankBlock(static_cast<size_t>(nBankID), static_cast<unsigned char*>(pData), static_cast<size_t>(nBankSize));
+    g_MemoryDialog.AddBank(nBankID);
+}
+
 API void CCONV _RA_ClearMemoryBanks()
 {
     g_MemManager.ClearMemoryBanks();
@@ -1222,7 +1232,7 @@ API void CCONV _RA_InvokeDialog(LPARAM nID)
 
             std::string sRichPresence;
             bool bRichPresenceExists = _ReadBufferFromFile(sRichPresence, sRichPresenceFile.c_str());
-            g_RichPresenceInterpreter.ParseFromString(sRichPresence.c_str());
+            g_RichPresenceInterpreter.ParseFromString(sRichPresence);
 
             if (g_RichPresenceDialog.GetHWND() == nullptr)
                 g_RichPresenceDialog.InstallHWND(CreateDialog(g_hThisDLLInst, MAKEINTRESOURCE(IDD_RA_RICHPRESENCE), g_RAMainWnd, &Dlg_RichPresence::s_RichPresenceDialogProc));
@@ -1342,14 +1352,40 @@ API void CCONV _RA_DoAchievementsFrame()
 {
     if (RAUsers::LocalUser().IsLoggedIn())
     {
+        const auto& pConfiguration = ra::services::ServiceLocator::Get<ra::services::IConfiguration>();
+        g_FrameProfiler.SetEnabled(pConfiguration.IsFeatureEnabled(ra::services::Feature::FrameProfiler));
+        RA_PROFILE_FRAME();
+
+        // leaderboard values and rich presence macros with the same clauses are evaluated once per frame
+        MemValue::AdvanceFrame(pConfiguration.IsFeatureEnabled(ra::services::Feature::ValueCache));
+
         if (g_nProcessTimer >= PROCESS_WAIT_TIME)
         {
-            g_pActiveAchievements->Test();
-            ra::services::ServiceLocator::GetMutable<ra::services::ILeaderboardManager>().Test();
+            // each address used by the achievements and leaderboards is read at most once per frame. if
+            // the snapshot is enabled, they're all captured up front into a single buffer.
+            const bool bFrameSnapshot = pConfiguration.IsFeatureEnabled(ra::services::Feature::FrameSnapshot);
+            ConditionProgram::SetIncrementalEvaluation(pConfiguration.IsFeatureEnabled(ra::services::Feature::IncrementalEvaluation));
+            ConditionProgram::SetBatchEvaluation(pConfiguration.IsFeatureEnabled(ra::services::Feature::BatchEvaluation));
+            g_MemManager.BeginFrame(bFrameSnapshot);
+
+            {
+                RA_PROFILE_SECTION(AchievementSet);
+                g_pActiveAchievements->Test();
+            }
+            {
+                RA_PROFILE_SECTION(LeaderboardManager);
+                ra::services::ServiceLocator::GetMutable<ra::services::ILeaderboardManager>().Test();
+            }
+
+            g_MemManager.EndFrame();
         }
         else
             g_nProcessTimer++;
 
+        // does nothing unless a background search is running
+        g_SearchSampler.Sample();
+
+        RA_PROFILE_SECTION(MemoryDialog);
         g_MemoryDialog.Invalidate();
     }
 }
@@ -46,6 +46,10 @@ extern "C" {
     //pWriter is typedef void (_RAMByteWriteFn)( unsigned int nOffs, unsigned int nVal );
     API void CCONV _RA_InstallMemoryBank(int nBankID, void* pReader, void* pWriter, int nBankSize);
 
+    //	Alternative to _RA_InstallMemoryBank for banks that are a contiguous block of host memory.
+    //	pData must remain valid until _RA_ClearMemoryBanks is called.
+    API void CCONV _RA_InstallMemoryBankBlock(int nBankID, void* pData, int nBankSize);
+
     //	Call before installing any memory banks
     API void CCONV _RA_ClearMemoryBanks();
 
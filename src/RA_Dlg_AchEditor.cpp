@@ -1,6 +1,7 @@
 #include "RA_Dlg_AchEditor.h"
 
 #include <Commdlg.h>
+#include <utility>
 #include "RA_AchievementSet.h"
 #include "RA_Resource.h"
 #include "RA_Core.h"
@@ -573,7 +574,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
             if (nSubItem == CSI_TYPE_TGT)
             {
                 const size_t nGrp = g_AchievementEditorDialog.GetSelectedConditionGroup();
-                const Condition& Cond = g_AchievementEditorDialog.ActiveAchievement()->GetCondition(nGrp, nItem);
+                const Condition& Cond = std::as_const(*g_AchievementEditorDialog.ActiveAchievement()).GetCondition(nGrp, nItem);
 
                 if (Cond.IsAddCondition() || Cond.IsSubCondition())
                     break;
@@ -646,7 +647,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
             if (nSubItem == CSI_SIZE_TGT)
             {
                 const size_t nGrp = g_AchievementEditorDialog.GetSelectedConditionGroup();
-                const Condition& Cond = g_AchievementEditorDialog.ActiveAchievement()->GetCondition(nGrp, nItem);
+                const Condition& Cond = std::as_const(*g_AchievementEditorDialog.ActiveAchievement()).GetCondition(nGrp, nItem);
 
                 if (Cond.IsAddCondition() || Cond.IsSubCondition())
                     break;
@@ -657,7 +658,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
                 TEXT("ComboBox"),
                 TEXT(""),
                 WS_CHILD | WS_VISIBLE | WS_POPUPWINDOW | WS_BORDER | CBS_DROPDOWNLIST,
-                rcSubItem.left, rcSubItem.top, nWidth, (int)(1.6f * nHeight * NumComparisonVariableSizeTypes),
+                rcSubItem.left, rcSubItem.top, nWidth, (int)(1.6f * nHeight * ComparisonVariableSize::Float),
                 g_AchievementEditorDialog.GetHWND(),
                 0,
                 GetModuleHandle(nullptr),
@@ -670,7 +671,8 @@ BOOL CreateIPE(int nItem, int nSubItem)
                 break;
             };
 
-            for (size_t i = 0; i < NumComparisonVariableSizeTypes; ++i)
+            //	conditions can't use Float. it's the last size, so the list indices still match the sizes.
+            for (size_t i = 0; i < ComparisonVariableSize::Float; ++i)
             {
                 ComboBox_AddString(g_hIPEEdit, NativeStr(COMPARISONVARIABLESIZE_STR[i]).c_str());
 
@@ -692,7 +694,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
                 break;
 
             const size_t nGrp = g_AchievementEditorDialog.GetSelectedConditionGroup();
-            const Condition& Cond = g_AchievementEditorDialog.ActiveAchievement()->GetCondition(nGrp, nItem);
+            const Condition& Cond = std::as_const(*g_AchievementEditorDialog.ActiveAchievement()).GetCondition(nGrp, nItem);
             if (Cond.IsAddCondition() || Cond.IsSubCondition())
                 break;
 
@@ -739,7 +741,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
             if (nSubItem != CSI_VALUE_SRC)
             {
                 const size_t nGrp = g_AchievementEditorDialog.GetSelectedConditionGroup();
-                const Condition& Cond = g_AchievementEditorDialog.ActiveAchievement()->GetCondition(nGrp, nItem);
+                const Condition& Cond = std::as_const(*g_AchievementEditorDialog.ActiveAchievement()).GetCondition(nGrp, nItem);
 
                 if (Cond.IsAddCondition() || Cond.IsSubCondition())
                     break;
@@ -774,7 +776,7 @@ BOOL CreateIPE(int nItem, int nSubItem)
                 if (g_AchievementEditorDialog.ActiveAchievement() != nullptr)
                 {
                     const size_t nGrp = g_AchievementEditorDialog.GetSelectedConditionGroup();
-                    const Condition& Cond = g_AchievementEditorDialog.ActiveAchievement()->GetCondition(nGrp, nItem);
+                    const Condition& Cond = std::as_const(*g_AchievementEditorDialog.ActiveAchievement()).GetCondition(nGrp, nItem);
 
                     char buffer[256];
                     sprintf_s(buffer, 256, "%u", Cond.RequiredHits());
@@ -1201,7 +1203,7 @@ INT_PTR Dlg_AchievementEditor::AchievementEditorProc(HWND hDlg, UINT uMsg, WPARA
 
                             for (int i = ListView_GetNextItem(hList, -1, LVNI_SELECTED); i >= 0; i = ListView_GetNextItem(hList, i, LVNI_SELECTED))
                             {
-                                const Condition& CondToCopy = pActiveAch->GetCondition(GetSelectedConditionGroup(), static_cast<size_t>(i));
+                                const Condition& CondToCopy = std::as_const(*pActiveAch).GetCondition(GetSelectedConditionGroup(), static_cast<size_t>(i));
 
                                 Condition NewCondition(CondToCopy);
 
@@ -1306,7 +1308,7 @@ INT_PTR Dlg_AchievementEditor::AchievementEditorProc(HWND hDlg, UINT uMsg, WPARA
                                 // as we remove items, the index within the achievement changes, but not in the UI until we refresh
                                 size_t nUpdatedIndex = static_cast<size_t>(i) - conditionsToMove.size();
 
-                                const Condition& CondToMove = pActiveAch->GetCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
+                                const Condition& CondToMove = std::as_const(*pActiveAch).GetCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
                                 conditionsToMove.push_back(std::move(CondToMove));
                                 pActiveAch->RemoveCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
                             }
@@ -1360,7 +1362,7 @@ INT_PTR Dlg_AchievementEditor::AchievementEditorProc(HWND hDlg, UINT uMsg, WPARA
                                 // as we remove items, the index within the achievement changes, but not in the UI until we refresh
                                 size_t nUpdatedIndex = static_cast<size_t>(i) - conditionsToMove.size();
 
-                                const Condition& CondToMove = pActiveAch->GetCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
+                                const Condition& CondToMove = std::as_const(*pActiveAch).GetCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
                                 conditionsToMove.push_back(std::move(CondToMove));
                                 pActiveAch->RemoveCondition(nSelectedConditionGroup, static_cast<size_t>(nUpdatedIndex));
 
@@ -1602,7 +1604,7 @@ INT_PTR Dlg_AchievementEditor::AchievementEditorProc(HWND hDlg, UINT uMsg, WPARA
                         if (static_cast<size_t>(pOnClick->iItem) > ActiveAchievement()->NumConditions(GetSelectedConditionGroup()))
                             return 0;
 
-                        Condition& rCond = ActiveAchievement()->GetCondition(GetSelectedConditionGroup(), pOnClick->iItem);
+                        const Condition& rCond = std::as_const(*ActiveAchievement()).GetCondition(GetSelectedConditionGroup(), pOnClick->iItem);
 
                         //HWND hMem = GetDlgItem( HWndMemoryDlg, IDC_RA_WATCHING );
                         if (pOnClick->iSubItem == CSI_VALUE_SRC)
@@ -1849,7 +1851,7 @@ void Dlg_AchievementEditor::GetListViewTooltip()
 
     m_nTooltipLocation = lvHitTestInfo.iItem * 256 + lvHitTestInfo.iSubItem;
 
-    Condition& rCond = pActiveAch->GetCondition(GetSelectedConditionGroup(), lvHitTestInfo.iItem);
+    const Condition& rCond = std::as_const(*pActiveAch).GetCondition(GetSelectedConditionGroup(), lvHitTestInfo.iItem);
     unsigned int nAddr = 0;
     switch (lvHitTestInfo.iSubItem)
     {
@@ -1969,7 +1971,7 @@ void Dlg_AchievementEditor::PopulateConditions(Achievement* pCheevo)
     {
         unsigned int nGrp = GetSelectedConditionGroup();
         for (size_t i = 0; i < m_pSelectedAchievement->NumConditions(nGrp); ++i)
-            AddCondition(hCondList, m_pSelectedAchievement->GetCondition(nGrp, i));
+            AddCondition(hCondList, std::as_const(*m_pSelectedAchievement).GetCondition(nGrp, i));
     }
 }
 
@@ -2105,7 +2107,7 @@ void Dlg_AchievementEditor::LoadAchievement(Achievement* pCheevo, _UNUSED BOOL)
 
                     for (size_t i = 0; i < m_pSelectedAchievement->NumConditions(nGrp); ++i)
                     {
-                        const Condition& Cond = m_pSelectedAchievement->GetCondition(nGrp, i);
+                        const Condition& Cond = std::as_const(*m_pSelectedAchievement).GetCondition(nGrp, i);
                         item.iItem = i;
                         UpdateCondition(hCondList, item, Cond);
                     }
@@ -8,6 +8,9 @@
 #include "RA_User.h"
 #include "RA_Dlg_MemBookmark.h"
 
+#include "services\IConfiguration.hh"
+#include "services\ServiceLocator.hh"
+
 #ifdef WIN32_LEAN_AND_MEAN
 #include <ShellAPI.h>
 #endif // WIN32_LEAN_AND_MEAN
@@ -1057,6 +1060,9 @@ INT_PTR Dlg_Memory::MemoryProc(HWND hDlg, UINT nMsg, WPARAM wParam, LPARAM lPara
                     SearchResult& sr = m_SearchResults.back();
                     sr.m_nCompareType = nCmpType;
 
+                    const auto& pConfiguration = ra::services::ServiceLocator::Get<ra::services::IConfiguration>();
+                    ra::services::SearchResults::SetThreadCount(pConfiguration.GetNumBackgroundThreads());
+
                     if (IsDlgButtonChecked(hDlg, IDC_RA_CBO_GIVENVAL) == BST_UNCHECKED)
                     {
                         sr.m_results.Initialize(srPrevious.m_results, nCmpType);
@@ -1083,6 +1089,9 @@ INT_PTR Dlg_Memory::MemoryProc(HWND hDlg, UINT nMsg, WPARAM wParam, LPARAM lPara
                     }
 
                     unsigned int nMatches = sr.m_results.MatchingAddressCount();
+                    RA_LOG("Search page %u: %u matches, %u bytes retained\n", m_nPage, nMatches,
+                        static_cast<unsigned int>(sr.m_results.RetainedBytes()));
+
                     if (nMatches == srPrevious.m_results.MatchingAddressCount())
                     {
                         // same number of matches, if the same query was used, don't double up on the search results
@@ -16,13 +16,19 @@ INT_PTR CALLBACK Dlg_RichPresence::RichPresenceDialogProc(HWND hDlg, UINT nMsg,
             SendMessage(GetDlgItem(hDlg, IDC_RA_RICHPRESENCERESULTTEXT), WM_SETFONT, (WPARAM)m_hFont, LPARAM{});
 
             RestoreWindowPosition(hDlg, "Rich Presence Monitor", true, true);
+            m_bRedraw = true;
             return TRUE;
         }
 
         case WM_TIMER:
         {
-            std::wstring sRP = ra::Widen(g_RichPresenceInterpreter.GetRichPresenceString());
-            SetDlgItemTextW(m_hRichPresenceDialog, IDC_RA_RICHPRESENCERESULTTEXT, sRP.c_str());
+            // only redraw when the string changes
+            if (g_RichPresenceInterpreter.GetRichPresenceString(m_sRichPresence) || m_bRedraw)
+            {
+                std::wstring sRP = ra::Widen(m_sRichPresence);
+                SetDlgItemTextW(m_hRichPresenceDialog, IDC_RA_RICHPRESENCERESULTTEXT, sRP.c_str());
+                m_bRedraw = false;
+            }
             return TRUE;
         }
 
@@ -104,6 +110,7 @@ void Dlg_RichPresence::StartMonitoring()
 void Dlg_RichPresence::ClearMessage()
 {
     StopTimer();
+    m_bRedraw = true;
 
     if (g_pCurrentGameData->GetGameID() == 0)
         SetDlgItemTextW(m_hRichPresenceDialog, IDC_RA_RICHPRESENCERESULTTEXT, L"No game loaded");
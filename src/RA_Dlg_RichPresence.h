@@ -6,6 +6,8 @@ struct IUnknown;
 #define NOMINMAX
 #include <WTypes.h>
 
+#include <string>
+
 class Dlg_RichPresence
 {
 public:
@@ -30,6 +32,9 @@ private:
     HFONT m_hFont;
     HWND m_hRichPresenceDialog;
     bool m_bTimerActive;
+
+    std::string m_sRichPresence;    // what was last displayed
+    bool m_bRedraw = true;          // the text has been replaced by something other than m_sRichPresence
 };
 
 extern Dlg_RichPresence g_RichPresenceDialog;
@@ -77,6 +77,7 @@ int		(CCONV *_RA_Shutdown)() = nullptr;
 bool    (CCONV *_RA_ConfirmLoadNewRom)(bool bQuitting) = nullptr;
 int     (CCONV *_RA_OnLoadNewRom)(const BYTE* pROM, unsigned int nROMSize) = nullptr;
 void    (CCONV *_RA_InstallMemoryBank)(int nBankID, void* pReader, void* pWriter, int nBankSize) = nullptr;
+void    (CCONV *_RA_InstallMemoryBankBlock)(int nBankID, void* pData, int nBankSize) = nullptr;
 void    (CCONV *_RA_ClearMemoryBanks)() = nullptr;
 void    (CCONV *_RA_OnLoadState)(const char* sFilename) = nullptr;
 void    (CCONV *_RA_OnSaveState)(const char* sFilename) = nullptr;
@@ -154,6 +155,15 @@ void RA_InstallMemoryBank(int nBankID, void* pReader, void* pWriter, int nBankSi
         _RA_InstallMemoryBank(nBankID, pReader, pWriter, nBankSize);
 }
 
+bool RA_InstallMemoryBankBlock(int nBankID, void* pData, int nBankSize)
+{
+    if (_RA_InstallMemoryBankBlock == nullptr)
+        return false;
+
+    _RA_InstallMemoryBankBlock(nBankID, pData, nBankSize);
+    return true;
+}
+
 HMENU RA_CreatePopupMenu()
 {
     return (_RA_CreatePopupMenu != nullptr) ? _RA_CreatePopupMenu() : nullptr;
@@ -459,6 +469,7 @@ static const char* CCONV _RA_InstallIntegration()
     _RA_RenderPopups = (void(CCONV *)(HDC, RECT*))                                    GetProcAddress(g_hRADLL, "_RA_RenderPopups");
     _RA_OnLoadNewRom = (int(CCONV *)(const BYTE*, unsigned int))                      GetProcAddress(g_hRADLL, "_RA_OnLoadNewRom");
     _RA_InstallMemoryBank = (void(CCONV *)(int, void*, void*, int))                   GetProcAddress(g_hRADLL, "_RA_InstallMemoryBank");
+    _RA_InstallMemoryBankBlock = (void(CCONV *)(int, void*, int))                     GetProcAddress(g_hRADLL, "_RA_InstallMemoryBankBlock");
     _RA_ClearMemoryBanks = (void(CCONV *)())                                          GetProcAddress(g_hRADLL, "_RA_ClearMemoryBanks");
     _RA_UpdateAppTitle = (void(CCONV *)(const char*))                                 GetProcAddress(g_hRADLL, "_RA_UpdateAppTitle");
     _RA_HandleHTTPResults = (void(CCONV *)())                                         GetProcAddress(g_hRADLL, "_RA_HandleHTTPResults");
@@ -631,6 +642,7 @@ void RA_Shutdown()
     _RA_RenderPopups = nullptr;
     _RA_OnLoadNewRom = nullptr;
     _RA_InstallMemoryBank = nullptr;
+    _RA_InstallMemoryBankBlock = nullptr;
     _RA_ClearMemoryBanks = nullptr;
     _RA_UpdateAppTitle = nullptr;
     _RA_HandleHTTPResults = nullptr;
@@ -165,6 +165,11 @@ extern void RA_ClearMemoryBanks();
 //pWriter is typedef void (_RAMByteWriteFn)( unsigned int nOffs, unsigned int nVal );
 extern void RA_InstallMemoryBank(int nBankID, void* pReader, void* pWriter, int nBankSize);
 
+//	Call instead of RA_InstallMemoryBank when the bank is a contiguous block of memory. pData must remain
+//	valid until RA_ClearMemoryBanks is called. Returns false if the DLL doesn't support it, in which case
+//	RA_InstallMemoryBank should be used.
+extern bool RA_InstallMemoryBankBlock(int nBankID, void* pData, int nBankSize);
+
 //	Call this before loading a new ROM or quitting, to ensure no developer changes are lost.
 extern bool RA_ConfirmLoadNewRom(bool bIsQuitting);
 
@@ -1,5 +1,7 @@
 #include "RA_MemManager.h"
 
+#include <algorithm>
+
 MemManager g_MemManager;
 
 MemManager::MemManager()
@@ -17,21 +19,105 @@ void MemManager::ClearMemoryBanks()
 {
     m_Banks.clear();
     m_nTotalBankSize = 0;
+    m_vBankTable.clear();
+    m_vPageBanks.clear();
+
+    ClearFrameSnapshot();
+    ClearReadPlan();
 }
 
 void MemManager::AddMemoryBank(size_t nBankID, _RAMByteReadFn* pReader, _RAMByteWriteFn* pWriter, size_t nBankSize)
+{
+    BankData* pBank = AddBank(nBankID, nBankSize);
+    if (pBank != nullptr)
+    {
+        pBank->Reader = pReader;
+        pBank->Writer = pWriter;
+        RebuildBankTable();
+    }
+}
+
+void MemManager::AddMemoryBankBlock(size_t nBankID, unsigned char* pData, size_t nBankSize)
+{
+    BankData* pBank = AddBank(nBankID, nBankSize);
+    if (pBank != nullptr)
+    {
+        pBank->Data = pData;
+        RebuildBankTable();
+    }
+}
+
+MemManager::BankData* MemManager::AddBank(size_t nBankID, size_t nBankSize)
 {
     if (m_Banks.find(nBankID) != m_Banks.end())
     {
         ASSERT(!"Failed! Bank already added! Did you remove the existing bank?");
-        return;
+        return nullptr;
     }
 
     m_nTotalBankSize += nBankSize;
 
-    m_Banks[nBankID].BankSize = nBankSize;
-    m_Banks[nBankID].Reader = pReader;
-    m_Banks[nBankID].Writer = pWriter;
+    BankData* pBank = &m_Banks[nBankID];
+    pBank->BankSize = nBankSize;
+
+    ClearFrameSnapshot();
+    return pBank;
+}
+
+void MemManager::RebuildBankTable()
+{
+    // banks are laid out in ID order, stopping at the first missing ID
+    m_vBankTable.clear();
+    ra::ByteAddress nStart = 0;
+    for (size_t nBankID = 0; ; ++nBankID)
+    {
+        const auto iter = m_Banks.find(nBankID);
+        if (iter == m_Banks.end())
+            break;
+
+        const BankData& bank = iter->second;
+        m_vBankTable.push_back({ nStart, bank.BankSize, bank.Reader, bank.Writer, bank.Data });
+        nStart += bank.BankSize;
+    }
+
+    const size_t nPageSize = (size_t)1 << PAGE_SHIFT;
+    const size_t nPages = (nStart + nPageSize - 1) >> PAGE_SHIFT;
+    m_vPageBanks.assign(nPages, PAGE_SPANS_BANKS);
+    if (m_vBankTable.size() >= PAGE_SPANS_BANKS)
+        return;
+
+    for (size_t nIndex = 0; nIndex < m_vBankTable.size(); ++nIndex)
+    {
+        const BankEntry& pEntry = m_vBankTable[nIndex];
+        const size_t nEnd = pEntry.nStart + pEntry.nSize;
+
+        // only pages that lie entirely within the bank
+        for (size_t nPage = (pEntry.nStart + nPageSize - 1) >> PAGE_SHIFT; ((nPage + 1) << PAGE_SHIFT) <= nEnd; ++nPage)
+            m_vPageBanks[nPage] = static_cast<unsigned short>(nIndex);
+    }
+}
+
+const MemManager::BankEntry* MemManager::FindBank(ra::ByteAddress nOffs) const
+{
+    const size_t nPage = nOffs >> PAGE_SHIFT;
+    if (nPage >= m_vPageBanks.size())
+        return nullptr;
+
+    const unsigned short nIndex = m_vPageBanks[nPage];
+    if (nIndex != PAGE_SPANS_BANKS)
+        return &m_vBankTable[nIndex];
+
+    // find the last bank starting at or before the address
+    auto iter = std::upper_bound(m_vBankTable.begin(), m_vBankTable.end(), nOffs,
+        [](ra::ByteAddress nAddress, const BankEntry& pEntry) { return nAddress < pEntry.nStart; });
+    if (iter == m_vBankTable.begin())
+        return nullptr;
+
+    --iter;
+    if (nOffs - iter->nStart >= iter->nSize)
+        return nullptr;
+
+    return &(*iter);
 }
 
 void MemManager::ChangeActiveMemBank(_UNUSED unsigned short)
@@ -69,120 +155,461 @@ std::vector<size_t> MemManager::GetBankIDs() const
 unsigned int MemManager::ActiveBankRAMRead(ra::ByteAddress nOffs, ComparisonVariableSize size) const
 {
     unsigned char buffer[4];
+    const size_t nBytes = BytesForSize(size);
+    const unsigned char* pBytes = GetSnapshotBytes(nOffs, nBytes);
+    if (pBytes == nullptr)
+    {
+        if (nBytes == 1)
+        {
+            buffer[0] = ReadByte(nOffs);
+            pBytes = buffer;
+        }
+        else
+        {
+            pBytes = GetBankData(nOffs, nBytes);
+            if (pBytes == nullptr)
+            {
+                ActiveBankRAMRead(buffer, nOffs, nBytes);
+                pBytes = buffer;
+            }
+        }
+    }
+
     switch (size)
     {
         case Bit_0:
-            return (ActiveBankRAMByteRead(nOffs) & 0x01);
+            return (pBytes[0] & 0x01);
         case Bit_1:
-            return (ActiveBankRAMByteRead(nOffs) & 0x02) ? 1 : 0;
+            return (pBytes[0] & 0x02) ? 1 : 0;
         case Bit_2:
-            return (ActiveBankRAMByteRead(nOffs) & 0x04) ? 1 : 0;
+            return (pBytes[0] & 0x04) ? 1 : 0;
         case Bit_3:
-            return (ActiveBankRAMByteRead(nOffs) & 0x08) ? 1 : 0;
+            return (pBytes[0] & 0x08) ? 1 : 0;
         case Bit_4:
-            return (ActiveBankRAMByteRead(nOffs) & 0x10) ? 1 : 0;
+            return (pBytes[0] & 0x10) ? 1 : 0;
         case Bit_5:
-            return (ActiveBankRAMByteRead(nOffs) & 0x20) ? 1 : 0;
+            return (pBytes[0] & 0x20) ? 1 : 0;
         case Bit_6:
-            return (ActiveBankRAMByteRead(nOffs) & 0x40) ? 1 : 0;
+            return (pBytes[0] & 0x40) ? 1 : 0;
         case Bit_7:
-            return (ActiveBankRAMByteRead(nOffs) & 0x80) ? 1 : 0;
+            return (pBytes[0] & 0x80) ? 1 : 0;
         case Nibble_Lower:
-            return (ActiveBankRAMByteRead(nOffs) & 0x0F);
+            return (pBytes[0] & 0x0F);
         case Nibble_Upper:
-            return ((ActiveBankRAMByteRead(nOffs) >> 4) & 0x0F);
+            return ((pBytes[0] >> 4) & 0x0F);
         case EightBit:
-            return ActiveBankRAMByteRead(nOffs);
+            return pBytes[0];
+        // memory is little-endian, as is the host - these become single (unaligned) loads
         default:
         case SixteenBit:
-            ActiveBankRAMRead(buffer, nOffs, 2);
-            return buffer[0] | (buffer[1] << 8);
+        {
+            uint16_t nValue;
+            memcpy(&nValue, pBytes, sizeof(nValue));
+            return nValue;
+        }
         case ThirtyTwoBit:
-            ActiveBankRAMRead(buffer, nOffs, 4);
-            return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | (buffer[3] << 24);
+        {
+            uint32_t nValue;
+            memcpy(&nValue, pBytes, sizeof(nValue));
+            return nValue;
+        }
+        case SixteenBitBE:
+            return (pBytes[0] << 8) | pBytes[1];
+        case ThirtyTwoBitBE:
+            return (static_cast<unsigned int>(pBytes[0]) << 24) | (pBytes[1] << 16) | (pBytes[2] << 8) | pBytes[3];
+        case SignedEightBit:
+            return static_cast<unsigned int>(static_cast<int>(static_cast<int8_t>(pBytes[0])));
+        case SignedSixteenBit:
+        {
+            int16_t nValue;
+            memcpy(&nValue, pBytes, sizeof(nValue));
+            return static_cast<unsigned int>(static_cast<int>(nValue));
+        }
+        case SignedThirtyTwoBit:
+        {
+            uint32_t nValue;
+            memcpy(&nValue, pBytes, sizeof(nValue));
+            return nValue;
+        }
+        case Float:
+        {
+            // the integer part of the value, saturated to the range of an int. NaN is treated as zero.
+            float fValue;
+            memcpy(&fValue, pBytes, sizeof(fValue));
+            if (!(fValue == fValue))
+                return 0;
+            if (fValue >= 2147483647.0f)
+                return 0x7FFFFFFF;
+            if (fValue <= -2147483648.0f)
+                return 0x80000000;
+            return static_cast<unsigned int>(static_cast<int>(fValue));
+        }
     }
 }
 
 unsigned char MemManager::ActiveBankRAMByteRead(ra::ByteAddress nOffs) const
 {
-    const BankData* bank = nullptr;
+    const unsigned char* pBytes = GetSnapshotBytes(nOffs, 1);
+    if (pBytes != nullptr)
+        return *pBytes;
 
-    int bankID = 0;
-    int numBanks = m_Banks.size();
-    while (bankID < numBanks)
-    {
-        bank = &m_Banks.at(bankID);
-        if (nOffs < bank->BankSize)
-            return bank->Reader(nOffs);
+    return ReadByte(nOffs);
+}
 
-        nOffs -= bank->BankSize;
-        bankID++;
-    }
+unsigned char MemManager::ReadByte(ra::ByteAddress nOffs) const
+{
+    const BankEntry* pBank = FindBank(nOffs);
+    if (pBank == nullptr)
+        return 0;
 
-    return 0;
+    nOffs -= pBank->nStart;
+    return (pBank->pData != nullptr) ? pBank->pData[nOffs] : pBank->pReader(nOffs);
+}
+
+const unsigned char* MemManager::GetBankData(ra::ByteAddress nOffs, size_t nBytes) const
+{
+    const BankEntry* pBank = FindBank(nOffs);
+    if (pBank == nullptr || pBank->pData == nullptr)
+        return nullptr;
+
+    nOffs -= pBank->nStart;
+    if (nOffs + nBytes > pBank->nSize)
+        return nullptr;
+
+    return pBank->pData + nOffs;
+}
+
+static void ReadBank(unsigned char* buffer, const unsigned char* pData, _RAMByteReadFn* reader, ra::ByteAddress nOffs, size_t count)
+{
+    if (pData != nullptr)
+    {
+        memcpy(buffer, pData + nOffs, count);
+    }
+    else
+    {
+        while (count-- > 0)
+            *buffer++ = reader(nOffs++);
+    }
 }
 
 void MemManager::ActiveBankRAMRead(unsigned char buffer[], ra::ByteAddress nOffs, size_t count) const
 {
-    const BankData* bank = nullptr;
+    const BankEntry* pBank = FindBank(nOffs);
+    if (pBank == nullptr)
+    {
+        memset(buffer, 0, count);
+        return;
+    }
+
+    const BankEntry* pEnd = m_vBankTable.data() + m_vBankTable.size();
+    nOffs -= pBank->nStart;
 
-    int bankID = 0;
-    int numBanks = m_Banks.size();
-    do
+    while (nOffs + count > pBank->nSize)
     {
-        if (bankID == numBanks)
+        const size_t firstBankCount = pBank->nSize - nOffs;
+        ReadBank(buffer, pBank->pData, pBank->pReader, nOffs, firstBankCount);
+        buffer += firstBankCount;
+        count -= firstBankCount;
+
+        nOffs = 0;
+        if (++pBank == pEnd)
         {
             memset(buffer, 0, count);
             return;
         }
+    }
 
-        bank = &m_Banks.at(bankID);
-        if (nOffs < bank->BankSize)
-            break;
+    ReadBank(buffer, pBank->pData, pBank->pReader, nOffs, count);
+}
+
+void MemManager::ActiveBankRAMByteWrite(ra::ByteAddress nOffs, unsigned int nVal)
+{
+    const BankEntry* pBank = FindBank(nOffs);
+    if (pBank != nullptr)
+    {
+        const ra::ByteAddress nBankOffset = nOffs - pBank->nStart;
+        if (pBank->pData != nullptr)
+            pBank->pData[nBankOffset] = static_cast<unsigned char>(nVal);
+        else
+            pBank->pWriter(nBankOffset, nVal);
+    }
 
-        nOffs -= bank->BankSize;
-        bankID++;
-    } while (true);
+    // keep the snapshot consistent with the write
+    unsigned char* pBytes = FindSnapshotBytes(nOffs, 1);
+    if (pBytes != nullptr)
+        *pBytes = static_cast<unsigned char>(nVal);
+}
 
-    _RAMByteReadFn* reader = bank->Reader;
+void MemManager::ClearFrameSnapshot()
+{
+    m_vSnapshotRanges.clear();
+    m_vSnapshot.clear();
+    m_vSnapshotMisses.clear();
+    ReleaseFrameSnapshot();
+}
 
-    while (nOffs + count >= bank->BankSize)
-    {
-        size_t firstBankCount = bank->BankSize - nOffs;
-        count -= firstBankCount;
+void MemManager::LoadFrameSnapshot(ra::ByteAddress nAddress, const unsigned char* pBytes, size_t nBytes)
+{
+    ClearFrameSnapshot();
 
-        while (firstBankCount-- > 0)
-            *buffer++ = reader(nOffs++);
+    m_vSnapshot.assign(pBytes, pBytes + nBytes);
+    m_vSnapshotRanges.push_back({ nAddress, nBytes, 0 });
+
+    m_nSnapshotThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    m_bSnapshotActive.store(true, std::memory_order_release);
+}
 
-        nOffs -= bank->BankSize;
-        bankID++;
-        if (bankID >= numBanks)
+void MemManager::CaptureFrameSnapshot()
+{
+    ReleaseFrameSnapshot();
+
+    if (!m_vSnapshotMisses.empty())
+        MergeSnapshotMisses();
+
+    for (const auto& pRange : m_vSnapshotRanges)
+        ActiveBankRAMRead(&m_vSnapshot[pRange.nOffset], pRange.nAddress, pRange.nSize);
+
+    m_nSnapshotThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    m_bSnapshotActive.store(true, std::memory_order_release);
+}
+
+void MemManager::MergeSnapshotMisses()
+{
+    std::vector<std::pair<ra::ByteAddress, size_t>> vRanges;
+    vRanges.reserve(m_vSnapshotRanges.size() + m_vSnapshotMisses.size());
+    for (const auto& pRange : m_vSnapshotRanges)
+        vRanges.emplace_back(pRange.nAddress, pRange.nSize);
+    vRanges.insert(vRanges.end(), m_vSnapshotMisses.begin(), m_vSnapshotMisses.end());
+    m_vSnapshotMisses.clear();
+
+    std::sort(vRanges.begin(), vRanges.end());
+
+    // only merge overlapping or adjacent ranges - capturing bytes nothing references would cost additional reads
+    m_vSnapshotRanges.clear();
+    for (const auto& pRange : vRanges)
+    {
+        if (!m_vSnapshotRanges.empty())
         {
-            while (count-- > 0)
-                *buffer++ = 0;
-            return;
+            SnapshotRange& pLast = m_vSnapshotRanges.back();
+            const size_t nLastEnd = pLast.nAddress + pLast.nSize;
+            if (pRange.first <= nLastEnd)
+            {
+                const size_t nEnd = pRange.first + pRange.second;
+                if (nEnd > nLastEnd)
+                    pLast.nSize = nEnd - pLast.nAddress;
+                continue;
+            }
         }
 
-        bank = &m_Banks.at(bankID);
-        reader = bank->Reader;
+        m_vSnapshotRanges.push_back({ pRange.first, pRange.second, 0 });
     }
 
-    while (count-- > 0)
-        *buffer++ = reader(nOffs++);
+    size_t nOffset = 0;
+    for (auto& pRange : m_vSnapshotRanges)
+    {
+        pRange.nOffset = nOffset;
+        nOffset += pRange.nSize;
+    }
+
+    // the old contents are stale - they'll be refreshed by the capture
+    m_vSnapshot.resize(nOffset);
 }
 
-void MemManager::ActiveBankRAMByteWrite(ra::ByteAddress nOffs, unsigned int nVal)
+unsigned char* MemManager::FindSnapshotBytes(ra::ByteAddress nOffs, size_t nBytes) const
+{
+    // find the last range starting at or before the address
+    auto iter = std::upper_bound(m_vSnapshotRanges.begin(), m_vSnapshotRanges.end(), nOffs,
+        [](ra::ByteAddress nAddress, const SnapshotRange& pRange) { return nAddress < pRange.nAddress; });
+    if (iter == m_vSnapshotRanges.begin())
+        return nullptr;
+
+    --iter;
+    const size_t nRangeOffset = nOffs - iter->nAddress;
+    if (nRangeOffset + nBytes > iter->nSize)
+        return nullptr;
+
+    return &m_vSnapshot[iter->nOffset + nRangeOffset];
+}
+
+const unsigned char* MemManager::GetSnapshotBytes(ra::ByteAddress nOffs, size_t nBytes) const
+{
+    // the snapshot is only valid for the thread processing the frame
+    if (!m_bSnapshotActive.load(std::memory_order_acquire) ||
+        std::this_thread::get_id() != m_nSnapshotThreadId.load(std::memory_order_relaxed))
+        return nullptr;
+
+    const unsigned char* pBytes = FindSnapshotBytes(nOffs, nBytes);
+    if (pBytes == nullptr)
+        m_vSnapshotMisses.emplace_back(nOffs, nBytes);
+
+    return pBytes;
+}
+
+void MemManager::BeginFrame(bool bCaptureSnapshot)
+{
+    if (bCaptureSnapshot)
+        CaptureFrameSnapshot();
+
+    // entries are only discarded between frames, so indices handed out during a frame remain valid for it
+    ApplyReadPlanReleases();
+    DiscardUnreferencedReadPlan();
+
+    // invalidates all values read in the previous frame
+    ++m_nFrame;
+
+    m_nFrameThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    m_bInFrame.store(true, std::memory_order_release);
+}
+
+void MemManager::EndFrame()
+{
+    m_bInFrame.store(false, std::memory_order_release);
+
+    if (IsFrameSnapshotActive())
+        ReleaseFrameSnapshot();
+}
+
+void MemManager::ClearReadPlan()
+{
+    m_vReadPlan.clear();
+    m_mReadPlanIndices.clear();
+    m_vUnreferencedReadPlan.clear();
+    m_vFreeReadPlan.clear();
+    ResetReadPlanCounters();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mtxReadPlanReleases);
+        m_vReadPlanReleases.clear();
+
+        // force anything holding indices to rebuild
+        m_nReadPlanGeneration.fetch_add(1, std::memory_order_release);
+    }
+}
+
+unsigned int MemManager::FindOrAddReadPlanEntry(ra::ByteAddress nAddress, ComparisonVariableSize nSize)
+{
+    const unsigned long long nKey = (static_cast<unsigned long long>(nAddress) << 8) | static_cast<unsigned long long>(nSize);
+    const auto iter = m_mReadPlanIndices.find(nKey);
+    if (iter != m_mReadPlanIndices.end())
+        return iter->second;
+
+    // nFrame is set so the first read of a reused entry doesn't see the value of the address it was discarded from
+    const ReadPlanEntry pEntry{ nAddress, nSize, 0U, m_nFrame - 1, 0U, true };
+
+    unsigned int nIndex;
+    if (!m_vFreeReadPlan.empty())
+    {
+        nIndex = m_vFreeReadPlan.back();
+        m_vFreeReadPlan.pop_back();
+        m_vReadPlan[nIndex] = pEntry;
+    }
+    else
+    {
+        nIndex = static_cast<unsigned int>(m_vReadPlan.size());
+        m_vReadPlan.push_back(pEntry);
+    }
+
+    m_mReadPlanIndices.emplace(nKey, nIndex);
+
+    // nothing holds a reference yet. if nothing does by the next frame, it'll be discarded unless it was read
+    m_vUnreferencedReadPlan.push_back(nIndex);
+    return nIndex;
+}
+
+unsigned int MemManager::AddToReadPlan(ra::ByteAddress nAddress, ComparisonVariableSize nSize)
+{
+    const unsigned int nIndex = FindOrAddReadPlanEntry(nAddress, nSize);
+    ++m_vReadPlan[nIndex].nReferences;
+    return nIndex;
+}
+
+void MemManager::ReleaseFromReadPlan(unsigned int nIndex, unsigned int nGeneration)
 {
-    int bankID = 0;
-    int numBanks = m_Banks.size();
-    while (bankID < numBanks && nOffs >= m_Banks.at(bankID).BankSize)
+    // the entries of an older plan have already been discarded. this includes everything released after
+    // g_MemManager is destroyed - the destructor discards the plan.
+    if (nGeneration != ReadPlanGeneration())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mtxReadPlanReleases);
+    m_vReadPlanReleases.emplace_back(nIndex, nGeneration);
+}
+
+void MemManager::ApplyReadPlanReleases()
+{
+    std::lock_guard<std::mutex> lock(m_mtxReadPlanReleases);
+
+    const unsigned int nGeneration = m_nReadPlanGeneration.load(std::memory_order_relaxed);
+    for (const auto& pRelease : m_vReadPlanReleases)
     {
-        nOffs -= m_Banks.at(bankID).BankSize;
-        bankID++;
+        if (pRelease.second != nGeneration)
+            continue;
+
+        ReadPlanEntry& pEntry = m_vReadPlan[pRelease.first];
+        if (--pEntry.nReferences == 0 && !pEntry.bUnreferenced)
+        {
+            pEntry.bUnreferenced = true;
+            m_vUnreferencedReadPlan.push_back(pRelease.first);
+        }
     }
 
-    if (bankID < numBanks)
+    m_vReadPlanReleases.clear();
+}
+
+void MemManager::DiscardUnreferencedReadPlan()
+{
+    // entries read by ReadPlanned in the frame that just ended are kept - they'll probably be read again
+    size_t nKept = 0;
+    for (const unsigned int nIndex : m_vUnreferencedReadPlan)
     {
-        m_Banks.at(bankID).Writer(nOffs, nVal);
+        ReadPlanEntry& pEntry = m_vReadPlan[nIndex];
+        if (pEntry.nReferences != 0)
+        {
+            pEntry.bUnreferenced = false;
+        }
+        else if (pEntry.nFrame == m_nFrame)
+        {
+            m_vUnreferencedReadPlan[nKept++] = nIndex;
+        }
+        else
+        {
+            pEntry.bUnreferenced = false;
+            m_mReadPlanIndices.erase((static_cast<unsigned long long>(pEntry.nAddress) << 8) | static_cast<unsigned long long>(pEntry.nSize));
+            m_vFreeReadPlan.push_back(nIndex);
+        }
+    }
+
+    m_vUnreferencedReadPlan.resize(nKept);
+}
+
+unsigned int MemManager::ReadPlanValue(unsigned int nIndex, ra::ByteAddress nAddress, ComparisonVariableSize nSize)
+{
+    // check the thread before touching the plan - the frame thread may be releasing entries
+    if (!IsFrameThread())
+        return ActiveBankRAMRead(nAddress, nSize);
+
+    return ReadFrameValue(nIndex);
+}
+
+unsigned int MemManager::ReadFrameValue(unsigned int nIndex)
+{
+    ASSERT(IsFrameThread());
+
+    ReadPlanEntry& pEntry = m_vReadPlan[nIndex];
+    ++m_nOperandReads;
+    if (pEntry.nFrame != m_nFrame)
+    {
+        ++m_nMemoryReads;
+        pEntry.nValue = ActiveBankRAMRead(pEntry.nAddress, pEntry.nSize);
+        pEntry.nFrame = m_nFrame;
     }
+
+    return pEntry.nValue;
+}
+
+unsigned int MemManager::ReadPlanned(ra::ByteAddress nAddress, ComparisonVariableSize nSize)
+{
+    if (!IsFrameThread())
+        return ActiveBankRAMRead(nAddress, nSize);
+
+    return ReadFrameValue(FindOrAddReadPlanEntry(nAddress, nSize));
 }
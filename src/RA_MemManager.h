@@ -4,6 +4,11 @@
 
 #include "RA_Condition.h" // ComparisonVariableSize
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 typedef unsigned char (_RAMByteReadFn)(unsigned int nOffs);
 typedef void (_RAMByteWriteFn)(unsigned int nOffs, unsigned int nVal);
 
@@ -14,12 +19,12 @@ private:
     {
     public:
         BankData()
-            : Reader(nullptr), Writer(nullptr), BankSize(0)
+            : Reader(nullptr), Writer(nullptr), Data(nullptr), BankSize(0)
         {
         }
 
         BankData(_RAMByteReadFn* pReadFn, _RAMByteWriteFn* pWriteFn, size_t nBankSize)
-            : Reader(pReadFn), Writer(pWriteFn), BankSize(nBankSize)
+            : Reader(pReadFn), Writer(pWriteFn), Data(nullptr), BankSize(nBankSize)
         {
         }
 
@@ -31,6 +36,7 @@ private:
     public:
         _RAMByteReadFn * Reader;
         _RAMByteWriteFn* Writer;
+        unsigned char* Data;    //	if not null, the bank is accessed directly instead of through Reader/Writer
         size_t BankSize;
     };
 
@@ -41,6 +47,7 @@ public:
 public:
     void ClearMemoryBanks();
     void AddMemoryBank(size_t nBankID, _RAMByteReadFn* pReader, _RAMByteWriteFn* pWriter, size_t nBankSize);
+    void AddMemoryBankBlock(size_t nBankID, unsigned char* pData, size_t nBankSize);
     size_t NumMemoryBanks() const { return m_Banks.size(); }
 
     inline size_t BankSize(unsigned short nBank) const { return m_Banks.at(nBank).BankSize; }
@@ -59,11 +66,129 @@ public:
 
     void ActiveBankRAMRead(unsigned char buffer[], ra::ByteAddress nOffs, size_t count) const;
 
+    //	While a frame snapshot is active, sized reads (and byte reads) made on the capturing thread are
+    //	served from a copy of memory taken when the snapshot was captured. Addresses that aren't in the
+    //	snapshot are read live and remembered so they're included in the next capture. Block reads
+    //	(memory viewer, searches) always read live memory.
+    void CaptureFrameSnapshot();
+    void LoadFrameSnapshot(ra::ByteAddress nAddress, const unsigned char* pBytes, size_t nBytes);
+    void ReleaseFrameSnapshot() { m_bSnapshotActive.store(false, std::memory_order_release); }
+    void ClearFrameSnapshot();
+    bool IsFrameSnapshotActive() const { return m_bSnapshotActive.load(std::memory_order_acquire); }
+    size_t FrameSnapshotSize() const { return m_vSnapshot.size(); }
+
+    //	Frames bracket the evaluation of the achievements and leaderboards. Within a frame, the values
+    //	registered in the read plan are read from memory at most once and shared by every operand
+    //	referencing them. Outside of a frame (or on another thread) read plan values are read live.
+    void BeginFrame(bool bCaptureSnapshot);
+    void EndFrame();
+    bool IsFrameThread() const
+    {
+        return m_bInFrame.load(std::memory_order_acquire) &&
+            std::this_thread::get_id() == m_nFrameThreadId.load(std::memory_order_relaxed);
+    }
+    unsigned int FrameNumber() const { return m_nFrame; }
+
+    //	Returns the read plan index for the address/size and adds a reference to it. Indices are valid until
+    //	ReadPlanGeneration changes or the reference is released.
+    unsigned int AddToReadPlan(ra::ByteAddress nAddress, ComparisonVariableSize nSize);
+    //	Releases a reference returned by AddToReadPlan. May be called from any thread - the release is applied
+    //	at the start of the next frame, and the entry is discarded once a frame passes without it being read.
+    void ReleaseFromReadPlan(unsigned int nIndex, unsigned int nGeneration);
+    //	Reads a read plan entry. Off the frame thread the entry may be discarded at any time, so the address
+    //	and size it was registered with are read live instead.
+    unsigned int ReadPlanValue(unsigned int nIndex, ra::ByteAddress nAddress, ComparisonVariableSize nSize);
+    //	Reads a read plan entry, caching the value for the rest of the frame. Only valid on the frame thread.
+    unsigned int ReadFrameValue(unsigned int nIndex);
+    //	Reads through the read plan without holding a reference to the entry.
+    unsigned int ReadPlanned(ra::ByteAddress nAddress, ComparisonVariableSize nSize);
+    unsigned int ReadPlanGeneration() const { return m_nReadPlanGeneration.load(std::memory_order_acquire); }
+    void ClearReadPlan();
+
+    struct ReadPlanCounters
+    {
+        size_t nAddresses;              //	unique address/size pairs currently in the plan
+        unsigned int nOperandReads;     //	values requested from the plan during frames
+        unsigned int nMemoryReads;      //	values actually read from memory during frames
+    };
+    ReadPlanCounters GetReadPlanCounters() const { return{ m_mReadPlanIndices.size(), m_nOperandReads, m_nMemoryReads }; }
+    void ResetReadPlanCounters() { m_nOperandReads = m_nMemoryReads = 0; }
+
 private:
+    struct SnapshotRange
+    {
+        ra::ByteAddress nAddress;
+        size_t nSize;
+        size_t nOffset;     //	into m_vSnapshot
+    };
+
+    //	Flattened copy of m_Banks in address order. Rebuilt whenever the banks change.
+    struct BankEntry
+    {
+        ra::ByteAddress nStart;
+        size_t nSize;
+        _RAMByteReadFn* pReader;
+        _RAMByteWriteFn* pWriter;
+        unsigned char* pData;
+    };
+
+    //	Each page of the address space maps to the index of the bank containing the entire page,
+    //	or PAGE_SPANS_BANKS if a bank boundary falls within the page.
+    static constexpr unsigned int PAGE_SHIFT = 12;
+    static constexpr unsigned short PAGE_SPANS_BANKS = 0xFFFF;
+
+    BankData* AddBank(size_t nBankID, size_t nBankSize);
+    void RebuildBankTable();
+    const BankEntry* FindBank(ra::ByteAddress nOffs) const;
+    unsigned char ReadByte(ra::ByteAddress nOffs) const;
+    const unsigned char* GetBankData(ra::ByteAddress nOffs, size_t nBytes) const;
+    unsigned char* FindSnapshotBytes(ra::ByteAddress nOffs, size_t nBytes) const;
+    const unsigned char* GetSnapshotBytes(ra::ByteAddress nOffs, size_t nBytes) const;
+    void MergeSnapshotMisses();
+
     std::map<size_t, BankData> m_Banks;
     unsigned short m_nActiveMemBank;
 
     size_t m_nTotalBankSize;
+
+    std::vector<BankEntry> m_vBankTable;
+    std::vector<unsigned short> m_vPageBanks;
+
+    std::vector<SnapshotRange> m_vSnapshotRanges; //	sorted by address, non-overlapping
+    mutable std::vector<unsigned char> m_vSnapshot;
+    mutable std::vector<std::pair<ra::ByteAddress, size_t>> m_vSnapshotMisses;
+
+    //	the frame/snapshot state is checked from other threads (memory viewer, rich presence) - the thread id
+    //	is stored before the flag is released so a reader that sees the flag set also sees the owning thread
+    std::atomic<std::thread::id> m_nSnapshotThreadId{};
+    std::atomic<bool> m_bSnapshotActive{ false };
+
+    struct ReadPlanEntry
+    {
+        ra::ByteAddress nAddress;
+        ComparisonVariableSize nSize;
+        unsigned int nValue;
+        unsigned int nFrame;    //	frame nValue was read in
+        unsigned int nReferences;
+        bool bUnreferenced;     //	in m_vUnreferencedReadPlan
+    };
+
+    unsigned int FindOrAddReadPlanEntry(ra::ByteAddress nAddress, ComparisonVariableSize nSize);
+    void ApplyReadPlanReleases();
+    void DiscardUnreferencedReadPlan();
+
+    std::vector<ReadPlanEntry> m_vReadPlan;
+    std::unordered_map<unsigned long long, unsigned int> m_mReadPlanIndices;
+    std::vector<unsigned int> m_vUnreferencedReadPlan;     //	candidates for discarding at the start of the next frame
+    std::vector<unsigned int> m_vFreeReadPlan;             //	discarded entries available for reuse
+    std::mutex m_mtxReadPlanReleases;
+    std::vector<std::pair<unsigned int, unsigned int>> m_vReadPlanReleases; //	index, generation
+    std::atomic<unsigned int> m_nReadPlanGeneration{ 1 };
+    unsigned int m_nFrame = 0;
+    unsigned int m_nOperandReads = 0;
+    unsigned int m_nMemoryReads = 0;
+    std::atomic<std::thread::id> m_nFrameThreadId{};
+    std::atomic<bool> m_bInFrame{ false };
 };
 
 extern MemManager g_MemManager;
@@ -3,37 +3,202 @@
 #include "RA_MemManager.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 #include "ra_utility.h"
 
-double MemValue::Clause::GetValue() const
+//	The largest common denominator of the clauses, and the largest total in units of it, that are evaluated
+//	as integers.
+static const long long MAX_SCALE = 0x7FFFFFFF;
+static const double MAX_SCALED_TOTAL = 4611686018427387904.0; // 2^62
+
+//	Signed values keep their sign, and floats keep their fraction, so they can be scaled by the modifier.
+static double ToDouble(unsigned int nAddress, unsigned int nValue, ComparisonVariableSize nSize)
+{
+    if (nSize == ComparisonVariableSize::Float)
+    {
+        //	the read plan holds the integer part of floats. read the raw value for the fraction.
+        const unsigned int nBits = g_MemManager.ReadPlanned(nAddress, ComparisonVariableSize::ThirtyTwoBit);
+        float fValue;
+        memcpy(&fValue, &nBits, sizeof(fValue));
+        return fValue;
+    }
+
+    return static_cast<int>(nValue);
+}
+
+unsigned int MemValue::Clause::ReadValue() const
 {
-    unsigned int nRetVal = 0;
     if (m_bParseVal)
+        return m_nAddress;	//	insert address as value.
+
+    unsigned int nRetVal = g_MemManager.ReadPlanned(m_nAddress, m_nVarSize);
+
+    if (m_bBCDParse)
     {
-        nRetVal = m_nAddress;	//	insert address as value.
+        //	Reparse this value as a binary coded decimal.
+        nRetVal = (((nRetVal >> 4) & 0xf) * 10) + (nRetVal & 0xf);
     }
-    else
+
+    return nRetVal;
+}
+
+unsigned int MemValue::Clause::ReadSecondValue() const
+{
+    unsigned int nSecondVal = g_MemManager.ReadPlanned(m_nSecondAddress, m_nSecondVarSize);
+
+    if (m_bInvertBit && m_nSecondVarSize >= ComparisonVariableSize::Bit_0 && m_nSecondVarSize <= ComparisonVariableSize::Bit_7)
+        nSecondVal ^= 1;
+
+    return nSecondVal;
+}
+
+double MemValue::Clause::GetValue() const
+{
+    const unsigned int nRetVal = ReadValue();
+    const bool bSigned = IsSigned();
+
+    if (m_nSecondAddress != 0)
     {
-        nRetVal = g_MemManager.ActiveBankRAMRead(m_nAddress, m_nVarSize);
+        const unsigned int nSecondVal = ReadSecondValue();
 
-        if (m_bBCDParse)
+        if (bSigned || IsSignedSize(m_nSecondVarSize))
         {
-            //	Reparse this value as a binary coded decimal.
-            nRetVal = (((nRetVal >> 4) & 0xf) * 10) + (nRetVal & 0xf);
+            const double fValue = bSigned ? ToDouble(m_nAddress, nRetVal, m_nVarSize) : nRetVal;
+            const double fSecondValue = IsSignedSize(m_nSecondVarSize) ?
+                ToDouble(m_nSecondAddress, nSecondVal, m_nSecondVarSize) : nSecondVal;
+            return fValue * fSecondValue;
         }
+
+        return nRetVal * nSecondVal;
     }
 
+    if (bSigned)
+        return ToDouble(m_nAddress, nRetVal, m_nVarSize) * m_fModifier;
+
+    return nRetVal * m_fModifier;
+}
+
+void MemValue::Clause::SetScale(long long nScale)
+{
+    //	products of two addresses don't have a modifier
+    m_nScaledModifier = (m_nSecondAddress != 0) ? nScale : m_nNumerator * (nScale / m_nDenominator);
+}
+
+long long MemValue::Clause::GetScaledValue() const
+{
+    const unsigned int nRetVal = ReadValue();
+    const long long nValue = IsSigned() ? static_cast<long long>(static_cast<int>(nRetVal)) : static_cast<long long>(nRetVal);
+
     if (m_nSecondAddress != 0)
     {
-        unsigned int nSecondVal = g_MemManager.ActiveBankRAMRead(m_nSecondAddress, m_nSecondVarSize);
+        const unsigned int nSecondVal = ReadSecondValue();
 
-        if (m_bInvertBit && m_nSecondVarSize >= ComparisonVariableSize::Bit_0 && m_nSecondVarSize <= ComparisonVariableSize::Bit_7)
-            nSecondVal ^= 1;
+        if (IsSigned() || IsSignedSize(m_nSecondVarSize))
+        {
+            const long long nSecondValue = IsSignedSize(m_nSecondVarSize) ?
+                static_cast<long long>(static_cast<int>(nSecondVal)) : static_cast<long long>(nSecondVal);
+            return nValue * nSecondValue * m_nScaledModifier;
+        }
 
-        return nRetVal * nSecondVal;
+        //	unsigned products wrap at 32 bits
+        return static_cast<long long>(nRetVal * nSecondVal) * m_nScaledModifier;
     }
 
-    return nRetVal * m_fModifier;
+    return nValue * m_nScaledModifier;
+}
+
+//	Every value of a size is smaller than 2^bits, whether it's signed or not.
+static double MaxMagnitude(ComparisonVariableSize nSize)
+{
+    return std::ldexp(1.0, 8 * BytesForSize(nSize));
+}
+
+double MemValue::Clause::GetMaxMagnitude() const
+{
+    const double fValue = m_bParseVal ? MaxMagnitude(ThirtyTwoBit) : m_bBCDParse ? MaxMagnitude(EightBit) : MaxMagnitude(m_nVarSize);
+
+    if (m_nSecondAddress != 0)
+    {
+        if (IsSigned() || IsSignedSize(m_nSecondVarSize))
+            return fValue * MaxMagnitude(m_nSecondVarSize);
+
+        return MaxMagnitude(ThirtyTwoBit);
+    }
+
+    return fValue * static_cast<double>(std::abs(m_nNumerator)) / static_cast<double>(m_nDenominator);
+}
+
+template<typename T>
+static void AppendBytes(std::vector<unsigned char>& vKey, const T& value)
+{
+    const auto* pBytes = reinterpret_cast<const unsigned char*>(&value);
+    vKey.insert(vKey.end(), pBytes, pBytes + sizeof(T));
+}
+
+void MemValue::Clause::AppendKey(std::vector<unsigned char>& vKey) const
+{
+    AppendBytes(vKey, m_nOperation);
+    AppendBytes(vKey, m_nAddress);
+    AppendBytes(vKey, m_nVarSize);
+    AppendBytes(vKey, m_bBCDParse);
+    AppendBytes(vKey, m_bParseVal);
+    AppendBytes(vKey, m_fModifier);
+    AppendBytes(vKey, m_bRational);
+    AppendBytes(vKey, m_nNumerator);
+    AppendBytes(vKey, m_nDenominator);
+    AppendBytes(vKey, m_nSecondAddress);
+    AppendBytes(vKey, m_nSecondVarSize);
+    AppendBytes(vKey, m_bInvertBit);
+}
+
+//	Gets the exact fraction for a decimal modifier like "3", "-1" or "0.25". Other things strtod accepts
+//	(exponents, hex, infinities) and values with too many digits aren't converted.
+static bool ParseRational(const char* pStart, const char* pEnd, long long& nNumerator, long long& nDenominator)
+{
+    const char* pIter = pStart;
+    bool bNegative = false;
+    if (pIter < pEnd && (*pIter == '-' || *pIter == '+'))
+    {
+        bNegative = (*pIter == '-');
+        ++pIter;
+    }
+
+    long long nValue = 0;
+    long long nScale = 1;
+    bool bFraction = false;
+    bool bDigits = false;
+    for (; pIter < pEnd; ++pIter)
+    {
+        if (*pIter == '.' && !bFraction)
+        {
+            bFraction = true;
+            continue;
+        }
+
+        if (*pIter < '0' || *pIter > '9')
+            return false;
+
+        if (nValue >= 100000000000000LL || (bFraction && nScale >= 1000000000LL))
+            return false;
+
+        nValue = nValue * 10 + (*pIter - '0');
+        if (bFraction)
+            nScale *= 10;
+        bDigits = true;
+    }
+
+    if (!bDigits)
+        return false;
+
+    const long long nDivisor = std::gcd(nValue, nScale);
+    nNumerator = (bNegative ? -nValue : nValue) / nDivisor;
+    nDenominator = nScale / nDivisor;
+    return true;
 }
 
 const char* MemValue::Clause::ParseFromString(const char* pBuffer)
@@ -58,6 +223,9 @@ const char* MemValue::Clause::ParseFromString(const char* pBuffer)
     m_nVarSize = varTemp.Size();
 
     m_fModifier = 1.0;
+    m_nNumerator = 1;
+    m_nDenominator = 1;
+    m_bRational = true;
     if (*pIter == '*')
     {
         pIter++;
@@ -81,16 +249,176 @@ const char* MemValue::Clause::ParseFromString(const char* pBuffer)
             // Multiply by constant
             char* pOut;
             m_fModifier = strtod(pIter, &pOut);
+            m_bRational = ParseRational(pIter, pOut, m_nNumerator, m_nDenominator);
             pIter = pOut;
         }
     }
 
+    //	floats have fractions, so they're always scaled as doubles
+    if (IsSigned() && m_nVarSize == ComparisonVariableSize::Float)
+        m_bRational = false;
+    if (m_nSecondAddress != 0 && m_nSecondVarSize == ComparisonVariableSize::Float)
+        m_bRational = false;
+
     return pIter;
 }
 
 //////////////////////////////////////////////////////////////////////////
 
+struct MemValueCacheEntry
+{
+    std::vector<unsigned char> vKey;    //	the canonical form of the clauses
+    unsigned int nFrame = 0;            //	frame nValue was evaluated in
+    unsigned int nValue = 0;
+};
+
+//	Frame 0 means the cache is disabled. The entries are keyed on a hash of their canonical form, and
+//	only live as long as a MemValue is using them.
+static std::atomic<unsigned int> s_nCacheFrame{ 0 };
+static std::mutex s_mtxCache;
+static std::unordered_map<unsigned long long, std::vector<std::weak_ptr<MemValueCacheEntry>>> s_mCacheEntries;
+static size_t s_nCachePruneSize = 64;
+static unsigned int s_nCacheHits = 0;
+static unsigned int s_nCacheMisses = 0;
+
+//	FNV-1a
+static unsigned long long HashKey(const std::vector<unsigned char>& vKey)
+{
+    unsigned long long nHash = 14695981039346656037ULL;
+    for (const auto nByte : vKey)
+    {
+        nHash ^= nByte;
+        nHash *= 1099511628211ULL;
+    }
+
+    return nHash;
+}
+
+static std::shared_ptr<MemValueCacheEntry> GetCacheEntry(std::vector<unsigned char>&& vKey)
+{
+    const unsigned long long nHash = HashKey(vKey);
+
+    std::lock_guard<std::mutex> lock(s_mtxCache);
+
+    //	drop the entries of MemValues that have been destroyed
+    if (s_mCacheEntries.size() >= s_nCachePruneSize)
+    {
+        for (auto iter = s_mCacheEntries.begin(); iter != s_mCacheEntries.end();)
+        {
+            auto& vEntries = iter->second;
+            vEntries.erase(std::remove_if(vEntries.begin(), vEntries.end(),
+                [](const std::weak_ptr<MemValueCacheEntry>& pEntry) { return pEntry.expired(); }), vEntries.end());
+
+            if (vEntries.empty())
+                iter = s_mCacheEntries.erase(iter);
+            else
+                ++iter;
+        }
+
+        s_nCachePruneSize = std::max<size_t>(64, s_mCacheEntries.size() * 2);
+    }
+
+    auto& vEntries = s_mCacheEntries[nHash];
+    for (const auto& pWeakEntry : vEntries)
+    {
+        auto pEntry = pWeakEntry.lock();
+        if (pEntry && pEntry->vKey == vKey)
+            return pEntry;
+    }
+
+    auto pEntry = std::make_shared<MemValueCacheEntry>();
+    pEntry->vKey = std::move(vKey);
+    vEntries.push_back(pEntry);
+    return pEntry;
+}
+
+void MemValue::AdvanceFrame(bool bCacheEnabled)
+{
+    if (!bCacheEnabled)
+    {
+        s_nCacheFrame = 0;
+        return;
+    }
+
+    //	skip 0 when the counter wraps
+    unsigned int nFrame = s_nCacheFrame + 1;
+    if (nFrame == 0)
+        nFrame = 1;
+    s_nCacheFrame = nFrame;
+}
+
+MemValue::CacheCounters MemValue::GetCacheCounters()
+{
+    std::lock_guard<std::mutex> lock(s_mtxCache);
+
+    size_t nEntries = 0;
+    for (const auto& pair : s_mCacheEntries)
+    {
+        for (const auto& pEntry : pair.second)
+        {
+            if (!pEntry.expired())
+                ++nEntries;
+        }
+    }
+
+    return{ s_nCacheHits, s_nCacheMisses, nEntries };
+}
+
+void MemValue::ResetCacheCounters()
+{
+    std::lock_guard<std::mutex> lock(s_mtxCache);
+    s_nCacheHits = s_nCacheMisses = 0;
+}
+
 unsigned int MemValue::GetValue() const
+{
+    const unsigned int nFrame = s_nCacheFrame;
+    if (nFrame == 0 || !m_pCacheEntry)
+        return Evaluate();
+
+    std::lock_guard<std::mutex> lock(s_mtxCache);
+    if (m_pCacheEntry->nFrame == nFrame)
+    {
+        ++s_nCacheHits;
+        return m_pCacheEntry->nValue;
+    }
+
+    ++s_nCacheMisses;
+    m_pCacheEntry->nValue = Evaluate();
+    m_pCacheEntry->nFrame = nFrame;
+    return m_pCacheEntry->nValue;
+}
+
+unsigned int MemValue::Evaluate() const
+{
+    if (!m_bFixedPoint)
+        return GetDoubleValue();
+
+    long long nVal = 0;
+    for (const auto& clause : m_vClauses)
+    {
+        const long long nNextVal = clause.GetScaledValue();
+        switch (clause.GetOperation())
+        {
+            case ClauseOperation::Maximum:
+                nVal = std::max(nVal, nNextVal);
+                break;
+
+            case ClauseOperation::Addition:
+            default:
+                nVal += nNextVal;
+                break;
+        }
+    }
+
+    //	truncate towards zero like the conversion from double. negative values wrap like they would in a condition.
+    if (m_nScale != 1)
+        nVal /= m_nScale;
+
+    return static_cast<unsigned int>(nVal);
+}
+
+unsigned int MemValue::GetDoubleValue() const
 {
     double fVal = 0.0;
     for (const auto& clause : m_vClauses)
@@ -109,6 +437,10 @@ unsigned int MemValue::GetValue() const
         }
     }
 
+    //	negative values (from signed or float memory) wrap like they would in a condition
+    if (fVal < 0.0)
+        return static_cast<unsigned int>(static_cast<int>(fVal));
+
     return static_cast<unsigned int>(fVal);	//	Concern about rounding?
 }
 
@@ -143,15 +475,91 @@ const char* MemValue::ParseFromString(const char* pChar)
         break;
     } while (true);
 
+    //	use a scale that every clause's denominator divides, so each clause is a whole number of units
+    m_nScale = 1;
+    m_bFixedPoint = true;
+    double fMaxTotal = 0.0;
+    for (const auto& clause : m_vClauses)
+    {
+        if (!clause.IsRational())
+        {
+            m_bFixedPoint = false;
+            break;
+        }
+
+        m_nScale = std::lcm(m_nScale, clause.GetDenominator());
+        if (m_nScale > MAX_SCALE)
+        {
+            m_bFixedPoint = false;
+            break;
+        }
+
+        fMaxTotal += clause.GetMaxMagnitude();
+    }
+
+    //	the scaled total has to fit in 64 bits
+    if (m_bFixedPoint && fMaxTotal * m_nScale >= MAX_SCALED_TOTAL)
+        m_bFixedPoint = false;
+
+    if (m_bFixedPoint)
+    {
+        for (auto& clause : m_vClauses)
+            clause.SetScale(m_nScale);
+    }
+
+    std::vector<unsigned char> vKey;
+    for (const auto& clause : m_vClauses)
+        clause.AppendKey(vKey);
+    m_pCacheEntry = GetCacheEntry(std::move(vKey));
+
     return pChar;
 }
 
+//	Writes nValue like sprintf's %0*d with nWidth, and returns the end of the written characters.
+static char* WriteDecimal(char* pOut, int nValue, int nWidth)
+{
+    char sDigits[12];
+    char* pDigits = sDigits + sizeof(sDigits);
+    unsigned int nMagnitude = (nValue < 0) ? 0U - static_cast<unsigned int>(nValue) : static_cast<unsigned int>(nValue);
+    do
+    {
+        *--pDigits = static_cast<char>('0' + nMagnitude % 10);
+        nMagnitude /= 10;
+    } while (nMagnitude != 0);
+
+    //	the width includes the sign
+    if (nValue < 0)
+    {
+        *pOut++ = '-';
+        --nWidth;
+    }
+
+    for (int nPadding = nWidth - static_cast<int>(sDigits + sizeof(sDigits) - pDigits); nPadding > 0; --nPadding)
+        *pOut++ = '0';
+
+    while (pDigits < sDigits + sizeof(sDigits))
+        *pOut++ = *pDigits++;
+
+    return pOut;
+}
+
 std::string MemValue::FormatValue(unsigned int nValue, MemValue::Format nFormat)
+{
+    char buffer[FORMAT_BUFFER_SIZE];
+    const size_t nLength = FormatValue(buffer, sizeof(buffer), nValue, nFormat);
+    return std::string(buffer, nLength);
+}
+
+size_t MemValue::FormatValue(char* pBuffer, size_t nBufferSize, unsigned int nValue, MemValue::Format nFormat)
 {
     static const int SECONDS_PER_MINUTE = 60;
     static const int FRAMES_PER_SECOND = 60; // TODO: this isn't true for all systems
 
-    char buffer[128];
+    if (nBufferSize == 0)
+        return 0;
+
+    char buffer[FORMAT_BUFFER_SIZE];
+    char* pOut = buffer;
     switch (nFormat)
     {
         case Format::TimeFrames:
@@ -159,7 +567,11 @@ std::string MemValue::FormatValue(unsigned int nValue, MemValue::Format nFormat)
             int nSecs = nValue / FRAMES_PER_SECOND;
             int nMins = nSecs / SECONDS_PER_MINUTE;
             int nMilli = static_cast<int>((nValue % FRAMES_PER_SECOND) * (100.0 / 60.0));	//	Convert from frames to hundredths of a second
-            sprintf_s(buffer, sizeof(buffer), "%02d:%02d.%02d", nMins, nSecs % SECONDS_PER_MINUTE, nMilli);
+            pOut = WriteDecimal(pOut, nMins, 2);
+            *pOut++ = ':';
+            pOut = WriteDecimal(pOut, nSecs % SECONDS_PER_MINUTE, 2);
+            *pOut++ = '.';
+            pOut = WriteDecimal(pOut, nMilli, 2);
         }
         break;
 
@@ -167,7 +579,9 @@ std::string MemValue::FormatValue(unsigned int nValue, MemValue::Format nFormat)
         {
             int nMins = nValue / SECONDS_PER_MINUTE;
             int nSecs = nValue % SECONDS_PER_MINUTE;
-            sprintf_s(buffer, sizeof(buffer), "%02d:%02d", nMins, nSecs);
+            pOut = WriteDecimal(pOut, nMins, 2);
+            *pOut++ = ':';
+            pOut = WriteDecimal(pOut, nSecs, 2);
         }
         break;
 
@@ -176,24 +590,33 @@ std::string MemValue::FormatValue(unsigned int nValue, MemValue::Format nFormat)
             int nSecs = nValue / 100; // hundredths of a second
             int nMilli = nValue % 100;
             int nMins = nSecs / SECONDS_PER_MINUTE;
-            sprintf_s(buffer, sizeof(buffer), "%02d:%02d.%02d", nMins, nSecs % SECONDS_PER_MINUTE, nMilli);
+            pOut = WriteDecimal(pOut, nMins, 2);
+            *pOut++ = ':';
+            pOut = WriteDecimal(pOut, nSecs % SECONDS_PER_MINUTE, 2);
+            *pOut++ = '.';
+            pOut = WriteDecimal(pOut, nMilli, 2);
         }
         break;
 
         case Format::Score:
-            sprintf_s(buffer, sizeof(buffer), "%06d Points", nValue);
+            pOut = WriteDecimal(pOut, static_cast<int>(nValue), 6);
+            memcpy(pOut, " Points", 7);
+            pOut += 7;
             break;
 
         case Format::Value:
-            sprintf_s(buffer, sizeof(buffer), "%01d", nValue);
+            pOut = WriteDecimal(pOut, static_cast<int>(nValue), 1);
             break;
 
         default:
-            sprintf_s(buffer, sizeof(buffer), "%06d", nValue);
+            pOut = WriteDecimal(pOut, static_cast<int>(nValue), 6);
             break;
     }
 
-    return std::string(buffer);
+    const size_t nLength = std::min(static_cast<size_t>(pOut - buffer), nBufferSize - 1);
+    memcpy(pBuffer, buffer, nLength);
+    pBuffer[nLength] = '\0';
+    return nLength;
 }
 
 MemValue::Format MemValue::ParseFormat(const std::string& sFormat)
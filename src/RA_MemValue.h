@@ -8,6 +8,10 @@
 #include <vector>  
 #endif /* !_VECTOR_ */
 
+#include <memory>
+
+struct MemValueCacheEntry;
+
 // Represents a value expression (one or more values which are added together to create a single value)
 class MemValue
 {
@@ -31,10 +35,35 @@ public:
     std::string GetFormattedValue(Format nFormat) const { return FormatValue(GetValue(), nFormat); }
 
     static std::string FormatValue(unsigned int nValue, Format nFormat);
+
+    //	Formats into a caller supplied buffer without allocating. Returns the number of characters written,
+    //	not counting the null terminator. A buffer of FORMAT_BUFFER_SIZE characters fits any value.
+    static size_t FormatValue(char* pBuffer, size_t nBufferSize, unsigned int nValue, Format nFormat);
+    static const size_t FORMAT_BUFFER_SIZE = 32;
     static Format ParseFormat(const std::string& sFormat);
     static const char* GetFormatString(Format format);
 
+    //	While the frame cache is enabled, MemValues with identical clauses (like a leaderboard value and a rich
+    //	presence macro reading the same memory) are only evaluated once per frame. Each call invalidates the
+    //	cached values. The cache is disabled until this is first called with bCacheEnabled set.
+    static void AdvanceFrame(bool bCacheEnabled);
+
+    struct CacheCounters
+    {
+        unsigned int nHits;             //	values returned from the cache
+        unsigned int nMisses;           //	values evaluated while the cache was enabled
+        size_t nEntries;                //	distinct values that can be cached
+    };
+    static CacheCounters GetCacheCounters();
+    static void ResetCacheCounters();
+
 protected:
+    //	Evaluates the clauses, without the frame cache.
+    unsigned int Evaluate() const;
+
+    //	Evaluates the clauses as doubles, for values that can't be calculated exactly with integers.
+    unsigned int GetDoubleValue() const;
+
     enum class ClauseOperation
     {
         None,
@@ -50,9 +79,20 @@ protected:
 
         const char* ParseFromString(const char* pBuffer);       //	Parse string into values, returns end of string
         double GetValue() const;                                //	Get the value in-memory with modifiers
+        long long GetScaledValue() const;                       //	Get the value in units of 1/scale. Only valid if IsRational.
+        void SetScale(long long nScale);                        //	Set the scale, which must be a multiple of the denominator
+        double GetMaxMagnitude() const;                         //	Get the largest absolute value GetValue can return
         ClauseOperation GetOperation() const { return m_nOperation; }
+        void AppendKey(std::vector<unsigned char>& vKey) const; //	Append the fields that determine the value
+
+        bool IsRational() const { return m_bRational; }
+        long long GetDenominator() const { return m_nDenominator; }
 
     protected:
+        unsigned int ReadValue() const;
+        unsigned int ReadSecondValue() const;
+        bool IsSigned() const { return !m_bParseVal && !m_bBCDParse && IsSignedSize(m_nVarSize); }
+
         unsigned int			m_nAddress = 0;                 //	Raw address of an 8-bit, or value.
         ComparisonVariableSize	m_nVarSize = EightBit;
         double					m_fModifier = 1.0f;             //	* 60 etc
@@ -62,9 +102,21 @@ protected:
         unsigned int			m_nSecondAddress = 0;
         ComparisonVariableSize	m_nSecondVarSize = EightBit;
         ClauseOperation         m_nOperation;
+
+        long long				m_nNumerator = 1;               //	m_fModifier as an exact fraction, if it has one
+        long long				m_nDenominator = 1;
+        bool					m_bRational = true;             //	The value can be calculated exactly with integers
+        long long				m_nScaledModifier = 1;          //	The modifier in units of 1/scale
     };
 
     std::vector<Clause> m_vClauses;
+
+    //	Values are accumulated as integers in units of 1/m_nScale unless a clause isn't rational, or the total
+    //	could overflow.
+    long long m_nScale = 1;
+    bool m_bFixedPoint = true;
+
+    std::shared_ptr<MemValueCacheEntry> m_pCacheEntry;	//	Shared by every MemValue with the same clauses
 };
 
 #endif !RA_MEMVALUE_H
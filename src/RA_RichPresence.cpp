@@ -4,20 +4,111 @@
 #include "RA_Log.h"
 #include "RA_MemValue.h"
 
+#include "services\FrameProfiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+
 RA_RichPresenceInterpreter g_RichPresenceInterpreter;
 
-RA_RichPresenceInterpreter::Lookup::Lookup(const std::string& sDesc)
+RA_RichPresenceInterpreter::Lookup::Lookup(std::string_view sDesc)
     : m_sLookupDescription(sDesc)
 {
 }
 
-const std::string& RA_RichPresenceInterpreter::Lookup::GetText(unsigned int nValue) const
+void RA_RichPresenceInterpreter::Lookup::Freeze()
+{
+    //	sort by value, keeping only the last entry for each value
+    std::stable_sort(m_vLookupData.begin(), m_vLookupData.end(),
+        [](const auto& pLeft, const auto& pRight) { return pLeft.first < pRight.first; });
+
+    size_t nKept = 0;
+    for (size_t i = 0; i < m_vLookupData.size(); ++i)
+    {
+        if (i + 1 == m_vLookupData.size() || m_vLookupData[i + 1].first != m_vLookupData[i].first)
+            m_vLookupData[nKept++] = m_vLookupData[i];
+    }
+    m_vLookupData.resize(nKept);
+
+    m_nItems = m_vLookupData.size();
+    m_sText.clear();
+    m_vTexts.clear();
+    m_vValues.clear();
+
+    if (m_vLookupData.empty())
+    {
+        m_bDense = false;
+        return;
+    }
+
+    //	a dense array is used if it's no more than half empty
+    m_nFirstValue = m_vLookupData.front().first;
+    const unsigned long long nRange = static_cast<unsigned long long>(m_vLookupData.back().first) - m_nFirstValue + 1;
+    m_bDense = (nRange <= std::max<unsigned long long>(m_nItems * 2, 64));
+
+    if (m_bDense)
+        m_vTexts.resize(static_cast<size_t>(nRange), { NO_TEXT, 0 });
+    else
+        m_vTexts.reserve(m_nItems);
+
+    //	lookups often map many values to the same text, which is only stored once
+    std::unordered_map<std::string_view, Text> mInterned;
+    mInterned.reserve(m_nItems);
+    for (const auto& pair : m_vLookupData)
+    {
+        auto iter = mInterned.find(pair.second);
+        if (iter == mInterned.end())
+        {
+            const Text text{ static_cast<unsigned int>(m_sText.length()), static_cast<unsigned int>(pair.second.length()) };
+            m_sText.append(pair.second);
+            iter = mInterned.emplace(pair.second, text).first;
+        }
+
+        if (m_bDense)
+        {
+            m_vTexts[pair.first - m_nFirstValue] = iter->second;
+        }
+        else
+        {
+            m_vValues.push_back(pair.first);
+            m_vTexts.push_back(iter->second);
+        }
+    }
+
+    m_sText.shrink_to_fit();
+    std::vector<std::pair<unsigned int, std::string_view>>().swap(m_vLookupData);
+}
+
+std::string_view RA_RichPresenceInterpreter::Lookup::GetText(unsigned int nValue) const
 {
-    auto iter = m_mLookupData.find(nValue);
-    if (iter != m_mLookupData.end())
-        return iter->second;
+    const Text* pText = nullptr;
+    if (m_bDense)
+    {
+        if (nValue - m_nFirstValue < m_vTexts.size())
+            pText = &m_vTexts[nValue - m_nFirstValue];
+    }
+    else
+    {
+        //	branchless binary search. the comparisons are unpredictable, so this is faster than std::lower_bound
+        const unsigned int* pFirst = m_vValues.data();
+        size_t nCount = m_vValues.size();
+        while (nCount > 1)
+        {
+            const size_t nHalf = nCount / 2;
+            pFirst = (pFirst[nHalf] <= nValue) ? pFirst + nHalf : pFirst;
+            nCount -= nHalf;
+        }
+
+        if (nCount != 0 && *pFirst == nValue)
+            pText = &m_vTexts[pFirst - m_vValues.data()];
+    }
+
+    if (pText == nullptr || pText->nOffset == NO_TEXT)
+        return m_sDefault;
 
-    return m_sDefault;
+    return std::string_view(m_sText.data() + pText->nOffset, pText->nLength);
 }
 
 RA_RichPresenceInterpreter::DisplayString::DisplayString()
@@ -25,17 +116,18 @@ RA_RichPresenceInterpreter::DisplayString::DisplayString()
     m_conditions.SetAlwaysTrue();
 }
 
-RA_RichPresenceInterpreter::DisplayString::DisplayString(const std::string& sCondition)
+bool RA_RichPresenceInterpreter::DisplayString::ParseCondition(const std::string& sCondition)
 {
-    const char* pBuffer = sCondition.data();
+    const char* pBuffer = sCondition.c_str();
     m_conditions.ParseFromString(pBuffer);
+    if (*pBuffer == '\0')
+        return true;
 
-    if (*pBuffer != '\0')
-        m_conditions.SetAlwaysFalse();
+    m_conditions.SetAlwaysFalse();
+    return false;
 }
 
-void RA_RichPresenceInterpreter::DisplayString::InitializeParts(const std::string& sDisplayString,
-    std::map<std::string, MemValue::Format>& mFormats, std::vector<Lookup>& vLookups)
+bool RA_RichPresenceInterpreter::DisplayString::ParseParts(std::string_view sDisplayString, unsigned int nLine)
 {
     bool bHasEscapes = false;
     size_t nIndex = 0;
@@ -73,51 +165,66 @@ void RA_RichPresenceInterpreter::DisplayString::InitializeParts(const std::strin
             }
             else
             {
-                part.m_sDisplayString.assign(sDisplayString, nStart, nIndex - nStart);
+                part.m_sDisplayString.assign(sDisplayString.data() + nStart, nIndex - nStart);
             }
         }
 
         if (nIndex == sDisplayString.length())
-            break;
+            return true;
 
         nStart = nIndex + 1;
-        nIndex = nStart;
-        while (nIndex < sDisplayString.length() && sDisplayString[nIndex] != '(')
-            nIndex++;
-        if (nIndex == sDisplayString.length())
-            break;
+        nIndex = sDisplayString.find('(', nStart);
+        if (nIndex == std::string_view::npos)
+            return false;
 
-        std::string sLookup(sDisplayString, nStart, nIndex - nStart);
+        const std::string_view sName = sDisplayString.substr(nStart, nIndex - nStart);
 
         nStart = nIndex + 1;
-        nIndex = nStart;
-        while (nIndex < sDisplayString.length() && sDisplayString[nIndex] != ')')
-            nIndex++;
-        if (nIndex == sDisplayString.length())
-            break;
+        nIndex = sDisplayString.find(')', nStart);
+        if (nIndex == std::string_view::npos)
+            return false;
+
+        m_vMacros.push_back({ m_vParts.size() - 1, sName, sDisplayString.substr(nStart, nIndex - nStart), nLine });
 
-        std::string sMemValue(sDisplayString, nStart, nIndex - nStart);
         nStart = nIndex + 1;
+        nIndex = nStart;
+    } while (true);
+}
+
+void RA_RichPresenceInterpreter::DisplayString::ResolveMacros(const FormatMap& mFormats,
+    const std::vector<Lookup>& vLookups, std::vector<ParseError>& vErrors)
+{
+    std::string sMemValue;
+    for (const auto& macro : m_vMacros)
+    {
+        Part& part = m_vParts[macro.nPart];
 
-        auto iter = mFormats.find(sLookup);
+        const auto iter = mFormats.find(macro.sName);
         if (iter != mFormats.end())
         {
             part.m_nFormat = iter->second;
-            part.m_memValue.ParseFromString(sMemValue.c_str());
         }
         else
         {
-            for (std::vector<Lookup>::const_iterator lookup = vLookups.begin(); lookup != vLookups.end(); ++lookup)
+            const auto pLookup = std::find_if(vLookups.begin(), vLookups.end(),
+                [&macro](const Lookup& lookup) { return lookup.Description() == macro.sName; });
+            if (pLookup == vLookups.end())
             {
-                if (lookup->Description() == sLookup)
-                {
-                    part.m_pLookup = &(*lookup);
-                    part.m_memValue.ParseFromString(sMemValue.c_str());
-                    break;
-                }
+                //	the macro is left out of the display string
+                vErrors.push_back({ macro.nLine, std::string("Unknown macro: ").append(macro.sName) });
+                continue;
             }
+
+            part.m_pLookup = &(*pLookup);
         }
-    } while (true);
+
+        //	MemValue needs a null terminated string
+        sMemValue.assign(macro.sMemValue);
+        if (*part.m_memValue.ParseFromString(sMemValue.c_str()) != '\0')
+            vErrors.push_back({ macro.nLine, std::string("Invalid value: ").append(macro.sMemValue) });
+    }
+
+    std::vector<Macro>().swap(m_vMacros);
 }
 
 bool RA_RichPresenceInterpreter::DisplayString::Test()
@@ -126,85 +233,178 @@ bool RA_RichPresenceInterpreter::DisplayString::Test()
     return m_conditions.Test(bDirtyConditions, bResetRead);
 }
 
-std::string RA_RichPresenceInterpreter::DisplayString::GetDisplayString() const
+//	Writes over the previous contents of a buffer, noting whether they change.
+class RichPresenceWriter
 {
-    std::string sResult;
+public:
+    explicit RichPresenceWriter(std::string& sBuffer) noexcept : m_sBuffer(sBuffer) {}
+
+    void Append(const char* pText, size_t nLength)
+    {
+        if (!m_bChanged)
+        {
+            if (m_nLength + nLength <= m_sBuffer.length() && memcmp(m_sBuffer.data() + m_nLength, pText, nLength) == 0)
+            {
+                m_nLength += nLength;
+                return;
+            }
+
+            //	discard the rest of the previous contents, but not the capacity
+            m_bChanged = true;
+            m_sBuffer.resize(m_nLength);
+        }
+
+        m_sBuffer.append(pText, nLength);
+    }
+
+    bool Finish()
+    {
+        if (!m_bChanged && m_nLength != m_sBuffer.length())
+        {
+            m_bChanged = true;
+            m_sBuffer.resize(m_nLength);
+        }
+
+        return m_bChanged;
+    }
+
+private:
+    std::string& m_sBuffer;
+    size_t m_nLength = 0;   //	characters matching the previous contents
+    bool m_bChanged = false;
+};
+
+bool RA_RichPresenceInterpreter::DisplayString::GetDisplayString(std::string& sBuffer) const
+{
+    RichPresenceWriter writer(sBuffer);
     for (const auto& part : m_vParts)
     {
         if (!part.m_sDisplayString.empty())
-            sResult.append(part.m_sDisplayString);
+            writer.Append(part.m_sDisplayString.data(), part.m_sDisplayString.length());
 
         if (!part.m_memValue.IsEmpty())
         {
             unsigned int nValue = part.m_memValue.GetValue();
 
             if (part.m_pLookup != nullptr)
-                sResult.append(part.m_pLookup->GetText(nValue));
+            {
+                const std::string_view sText = part.m_pLookup->GetText(nValue);
+                writer.Append(sText.data(), sText.length());
+            }
             else
-                sResult.append(MemValue::FormatValue(nValue, part.m_nFormat));
+            {
+                char buffer[MemValue::FORMAT_BUFFER_SIZE];
+                const size_t nLength = MemValue::FormatValue(buffer, sizeof(buffer), nValue, part.m_nFormat);
+                writer.Append(buffer, nLength);
+            }
         }
     }
 
-    return sResult;
+    return writer.Finish();
 }
 
-static bool GetLine(std::stringstream& stream, std::string& sLine)
+//	Splits a script into lines without copying it, removing comments and trailing CRs.
+class RichPresenceLineReader
 {
-    if (!std::getline(stream, sLine, '\n'))
-        return false;
+public:
+    explicit RichPresenceLineReader(std::string_view sScript) noexcept : m_sScript(sScript) {}
 
-    if (!sLine.empty())
+    bool GetLine(std::string_view& sLine)
     {
-        size_t index = sLine.find("//");
-        while (index != std::string::npos && index > 0 && sLine[index - 1] == '\\')
-            index = sLine.find("//", index + 1);
-
-        if (index != std::string::npos)
+        if (m_nPosition == m_sScript.length())
+            return false;
+
+        const char* pStart = m_sScript.data() + m_nPosition;
+        const char* pEnd = m_sScript.data() + m_sScript.length();
+        const char* pScan = pStart;
+        const char* pComment = nullptr;
+        while (pScan < pEnd && *pScan != '\n')
         {
-            // if a comment marker was found, remove it and any trailing whitespace
-            while (index > 0 && isspace(sLine[index - 1]))
-                index--;
+            //	a comment marker can be escaped with a backslash, which is removed when the text is displayed
+            if (*pScan == '/' && pScan + 1 < pEnd && pScan[1] == '/' && (pScan == pStart || pScan[-1] != '\\'))
+            {
+                pComment = pScan;
+                pScan = static_cast<const char*>(memchr(pScan, '\n', pEnd - pScan));
+                if (pScan == nullptr)
+                    pScan = pEnd;
+                break;
+            }
 
-            sLine.resize(index);
+            ++pScan;
         }
-        else if (sLine[sLine.length() - 1] == '\r')
+
+        m_nPosition = (pScan < pEnd) ? pScan - m_sScript.data() + 1 : m_sScript.length();
+        ++m_nLine;
+
+        const char* pLineEnd = pScan;
+        if (pComment != nullptr)
         {
-            // also remove CR, not just LF
-            sLine.resize(sLine.length() - 1);
+            //	if a comment marker was found, remove it and any trailing whitespace
+            pLineEnd = pComment;
+            while (pLineEnd > pStart && isspace(static_cast<unsigned char>(pLineEnd[-1])))
+                --pLineEnd;
         }
+        else if (pLineEnd > pStart && pLineEnd[-1] == '\r')
+        {
+            //	also remove CR, not just LF
+            --pLineEnd;
+        }
+
+        sLine = std::string_view(pStart, pLineEnd - pStart);
+        return true;
     }
 
-    return true;
+    unsigned int LineNumber() const noexcept { return m_nLine; }
+
+private:
+    std::string_view m_sScript;
+    size_t m_nPosition = 0;
+    unsigned int m_nLine = 0;
+};
+
+static bool StartsWith(std::string_view sLine, std::string_view sPrefix)
+{
+    return sLine.compare(0, sPrefix.length(), sPrefix) == 0;
 }
 
-void RA_RichPresenceInterpreter::ParseFromString(const char* sRichPresence)
+void RA_RichPresenceInterpreter::AddParseError(unsigned int nLine, std::string sMessage)
+{
+    m_vParseErrors.push_back({ nLine, std::move(sMessage) });
+}
+
+void RA_RichPresenceInterpreter::ParseFromString(std::string_view sRichPresence)
 {
     m_vLookups.clear();
     m_vDisplayStrings.clear();
+    m_vParseErrors.clear();
 
-    std::vector<std::pair<std::string, std::string>> mDisplayStrings;
-    std::string sDisplayString;
+    //	conditional display strings are added to m_vDisplayStrings as they're parsed, and the default one is
+    //	added after them once everything has been parsed
+    DisplayString defaultDisplayString;
+    bool bHasDisplay = false;
+    bool bHasDefault = false;
 
-    std::map<std::string, MemValue::Format> mFormats;
+    FormatMap mFormats;
+    std::string sCondition;
 
-    std::stringstream ssRichPresence(sRichPresence);
-    std::string sLine;
-    while (GetLine(ssRichPresence, sLine))
+    RichPresenceLineReader reader(sRichPresence);
+    std::string_view sLine;
+    while (reader.GetLine(sLine))
     {
-        if (strncmp("Lookup:", sLine.c_str(), 7) == 0)
+        if (StartsWith(sLine, "Lookup:"))
         {
-            std::string sLookupName(sLine, 7);
-            Lookup& newLookup = m_vLookups.emplace_back(sLookupName);
-            do
+            Lookup& newLookup = m_vLookups.emplace_back(sLine.substr(7));
+            while (reader.GetLine(sLine) && sLine.length() >= 2)
             {
-                if (!GetLine(ssRichPresence, sLine) || sLine.length() < 2)
-                    break;
-
-                size_t nIndex = sLine.find('=');
-                if (nIndex == std::string::npos)
+                const size_t nIndex = sLine.find('=');
+                if (nIndex == std::string_view::npos)
+                {
+                    AddParseError(reader.LineNumber(), "Lookup entry without '='");
                     continue;
+                }
 
-                std::string sLabel(sLine, nIndex + 1);
+                //	the text is copied out of the script when the lookup is frozen
+                const std::string_view sLabel = sLine.substr(nIndex + 1);
 
                 if (sLine[0] == '*')
                 {
@@ -212,75 +412,111 @@ void RA_RichPresenceInterpreter::ParseFromString(const char* sRichPresence)
                     continue;
                 }
 
+                //	strtoul stops at the '=', so it doesn't need a null terminated line
                 unsigned int nVal;
                 if (sLine[0] == '0' && sLine[1] == 'x')
-                    nVal = strtoul(&sLine[2], nullptr, 16);
+                    nVal = strtoul(sLine.data() + 2, nullptr, 16);
                 else
-                    nVal = strtoul(&sLine[0], nullptr, 10);
+                    nVal = strtoul(sLine.data(), nullptr, 10);
 
                 newLookup.AddLookupData(nVal, sLabel);
-            } while (true);
+            }
 
-            RA_LOG("RP: Adding Lookup %s (%zu items)\n", sLookupName.c_str(), newLookup.NumItems());
+            newLookup.Freeze();
+            RA_LOG("RP: Adding Lookup %s (%zu items)\n", newLookup.Description().c_str(), newLookup.NumItems());
         }
-        else if (strncmp("Format:", sLine.c_str(), 7) == 0)
+        else if (StartsWith(sLine, "Format:"))
         {
-            std::string sFormatName(sLine, 7);
-            if (GetLine(ssRichPresence, sLine) && strncmp("FormatType=", sLine.c_str(), 11) == 0)
+            const std::string_view sFormatName = sLine.substr(7);
+            if (reader.GetLine(sLine) && StartsWith(sLine, "FormatType="))
             {
-                std::string sFormatType(sLine, 11);
+                const std::string sFormatType(sLine.substr(11));
                 MemValue::Format nType = MemValue::ParseFormat(sFormatType);
 
-                RA_LOG("RP: Adding Formatter %s (%s)\n", sFormatName.c_str(), sFormatType.c_str());
-                mFormats[sFormatName] = nType;
+                RA_LOG("RP: Adding Formatter %.*s (%s)\n", static_cast<int>(sFormatName.length()), sFormatName.data(), sFormatType.c_str());
+                mFormats.insert_or_assign(std::string(sFormatName), nType);
+            }
+            else
+            {
+                AddParseError(reader.LineNumber(), std::string("Format without FormatType: ").append(sFormatName));
             }
         }
-        else if (strncmp("Display:", sLine.c_str(), 8) == 0)
+        else if (StartsWith(sLine, "Display:"))
         {
-            do
+            bHasDisplay = true;
+            while (reader.GetLine(sLine) && sLine.length() >= 2)
             {
-                if (!GetLine(ssRichPresence, sLine) || sLine.length() < 2)
-                    break;
-
                 if (sLine[0] == '?')
                 {
                     size_t nIndex = sLine.find('?', 1);
-                    if (nIndex != std::string::npos)
+                    if (nIndex != std::string_view::npos)
                     {
-                        std::string sCondition(sLine, 1, nIndex - 1);
-                        std::string sDisplay(sLine, nIndex + 1);
+                        auto& displayString = m_vDisplayStrings.emplace_back();
+
+                        //	ConditionSet needs a null terminated string
+                        sCondition.assign(sLine.substr(1, nIndex - 1));
+                        if (!displayString.ParseCondition(sCondition))
+                            AddParseError(reader.LineNumber(), "Invalid condition: " + sCondition);
+
+                        if (!displayString.ParseParts(sLine.substr(nIndex + 1), reader.LineNumber()))
+                            AddParseError(reader.LineNumber(), "Unterminated macro");
 
-                        mDisplayStrings.emplace_back(sCondition, sDisplay);
                         continue;
                     }
                 }
 
-                sDisplayString = sLine;
+                defaultDisplayString = DisplayString();
+                if (!defaultDisplayString.ParseParts(sLine, reader.LineNumber()))
+                    AddParseError(reader.LineNumber(), "Unterminated macro");
+
+                bHasDefault = true;
                 break;
-            } while (true);
+            }
         }
     }
 
-    if (!sDisplayString.empty())
+    if (bHasDefault)
     {
-        for (std::vector<std::pair<std::string, std::string>>::const_iterator iter = mDisplayStrings.begin(); iter != mDisplayStrings.end(); ++iter)
-        {
-            auto& displayString = m_vDisplayStrings.emplace_back(iter->first);
-            displayString.InitializeParts(iter->second, mFormats, m_vLookups);
-        }
+        m_vDisplayStrings.push_back(std::move(defaultDisplayString));
+        for (auto& displayString : m_vDisplayStrings)
+            displayString.ResolveMacros(mFormats, m_vLookups, m_vParseErrors);
+    }
+    else
+    {
+        if (bHasDisplay)
+            AddParseError(reader.LineNumber(), "No default display string");
 
-        auto& displayString = m_vDisplayStrings.emplace_back();
-        displayString.InitializeParts(sDisplayString, mFormats, m_vLookups);
+        m_vDisplayStrings.clear();
     }
+
+    //	macros are resolved after everything else, so their errors are out of order
+    std::stable_sort(m_vParseErrors.begin(), m_vParseErrors.end(),
+        [](const ParseError& pLeft, const ParseError& pRight) { return pLeft.nLine < pRight.nLine; });
+
+    for (const auto& error : m_vParseErrors)
+        RA_LOG("RP: Line %u: %s\n", error.nLine, error.sMessage.c_str());
 }
 
 std::string RA_RichPresenceInterpreter::GetRichPresenceString()
 {
+    std::string sResult;
+    GetRichPresenceString(sResult);
+    return sResult;
+}
+
+bool RA_RichPresenceInterpreter::GetRichPresenceString(std::string& sBuffer)
+{
+    RA_PROFILE_SECTION(RichPresence);
+
     for (auto& displayString : m_vDisplayStrings)
     {
         if (displayString.Test())
-            return displayString.GetDisplayString();
+            return displayString.GetDisplayString(sBuffer);
     }
 
-    return std::string();
+    if (sBuffer.empty())
+        return false;
+
+    sBuffer.clear();
+    return true;
 }
@@ -5,46 +5,87 @@
 #include "RA_Condition.h"
 #include "RA_MemValue.h"
 
+#include <string_view>
+
 class RA_RichPresenceInterpreter
 {
 public:
     RA_RichPresenceInterpreter() {}
 
-    void ParseFromString(const char* sRichPresence);
+    //	Parses the script in a single pass, without copying it. Problems are logged and available from
+    //	GetParseErrors, but don't stop the rest of the script from being used.
+    void ParseFromString(std::string_view sRichPresence);
+
+    struct ParseError
+    {
+        unsigned int nLine;
+        std::string sMessage;
+    };
+    const std::vector<ParseError>& GetParseErrors() const { return m_vParseErrors; }
 
     std::string GetRichPresenceString();
-    
+
+    //	Renders the current string over the previous contents of sBuffer, which doesn't allocate once the buffer
+    //	has grown to fit the longest string. Returns false if the string hasn't changed since sBuffer was last
+    //	rendered into, so callers can skip sending or redrawing it.
+    bool GetRichPresenceString(std::string& sBuffer);
+
     bool Enabled() const { return !m_vDisplayStrings.empty(); }
 
 protected:
+    //	Entries are added while the script is parsed, then Freeze stores them in a dense array indexed by value
+    //	when the values are mostly contiguous, or in a sorted array that's binary searched when they're not. The
+    //	text of every entry is stored once in a single buffer.
     class Lookup
     {
     public:
-        Lookup(const std::string& sDesc);
+        Lookup(std::string_view sDesc);
 
         const std::string& Description() const { return m_sLookupDescription; }
-        const std::string& GetText(unsigned int nValue) const;
+        std::string_view GetText(unsigned int nValue) const;
 
-        void AddLookupData(unsigned int nValue, const std::string& sLookupData) { m_mLookupData[nValue] = sLookupData; }
-        void SetDefault(const std::string& sDefault) { m_sDefault = sDefault; }
-        size_t NumItems() const { return m_mLookupData.size(); }
+        //	sLookupData isn't copied until Freeze is called, so it must remain valid until then.
+        void AddLookupData(unsigned int nValue, std::string_view sLookupData) { m_vLookupData.emplace_back(nValue, sLookupData); }
+        void SetDefault(std::string_view sDefault) { m_sDefault.assign(sDefault); }
+        void Freeze();
+        size_t NumItems() const { return m_nItems; }
+        bool IsDense() const { return m_bDense; }
 
     private:
+        struct Text
+        {
+            unsigned int nOffset;   //	into m_sText, or NO_TEXT for values in a dense array without an entry
+            unsigned int nLength;
+        };
+        static const unsigned int NO_TEXT = 0xFFFFFFFF;
+
         std::string m_sDefault;
         std::string m_sLookupDescription;
-        std::map<unsigned int, std::string> m_mLookupData;
+        std::vector<std::pair<unsigned int, std::string_view>> m_vLookupData;  //	until frozen
+
+        std::string m_sText;
+        std::vector<Text> m_vTexts;         //	dense: indexed by value - m_nFirstValue. sparse: parallel to m_vValues
+        std::vector<unsigned int> m_vValues;
+        unsigned int m_nFirstValue = 0;
+        size_t m_nItems = 0;
+        bool m_bDense = false;
     };
 
+    using FormatMap = std::map<std::string, MemValue::Format, std::less<>>;
+
     class DisplayString
     {
     public:
         DisplayString();
-        DisplayString(const std::string& sCondition);
-        void InitializeParts(const std::string& sDisplayString,
-            std::map<std::string, MemValue::Format>& mFormats, std::vector<Lookup>& vLookups);
+        bool ParseCondition(const std::string& sCondition);
+        bool ParseParts(std::string_view sDisplayString, unsigned int nLine);
+
+        //	Macros can refer to lookups and formats defined after the display string, so they're resolved once
+        //	the whole script has been parsed.
+        void ResolveMacros(const FormatMap& mFormats, const std::vector<Lookup>& vLookups, std::vector<ParseError>& vErrors);
 
         bool Test();
-        std::string GetDisplayString() const;
+        bool GetDisplayString(std::string& sBuffer) const;
 
     protected:
         struct Part
@@ -56,14 +97,25 @@ protected:
         };
 
     private:
+        struct Macro
+        {
+            size_t nPart;
+            std::string_view sName;     //	into the script, so only valid until the macros are resolved
+            std::string_view sMemValue;
+            unsigned int nLine;
+        };
 
         std::vector<Part> m_vParts;
+        std::vector<Macro> m_vMacros;
         ConditionSet m_conditions;
     };
 
 private:
+    void AddParseError(unsigned int nLine, std::string sMessage);
+
     std::vector<Lookup> m_vLookups;
     std::vector<DisplayString> m_vDisplayStrings;
+    std::vector<ParseError> m_vParseErrors;
 };
 
 extern RA_RichPresenceInterpreter g_RichPresenceInterpreter;
@@ -752,6 +752,7 @@ void RAWeb::RA_InitializeHTTPThreads()
 DWORD RAWeb::HTTPWorkerThread(LPVOID lpParameter)
 {
     time_t nSendNextKeepAliveAt = time(nullptr) + SERVER_PING_DURATION;
+    std::string sRichPresence;
 
     bool bThreadActive = true;
     bool bDoPingKeepAlive = (reinterpret_cast<int>(lpParameter) == 0);  //  Cause this only on first thread
@@ -822,10 +823,11 @@ DWORD RAWeb::HTTPWorkerThread(LPVOID lpParameter)
                         }
                         else
                         {
-                            const std::string& sRPResponse = g_RichPresenceInterpreter.GetRichPresenceString();
-                            if (!sRPResponse.empty())
+                            // the ping is sent even if the string hasn't changed, so the server keeps the player listed
+                            g_RichPresenceInterpreter.GetRichPresenceString(sRichPresence);
+                            if (!sRichPresence.empty())
                             {
-                                args['m'] = sRPResponse;
+                                args['m'] = sRichPresence;
                             }
                             else if (g_pActiveAchievements && g_pActiveAchievements->NumAchievements() > 0)
                             {
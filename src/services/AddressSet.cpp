@@ -0,0 +1,414 @@
+#include "AddressSet.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ra {
+namespace services {
+
+unsigned int AddressSet::PopCount(unsigned int nBits)
+{
+#ifdef _MSC_VER
+    // __popcnt requires SSE4.2 hardware, so use the portable version
+    nBits = nBits - ((nBits >> 1) & 0x55555555);
+    nBits = (nBits & 0x33333333) + ((nBits >> 2) & 0x33333333);
+    return (((nBits + (nBits >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+#else
+    return __builtin_popcount(nBits);
+#endif
+}
+
+unsigned int AddressSet::LowestSetBit(unsigned int nBits)
+{
+#ifdef _MSC_VER
+    unsigned long nIndex;
+    _BitScanForward(&nIndex, nBits);
+    return nIndex;
+#else
+    return __builtin_ctz(nBits);
+#endif
+}
+
+AddressSet::AddressSet(const AddressSet& other)
+    : m_nFirstAddress(other.m_nFirstAddress), m_nAddressCount(other.m_nAddressCount), m_nCount(other.m_nCount),
+      m_bDense(other.m_bDense), m_vBlocks(other.m_vBlocks), m_vRank(other.m_vRank), m_vAddresses(other.m_vAddresses)
+{
+    // the blocks are shared with the other set until they're modified
+}
+
+void AddressSet::Reset(unsigned int nFirstAddress, unsigned int nAddressCount)
+{
+    m_nFirstAddress = nFirstAddress;
+    m_nAddressCount = nAddressCount;
+    m_nCount = 0;
+    m_nOwnedBlocks = 0;
+    m_bDense = false;
+
+    m_vBlocks.clear();
+    m_vRank.clear();
+    m_vAddresses.clear();
+}
+
+bool AddressSet::CanAppend(unsigned int nCount) const
+{
+    // a sorted vector costs 32 bits per address, the bitmap costs 1 bit per address in the range
+    return (static_cast<unsigned long long>(m_vAddresses.size()) + nCount) * 32 < m_nAddressCount;
+}
+
+void AddressSet::ConvertToBitmap()
+{
+    m_bDense = true;
+    m_vBlocks.resize((WordCount() + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK);
+
+    for (const auto nAddress : m_vAddresses)
+    {
+        const unsigned int nOffset = nAddress - m_nFirstAddress;
+        GetMutableWord(nOffset >> 5) |= 1U << (nOffset & 31);
+    }
+
+    std::vector<unsigned int>().swap(m_vAddresses);
+}
+
+unsigned int& AddressSet::GetMutableWord(unsigned int nWord)
+{
+    auto& pBlock = m_vBlocks[nWord / WORDS_PER_BLOCK];
+    if (!pBlock)
+    {
+        pBlock = std::make_shared<Block>();
+        ++m_nOwnedBlocks;
+    }
+    else if (pBlock.use_count() > 1)
+    {
+        pBlock = std::make_shared<Block>(*pBlock);
+        ++m_nOwnedBlocks;
+    }
+
+    return pBlock->m_vWords[nWord % WORDS_PER_BLOCK];
+}
+
+void AddressSet::AddBits(unsigned int nAddress, const unsigned int* pBits, unsigned int nBitCount)
+{
+    const unsigned int nWords = (nBitCount + 31) / 32;
+    unsigned int i = 0;
+
+    if (!m_bDense)
+    {
+        unsigned int nCount = 0;
+        for (unsigned int j = 0; j < nWords; ++j)
+            nCount += PopCount(pBits[j]);
+
+        if (nCount == 0)
+            return;
+
+        if (!CanAppend(nCount))
+        {
+            ConvertToBitmap();
+        }
+        else
+        {
+            for (; i < nWords; ++i)
+            {
+                unsigned int nBits = pBits[i];
+                if (nBits == 0)
+                    continue;
+
+                // if the bits overlap the addresses that have already been collected, fall back to the bitmap
+                const unsigned int nWordAddress = nAddress + (i << 5);
+                if (!m_vAddresses.empty() && nWordAddress + LowestSetBit(nBits) <= m_vAddresses.back())
+                {
+                    ConvertToBitmap();
+                    break;
+                }
+
+                do
+                {
+                    m_vAddresses.push_back(nWordAddress + LowestSetBit(nBits));
+                    nBits &= nBits - 1;
+                } while (nBits);
+            }
+
+            if (i == nWords)
+                return;
+        }
+    }
+
+    const unsigned int nOffset = nAddress - m_nFirstAddress;
+    const unsigned int nShift = nOffset & 31;
+    const unsigned int nWordCount = WordCount();
+    unsigned int nWord = (nOffset >> 5) + i;
+
+    for (; i < nWords; ++i, ++nWord)
+    {
+        const unsigned int nBits = pBits[i];
+        if (nBits == 0)
+            continue;
+
+        GetMutableWord(nWord) |= nBits << nShift;
+        if (nShift != 0 && nWord + 1 < nWordCount && (nBits >> (32 - nShift)) != 0)
+            GetMutableWord(nWord + 1) |= nBits >> (32 - nShift);
+    }
+}
+
+void AddressSet::Add(unsigned int nAddress)
+{
+    if (!m_bDense)
+    {
+        if (m_vAddresses.empty() || nAddress > m_vAddresses.back())
+        {
+            if (CanAppend(1))
+            {
+                m_vAddresses.push_back(nAddress);
+                return;
+            }
+        }
+        else if (m_vAddresses.back() == nAddress)
+        {
+            return;
+        }
+
+        ConvertToBitmap();
+    }
+
+    const unsigned int nOffset = nAddress - m_nFirstAddress;
+    GetMutableWord(nOffset >> 5) |= 1U << (nOffset & 31);
+}
+
+void AddressSet::Compact(const AddressSet* pPrevious)
+{
+    if (!m_bDense)
+    {
+        // the addresses never outgrew the vector
+        m_nCount = static_cast<unsigned int>(m_vAddresses.size());
+        m_vAddresses.shrink_to_fit();
+        return;
+    }
+
+    m_nCount = 0;
+    for (const auto& pBlock : m_vBlocks)
+    {
+        if (pBlock)
+        {
+            for (auto nBits : pBlock->m_vWords)
+                m_nCount += PopCount(nBits);
+        }
+    }
+
+    // a sorted vector costs 32 bits per address, the bitmap costs 1 bit per address in the range
+    if (static_cast<unsigned long long>(m_nCount) * 32 < m_nAddressCount)
+    {
+        m_vAddresses.reserve(m_nCount);
+        for (unsigned int nWord = 0; nWord < WordCount(); ++nWord)
+        {
+            unsigned int nBits = GetWord(nWord);
+            while (nBits)
+            {
+                m_vAddresses.push_back(m_nFirstAddress + (nWord << 5) + LowestSetBit(nBits));
+                nBits &= nBits - 1;
+            }
+        }
+
+        m_bDense = false;
+        std::vector<std::shared_ptr<Block>>().swap(m_vBlocks);
+        m_vRank.clear();
+        m_nOwnedBlocks = 0;
+        return;
+    }
+
+    // release empty blocks, and share blocks that are the same as the previous set's
+    const bool bCanShare = (pPrevious != nullptr && pPrevious->m_bDense &&
+        pPrevious->m_nFirstAddress == m_nFirstAddress && pPrevious->m_nAddressCount == m_nAddressCount);
+    const Block pEmpty{};
+
+    m_nOwnedBlocks = 0;
+    for (unsigned int i = 0; i < m_vBlocks.size(); ++i)
+    {
+        auto& pBlock = m_vBlocks[i];
+        if (!pBlock)
+            continue;
+
+        if (memcmp(pBlock->m_vWords, pEmpty.m_vWords, sizeof(pEmpty.m_vWords)) == 0)
+        {
+            pBlock.reset();
+            continue;
+        }
+
+        if (bCanShare)
+        {
+            const auto& pPreviousBlock = pPrevious->m_vBlocks[i];
+            if (pPreviousBlock && memcmp(pBlock->m_vWords, pPreviousBlock->m_vWords, sizeof(pEmpty.m_vWords)) == 0)
+            {
+                pBlock = pPreviousBlock;
+                continue;
+            }
+        }
+
+        ++m_nOwnedBlocks;
+    }
+
+    BuildRankIndex();
+}
+
+void AddressSet::BuildRankIndex()
+{
+    const unsigned int nWordCount = WordCount();
+    m_vRank.resize((nWordCount + WORDS_PER_RANK - 1) / WORDS_PER_RANK);
+
+    unsigned int nCount = 0;
+    for (unsigned int nWord = 0; nWord < nWordCount; ++nWord)
+    {
+        if (nWord % WORDS_PER_RANK == 0)
+            m_vRank[nWord / WORDS_PER_RANK] = nCount;
+
+        nCount += PopCount(GetWord(nWord));
+    }
+}
+
+size_t AddressSet::MemoryUsage() const
+{
+    return m_nOwnedBlocks * sizeof(Block) + m_vBlocks.capacity() * sizeof(m_vBlocks[0]) +
+        (m_vRank.capacity() + m_vAddresses.capacity()) * sizeof(unsigned int);
+}
+
+bool AddressSet::Remove(unsigned int nAddress)
+{
+    if (!m_bDense)
+    {
+        const auto iter = std::lower_bound(m_vAddresses.begin(), m_vAddresses.end(), nAddress);
+        if (iter == m_vAddresses.end() || *iter != nAddress)
+            return false;
+
+        m_vAddresses.erase(iter);
+        --m_nCount;
+        return true;
+    }
+
+    if (!Contains(nAddress))
+        return false;
+
+    const unsigned int nOffset = nAddress - m_nFirstAddress;
+    GetMutableWord(nOffset >> 5) &= ~(1U << (nOffset & 31));
+    --m_nCount;
+
+    for (auto iter = m_vRank.begin() + (nOffset >> 5) / WORDS_PER_RANK + 1; iter < m_vRank.end(); ++iter)
+        --(*iter);
+
+    return true;
+}
+
+bool AddressSet::Contains(unsigned int nAddress) const
+{
+    if (!m_bDense)
+        return std::binary_search(m_vAddresses.begin(), m_vAddresses.end(), nAddress);
+
+    if (nAddress < m_nFirstAddress)
+        return false;
+
+    const unsigned int nOffset = nAddress - m_nFirstAddress;
+    if (nOffset >= m_nAddressCount)
+        return false;
+
+    return (GetWord(nOffset >> 5) & (1U << (nOffset & 31))) != 0;
+}
+
+unsigned int AddressSet::ExtractBits(unsigned int nBit) const
+{
+    const unsigned int nWord = nBit >> 5;
+    const unsigned int nShift = nBit & 31;
+    const unsigned int nWordCount = WordCount();
+    if (nWord >= nWordCount)
+        return 0;
+
+    unsigned int nBits = GetWord(nWord) >> nShift;
+    if (nShift != 0 && nWord + 1 < nWordCount)
+        nBits |= GetWord(nWord + 1) << (32 - nShift);
+
+    return nBits;
+}
+
+void AddressSet::IntersectBits(unsigned int nAddress, unsigned int* pBits, unsigned int nBitCount) const
+{
+    const unsigned int nWords = (nBitCount + 31) / 32;
+
+    if (m_bDense)
+    {
+        for (unsigned int i = 0; i < nWords; ++i)
+        {
+            if (pBits[i] == 0)
+                continue;
+
+            // bits for addresses before the range are never set
+            const unsigned int nWordAddress = nAddress + (i << 5);
+            if (nWordAddress >= m_nFirstAddress)
+            {
+                pBits[i] &= ExtractBits(nWordAddress - m_nFirstAddress);
+            }
+            else if (m_nFirstAddress - nWordAddress < 32)
+            {
+                const unsigned int nShift = m_nFirstAddress - nWordAddress;
+                pBits[i] &= ExtractBits(0) << nShift;
+            }
+            else
+            {
+                pBits[i] = 0;
+            }
+        }
+
+        return;
+    }
+
+    // walk the sorted addresses alongside the words
+    auto iter = std::lower_bound(m_vAddresses.begin(), m_vAddresses.end(), nAddress);
+    for (unsigned int i = 0; i < nWords; ++i)
+    {
+        const unsigned int nWordEnd = nAddress + (i << 5) + 32;
+        unsigned int nMask = 0;
+        while (iter != m_vAddresses.end() && *iter < nWordEnd)
+        {
+            nMask |= 1U << ((*iter - nAddress) & 31);
+            ++iter;
+        }
+
+        pBits[i] &= nMask;
+    }
+}
+
+bool AddressSet::GetAt(unsigned int nIndex, unsigned int& nAddress) const
+{
+    if (nIndex >= m_nCount)
+        return false;
+
+    if (!m_bDense)
+    {
+        nAddress = m_vAddresses[nIndex];
+        return true;
+    }
+
+    // find the last group that starts at or before nIndex, then count through its words
+    const auto iter = std::upper_bound(m_vRank.begin(), m_vRank.end(), nIndex);
+    const unsigned int nGroup = static_cast<unsigned int>(iter - m_vRank.begin()) - 1;
+    unsigned int nRemaining = nIndex - m_vRank[nGroup];
+
+    unsigned int nWord = nGroup * WORDS_PER_RANK;
+    unsigned int nBits = GetWord(nWord);
+    unsigned int nWordCount = PopCount(nBits);
+    while (nRemaining >= nWordCount)
+    {
+        nRemaining -= nWordCount;
+        nBits = GetWord(++nWord);
+        nWordCount = PopCount(nBits);
+    }
+
+    // select the nRemaining'th set bit of the word
+    while (nRemaining--)
+        nBits &= nBits - 1;
+
+    nAddress = m_nFirstAddress + (nWord << 5) + LowestSetBit(nBits);
+    return true;
+}
+
+} // namespace services
+} // namespace ra
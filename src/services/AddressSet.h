@@ -0,0 +1,167 @@
+#ifndef RA_SERVICES_ADDRESS_SET_H
+#define RA_SERVICES_ADDRESS_SET_H
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace ra {
+namespace services {
+
+/// <summary>
+/// A sorted set of addresses within a range. Large sets are stored as a bitmap with a rank index so
+/// counting, membership and indexing stay cheap; small sets are stored as a sorted vector.
+/// </summary>
+/// <remarks>
+/// The bitmap is split into blocks which are shared between copies, and with the set passed to
+/// <see cref="Compact" />, until they're modified. While the set is being built, addresses added in
+/// ascending order are collected in the vector until there are too many for it, so sparse sets over
+/// large ranges never allocate the bitmap.
+/// </remarks>
+class AddressSet
+{
+public:
+    AddressSet() = default;
+    AddressSet(const AddressSet& other);
+    AddressSet& operator=(const AddressSet&) = delete;
+
+    /// <summary>
+    /// Empties the set and prepares it to hold addresses in the range [nFirstAddress, nFirstAddress + nAddressCount).
+    /// </summary>
+    void Reset(unsigned int nFirstAddress, unsigned int nAddressCount);
+
+    /// <summary>
+    /// Adds the addresses for each set bit in <paramref name="pBits" />. Bit (i % 32) of pBits[i / 32]
+    /// represents nAddress + i.
+    /// </summary>
+    void AddBits(unsigned int nAddress, const unsigned int* pBits, unsigned int nBitCount);
+
+    /// <summary>
+    /// Adds an address. Must be called in ascending address order while building the set.
+    /// </summary>
+    void Add(unsigned int nAddress);
+
+    /// <summary>
+    /// Finishes building the set. Chooses the smaller representation and builds the rank index.
+    /// </summary>
+    /// <param name="pPrevious">A set over the same range whose unchanged blocks should be shared, or <c>nullptr</c>.</param>
+    void Compact(const AddressSet* pPrevious = nullptr);
+
+    /// <summary>
+    /// Removes an address from the set.
+    /// </summary>
+    /// <returns><c>true</c> if the address was in the set.</returns>
+    bool Remove(unsigned int nAddress);
+
+    /// <summary>
+    /// Determines whether the specified address is in the set.
+    /// </summary>
+    bool Contains(unsigned int nAddress) const;
+
+    /// <summary>
+    /// Clears the bits in <paramref name="pBits" /> for addresses that are not in the set. Bit (i % 32)
+    /// of pBits[i / 32] represents nAddress + i.
+    /// </summary>
+    void IntersectBits(unsigned int nAddress, unsigned int* pBits, unsigned int nBitCount) const;
+
+    /// <summary>
+    /// Gets the number of addresses in the set.
+    /// </summary>
+    unsigned int Count() const { return m_nCount; }
+
+    /// <summary>
+    /// Gets the nIndex'th address in the set.
+    /// </summary>
+    /// <returns><c>true</c> if nAddress was populated, <c>false</c> if the index was invalid.</returns>
+    bool GetAt(unsigned int nIndex, unsigned int& nAddress) const;
+
+    /// <summary>
+    /// Calls fVisit(nAddress) for each address in the set, in ascending order.
+    /// </summary>
+    template<typename TFunc>
+    void ForEach(TFunc&& fVisit) const
+    {
+        if (!m_bDense)
+        {
+            for (const auto nAddress : m_vAddresses)
+                fVisit(nAddress);
+            return;
+        }
+
+        const unsigned int nWordCount = WordCount();
+        for (unsigned int nWord = 0; nWord < nWordCount; ++nWord)
+        {
+            unsigned int nBits = GetWord(nWord);
+            while (nBits)
+            {
+                fVisit(m_nFirstAddress + (nWord << 5) + LowestSetBit(nBits));
+                nBits &= nBits - 1;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Determines whether the set is stored as a bitmap.
+    /// </summary>
+    bool IsDense() const { return m_bDense; }
+
+    /// <summary>
+    /// Gets the number of bytes allocated by the set, excluding blocks it shares with the set it was
+    /// copied from or compacted against.
+    /// </summary>
+    size_t MemoryUsage() const;
+
+    /// <summary>
+    /// Gets the number of set bits in a word.
+    /// </summary>
+    static unsigned int PopCount(unsigned int nBits);
+
+    /// <summary>
+    /// Gets the index of the lowest set bit in a non-zero word.
+    /// </summary>
+    static unsigned int LowestSetBit(unsigned int nBits);
+
+private:
+    static const unsigned int WORDS_PER_BLOCK = 128; // 4096 addresses
+    static const unsigned int WORDS_PER_RANK = 16;   // 512 addresses
+
+    struct Block
+    {
+        unsigned int m_vWords[WORDS_PER_BLOCK];
+    };
+
+    unsigned int WordCount() const { return (m_nAddressCount + 31) / 32; }
+
+    // gets word nWord of the bitmap. null blocks are empty.
+    unsigned int GetWord(unsigned int nWord) const
+    {
+        const auto& pBlock = m_vBlocks[nWord / WORDS_PER_BLOCK];
+        return pBlock ? pBlock->m_vWords[nWord % WORDS_PER_BLOCK] : 0U;
+    }
+
+    // gets a modifiable reference to word nWord of the bitmap, allocating or unsharing its block
+    unsigned int& GetMutableWord(unsigned int nWord);
+
+    // gets the 32 bits of the bitmap starting at nBit (relative to m_nFirstAddress)
+    unsigned int ExtractBits(unsigned int nBit) const;
+
+    // while building, determines whether nCount more addresses can be collected in the vector
+    bool CanAppend(unsigned int nCount) const;
+    void ConvertToBitmap();
+    void BuildRankIndex();
+
+    unsigned int m_nFirstAddress = 0;
+    unsigned int m_nAddressCount = 0;
+    unsigned int m_nCount = 0;
+    unsigned int m_nOwnedBlocks = 0;
+    bool m_bDense = false;
+
+    std::vector<std::shared_ptr<Block>> m_vBlocks; // dense: bit (i % 32) of word (i / 32) is m_nFirstAddress + i
+    std::vector<unsigned int> m_vRank;             // dense: number of addresses before each group of WORDS_PER_RANK words
+    std::vector<unsigned int> m_vAddresses;        // sparse
+};
+
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_ADDRESS_SET_H
@@ -0,0 +1,290 @@
+#include "FrameProfiler.h"
+
+#include "RA_Json.h"
+#include "RA_MemManager.h"
+
+#include <algorithm>
+
+ra::services::FrameProfiler g_FrameProfiler;
+
+namespace ra {
+namespace services {
+
+const char* FrameProfiler::SectionName(Section nSection)
+{
+    switch (nSection)
+    {
+        case Section::AchievementSet:       return "AchievementSet";
+        case Section::LeaderboardManager:   return "LeaderboardManager";
+        case Section::RichPresence:         return "RichPresence";
+        case Section::MemoryDialog:         return "MemoryDialog";
+        default:                            return "Unknown";
+    }
+}
+
+double FrameProfiler::ToMicroseconds(Clock::duration tElapsed)
+{
+    return std::chrono::duration<double, std::micro>(tElapsed).count();
+}
+
+void FrameProfiler::SetEnabled(bool bEnabled)
+{
+    if (m_bEnabled.exchange(bEnabled) != bEnabled && !bEnabled)
+        Reset();
+}
+
+void FrameProfiler::SetWindowSize(unsigned int nFrames)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_nWindowSize = std::max(nFrames, 1U);
+
+    // the ring buffers can't be resized in place without losing their order
+    m_vFrameTimes.Clear();
+    for (auto& vSectionTimes : m_vSectionTimes)
+        vSectionTimes.Clear();
+    m_mAchievements.clear();
+}
+
+void FrameProfiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_bInFrame = false;
+    std::fill(std::begin(m_fSectionTimes), std::end(m_fSectionTimes), 0.0);
+
+    m_vFrameTimes.Clear();
+    for (auto& vSectionTimes : m_vSectionTimes)
+        vSectionTimes.Clear();
+    m_mAchievements.clear();
+}
+
+void FrameProfiler::BeginFrame()
+{
+    if (!IsEnabled())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_bInFrame = true;
+    m_tFrameStart = Clock::now();
+}
+
+void FrameProfiler::EndFrame()
+{
+    if (!IsEnabled())
+        return;
+
+    const auto tFrameEnd = Clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_bInFrame)
+        return;
+
+    m_bInFrame = false;
+    m_vFrameTimes.Add(ToMicroseconds(tFrameEnd - m_tFrameStart), m_nWindowSize);
+
+    // sections that run outside the frame (like rich presence, which is evaluated on the http thread)
+    // are attributed to the frame that was active when they finished.
+    for (int i = 0; i < static_cast<int>(Section::NumSections); ++i)
+    {
+        m_vSectionTimes[i].Add(m_fSectionTimes[i], m_nWindowSize);
+        m_fSectionTimes[i] = 0.0;
+    }
+
+    for (auto& pPair : m_mAchievements)
+    {
+        AchievementProfile& pProfile = pPair.second;
+        if (!pProfile.bEvaluated)
+            continue;
+
+        pProfile.vTimes.Add(pProfile.fFrameTime, m_nWindowSize);
+        pProfile.vMemoryReads.Add(pProfile.nFrameMemoryReads, m_nWindowSize);
+        pProfile.fFrameTime = 0.0;
+        pProfile.nFrameMemoryReads = 0;
+        pProfile.bEvaluated = false;
+    }
+}
+
+void FrameProfiler::AddSectionTime(Section nSection, Clock::duration tElapsed)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_fSectionTimes[static_cast<int>(nSection)] += ToMicroseconds(tElapsed);
+}
+
+void FrameProfiler::AddAchievementCost(ra::AchievementID nID, Clock::duration tElapsed, unsigned int nMemoryReads)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    AchievementProfile& pProfile = m_mAchievements[nID];
+    pProfile.fFrameTime += ToMicroseconds(tElapsed);
+    pProfile.nFrameMemoryReads += nMemoryReads;
+    pProfile.bEvaluated = true;
+}
+
+FrameProfiler::Statistics FrameProfiler::GetFrameStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_vFrameTimes.Calculate();
+}
+
+FrameProfiler::Statistics FrameProfiler::GetSectionStatistics(Section nSection) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_vSectionTimes[static_cast<int>(nSection)].Calculate();
+}
+
+FrameProfiler::Statistics FrameProfiler::GetAchievementStatistics(ra::AchievementID nID) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    const auto iter = m_mAchievements.find(nID);
+    if (iter == m_mAchievements.end())
+        return Statistics{};
+
+    return iter->second.vTimes.Calculate();
+}
+
+FrameProfiler::Statistics FrameProfiler::GetAchievementMemoryReadStatistics(ra::AchievementID nID) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    const auto iter = m_mAchievements.find(nID);
+    if (iter == m_mAchievements.end())
+        return Statistics{};
+
+    return iter->second.vMemoryReads.Calculate();
+}
+
+static void WriteStatistics(rapidjson::Writer<rapidjson::StringBuffer>& writer, const FrameProfiler::Statistics& stats)
+{
+    writer.StartObject();
+    writer.Key("p50");
+    writer.Double(stats.fP50);
+    writer.Key("p99");
+    writer.Double(stats.fP99);
+    writer.Key("max");
+    writer.Double(stats.fMax);
+    writer.Key("samples");
+    writer.Uint64(stats.nSamples);
+    writer.EndObject();
+}
+
+std::string FrameProfiler::ExportJson() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+
+    writer.Key("WindowSize");
+    writer.Uint(m_nWindowSize);
+
+    writer.Key("Frame");
+    WriteStatistics(writer, m_vFrameTimes.Calculate());
+
+    writer.Key("Sections");
+    writer.StartObject();
+    for (int i = 0; i < static_cast<int>(Section::NumSections); ++i)
+    {
+        writer.Key(SectionName(static_cast<Section>(i)));
+        WriteStatistics(writer, m_vSectionTimes[i].Calculate());
+    }
+    writer.EndObject();
+
+    struct AchievementStatistics
+    {
+        ra::AchievementID nID;
+        Statistics time;
+        Statistics reads;
+    };
+    std::vector<AchievementStatistics> vAchievements;
+    vAchievements.reserve(m_mAchievements.size());
+    for (const auto& pPair : m_mAchievements)
+        vAchievements.push_back({ pPair.first, pPair.second.vTimes.Calculate(), pPair.second.vMemoryReads.Calculate() });
+
+    std::sort(vAchievements.begin(), vAchievements.end(), [](const AchievementStatistics& a, const AchievementStatistics& b)
+    {
+        if (a.time.fP99 != b.time.fP99)
+            return a.time.fP99 > b.time.fP99;
+        return a.nID < b.nID;
+    });
+
+    writer.Key("Achievements");
+    writer.StartArray();
+    for (const auto& pAchievement : vAchievements)
+    {
+        writer.StartObject();
+        writer.Key("ID");
+        writer.Uint(pAchievement.nID);
+        writer.Key("Time");
+        WriteStatistics(writer, pAchievement.time);
+        writer.Key("MemoryReads");
+        WriteStatistics(writer, pAchievement.reads);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+void FrameProfiler::RollingWindow::Add(double fValue, unsigned int nWindowSize)
+{
+    if (m_vSamples.size() < nWindowSize)
+    {
+        m_vSamples.push_back(fValue);
+    }
+    else
+    {
+        m_vSamples[m_nNext] = fValue;
+        m_nNext = (m_nNext + 1) % m_vSamples.size();
+    }
+}
+
+FrameProfiler::Statistics FrameProfiler::RollingWindow::Calculate() const
+{
+    Statistics stats{};
+    stats.nSamples = m_vSamples.size();
+    if (m_vSamples.empty())
+        return stats;
+
+    // nearest-rank percentiles
+    std::vector<double> vSorted(m_vSamples);
+    std::sort(vSorted.begin(), vSorted.end());
+    const size_t nLast = vSorted.size() - 1;
+    stats.fP50 = vSorted[nLast * 50 / 100];
+    stats.fP99 = vSorted[nLast * 99 / 100];
+    stats.fMax = vSorted[nLast];
+    return stats;
+}
+
+ScopedProfilerSection::ScopedProfilerSection(FrameProfiler& pProfiler, FrameProfiler::Section nSection)
+    : m_pProfiler(pProfiler), m_nSection(nSection), m_bActive(pProfiler.IsEnabled())
+{
+    if (m_bActive)
+        m_tStart = FrameProfiler::Clock::now();
+}
+
+ScopedProfilerSection::~ScopedProfilerSection()
+{
+    if (m_bActive)
+        m_pProfiler.AddSectionTime(m_nSection, FrameProfiler::Clock::now() - m_tStart);
+}
+
+ScopedProfilerAchievement::ScopedProfilerAchievement(FrameProfiler& pProfiler, ra::AchievementID nID)
+    : m_pProfiler(pProfiler), m_nID(nID), m_nStartReads(0), m_bActive(pProfiler.IsEnabled())
+{
+    if (m_bActive)
+    {
+        m_nStartReads = g_MemManager.GetReadPlanCounters().nOperandReads;
+        m_tStart = FrameProfiler::Clock::now();
+    }
+}
+
+ScopedProfilerAchievement::~ScopedProfilerAchievement()
+{
+    if (m_bActive)
+    {
+        const auto tElapsed = FrameProfiler::Clock::now() - m_tStart;
+        m_pProfiler.AddAchievementCost(m_nID, tElapsed, g_MemManager.GetReadPlanCounters().nOperandReads - m_nStartReads);
+    }
+}
+
+} // namespace services
+} // namespace ra
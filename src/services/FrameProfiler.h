@@ -0,0 +1,218 @@
+#ifndef RA_SERVICES_FRAME_PROFILER_H
+#define RA_SERVICES_FRAME_PROFILER_H
+#pragma once
+
+#include "RA_Defs.h" // AchievementID
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ra {
+namespace services {
+
+class FrameProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Section
+    {
+        AchievementSet,
+        LeaderboardManager,
+        RichPresence,
+        MemoryDialog,
+
+        NumSections
+    };
+
+    /// <summary>
+    /// Gets the name of a section, as used by <see cref="ExportJson" />.
+    /// </summary>
+    static const char* SectionName(Section nSection);
+
+    /// <summary>
+    /// Enables or disables data collection. Disabling the profiler discards the collected data.
+    /// </summary>
+    void SetEnabled(bool bEnabled);
+
+    /// <summary>
+    /// Determines if data is being collected.
+    /// </summary>
+    bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+    /// <summary>
+    /// Sets the number of frames the statistics are calculated over.
+    /// </summary>
+    void SetWindowSize(unsigned int nFrames);
+
+    /// <summary>
+    /// Gets the number of frames the statistics are calculated over.
+    /// </summary>
+    unsigned int WindowSize() const { return m_nWindowSize; }
+
+    /// <summary>
+    /// Starts collecting data for a new frame.
+    /// </summary>
+    void BeginFrame();
+
+    /// <summary>
+    /// Adds the data collected since <see cref="BeginFrame" /> to the rolling window.
+    /// </summary>
+    void EndFrame();
+
+    /// <summary>
+    /// Adds time spent in a section to the current frame. May be called from any thread.
+    /// </summary>
+    void AddSectionTime(Section nSection, Clock::duration tElapsed);
+
+    /// <summary>
+    /// Adds the cost of evaluating an achievement to the current frame.
+    /// </summary>
+    /// <param name="nID">The achievement.</param>
+    /// <param name="tElapsed">The time spent evaluating the achievement.</param>
+    /// <param name="nMemoryReads">The number of memory values requested while evaluating the achievement.</param>
+    void AddAchievementCost(ra::AchievementID nID, Clock::duration tElapsed, unsigned int nMemoryReads);
+
+    struct Statistics
+    {
+        double fP50;        //	microseconds, or reads for memory read statistics
+        double fP99;
+        double fMax;
+        size_t nSamples;
+    };
+
+    /// <summary>
+    /// Gets the statistics for the total time of each frame in the window.
+    /// </summary>
+    Statistics GetFrameStatistics() const;
+
+    /// <summary>
+    /// Gets the statistics for the time spent in a section for each frame in the window.
+    /// </summary>
+    Statistics GetSectionStatistics(Section nSection) const;
+
+    /// <summary>
+    /// Gets the statistics for the time spent evaluating an achievement for each frame in the window
+    /// where it was evaluated.
+    /// </summary>
+    Statistics GetAchievementStatistics(ra::AchievementID nID) const;
+
+    /// <summary>
+    /// Gets the statistics for the memory reads of an achievement for each frame in the window where it
+    /// was evaluated.
+    /// </summary>
+    Statistics GetAchievementMemoryReadStatistics(ra::AchievementID nID) const;
+
+    /// <summary>
+    /// Returns the statistics for the frame, each section, and each achievement as a JSON object.
+    /// Achievements are sorted by their p99 time, most expensive first.
+    /// </summary>
+    std::string ExportJson() const;
+
+    /// <summary>
+    /// Discards the collected data.
+    /// </summary>
+    void Reset();
+
+private:
+    // fixed-size ring buffer of per-frame samples
+    class RollingWindow
+    {
+    public:
+        void Add(double fValue, unsigned int nWindowSize);
+        Statistics Calculate() const;
+        void Clear() { m_vSamples.clear(); m_nNext = 0; }
+
+    private:
+        std::vector<double> m_vSamples;
+        size_t m_nNext = 0;
+    };
+
+    struct AchievementProfile
+    {
+        RollingWindow vTimes;
+        RollingWindow vMemoryReads;
+        double fFrameTime = 0.0;
+        unsigned int nFrameMemoryReads = 0;
+        bool bEvaluated = false;
+    };
+
+    static double ToMicroseconds(Clock::duration tElapsed);
+
+    std::atomic<bool> m_bEnabled{ false };
+    unsigned int m_nWindowSize = 600;
+
+    mutable std::mutex m_mtx;
+    bool m_bInFrame = false;
+    Clock::time_point m_tFrameStart;
+    double m_fSectionTimes[static_cast<int>(Section::NumSections)]{};
+
+    RollingWindow m_vFrameTimes;
+    RollingWindow m_vSectionTimes[static_cast<int>(Section::NumSections)];
+    std::unordered_map<ra::AchievementID, AchievementProfile> m_mAchievements;
+};
+
+// adds the time until the end of the scope to a section of the frame profiler
+class ScopedProfilerSection
+{
+public:
+    explicit ScopedProfilerSection(FrameProfiler& pProfiler, FrameProfiler::Section nSection);
+    ~ScopedProfilerSection();
+
+private:
+    FrameProfiler& m_pProfiler;
+    FrameProfiler::Section m_nSection;
+    FrameProfiler::Clock::time_point m_tStart;
+    bool m_bActive;
+};
+
+// adds the time and memory reads until the end of the scope to an achievement in the frame profiler
+class ScopedProfilerAchievement
+{
+public:
+    explicit ScopedProfilerAchievement(FrameProfiler& pProfiler, ra::AchievementID nID);
+    ~ScopedProfilerAchievement();
+
+private:
+    FrameProfiler& m_pProfiler;
+    ra::AchievementID m_nID;
+    FrameProfiler::Clock::time_point m_tStart;
+    unsigned int m_nStartReads;
+    bool m_bActive;
+};
+
+// brackets a frame of the frame profiler
+class ScopedProfilerFrame
+{
+public:
+    explicit ScopedProfilerFrame(FrameProfiler& pProfiler) : m_pProfiler(pProfiler) { m_pProfiler.BeginFrame(); }
+    ~ScopedProfilerFrame() { m_pProfiler.EndFrame(); }
+
+private:
+    FrameProfiler& m_pProfiler;
+};
+
+} // namespace services
+} // namespace ra
+
+extern ra::services::FrameProfiler g_FrameProfiler;
+
+// the instrumentation can be removed entirely by defining RA_DISABLE_PROFILER
+#ifndef RA_DISABLE_PROFILER
+#define RA_PROFILE_FRAME() \
+    ra::services::ScopedProfilerFrame ra_profile_frame(g_FrameProfiler)
+#define RA_PROFILE_SECTION(nSection) \
+    ra::services::ScopedProfilerSection ra_profile_section(g_FrameProfiler, ra::services::FrameProfiler::Section::nSection)
+#define RA_PROFILE_ACHIEVEMENT(nID) \
+    ra::services::ScopedProfilerAchievement ra_profile_achievement(g_FrameProfiler, nID)
+#else
+#define RA_PROFILE_FRAME()
+#define RA_PROFILE_SECTION(nSection)
+#define RA_PROFILE_ACHIEVEMENT(nID)
+#endif
+
+#endif // !RA_SERVICES_FRAME_PROFILER_H
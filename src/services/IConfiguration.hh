@@ -18,6 +18,11 @@ enum class Feature
     LeaderboardCounters,
     LeaderboardScoreboards,
     PreferDecimal,
+    FrameSnapshot,
+    IncrementalEvaluation,
+    BatchEvaluation,
+    FrameProfiler,
+    ValueCache,
 };
 
 class IConfiguration {
@@ -2,22 +2,140 @@
 
 #include "RA_MemManager.h"
 
+#include "services\SpillFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RA_SEARCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RA_SEARCH_TARGET_AVX2
+#else
+#define RA_SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 namespace ra {
 namespace services {
 
 const unsigned int MAX_BLOCK_SIZE = 256 * 1024; // 256K
 
+// memory is captured and filtered this many chunks at a time, so large ranges don't need a copy of all of memory
+const unsigned int WINDOW_CHUNKS = (2 * 1024 * 1024) / SearchResults::CHUNK_SIZE; // 2M of memory
+
 static unsigned int Padding(ComparisonVariableSize size)
 {
-    switch (size)
+    return BytesForSize(size) - 1;
+}
+
+static size_t s_nMemoryBudget = 256 * 1024 * 1024; // 256M
+static std::atomic<size_t> s_nHeapChunkBytes{ 0 };
+
+void SearchResults::SetMemoryBudget(size_t nBytes)
+{
+    s_nMemoryBudget = nBytes;
+}
+
+class SearchResults::HeapChunk : public SearchResults::Chunk
+{
+public:
+    HeapChunk(const unsigned char* pBytes, unsigned int nBytes)
     {
-        case ThirtyTwoBit:
-            return 3;
-        case SixteenBit:
-            return 1;
-        default:
-            return 0;
+        memcpy(m_vBytes, pBytes, nBytes);
+        memset(m_vBytes + nBytes, 0, SIZE - nBytes);
+        s_nHeapChunkBytes += sizeof(HeapChunk);
+    }
+
+    ~HeapChunk() override
+    {
+        s_nHeapChunkBytes -= sizeof(HeapChunk);
+    }
+
+    const unsigned char* Bytes(std::shared_ptr<const void>&) const override { return m_vBytes; }
+    size_t HeapBytes() const override { return sizeof(HeapChunk); }
+
+private:
+    unsigned char m_vBytes[SIZE];
+};
+
+class SearchResults::SpilledChunk : public SearchResults::Chunk
+{
+public:
+    SpilledChunk(std::shared_ptr<SpillFile> pSpillFile, unsigned int nSlot)
+        : m_pSpillFile(std::move(pSpillFile)), m_nSlot(nSlot)
+    {
+    }
+
+    ~SpilledChunk() override
+    {
+        m_pSpillFile->Free(m_nSlot);
+    }
+
+    const unsigned char* Bytes(std::shared_ptr<const void>& pPin) const override
+    {
+        // if the view can't be mapped, the values read as zero rather than crashing
+        static const unsigned char vEmpty[SIZE] = {};
+        const unsigned char* pBytes = m_pSpillFile->Read(m_nSlot, pPin);
+        return (pBytes != nullptr) ? pBytes : vEmpty;
+    }
+
+    size_t HeapBytes() const override { return sizeof(SpilledChunk); }
+
+private:
+    // the file is shared by all spilled chunks, and is closed when the last of them is destroyed
+    std::shared_ptr<SpillFile> m_pSpillFile;
+    unsigned int m_nSlot;
+};
+
+class SearchResults::BufferChunk : public SearchResults::Chunk
+{
+public:
+    // pBytes points into a buffer that it shares ownership of
+    explicit BufferChunk(std::shared_ptr<const unsigned char> pBytes) : m_pBytes(std::move(pBytes)) {}
+
+    const unsigned char* Bytes(std::shared_ptr<const void>&) const override { return m_pBytes.get(); }
+    size_t HeapBytes() const override { return sizeof(BufferChunk); }
+
+private:
+    std::shared_ptr<const unsigned char> m_pBytes;
+};
+
+std::shared_ptr<const SearchResults::Chunk> SearchResults::CreateChunk(const unsigned char* pBytes, unsigned int nBytes)
+{
+    if (s_nHeapChunkBytes.load(std::memory_order_relaxed) + sizeof(HeapChunk) > s_nMemoryBudget)
+    {
+        static std::weak_ptr<SpillFile> s_pSpillFile;
+        static std::mutex s_mtxSpillFile;
+
+        std::shared_ptr<SpillFile> pSpillFile;
+        {
+            std::lock_guard<std::mutex> lock(s_mtxSpillFile);
+            pSpillFile = s_pSpillFile.lock();
+            if (pSpillFile == nullptr)
+            {
+                pSpillFile = std::make_shared<SpillFile>(Chunk::SIZE);
+                s_pSpillFile = pSpillFile;
+            }
+        }
+
+        unsigned char vBytes[Chunk::SIZE];
+        memcpy(vBytes, pBytes, nBytes);
+        memset(vBytes + nBytes, 0, Chunk::SIZE - nBytes);
+
+        // if the file couldn't be written, keep the chunk in the heap
+        const unsigned int nSlot = pSpillFile->Write(vBytes);
+        if (nSlot != SpillFile::INVALID_SLOT)
+            return std::make_shared<SpilledChunk>(std::move(pSpillFile), nSlot);
     }
+
+    return std::make_shared<HeapChunk>(pBytes, nBytes);
 }
 
 void SearchResults::Initialize(unsigned int nAddress, unsigned int nBytes, ComparisonVariableSize nSize)
@@ -32,7 +150,7 @@ void SearchResults::Initialize(unsigned int nAddress, unsigned int nBytes, Compa
         nBytes = g_MemManager.TotalBankSize() - nAddress;
 
     unsigned int nPadding = Padding(nSize);
-    nBytes -= nPadding;
+    nBytes = (nBytes > nPadding) ? nBytes - nPadding : 0;
 
     m_sSummary.reserve(64);
     m_sSummary.append("Cleared: (");
@@ -44,42 +162,84 @@ void SearchResults::Initialize(unsigned int nAddress, unsigned int nBytes, Compa
         m_sSummary.append(std::to_string(nBytes));
     m_sSummary.append(" RAM locations.");
 
-    while (nBytes > 0)
+    m_nStartAddress = nAddress;
+    m_nEndAddress = nAddress + nBytes;
+    m_vChunks.resize(ChunkCount());
+
+    if (m_vChunks.empty())
+        return;
+
+    std::vector<unsigned char> vMemory;
+    m_nChunkBytes = 0;
+
+    const unsigned int nChunks = static_cast<unsigned int>(m_vChunks.size());
+    for (unsigned int nWindow = 0; nWindow < nChunks; nWindow += WINDOW_CHUNKS)
     {
-        auto nBlockSize = (nBytes > MAX_BLOCK_SIZE) ? MAX_BLOCK_SIZE : nBytes;
-        auto& block = AddBlock(nAddress, nBlockSize + nPadding);
-        g_MemManager.ActiveBankRAMRead(block.GetBytes(), block.GetAddress(), nBlockSize + nPadding);
+        const unsigned int nWindowOffset = nWindow * CHUNK_SIZE;
+        const unsigned int nWindowBytes = std::min(WINDOW_CHUNKS * CHUNK_SIZE, nBytes - nWindowOffset) + nPadding;
+        vMemory.resize(nWindowBytes);
+        g_MemManager.ActiveBankRAMRead(vMemory.data(), nAddress + nWindowOffset, nWindowBytes);
 
-        nAddress += nBlockSize;
-        nBytes -= nBlockSize;
+        const unsigned int nLast = std::min(nWindow + WINDOW_CHUNKS, nChunks);
+        for (unsigned int i = nWindow; i < nLast; ++i)
+        {
+            const unsigned int nOffset = (i - nWindow) * CHUNK_SIZE;
+            m_vChunks[i] = CreateChunk(vMemory.data() + nOffset, std::min(CHUNK_SIZE + nPadding, nWindowBytes - nOffset));
+            m_nChunkBytes += m_vChunks[i]->HeapBytes();
+        }
     }
 }
 
-SearchResults::MemBlock& SearchResults::AddBlock(unsigned int nAddress, unsigned int nSize)
+const SearchResults::Chunk* SearchResults::GetChunk(unsigned int nAddress) const
 {
-    m_vBlocks.emplace_back(nAddress, nSize);
-    return m_vBlocks.back();
+    if (nAddress < m_nStartAddress || nAddress >= m_nEndAddress)
+        return nullptr;
+
+    return m_vChunks[(nAddress - m_nStartAddress) / CHUNK_SIZE].get();
 }
 
-static bool Compare(unsigned int nLeft, unsigned int nRight, ComparisonType nCompareType)
+void SearchResults::ReadChunks(const SearchResults& srSource, unsigned int nFirst, unsigned int nCount,
+    std::vector<unsigned char>& vMemory) const
 {
-    switch (nCompareType)
+    // chunk nFirst + i is read to vMemory[i * CHUNK_SIZE]. runs of consecutive chunks are read together.
+    const unsigned int nEndByte = m_nEndAddress + Padding(m_nSize);
+    vMemory.assign(nCount * CHUNK_SIZE + 3, 0);
+
+    const unsigned int nLast = nFirst + nCount;
+    unsigned int nIndex = nFirst;
+    while (nIndex < nLast)
     {
-        case Equals:
-            return nLeft == nRight;
-        case LessThan:
-            return nLeft < nRight;
-        case LessThanOrEqual:
-            return nLeft <= nRight;
-        case GreaterThan:
-            return nLeft > nRight;
-        case GreaterThanOrEqual:
-            return nLeft >= nRight;
-        case NotEqualTo:
-            return nLeft != nRight;
-        default:
-            return false;
+        if (!srSource.m_vChunks[nIndex])
+        {
+            ++nIndex;
+            continue;
+        }
+
+        const unsigned int nRunStart = nIndex;
+        while (nIndex < nLast && srSource.m_vChunks[nIndex])
+            ++nIndex;
+
+        const unsigned int nAddress = m_nStartAddress + nRunStart * CHUNK_SIZE;
+        const unsigned int nBytes = std::min(m_nStartAddress + nIndex * CHUNK_SIZE + Padding(m_nSize), nEndByte) - nAddress;
+        g_MemManager.ActiveBankRAMRead(vMemory.data() + (nRunStart - nFirst) * CHUNK_SIZE, nAddress, nBytes);
+    }
+}
+
+void SearchResults::SetChunk(const SearchResults& srSource, unsigned int nIndex, const unsigned char* pMemory)
+{
+    const unsigned int nAddress = m_nStartAddress + nIndex * CHUNK_SIZE;
+    const unsigned int nBytes = std::min(CHUNK_SIZE + Padding(m_nSize), m_nEndAddress + Padding(m_nSize) - nAddress);
+
+    // if nothing in the chunk has changed, share it with the source
+    const auto& pSourceChunk = srSource.m_vChunks[nIndex];
+    std::shared_ptr<const void> pPin;
+    if (memcmp(pSourceChunk->Bytes(pPin), pMemory, nBytes) == 0)
+    {
+        m_vChunks[nIndex] = pSourceChunk;
+        return;
     }
+
+    m_vChunks[nIndex] = CreateChunk(pMemory, nBytes);
 }
 
 static const char* ComparisonString(ComparisonType nCompareType)
@@ -103,19 +263,22 @@ static const char* ComparisonString(ComparisonType nCompareType)
     }
 }
 
+template<ComparisonVariableSize nSize>
+static inline unsigned int ReadValue(const unsigned char* pBuffer, unsigned int nOffset);
+
 static unsigned int GetValue(const unsigned char* pBuffer, unsigned int nOffset, ComparisonVariableSize nSize)
 {
     switch (nSize)
     {
-        case EightBit:
-            return pBuffer[nOffset];
-
-        case SixteenBit:
-            return pBuffer[nOffset] | (pBuffer[nOffset + 1] << 8);
-
-        case ThirtyTwoBit:
-            return pBuffer[nOffset] | (pBuffer[nOffset + 1] << 8) |
-                (pBuffer[nOffset + 2] << 16) | (pBuffer[nOffset + 3] << 24);
+        case EightBit:              return ReadValue<EightBit>(pBuffer, nOffset);
+        case SixteenBit:            return ReadValue<SixteenBit>(pBuffer, nOffset);
+        case ThirtyTwoBit:          return ReadValue<ThirtyTwoBit>(pBuffer, nOffset);
+        case SixteenBitBE:          return ReadValue<SixteenBitBE>(pBuffer, nOffset);
+        case ThirtyTwoBitBE:        return ReadValue<ThirtyTwoBitBE>(pBuffer, nOffset);
+        case SignedEightBit:        return ReadValue<SignedEightBit>(pBuffer, nOffset);
+        case SignedSixteenBit:      return ReadValue<SignedSixteenBit>(pBuffer, nOffset);
+        case SignedThirtyTwoBit:    return ReadValue<SignedThirtyTwoBit>(pBuffer, nOffset);
+        case Float:                 return ReadValue<Float>(pBuffer, nOffset);
 
         case Nibble_Upper:
             return pBuffer[nOffset] >> 4;
@@ -130,332 +293,1725 @@ static unsigned int GetValue(const unsigned char* pBuffer, unsigned int nOffset,
 
 bool SearchResults::ContainsAddress(unsigned int nAddress) const
 {
-    if (!m_bUnfiltered)
-    {
-        if (m_nSize != Nibble_Lower)
-            return std::binary_search(m_vMatchingAddresses.begin(), m_vMatchingAddresses.end(), nAddress);
+    if (m_bUnfiltered)
+        return (nAddress >= m_nStartAddress && nAddress < m_nEndAddress);
 
-        nAddress <<= 1;
-        const auto iter = std::lower_bound(m_vMatchingAddresses.begin(), m_vMatchingAddresses.end(), nAddress);
-        return (iter != m_vMatchingAddresses.end() && (*iter == nAddress || *iter == (nAddress | 1)));
-    }
+    if (!m_pMatchingAddresses)
+        return false;
 
-    unsigned int nPadding = Padding(m_nSize);
-    for (const auto& block : m_vBlocks)
-    {
-        if (block.GetAddress() > nAddress)
-            return false;
-        if (nAddress < block.GetAddress() + block.GetSize() - nPadding)
-            return true;
-    }
+    if (m_nSize != Nibble_Lower)
+        return m_pMatchingAddresses->Contains(nAddress);
 
-    return false;
+    nAddress <<= 1;
+    return m_pMatchingAddresses->Contains(nAddress) || m_pMatchingAddresses->Contains(nAddress | 1);
 }
 
-void SearchResults::AddMatches(unsigned int nAddressBase, const unsigned char pMemory[], const std::vector<unsigned int>& vMatches)
+void SearchResults::ResetMatchingAddresses(const SearchResults& srSource)
 {
-    unsigned int nBlockSize = vMatches.back() - vMatches.front() + Padding(m_nSize) + 1;
-    MemBlock& block = AddBlock(nAddressBase + vMatches.front(), nBlockSize);
-    memcpy(block.GetBytes(), pMemory + vMatches.front(), nBlockSize);
+    // the matches are a subset of the source, so they cover the same range
+    m_nStartAddress = srSource.m_nStartAddress;
+    m_nEndAddress = srSource.m_nEndAddress;
+    m_vChunks.resize(ChunkCount());
 
-    for (auto nMatch : vMatches)
-        m_vMatchingAddresses.push_back(nAddressBase + nMatch);
+    m_pMatchingAddresses = std::make_shared<AddressSet>();
+    if (m_nSize == Nibble_Lower)
+        m_pMatchingAddresses->Reset(m_nStartAddress << 1, (m_nEndAddress - m_nStartAddress) << 1);
+    else
+        m_pMatchingAddresses->Reset(m_nStartAddress, m_nEndAddress - m_nStartAddress);
 }
 
-void SearchResults::ProcessBlocks(const SearchResults& srSource, std::function<bool(unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])> testIndexFunction)
-{
-    std::vector<unsigned int> vMatches;
-    std::vector<unsigned char> vMemory;
-    unsigned int nPadding = Padding(m_nSize);
-
-    for (auto& block : srSource.m_vBlocks)
-    {
-        if (block.GetSize() > vMemory.capacity())
-            vMemory.reserve(block.GetSize());
-
-        unsigned char* pMemory = vMemory.data();
-        const unsigned char* pPrev = block.GetBytes();
+// filter kernels. each one evaluates nCount addresses of a block and sets bit (i % 32) of pBits[i / 32]
+// for each match. they're specialized at compile time on the size, comparison and whether the comparison
+// is against the previous value, so the inner loops have no branches other than the loop itself.
+typedef void (*FilterKernel)(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits);
 
-        g_MemManager.ActiveBankRAMRead(pMemory, block.GetAddress(), block.GetSize());
-
-        for (unsigned int i = 0; i < block.GetSize() - nPadding; ++i)
-        {
-            if (!testIndexFunction(i, pMemory, pPrev))
-                continue;
+// reads the value at pBuffer[nOffset]. signed values are sign extended, and floats are returned as their bits.
+template<ComparisonVariableSize nSize>
+static inline unsigned int ReadValue(const unsigned char* pBuffer, unsigned int nOffset)
+{
+    if constexpr (nSize == EightBit)
+        return pBuffer[nOffset];
+    else if constexpr (nSize == SignedEightBit)
+        return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(pBuffer[nOffset])));
+    else if constexpr (nSize == SixteenBit)
+        return pBuffer[nOffset] | (pBuffer[nOffset + 1] << 8);
+    else if constexpr (nSize == SignedSixteenBit)
+        return static_cast<unsigned int>(static_cast<int>(static_cast<short>(pBuffer[nOffset] | (pBuffer[nOffset + 1] << 8))));
+    else if constexpr (nSize == SixteenBitBE)
+        return (pBuffer[nOffset] << 8) | pBuffer[nOffset + 1];
+    else if constexpr (nSize == ThirtyTwoBitBE)
+        return (static_cast<unsigned int>(pBuffer[nOffset]) << 24) | (pBuffer[nOffset + 1] << 16) | (pBuffer[nOffset + 2] << 8) | pBuffer[nOffset + 3];
+    else
+        return pBuffer[nOffset] | (pBuffer[nOffset + 1] << 8) | (pBuffer[nOffset + 2] << 16) | (static_cast<unsigned int>(pBuffer[nOffset + 3]) << 24);
+}
 
-            unsigned int nAddress = block.GetAddress() + i;
-            if (!srSource.ContainsAddress(nAddress))
-                continue;
+template<ComparisonType nCompareType, typename T>
+static inline bool CompareValues(T nLeft, T nRight)
+{
+    if constexpr (nCompareType == Equals)
+        return nLeft == nRight;
+    else if constexpr (nCompareType == LessThan)
+        return nLeft < nRight;
+    else if constexpr (nCompareType == LessThanOrEqual)
+        return nLeft <= nRight;
+    else if constexpr (nCompareType == GreaterThan)
+        return nLeft > nRight;
+    else if constexpr (nCompareType == GreaterThanOrEqual)
+        return nLeft >= nRight;
+    else
+        return nLeft != nRight;
+}
 
-            if (!vMatches.empty() && (i - vMatches.back()) > 16)
-            {
-                AddMatches(block.GetAddress(), pMemory, vMatches);
-                vMatches.clear();
-            }
+static inline float AsFloat(unsigned int nBits)
+{
+    float fValue;
+    memcpy(&fValue, &nBits, sizeof(fValue));
+    return fValue;
+}
 
-            vMatches.push_back(i);
-        }
+// compares two values returned by ReadValue as the type they represent
+template<ComparisonVariableSize nSize, ComparisonType nCompareType>
+static inline bool CompareTyped(unsigned int nLeft, unsigned int nRight)
+{
+    if constexpr (nSize == Float)
+        return CompareValues<nCompareType>(AsFloat(nLeft), AsFloat(nRight));
+    else if constexpr (IsSignedSize(nSize))
+        return CompareValues<nCompareType>(static_cast<int>(nLeft), static_cast<int>(nRight));
+    else
+        return CompareValues<nCompareType>(nLeft, nRight);
+}
 
-        if (!vMatches.empty())
-        {
-            AddMatches(block.GetAddress(), pMemory, vMatches);
-            vMatches.clear();
-        }
+template<ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious>
+static void FilterScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nStart, unsigned int nCount, unsigned int* pBits)
+{
+    for (unsigned int i = nStart; i < nCount; ++i)
+    {
+        const unsigned int nRight = bPrevious ? ReadValue<nSize>(pPrev, i) : nTestValue;
+        if (CompareTyped<nSize, nCompareType>(ReadValue<nSize>(pMemory, i), nRight))
+            pBits[i >> 5] |= (1U << (i & 31));
     }
 }
 
-void SearchResults::AddMatchesNibbles(unsigned int nAddressBase, const unsigned char pMemory[], const std::vector<unsigned int>& vMatches)
+template<ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious>
+static void FilterBlockScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits)
 {
-    unsigned int nBlockSize = (vMatches.back() >> 1) - (vMatches.front() >> 1) + Padding(m_nSize) + 1;
-    auto& block = AddBlock((nAddressBase + vMatches.front()) >> 1, nBlockSize);
-    memcpy(block.GetBytes(), pMemory + (vMatches.front() >> 1), nBlockSize);
-
-    for (auto nMatch : vMatches)
-        m_vMatchingAddresses.push_back(nAddressBase + nMatch);
+    FilterScalar<nSize, nCompareType, bPrevious>(pMemory, pPrev, nTestValue, 0, nCount, pBits);
 }
 
-void SearchResults::ProcessBlocksNibbles(const SearchResults& srSource, unsigned int nTestValue, ComparisonType nCompareType)
+// the fused filters. the parameters are prepared by PrepareFilter, which reduces DecreasedBy to IncreasedBy
+// and parameters that can't match to an empty range, so the kernels only have to handle the simple cases.
+static constexpr unsigned int ValueMask(ComparisonVariableSize nSize)
 {
-    std::vector<unsigned int> vMatches;
-    std::vector<unsigned char> vMemory;
-    unsigned int nPadding = Padding(m_nSize);
-
-    for (auto& block : srSource.m_vBlocks)
-    {
-        if (block.GetSize() > vMemory.capacity())
-            vMemory.reserve(block.GetSize());
+    return (nSize == Nibble_Lower || nSize == Nibble_Upper) ? 0x0FU :
+        (BytesForSize(nSize) == 1) ? 0xFFU : (BytesForSize(nSize) == 2) ? 0xFFFFU : 0xFFFFFFFFU;
+}
 
-        unsigned char* pMemory = vMemory.data();
-        const unsigned char* pPrev = block.GetBytes();
+struct FusedFilter
+{
+    SearchResults::FilterType nType;
+    unsigned int nParam1;
+    unsigned int nParam2;
+};
 
-        g_MemManager.ActiveBankRAMRead(pMemory, block.GetAddress(), block.GetSize());
+static FusedFilter PrepareFilter(SearchResults::FilterType nFilterType, unsigned int nParam, unsigned int nParam2, ComparisonVariableSize nSize)
+{
+    const FusedFilter pNoMatches = { SearchResults::FilterType::InRange, 1U, 0U };
+    const unsigned int nMask = ValueMask(nSize);
 
-        for (unsigned int i = 0; i < block.GetSize() - nPadding; ++i)
-        {
-            unsigned int nValue1 = pMemory[i];
-            unsigned int nValue2 = (nTestValue > 15) ? (pPrev[i] & 0x0F) : nTestValue;
+    // float parameters are the bits of the float. negating a float flips its sign bit.
+    const unsigned int nNegated = (nSize == Float) ? (nParam ^ 0x80000000) : ((0U - nParam) & nMask);
 
-            if (Compare(nValue1 & 0x0F, nValue2, nCompareType))
+    // differences wrap around, so a value that went from 0xFF to 0x01 increased by 2
+    switch (nFilterType)
+    {
+        case SearchResults::FilterType::ChangedBy:
+            if (nParam > nMask)
+                return pNoMatches;
+            return { nFilterType, nParam, nNegated };
+
+        case SearchResults::FilterType::IncreasedBy:
+            if (nParam > nMask)
+                return pNoMatches;
+            return { nFilterType, nParam, 0U };
+
+        case SearchResults::FilterType::DecreasedBy:
+            if (nParam > nMask)
+                return pNoMatches;
+            return { SearchResults::FilterType::IncreasedBy, nNegated, 0U };
+
+        case SearchResults::FilterType::InRange:
+            if (nSize == Float)
+                return { nFilterType, nParam, nParam2 };
+
+            if (IsSignedSize(nSize))
             {
-                unsigned int nAddress = (block.GetAddress() + i) << 1;
-                if (srSource.ContainsAddress(nAddress >> 1))
-                {
-                    if (!vMatches.empty() && (i - (vMatches.back() >> 1)) > 16)
-                    {
-                        AddMatchesNibbles(block.GetAddress() << 1, pMemory, vMatches);
-                        vMatches.clear();
-                    }
-
-                    vMatches.push_back(i << 1);
-                }
+                // clamp the bounds to the values the size can hold so they fit in the vector lanes
+                const int nMax = static_cast<int>(nMask >> 1);
+                const int nLow = std::max(static_cast<int>(nParam), -nMax - 1);
+                const int nHigh = std::min(static_cast<int>(nParam2), nMax);
+                if (nLow > nHigh)
+                    return pNoMatches;
+                return { nFilterType, static_cast<unsigned int>(nLow), static_cast<unsigned int>(nHigh) };
             }
 
-            if (nTestValue > 15)
-                nValue2 = pPrev[i] >> 4;
-
-            if (Compare(nValue1 >> 4, nValue2, nCompareType))
-            {
-                unsigned int nAddress = ((block.GetAddress() + i) << 1) | 1;
-                if (srSource.ContainsAddress(nAddress >> 1))
-                {
-                    if (!vMatches.empty() && (i - (vMatches.back() >> 1)) > 16)
-                    {
-                        AddMatchesNibbles(block.GetAddress() << 1, pMemory, vMatches);
-                        vMatches.clear();
-                    }
+            if (nParam > nParam2 || nParam > nMask)
+                return pNoMatches;
+            return { nFilterType, nParam, std::min(nParam2, nMask) };
 
-                    vMatches.push_back((i << 1) | 1);
-                }
-            }
-        }
+        case SearchResults::FilterType::BitChanged:
+            if (nParam >= 32 || ((1U << nParam) & nMask) == 0)
+                return pNoMatches;
+            return { nFilterType, 1U << nParam, 0U };
 
-        if (!vMatches.empty())
-        {
-            AddMatchesNibbles(block.GetAddress() << 1, pMemory, vMatches);
-            vMatches.clear();
-        }
+        default:
+            return pNoMatches;
     }
 }
 
-
-void SearchResults::Initialize(const SearchResults& srSource, ComparisonType nCompareType, unsigned int nTestValue)
+template<ComparisonVariableSize nSize>
+static inline bool FilterMatches(SearchResults::FilterType nFilterType, unsigned int nValue, unsigned int nPrevious,
+    unsigned int nParam1, unsigned int nParam2)
 {
-    m_nSize = srSource.m_nSize;
+    constexpr unsigned int nMask = ValueMask(nSize);
 
-    switch (m_nSize)
+    switch (nFilterType)
     {
-        case Nibble_Lower:
-            ProcessBlocksNibbles(srSource, nTestValue & 0x0F, nCompareType);
-            break;
-
-        case EightBit:
-            ProcessBlocks(srSource, [nTestValue, nCompareType](unsigned int nIndex, const unsigned char pMemory[], [[maybe_unused]] const unsigned char[])
+        case SearchResults::FilterType::ChangedBy:
+            if constexpr (nSize == Float)
             {
-                return Compare(pMemory[nIndex], nTestValue, nCompareType);
-            });
-            break;
-
-        case SixteenBit:
-            ProcessBlocks(srSource, [nTestValue, nCompareType](unsigned int nIndex, const unsigned char pMemory[], [[maybe_unused]] const unsigned char[])
+                const float fDelta = AsFloat(nValue) - AsFloat(nPrevious);
+                return (fDelta == AsFloat(nParam1) || fDelta == AsFloat(nParam2));
+            }
+            else
             {
-                unsigned int nValue = pMemory[nIndex] | (pMemory[nIndex + 1] << 8);
-                return Compare(nValue, nTestValue, nCompareType);
-            });
-            break;
+                const unsigned int nDelta = (nValue - nPrevious) & nMask;
+                return (nDelta == nParam1 || nDelta == nParam2);
+            }
 
-        case ThirtyTwoBit:
-            ProcessBlocks(srSource, [nTestValue, nCompareType](unsigned int nIndex, const unsigned char pMemory[], [[maybe_unused]] const unsigned char[])
-            {
-                unsigned int nValue = pMemory[nIndex] | (pMemory[nIndex + 1] << 8) |
-                    (pMemory[nIndex + 2] << 16) | (pMemory[nIndex + 3] << 24);
-                return Compare(nValue, nTestValue, nCompareType);
-            });
-            break;
-    }
+        case SearchResults::FilterType::IncreasedBy:
+            if constexpr (nSize == Float)
+                return (AsFloat(nValue) - AsFloat(nPrevious)) == AsFloat(nParam1);
+            else
+                return ((nValue - nPrevious) & nMask) == nParam1;
 
-    m_sSummary.reserve(64);
-    m_sSummary.append("Filtering for ");
-    m_sSummary.append(ComparisonString(nCompareType));
-    m_sSummary.append(" ");
-    m_sSummary.append(std::to_string(nTestValue));
-    m_sSummary.append("...");
+        case SearchResults::FilterType::InRange:
+            if constexpr (nSize == Float)
+                return (AsFloat(nValue) >= AsFloat(nParam1) && AsFloat(nValue) <= AsFloat(nParam2));
+            else if constexpr (IsSignedSize(nSize))
+                return (static_cast<int>(nValue) >= static_cast<int>(nParam1) && static_cast<int>(nValue) <= static_cast<int>(nParam2));
+            else
+                return (nValue >= nParam1 && nValue <= nParam2);
+
+        case SearchResults::FilterType::BitChanged:
+            return ((nValue ^ nPrevious) & nParam1) != 0;
+
+        default:
+            return false;
+    }
 }
 
-void SearchResults::Initialize(const SearchResults& srSource, ComparisonType nCompareType)
-{
-    m_nSize = srSource.m_nSize;
+typedef void (*FusedKernel)(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nCount, unsigned int* pBits);
 
-    if (m_nSize == EightBit)
+template<ComparisonVariableSize nSize, SearchResults::FilterType nFilterType>
+static void FusedScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nStart, unsigned int nCount, unsigned int* pBits)
+{
+    for (unsigned int i = nStart; i < nCount; ++i)
     {
-        // efficient comparisons for 8-bit
-        switch (nCompareType)
-        {
-            case Equals:
-                ProcessBlocks(srSource, [](unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])
-                {
-                    return pMemory[nIndex] == pPrev[nIndex];
-                });
-                break;
+        if (FilterMatches<nSize>(nFilterType, ReadValue<nSize>(pMemory, i), ReadValue<nSize>(pPrev, i), nParam1, nParam2))
+            pBits[i >> 5] |= (1U << (i & 31));
+    }
+}
 
-            case NotEqualTo:
-                ProcessBlocks(srSource, [](unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])
-                {
-                    return pMemory[nIndex] != pPrev[nIndex];
-                });
-                break;
+template<ComparisonVariableSize nSize, SearchResults::FilterType nFilterType>
+static void FusedBlockScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nCount, unsigned int* pBits)
+{
+    FusedScalar<nSize, nFilterType>(pMemory, pPrev, nParam1, nParam2, 0, nCount, pBits);
+}
 
-            default:
-                ProcessBlocks(srSource, [nCompareType](unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])
-                {
-                    return Compare(pMemory[nIndex], pPrev[nIndex], nCompareType);
-                });
-                break;
-        }
-    }
-    else if (m_nSize == Nibble_Lower)
+// nibble kernels. the lower and upper nibbles of the byte at offset i are the nibble addresses 2i and 2i + 1,
+// so they set bits (2i % 32) and (2i % 32 + 1) of pBits[i / 16], and nCount bytes fill 2 * nCount bits.
+// constants are masked to a nibble by the caller.
+template<ComparisonType nCompareType, bool bPrevious>
+static void FilterNibblesScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nStart, unsigned int nCount, unsigned int* pBits)
+{
+    for (unsigned int i = nStart; i < nCount; ++i)
     {
-        // special logic for nibbles
-        ProcessBlocksNibbles(srSource, 0xFFFF, nCompareType);
+        const unsigned int nLower = bPrevious ? (pPrev[i] & 0x0FU) : nTestValue;
+        const unsigned int nUpper = bPrevious ? (pPrev[i] >> 4) : nTestValue;
+        if (CompareValues<nCompareType>(pMemory[i] & 0x0FU, nLower))
+            pBits[i >> 4] |= (1U << ((i & 15) << 1));
+        if (CompareValues<nCompareType>(static_cast<unsigned int>(pMemory[i] >> 4), nUpper))
+            pBits[i >> 4] |= (2U << ((i & 15) << 1));
     }
-    else
+}
+
+template<ComparisonType nCompareType, bool bPrevious>
+static void FilterNibblesBlockScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits)
+{
+    FilterNibblesScalar<nCompareType, bPrevious>(pMemory, pPrev, nTestValue, 0, nCount, pBits);
+}
+
+template<SearchResults::FilterType nFilterType>
+static void FusedNibblesScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nStart, unsigned int nCount, unsigned int* pBits)
+{
+    for (unsigned int i = nStart; i < nCount; ++i)
     {
-        // generic handling for 16-bit and 32-bit
-        ProcessBlocks(srSource, [nCompareType, nSize = m_nSize](unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])
-        {
-            auto nValue = GetValue(pMemory, nIndex, nSize);
-            auto nPrevValue = GetValue(pPrev, nIndex, nSize);
-            return Compare(nValue, nPrevValue, nCompareType);
-        });
+        if (FilterMatches<Nibble_Lower>(nFilterType, pMemory[i] & 0x0FU, pPrev[i] & 0x0FU, nParam1, nParam2))
+            pBits[i >> 4] |= (1U << ((i & 15) << 1));
+        if (FilterMatches<Nibble_Lower>(nFilterType, pMemory[i] >> 4, pPrev[i] >> 4, nParam1, nParam2))
+            pBits[i >> 4] |= (2U << ((i & 15) << 1));
     }
-
-    m_sSummary.reserve(64);
-    m_sSummary.append("Filtering for ");
-    m_sSummary.append(ComparisonString(nCompareType));
-    m_sSummary.append(" last known value...");
 }
 
-unsigned int SearchResults::MatchingAddressCount()
+template<SearchResults::FilterType nFilterType>
+static void FusedNibblesBlockScalar(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nCount, unsigned int* pBits)
 {
-    if (!m_bUnfiltered)
-        return m_vMatchingAddresses.size();
+    FusedNibblesScalar<nFilterType>(pMemory, pPrev, nParam1, nParam2, 0, nCount, pBits);
+}
 
-    unsigned int nPadding = Padding(m_nSize);
-    unsigned int nCount = 0;
-    for (auto& block : m_vBlocks)
-        nCount += block.GetSize() - nPadding;
+#ifdef RA_SEARCH_X86
 
-    if (m_nSize == Nibble_Lower)
-        nCount *= 2;
+// the SSE2 and AVX2 integer compares are signed, so unsigned values are biased by the sign bit to get an
+// unsigned ordering. signed values are compared as they are. floats use the float compares.
+static constexpr unsigned int LaneBias(ComparisonVariableSize nSize)
+{
+    return (IsSignedSize(nSize)) ? 0U : ValueMask(nSize) ^ (ValueMask(nSize) >> 1);
+}
 
-    return nCount;
+template<ComparisonVariableSize nSize>
+static inline __m128i SplatLanes(unsigned int nValue)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+        return _mm_set1_epi8(static_cast<char>(nValue));
+    else if constexpr (BytesForSize(nSize) == 2)
+        return _mm_set1_epi16(static_cast<short>(nValue));
+    else
+        return _mm_set1_epi32(static_cast<int>(nValue));
 }
 
-void SearchResults::ExcludeAddress(unsigned int nAddress)
+template<ComparisonVariableSize nSize>
+static inline __m128i BiasLanes(__m128i nValues)
 {
-    if (!m_bUnfiltered)
-        m_vMatchingAddresses.erase(std::remove(m_vMatchingAddresses.begin(), m_vMatchingAddresses.end(), nAddress), m_vMatchingAddresses.end());
+    if constexpr (LaneBias(nSize) != 0)
+        return _mm_xor_si128(nValues, SplatLanes<nSize>(LaneBias(nSize)));
+    else
+        return nValues;
 }
 
-void SearchResults::ExcludeMatchingAddress(unsigned int nIndex)
+// each returns an all-ones lane where the comparison is true
+template<ComparisonType nCompareType>
+static inline __m128i CompareLanes8(__m128i nLeft, __m128i nRight)
 {
-    if (!m_bUnfiltered)
-        m_vMatchingAddresses.erase(m_vMatchingAddresses.begin() + nIndex);
+    if constexpr (nCompareType == Equals)
+        return _mm_cmpeq_epi8(nLeft, nRight);
+    else if constexpr (nCompareType == NotEqualTo)
+        return _mm_xor_si128(_mm_cmpeq_epi8(nLeft, nRight), _mm_set1_epi32(-1));
+    else if constexpr (nCompareType == LessThan)
+        return _mm_cmpgt_epi8(nRight, nLeft);
+    else if constexpr (nCompareType == GreaterThan)
+        return _mm_cmpgt_epi8(nLeft, nRight);
+    else if constexpr (nCompareType == LessThanOrEqual)
+        return _mm_xor_si128(_mm_cmpgt_epi8(nLeft, nRight), _mm_set1_epi32(-1));
+    else
+        return _mm_xor_si128(_mm_cmpgt_epi8(nRight, nLeft), _mm_set1_epi32(-1));
 }
 
-bool SearchResults::GetMatchingAddress(unsigned int nIndex, _Out_ SearchResults::Result& result)
+template<ComparisonType nCompareType>
+static inline __m128i CompareLanes16(__m128i nLeft, __m128i nRight)
 {
-    result.nSize = m_nSize;
+    if constexpr (nCompareType == Equals)
+        return _mm_cmpeq_epi16(nLeft, nRight);
+    else if constexpr (nCompareType == NotEqualTo)
+        return _mm_xor_si128(_mm_cmpeq_epi16(nLeft, nRight), _mm_set1_epi32(-1));
+    else if constexpr (nCompareType == LessThan)
+        return _mm_cmpgt_epi16(nRight, nLeft);
+    else if constexpr (nCompareType == GreaterThan)
+        return _mm_cmpgt_epi16(nLeft, nRight);
+    else if constexpr (nCompareType == LessThanOrEqual)
+        return _mm_xor_si128(_mm_cmpgt_epi16(nLeft, nRight), _mm_set1_epi32(-1));
+    else
+        return _mm_xor_si128(_mm_cmpgt_epi16(nRight, nLeft), _mm_set1_epi32(-1));
+}
 
-    if (m_vBlocks.empty())
-        return false;
+template<ComparisonType nCompareType>
+static inline __m128i CompareLanes32(__m128i nLeft, __m128i nRight)
+{
+    if constexpr (nCompareType == Equals)
+        return _mm_cmpeq_epi32(nLeft, nRight);
+    else if constexpr (nCompareType == NotEqualTo)
+        return _mm_xor_si128(_mm_cmpeq_epi32(nLeft, nRight), _mm_set1_epi32(-1));
+    else if constexpr (nCompareType == LessThan)
+        return _mm_cmpgt_epi32(nRight, nLeft);
+    else if constexpr (nCompareType == GreaterThan)
+        return _mm_cmpgt_epi32(nLeft, nRight);
+    else if constexpr (nCompareType == LessThanOrEqual)
+        return _mm_xor_si128(_mm_cmpgt_epi32(nLeft, nRight), _mm_set1_epi32(-1));
+    else
+        return _mm_xor_si128(_mm_cmpgt_epi32(nRight, nLeft), _mm_set1_epi32(-1));
+}
 
-    unsigned int nPadding = 0;
-    if (m_bUnfiltered)
-    {
-        if (m_nSize == Nibble_Lower)
-        {
-            result.nAddress = (nIndex >> 1) + m_vBlocks[0].GetAddress();
-            if (nIndex & 1)
-                result.nSize = Nibble_Upper;
-        }
-        else
-        {
-            result.nAddress = nIndex + m_vBlocks[0].GetAddress();
-        }
+// the float compares are false for NaN, except for not equal, which matches the scalar comparisons
+template<ComparisonType nCompareType>
+static inline __m128i CompareLanesFloat(__m128i nLeft, __m128i nRight)
+{
+    const __m128 fLeft = _mm_castsi128_ps(nLeft);
+    const __m128 fRight = _mm_castsi128_ps(nRight);
+
+    if constexpr (nCompareType == Equals)
+        return _mm_castps_si128(_mm_cmpeq_ps(fLeft, fRight));
+    else if constexpr (nCompareType == NotEqualTo)
+        return _mm_castps_si128(_mm_cmpneq_ps(fLeft, fRight));
+    else if constexpr (nCompareType == LessThan)
+        return _mm_castps_si128(_mm_cmplt_ps(fLeft, fRight));
+    else if constexpr (nCompareType == GreaterThan)
+        return _mm_castps_si128(_mm_cmpgt_ps(fLeft, fRight));
+    else if constexpr (nCompareType == LessThanOrEqual)
+        return _mm_castps_si128(_mm_cmple_ps(fLeft, fRight));
+    else
+        return _mm_castps_si128(_mm_cmpge_ps(fLeft, fRight));
+}
 
-        // in unfiltered mode, blocks are padded so we don't have to cross blocks to read multi-byte values
-        nPadding = Padding(m_nSize);
+// the values at 16 consecutive byte offsets: one register of 8-bit lanes, two of 16-bit lanes, or four of 32-bit lanes
+template<ComparisonVariableSize nSize>
+struct Lanes
+{
+    static constexpr int COUNT = (BytesForSize(nSize) == 1) ? 1 : (BytesForSize(nSize) == 2) ? 2 : 4;
+    __m128i nValues[COUNT];
+};
+
+// builds the biased values at byte offsets [0, 16) of pBuffer. reads pBuffer[0, 16 + size - 1), which for the
+// last addresses of a block is the padding at the end of the block.
+template<ComparisonVariableSize nSize>
+static inline void LoadLanes(const unsigned char* pBuffer, Lanes<nSize>& pLanes)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+    {
+        pLanes.nValues[0] = BiasLanes<nSize>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer)));
+    }
+    else if constexpr (BytesForSize(nSize) == 2)
+    {
+        // interleaving the bytes at offsets n and n+1 builds the little-endian 16-bit value at offset n.
+        // interleaving them the other way around builds the big-endian value.
+        constexpr bool bBigEndian = (nSize == SixteenBitBE);
+        const __m128i nByte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 1 : 0)));
+        const __m128i nByte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 0 : 1)));
+        pLanes.nValues[0] = BiasLanes<nSize>(_mm_unpacklo_epi8(nByte0, nByte1));
+        pLanes.nValues[1] = BiasLanes<nSize>(_mm_unpackhi_epi8(nByte0, nByte1));
     }
     else
     {
-        if (nIndex >= m_vMatchingAddresses.size())
-            return false;
+        // and interleaving the 16-bit values at offsets n and n+2 builds the 32-bit value at offset n
+        constexpr bool bBigEndian = (nSize == ThirtyTwoBitBE);
+        const __m128i nByte0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 3 : 0)));
+        const __m128i nByte1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 2 : 1)));
+        const __m128i nByte2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 1 : 2)));
+        const __m128i nByte3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer + (bBigEndian ? 0 : 3)));
+        const __m128i nLowWords0 = _mm_unpacklo_epi8(nByte0, nByte1);
+        const __m128i nLowWords1 = _mm_unpackhi_epi8(nByte0, nByte1);
+        const __m128i nHighWords0 = _mm_unpacklo_epi8(nByte2, nByte3);
+        const __m128i nHighWords1 = _mm_unpackhi_epi8(nByte2, nByte3);
+        pLanes.nValues[0] = BiasLanes<nSize>(_mm_unpacklo_epi16(nLowWords0, nHighWords0));
+        pLanes.nValues[1] = BiasLanes<nSize>(_mm_unpackhi_epi16(nLowWords0, nHighWords0));
+        pLanes.nValues[2] = BiasLanes<nSize>(_mm_unpacklo_epi16(nLowWords1, nHighWords1));
+        pLanes.nValues[3] = BiasLanes<nSize>(_mm_unpackhi_epi16(nLowWords1, nHighWords1));
+    }
+}
 
-        result.nAddress = m_vMatchingAddresses[nIndex];
+template<ComparisonVariableSize nSize>
+static inline void SetLanes(unsigned int nTestValue, Lanes<nSize>& pLanes)
+{
+    const __m128i nValue = SplatLanes<nSize>(nTestValue ^ LaneBias(nSize));
+    for (auto& nLane : pLanes.nValues)
+        nLane = nValue;
+}
 
-        if (m_nSize == Nibble_Lower)
-        {
-            if (result.nAddress & 1)
-                result.nSize = Nibble_Upper;
+// returns the 16 results for a Lanes as a bitmask. the wider results are narrowed with saturating packs,
+// which keep all-ones lanes all-ones.
+template<ComparisonVariableSize nSize>
+static inline unsigned int PackMask(const __m128i* pResults)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+        return _mm_movemask_epi8(pResults[0]);
+    else if constexpr (BytesForSize(nSize) == 2)
+        return _mm_movemask_epi8(_mm_packs_epi16(pResults[0], pResults[1]));
+    else
+        return _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(pResults[0], pResults[1]), _mm_packs_epi32(pResults[2], pResults[3])));
+}
 
-            result.nAddress >>= 1;
-        }
+template<ComparisonVariableSize nSize, ComparisonType nCompareType>
+static inline unsigned int CompareSSE2(const Lanes<nSize>& pLeft, const Lanes<nSize>& pRight)
+{
+    __m128i vResults[Lanes<nSize>::COUNT];
+    for (int i = 0; i < Lanes<nSize>::COUNT; ++i)
+    {
+        if constexpr (nSize == Float)
+            vResults[i] = CompareLanesFloat<nCompareType>(pLeft.nValues[i], pRight.nValues[i]);
+        else if constexpr (BytesForSize(nSize) == 1)
+            vResults[i] = CompareLanes8<nCompareType>(pLeft.nValues[i], pRight.nValues[i]);
+        else if constexpr (BytesForSize(nSize) == 2)
+            vResults[i] = CompareLanes16<nCompareType>(pLeft.nValues[i], pRight.nValues[i]);
+        else
+            vResults[i] = CompareLanes32<nCompareType>(pLeft.nValues[i], pRight.nValues[i]);
     }
 
-    size_t nBlockIndex = 0;
+    return PackMask<nSize>(vResults);
+}
 
-    MemBlock* block = &m_vBlocks[nBlockIndex];
-    while (result.nAddress >= block->GetAddress() + block->GetSize() - nPadding)
+template<ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious>
+static void FilterBlockSSE2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits)
+{
+    Lanes<nSize> pLeft, pRight;
+    if constexpr (!bPrevious)
+        SetLanes<nSize>(nTestValue, pRight);
+
+    // each iteration fills one 32-bit word of the bitmap
+    unsigned int i = 0;
+    for (; i + 32 <= nCount; i += 32)
+    {
+        LoadLanes<nSize>(pMemory + i, pLeft);
+        if constexpr (bPrevious)
+            LoadLanes<nSize>(pPrev + i, pRight);
+        unsigned int nBits = CompareSSE2<nSize, nCompareType>(pLeft, pRight);
+
+        LoadLanes<nSize>(pMemory + i + 16, pLeft);
+        if constexpr (bPrevious)
+            LoadLanes<nSize>(pPrev + i + 16, pRight);
+        nBits |= CompareSSE2<nSize, nCompareType>(pLeft, pRight) << 16;
+
+        pBits[i >> 5] = nBits;
+    }
+
+    FilterScalar<nSize, nCompareType, bPrevious>(pMemory, pPrev, nTestValue, i, nCount, pBits);
+}
+
+template<ComparisonVariableSize nSize>
+static inline __m128i EqualLanes(__m128i nLeft, __m128i nRight)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+        return _mm_cmpeq_epi8(nLeft, nRight);
+    else if constexpr (BytesForSize(nSize) == 2)
+        return _mm_cmpeq_epi16(nLeft, nRight);
+    else
+        return _mm_cmpeq_epi32(nLeft, nRight);
+}
+
+template<ComparisonVariableSize nSize>
+static inline __m128i GreaterLanes(__m128i nLeft, __m128i nRight)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+        return _mm_cmpgt_epi8(nLeft, nRight);
+    else if constexpr (BytesForSize(nSize) == 2)
+        return _mm_cmpgt_epi16(nLeft, nRight);
+    else
+        return _mm_cmpgt_epi32(nLeft, nRight);
+}
+
+template<ComparisonVariableSize nSize>
+static inline __m128i SubtractLanes(__m128i nLeft, __m128i nRight)
+{
+    if constexpr (BytesForSize(nSize) == 1)
+        return _mm_sub_epi8(nLeft, nRight);
+    else if constexpr (BytesForSize(nSize) == 2)
+        return _mm_sub_epi16(nLeft, nRight);
+    else
+        return _mm_sub_epi32(nLeft, nRight);
+}
+
+// evaluates a fused filter on integer lanes. the bias cancels out of differences and XORs, so only the
+// range bounds need to be biased.
+template<ComparisonVariableSize nSize, SearchResults::FilterType nFilterType>
+static inline __m128i FilterLanes(__m128i nValue, __m128i nPrevious, __m128i nParam1, __m128i nParam2)
+{
+    const __m128i nAllSet = _mm_set1_epi32(-1);
+
+    if constexpr (nFilterType == SearchResults::FilterType::IncreasedBy)
+    {
+        return EqualLanes<nSize>(SubtractLanes<nSize>(nValue, nPrevious), nParam1);
+    }
+    else if constexpr (nFilterType == SearchResults::FilterType::ChangedBy)
+    {
+        const __m128i nDelta = SubtractLanes<nSize>(nValue, nPrevious);
+        return _mm_or_si128(EqualLanes<nSize>(nDelta, nParam1), EqualLanes<nSize>(nDelta, nParam2));
+    }
+    else if constexpr (nFilterType == SearchResults::FilterType::InRange)
+    {
+        (void)nPrevious;
+        return _mm_xor_si128(_mm_or_si128(GreaterLanes<nSize>(nParam1, nValue), GreaterLanes<nSize>(nValue, nParam2)), nAllSet);
+    }
+    else
+    {
+        const __m128i nChanged = _mm_and_si128(_mm_xor_si128(nValue, nPrevious), nParam1);
+        return _mm_xor_si128(EqualLanes<nSize>(nChanged, _mm_setzero_si128()), nAllSet);
+    }
+}
+
+template<ComparisonVariableSize nSize, SearchResults::FilterType nFilterType>
+static void FusedBlockSSE2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nCount, unsigned int* pBits)
+{
+    constexpr bool bPrevious = (nFilterType != SearchResults::FilterType::InRange);
+    constexpr unsigned int nBias = bPrevious ? 0U : LaneBias(nSize);
+    const __m128i nLaneParam1 = SplatLanes<nSize>(nParam1 ^ nBias);
+    const __m128i nLaneParam2 = SplatLanes<nSize>(nParam2 ^ nBias);
+
+    Lanes<nSize> pValue, pPrevious{};
+    __m128i vResults[Lanes<nSize>::COUNT];
+
+    // each iteration fills one 32-bit word of the bitmap
+    unsigned int i = 0;
+    for (; i + 32 <= nCount; i += 32)
+    {
+        unsigned int nBits = 0;
+        for (unsigned int nHalf = 0; nHalf < 32; nHalf += 16)
+        {
+            LoadLanes<nSize>(pMemory + i + nHalf, pValue);
+            if constexpr (bPrevious)
+                LoadLanes<nSize>(pPrev + i + nHalf, pPrevious);
+
+            for (int j = 0; j < Lanes<nSize>::COUNT; ++j)
+                vResults[j] = FilterLanes<nSize, nFilterType>(pValue.nValues[j], pPrevious.nValues[j], nLaneParam1, nLaneParam2);
+
+            nBits |= PackMask<nSize>(vResults) << nHalf;
+        }
+
+        pBits[i >> 5] = nBits;
+    }
+
+    FusedScalar<nSize, nFilterType>(pMemory, pPrev, nParam1, nParam2, i, nCount, pBits);
+}
+
+// splits 16 bytes into their 32 nibbles, in nibble address order: each byte's lower nibble followed by its
+// upper nibble. the nibbles are small enough that the signed compares order them correctly without a bias.
+static inline void SplitNibbles(const unsigned char* pBuffer, __m128i& nFirst, __m128i& nSecond)
+{
+    const __m128i nMask = _mm_set1_epi8(0x0F);
+    const __m128i nBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBuffer));
+    const __m128i nLower = _mm_and_si128(nBytes, nMask);
+    const __m128i nUpper = _mm_and_si128(_mm_srli_epi16(nBytes, 4), nMask);
+    nFirst = _mm_unpacklo_epi8(nLower, nUpper);
+    nSecond = _mm_unpackhi_epi8(nLower, nUpper);
+}
+
+static inline unsigned int PackNibbleMask(__m128i nFirst, __m128i nSecond)
+{
+    return static_cast<unsigned int>(_mm_movemask_epi8(nFirst)) | (static_cast<unsigned int>(_mm_movemask_epi8(nSecond)) << 16);
+}
+
+template<ComparisonType nCompareType, bool bPrevious>
+static void FilterNibblesSSE2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits)
+{
+    __m128i nValue0, nValue1;
+    __m128i nRight0 = _mm_set1_epi8(static_cast<char>(nTestValue));
+    __m128i nRight1 = nRight0;
+
+    // each iteration splits 16 bytes into 32 nibbles, filling one 32-bit word of the bitmap
+    unsigned int i = 0;
+    for (; i + 16 <= nCount; i += 16)
+    {
+        SplitNibbles(pMemory + i, nValue0, nValue1);
+        if constexpr (bPrevious)
+            SplitNibbles(pPrev + i, nRight0, nRight1);
+
+        pBits[i >> 4] = PackNibbleMask(CompareLanes8<nCompareType>(nValue0, nRight0), CompareLanes8<nCompareType>(nValue1, nRight1));
+    }
+
+    FilterNibblesScalar<nCompareType, bPrevious>(pMemory, pPrev, nTestValue, i, nCount, pBits);
+}
+
+template<SearchResults::FilterType nFilterType>
+static inline __m128i FilterNibbleLanes(__m128i nValue, __m128i nPrevious, __m128i nParam1, __m128i nParam2)
+{
+    if constexpr (nFilterType == SearchResults::FilterType::IncreasedBy || nFilterType == SearchResults::FilterType::ChangedBy)
+    {
+        // the differences wrap around within the nibble
+        const __m128i nDelta = _mm_and_si128(_mm_sub_epi8(nValue, nPrevious), _mm_set1_epi8(0x0F));
+        return FilterLanes<EightBit, nFilterType>(nDelta, _mm_setzero_si128(), nParam1, nParam2);
+    }
+    else
+    {
+        return FilterLanes<EightBit, nFilterType>(nValue, nPrevious, nParam1, nParam2);
+    }
+}
+
+template<SearchResults::FilterType nFilterType>
+static void FusedNibblesSSE2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nParam1,
+    unsigned int nParam2, unsigned int nCount, unsigned int* pBits)
+{
+    constexpr bool bPrevious = (nFilterType != SearchResults::FilterType::InRange);
+    const __m128i nLaneParam1 = _mm_set1_epi8(static_cast<char>(nParam1));
+    const __m128i nLaneParam2 = _mm_set1_epi8(static_cast<char>(nParam2));
+    __m128i nValue0, nValue1, nPrevious0 = _mm_setzero_si128(), nPrevious1 = _mm_setzero_si128();
+
+    unsigned int i = 0;
+    for (; i + 16 <= nCount; i += 16)
+    {
+        SplitNibbles(pMemory + i, nValue0, nValue1);
+        if constexpr (bPrevious)
+            SplitNibbles(pPrev + i, nPrevious0, nPrevious1);
+
+        pBits[i >> 4] = PackNibbleMask(FilterNibbleLanes<nFilterType>(nValue0, nPrevious0, nLaneParam1, nLaneParam2),
+            FilterNibbleLanes<nFilterType>(nValue1, nPrevious1, nLaneParam1, nLaneParam2));
+    }
+
+    FusedNibblesScalar<nFilterType>(pMemory, pPrev, nParam1, nParam2, i, nCount, pBits);
+}
+
+template<ComparisonType nCompareType>
+RA_SEARCH_TARGET_AVX2 static void FilterBlockAVX2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits, bool bPrevious)
+{
+    const __m256i nBias = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i nConstant = _mm256_set1_epi8(static_cast<char>(nTestValue ^ 0x80));
+
+    unsigned int i = 0;
+    for (; i + 32 <= nCount; i += 32)
+    {
+        const __m256i nLeft = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pMemory + i)), nBias);
+        const __m256i nRight = bPrevious ? _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pPrev + i)), nBias) : nConstant;
+
+        unsigned int nBits;
+        if constexpr (nCompareType == Equals)
+            nBits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(nLeft, nRight));
+        else if constexpr (nCompareType == NotEqualTo)
+            nBits = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(nLeft, nRight));
+        else if constexpr (nCompareType == LessThan)
+            nBits = _mm256_movemask_epi8(_mm256_cmpgt_epi8(nRight, nLeft));
+        else if constexpr (nCompareType == GreaterThan)
+            nBits = _mm256_movemask_epi8(_mm256_cmpgt_epi8(nLeft, nRight));
+        else if constexpr (nCompareType == LessThanOrEqual)
+            nBits = ~_mm256_movemask_epi8(_mm256_cmpgt_epi8(nLeft, nRight));
+        else
+            nBits = ~_mm256_movemask_epi8(_mm256_cmpgt_epi8(nRight, nLeft));
+
+        pBits[i >> 5] = nBits;
+    }
+
+    if (bPrevious)
+        FilterScalar<EightBit, nCompareType, true>(pMemory, pPrev, nTestValue, i, nCount, pBits);
+    else
+        FilterScalar<EightBit, nCompareType, false>(pMemory, pPrev, nTestValue, i, nCount, pBits);
+}
+
+template<ComparisonType nCompareType, bool bPrevious>
+static void FilterBlockEightBitAVX2(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nTestValue,
+    unsigned int nCount, unsigned int* pBits)
+{
+    FilterBlockAVX2<nCompareType>(pMemory, pPrev, nTestValue, nCount, pBits, bPrevious);
+}
+
+#endif // RA_SEARCH_X86
+
+static inline unsigned int LowestSetBit(unsigned int nBits)
+{
+#ifdef _MSC_VER
+    unsigned long nIndex;
+    _BitScanForward(&nIndex, nBits);
+    return nIndex;
+#else
+    return __builtin_ctz(nBits);
+#endif
+}
+
+static ConditionBatch::InstructionSet s_nInstructionSet = ConditionBatch::DetectInstructionSet();
+
+void SearchResults::SetInstructionSet(ConditionBatch::InstructionSet nInstructionSet)
+{
+    s_nInstructionSet = nInstructionSet;
+}
+
+template<ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious>
+static FilterKernel SelectKernel(unsigned int nTestValue)
+{
+#ifdef RA_SEARCH_X86
+    // the vector kernels compare within the size of the value. a constant that doesn't fit can't use them.
+    bool bFits = true;
+    if constexpr (!bPrevious && BytesForSize(nSize) < 4)
+    {
+        constexpr int nMax = static_cast<int>(ValueMask(nSize) >> 1);
+        if constexpr (IsSignedSize(nSize))
+            bFits = (static_cast<int>(nTestValue) >= -nMax - 1 && static_cast<int>(nTestValue) <= nMax);
+        else
+            bFits = (nTestValue <= ValueMask(nSize));
+    }
+
+    if (bFits)
+    {
+        if constexpr (nSize == EightBit)
+        {
+            if (s_nInstructionSet == ConditionBatch::InstructionSet::AVX2)
+                return FilterBlockEightBitAVX2<nCompareType, bPrevious>;
+        }
+
+        if (s_nInstructionSet != ConditionBatch::InstructionSet::Scalar)
+            return FilterBlockSSE2<nSize, nCompareType, bPrevious>;
+    }
+#else
+    (void)nTestValue;
+#endif
+
+    return FilterBlockScalar<nSize, nCompareType, bPrevious>;
+}
+
+template<ComparisonVariableSize nSize, bool bPrevious>
+static FilterKernel SelectKernel(ComparisonType nCompareType, unsigned int nTestValue)
+{
+    switch (nCompareType)
+    {
+        case Equals:                return SelectKernel<nSize, Equals, bPrevious>(nTestValue);
+        case LessThan:              return SelectKernel<nSize, LessThan, bPrevious>(nTestValue);
+        case LessThanOrEqual:       return SelectKernel<nSize, LessThanOrEqual, bPrevious>(nTestValue);
+        case GreaterThan:           return SelectKernel<nSize, GreaterThan, bPrevious>(nTestValue);
+        case GreaterThanOrEqual:    return SelectKernel<nSize, GreaterThanOrEqual, bPrevious>(nTestValue);
+        case NotEqualTo:            return SelectKernel<nSize, NotEqualTo, bPrevious>(nTestValue);
+        default:                    return nullptr;
+    }
+}
+
+template<ComparisonVariableSize nSize>
+static FilterKernel SelectKernel(ComparisonType nCompareType, bool bPrevious, unsigned int nTestValue)
+{
+    return bPrevious ? SelectKernel<nSize, true>(nCompareType, nTestValue) : SelectKernel<nSize, false>(nCompareType, nTestValue);
+}
+
+template<ComparisonType nCompareType, bool bPrevious>
+static FilterKernel SelectNibbleKernel()
+{
+#ifdef RA_SEARCH_X86
+    if (s_nInstructionSet != ConditionBatch::InstructionSet::Scalar)
+        return FilterNibblesSSE2<nCompareType, bPrevious>;
+#endif
+
+    return FilterNibblesBlockScalar<nCompareType, bPrevious>;
+}
+
+template<bool bPrevious>
+static FilterKernel SelectNibbleKernel(ComparisonType nCompareType)
+{
+    switch (nCompareType)
+    {
+        case Equals:                return SelectNibbleKernel<Equals, bPrevious>();
+        case LessThan:              return SelectNibbleKernel<LessThan, bPrevious>();
+        case LessThanOrEqual:       return SelectNibbleKernel<LessThanOrEqual, bPrevious>();
+        case GreaterThan:           return SelectNibbleKernel<GreaterThan, bPrevious>();
+        case GreaterThanOrEqual:    return SelectNibbleKernel<GreaterThanOrEqual, bPrevious>();
+        case NotEqualTo:            return SelectNibbleKernel<NotEqualTo, bPrevious>();
+        default:                    return nullptr;
+    }
+}
+
+static FilterKernel SelectKernel(ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious, unsigned int nTestValue)
+{
+    switch (nSize)
+    {
+        case EightBit:              return SelectKernel<EightBit>(nCompareType, bPrevious, nTestValue);
+        case SixteenBit:            return SelectKernel<SixteenBit>(nCompareType, bPrevious, nTestValue);
+        case ThirtyTwoBit:          return SelectKernel<ThirtyTwoBit>(nCompareType, bPrevious, nTestValue);
+        case SixteenBitBE:          return SelectKernel<SixteenBitBE>(nCompareType, bPrevious, nTestValue);
+        case ThirtyTwoBitBE:        return SelectKernel<ThirtyTwoBitBE>(nCompareType, bPrevious, nTestValue);
+        case SignedEightBit:        return SelectKernel<SignedEightBit>(nCompareType, bPrevious, nTestValue);
+        case SignedSixteenBit:      return SelectKernel<SignedSixteenBit>(nCompareType, bPrevious, nTestValue);
+        case SignedThirtyTwoBit:    return SelectKernel<SignedThirtyTwoBit>(nCompareType, bPrevious, nTestValue);
+        case Float:                 return SelectKernel<Float>(nCompareType, bPrevious, nTestValue);
+        case Nibble_Lower:          return bPrevious ? SelectNibbleKernel<true>(nCompareType) : SelectNibbleKernel<false>(nCompareType);
+        default:                    return nullptr;
+    }
+}
+
+template<ComparisonVariableSize nSize, SearchResults::FilterType nFilterType>
+static FusedKernel SelectFusedKernel()
+{
+#ifdef RA_SEARCH_X86
+    // the float differences aren't vectorized
+    if constexpr (nSize != Float)
+    {
+        if (s_nInstructionSet != ConditionBatch::InstructionSet::Scalar)
+            return FusedBlockSSE2<nSize, nFilterType>;
+    }
+#endif
+
+    return FusedBlockScalar<nSize, nFilterType>;
+}
+
+template<ComparisonVariableSize nSize>
+static FusedKernel SelectFusedKernel(SearchResults::FilterType nFilterType)
+{
+    switch (nFilterType)
+    {
+        case SearchResults::FilterType::ChangedBy:      return SelectFusedKernel<nSize, SearchResults::FilterType::ChangedBy>();
+        case SearchResults::FilterType::IncreasedBy:    return SelectFusedKernel<nSize, SearchResults::FilterType::IncreasedBy>();
+        case SearchResults::FilterType::InRange:        return SelectFusedKernel<nSize, SearchResults::FilterType::InRange>();
+        case SearchResults::FilterType::BitChanged:     return SelectFusedKernel<nSize, SearchResults::FilterType::BitChanged>();
+        default:                                        return nullptr;
+    }
+}
+
+template<SearchResults::FilterType nFilterType>
+static FusedKernel SelectFusedNibbleKernel()
+{
+#ifdef RA_SEARCH_X86
+    if (s_nInstructionSet != ConditionBatch::InstructionSet::Scalar)
+        return FusedNibblesSSE2<nFilterType>;
+#endif
+
+    return FusedNibblesBlockScalar<nFilterType>;
+}
+
+static FusedKernel SelectFusedNibbleKernel(SearchResults::FilterType nFilterType)
+{
+    switch (nFilterType)
+    {
+        case SearchResults::FilterType::ChangedBy:      return SelectFusedNibbleKernel<SearchResults::FilterType::ChangedBy>();
+        case SearchResults::FilterType::IncreasedBy:    return SelectFusedNibbleKernel<SearchResults::FilterType::IncreasedBy>();
+        case SearchResults::FilterType::InRange:        return SelectFusedNibbleKernel<SearchResults::FilterType::InRange>();
+        case SearchResults::FilterType::BitChanged:     return SelectFusedNibbleKernel<SearchResults::FilterType::BitChanged>();
+        default:                                        return nullptr;
+    }
+}
+
+static FusedKernel SelectFusedKernel(ComparisonVariableSize nSize, SearchResults::FilterType nFilterType)
+{
+    switch (nSize)
+    {
+        case EightBit:              return SelectFusedKernel<EightBit>(nFilterType);
+        case SixteenBit:            return SelectFusedKernel<SixteenBit>(nFilterType);
+        case ThirtyTwoBit:          return SelectFusedKernel<ThirtyTwoBit>(nFilterType);
+        case SixteenBitBE:          return SelectFusedKernel<SixteenBitBE>(nFilterType);
+        case ThirtyTwoBitBE:        return SelectFusedKernel<ThirtyTwoBitBE>(nFilterType);
+        case SignedEightBit:        return SelectFusedKernel<SignedEightBit>(nFilterType);
+        case SignedSixteenBit:      return SelectFusedKernel<SignedSixteenBit>(nFilterType);
+        case SignedThirtyTwoBit:    return SelectFusedKernel<SignedThirtyTwoBit>(nFilterType);
+        case Float:                 return SelectFusedKernel<Float>(nFilterType);
+        case Nibble_Lower:          return SelectFusedNibbleKernel(nFilterType);
+        default:                    return nullptr;
+    }
+}
+
+// calls fProcess(i) for each i in [0, nCount) across nThreads threads, including the calling one. each
+// thread takes the next unprocessed index, so threads that finish early pick up the remaining work.
+template<typename TFunc>
+static void ParallelFor(size_t nCount, unsigned int nThreads, TFunc&& fProcess)
+{
+    if (nThreads > nCount)
+        nThreads = static_cast<unsigned int>(nCount);
+
+    if (nThreads <= 1)
+    {
+        for (size_t i = 0; i < nCount; ++i)
+            fProcess(i);
+        return;
+    }
+
+    std::atomic<size_t> nNext{ 0 };
+    auto fWorker = [&nNext, nCount, &fProcess]()
+    {
+        size_t i;
+        while ((i = nNext.fetch_add(1)) < nCount)
+            fProcess(i);
+    };
+
+    std::vector<std::thread> vThreads;
+    vThreads.reserve(nThreads - 1);
+    for (unsigned int i = 1; i < nThreads; ++i)
+        vThreads.emplace_back(fWorker);
+
+    fWorker();
+
+    for (auto& pThread : vThreads)
+        pThread.join();
+}
+
+static unsigned int s_nThreadCount = 1;
+
+void SearchResults::SetThreadCount(unsigned int nThreads)
+{
+    s_nThreadCount = (nThreads > 0) ? nThreads : 1;
+}
+
+// a nibble is only filtered if either nibble of its byte was in the source results. the source's bits for
+// each pair of nibbles are merged and applied to both nibbles, rather than looking up each byte in the source.
+static void IntersectNibbleBits(const AddressSet& pSource, unsigned int nAddress, unsigned int* pBits,
+    unsigned int nCount, std::vector<unsigned int>& vSourceBits)
+{
+    const unsigned int nWords = (nCount * 2 + 31) / 32;
+    vSourceBits.assign(nWords, 0xFFFFFFFFU);
+    pSource.IntersectBits(nAddress << 1, vSourceBits.data(), nCount * 2);
+
+    for (unsigned int i = 0; i < nWords; ++i)
+    {
+        unsigned int nBytes = (vSourceBits[i] | (vSourceBits[i] >> 1)) & 0x55555555U;
+        nBytes |= (nBytes << 1);
+        pBits[i] &= nBytes;
+    }
+}
+
+void SearchResults::ProcessBlocks(const SearchResults& srSource, const ChunkFilter& fFilter)
+{
+    ResetMatchingAddresses(srSource);
+
+    // each byte is two addresses in nibble results, so the filters set two bits per byte
+    const unsigned int nShift = (m_nSize == Nibble_Lower) ? 1 : 0;
+    const unsigned int nChunks = static_cast<unsigned int>(m_vChunks.size());
+    const unsigned int nWordsPerChunk = (CHUNK_SIZE << nShift) / 32;
+    const unsigned int nChunksPerTask = MAX_BLOCK_SIZE / CHUNK_SIZE;
+    std::vector<unsigned char> vMemory;
+    std::vector<unsigned int> vBits;
+
+    for (unsigned int nWindow = 0; nWindow < nChunks; nWindow += WINDOW_CHUNKS)
+    {
+        // the emulator's memory readers aren't thread safe, so the memory for the window is captured
+        // on this thread before any of it is filtered
+        const unsigned int nWindowChunks = std::min(WINDOW_CHUNKS, nChunks - nWindow);
+        ReadChunks(srSource, nWindow, nWindowChunks, vMemory);
+        vBits.assign(nWindowChunks * nWordsPerChunk, 0U);
+
+        // each group of chunks is filtered independently. the chunks and bits for each are only written by
+        // the thread processing it, so the results don't depend on which thread processed which group.
+        ParallelFor((nWindowChunks + nChunksPerTask - 1) / nChunksPerTask, s_nThreadCount, [&](size_t nTask)
+        {
+            std::vector<unsigned int> vSourceBits;
+            const unsigned int nFirst = static_cast<unsigned int>(nTask) * nChunksPerTask;
+            const unsigned int nLast = std::min(nFirst + nChunksPerTask, nWindowChunks);
+            for (unsigned int i = nFirst; i < nLast; ++i)
+            {
+                const unsigned int nIndex = nWindow + i;
+                const auto& pSourceChunk = srSource.m_vChunks[nIndex];
+                if (!pSourceChunk)
+                    continue;
+
+                const unsigned int nAddress = m_nStartAddress + nIndex * CHUNK_SIZE;
+                const unsigned int nCount = std::min(CHUNK_SIZE, m_nEndAddress - nAddress);
+                const unsigned char* pMemory = vMemory.data() + i * CHUNK_SIZE;
+                unsigned int* pBits = vBits.data() + i * nWordsPerChunk;
+
+                std::shared_ptr<const void> pPin;
+                fFilter(nAddress, pMemory, pSourceChunk->Bytes(pPin), nCount, pBits);
+
+                if (!srSource.m_bUnfiltered)
+                {
+                    if (nShift)
+                        IntersectNibbleBits(*srSource.m_pMatchingAddresses, nAddress, pBits, nCount, vSourceBits);
+                    else
+                        srSource.m_pMatchingAddresses->IntersectBits(nAddress, pBits, nCount);
+                }
+
+                for (unsigned int nWord = 0; nWord < nWordsPerChunk; ++nWord)
+                {
+                    if (pBits[nWord])
+                    {
+                        SetChunk(srSource, nIndex, pMemory);
+                        break;
+                    }
+                }
+            }
+        });
+
+        const unsigned int nWindowAddress = m_nStartAddress + nWindow * CHUNK_SIZE;
+        m_pMatchingAddresses->AddBits(nWindowAddress << nShift, vBits.data(),
+            std::min(nWindowChunks * CHUNK_SIZE, m_nEndAddress - nWindowAddress) << nShift);
+    }
+
+    m_pMatchingAddresses->Compact(srSource.m_bUnfiltered ? nullptr : srSource.m_pMatchingAddresses.get());
+
+    CountChunkBytes(srSource);
+}
+
+void SearchResults::CountChunkBytes(const SearchResults& srSource)
+{
+    m_nChunkBytes = 0;
+    for (unsigned int i = 0; i < m_vChunks.size(); ++i)
+    {
+        if (m_vChunks[i] && m_vChunks[i] != srSource.m_vChunks[i])
+            m_nChunkBytes += m_vChunks[i]->HeapBytes();
+    }
+}
+
+// formats a search parameter for the summary the way the user would have entered it
+static std::string ValueString(unsigned int nValue, ComparisonVariableSize nSize)
+{
+    if (nSize == Float)
+    {
+        char sBuffer[32];
+        snprintf(sBuffer, sizeof(sBuffer), "%g", AsFloat(nValue));
+        return sBuffer;
+    }
+
+    if (IsSignedSize(nSize))
+        return std::to_string(static_cast<int>(nValue));
+
+    return std::to_string(nValue);
+}
+
+void SearchResults::Initialize(const SearchResults& srSource, ComparisonType nCompareType, unsigned int nTestValue)
+{
+    m_nSize = srSource.m_nSize;
+
+    // each nibble is compared to the lower nibble of the value
+    const unsigned int nKernelValue = (m_nSize == Nibble_Lower) ? (nTestValue & 0x0F) : nTestValue;
+    const FilterKernel pKernel = SelectKernel(m_nSize, nCompareType, false, nKernelValue);
+    if (pKernel != nullptr)
     {
-        if (++nBlockIndex == m_vBlocks.size())
+        ProcessBlocks(srSource, [pKernel, nKernelValue](unsigned int, const unsigned char* pMemory, const unsigned char* pPrev,
+            unsigned int nCount, unsigned int* pBits)
+        {
+            pKernel(pMemory, pPrev, nKernelValue, nCount, pBits);
+        });
+    }
+
+    m_sSummary.reserve(64);
+    m_sSummary.append("Filtering for ");
+    m_sSummary.append(ComparisonString(nCompareType));
+    m_sSummary.append(" ");
+    m_sSummary.append(ValueString(nTestValue, m_nSize));
+    m_sSummary.append("...");
+}
+
+void SearchResults::Initialize(const SearchResults& srSource, ComparisonType nCompareType)
+{
+    m_nSize = srSource.m_nSize;
+
+    const FilterKernel pKernel = SelectKernel(m_nSize, nCompareType, true, 0);
+    if (pKernel != nullptr)
+    {
+        ProcessBlocks(srSource, [pKernel](unsigned int, const unsigned char* pMemory, const unsigned char* pPrev,
+            unsigned int nCount, unsigned int* pBits)
+        {
+            pKernel(pMemory, pPrev, 0, nCount, pBits);
+        });
+    }
+
+    m_sSummary.reserve(64);
+    m_sSummary.append("Filtering for ");
+    m_sSummary.append(ComparisonString(nCompareType));
+    m_sSummary.append(" last known value...");
+}
+
+void SearchResults::Initialize(const SearchResults& srSource, FilterType nFilterType, unsigned int nParam, unsigned int nParam2)
+{
+    m_nSize = srSource.m_nSize;
+
+    const FusedFilter pFilter = PrepareFilter(nFilterType, nParam, nParam2, m_nSize);
+    const FusedKernel pKernel = SelectFusedKernel(m_nSize, pFilter.nType);
+    if (pKernel != nullptr)
+    {
+        ProcessBlocks(srSource, [pKernel, pFilter](unsigned int, const unsigned char* pMemory, const unsigned char* pPrev,
+            unsigned int nCount, unsigned int* pBits)
+        {
+            pKernel(pMemory, pPrev, pFilter.nParam1, pFilter.nParam2, nCount, pBits);
+        });
+    }
+
+    m_sSummary.reserve(64);
+    m_sSummary.append("Filtering for ");
+    switch (nFilterType)
+    {
+        case FilterType::ChangedBy:
+            m_sSummary.append("CHANGED BY ");
+            m_sSummary.append(ValueString(nParam, m_nSize));
+            break;
+
+        case FilterType::IncreasedBy:
+            m_sSummary.append("INCREASED BY ");
+            m_sSummary.append(ValueString(nParam, m_nSize));
+            break;
+
+        case FilterType::DecreasedBy:
+            m_sSummary.append("DECREASED BY ");
+            m_sSummary.append(ValueString(nParam, m_nSize));
+            break;
+
+        case FilterType::InRange:
+            m_sSummary.append("BETWEEN ");
+            m_sSummary.append(ValueString(nParam, m_nSize));
+            m_sSummary.append(" AND ");
+            m_sSummary.append(ValueString(nParam2, m_nSize));
+            break;
+
+        case FilterType::BitChanged:
+            m_sSummary.append("BIT ");
+            m_sSummary.append(std::to_string(nParam));
+            m_sSummary.append(" CHANGED");
+            break;
+    }
+    m_sSummary.append("...");
+}
+
+void SearchResults::Initialize(const SearchResults& srSource, const SearchSampler& pSampler,
+    SearchSampler::FilterType nFilterType, unsigned int nParam, unsigned int nParam2)
+{
+    m_nSize = srSource.m_nSize;
+
+    {
+        // the worker thread can't update the statistics while they're being filtered
+        const auto pLock = pSampler.LockStatistics();
+        if (m_nSize == pSampler.Size())
+        {
+            ProcessBlocks(srSource, [&pSampler, nFilterType, nParam, nParam2](unsigned int nAddress,
+                const unsigned char*, const unsigned char*, unsigned int nCount, unsigned int* pBits)
+            {
+                pSampler.MatchAddresses(nFilterType, nParam, nParam2, nAddress, nCount, pBits);
+            });
+        }
+        else
+        {
+            // statistics for a different size don't apply to these results
+            ResetMatchingAddresses(srSource);
+            m_pMatchingAddresses->Compact();
+        }
+    }
+
+    m_sSummary.reserve(64);
+    m_sSummary.append("Filtering for ");
+    switch (nFilterType)
+    {
+        case SearchSampler::FilterType::ChangedExactly:
+            m_sSummary.append("CHANGED ");
+            m_sSummary.append(std::to_string(nParam));
+            m_sSummary.append(" TIMES");
+            break;
+
+        case SearchSampler::FilterType::ChangedAtLeast:
+            m_sSummary.append("CHANGED AT LEAST ");
+            m_sSummary.append(std::to_string(nParam));
+            m_sSummary.append(" TIMES");
+            break;
+
+        case SearchSampler::FilterType::ChangedAtMost:
+            m_sSummary.append("CHANGED AT MOST ");
+            m_sSummary.append(std::to_string(nParam));
+            m_sSummary.append(" TIMES");
+            break;
+
+        case SearchSampler::FilterType::NeverIncreased:
+            m_sSummary.append("NEVER INCREASED");
+            break;
+
+        case SearchSampler::FilterType::NeverDecreased:
+            m_sSummary.append("NEVER DECREASED");
+            break;
+
+        case SearchSampler::FilterType::StayedInRange:
+            m_sSummary.append("ALWAYS BETWEEN ");
+            m_sSummary.append(ValueString(nParam, m_nSize));
+            m_sSummary.append(" AND ");
+            m_sSummary.append(ValueString(nParam2, m_nSize));
+            break;
+    }
+    m_sSummary.append(" IN ");
+    m_sSummary.append(std::to_string(pSampler.SampleCount()));
+    m_sSummary.append(" SAMPLES...");
+}
+
+unsigned int SearchResults::MatchingAddressCount()
+{
+    if (!m_bUnfiltered)
+        return m_pMatchingAddresses ? m_pMatchingAddresses->Count() : 0;
+
+    unsigned int nCount = m_nEndAddress - m_nStartAddress;
+    if (m_nSize == Nibble_Lower)
+        nCount *= 2;
+
+    return nCount;
+}
+
+void SearchResults::ExcludeAddress(unsigned int nAddress)
+{
+    if (m_bUnfiltered || !m_pMatchingAddresses)
+        return;
+
+    // copies share the matches until they're modified
+    if (m_pMatchingAddresses.use_count() > 1)
+        m_pMatchingAddresses = std::make_shared<AddressSet>(*m_pMatchingAddresses);
+
+    m_pMatchingAddresses->Remove(nAddress);
+}
+
+void SearchResults::ExcludeMatchingAddress(unsigned int nIndex)
+{
+    unsigned int nAddress;
+    if (!m_bUnfiltered && m_pMatchingAddresses && m_pMatchingAddresses->GetAt(nIndex, nAddress))
+        ExcludeAddress(nAddress);
+}
+
+bool SearchResults::GetMatchingAddress(unsigned int nIndex, _Out_ SearchResults::Result& result)
+{
+    result.nSize = m_nSize;
+
+    if (m_bUnfiltered)
+    {
+        if (m_nSize == Nibble_Lower)
+        {
+            result.nAddress = (nIndex >> 1) + m_nStartAddress;
+            if (nIndex & 1)
+                result.nSize = Nibble_Upper;
+        }
+        else
+        {
+            result.nAddress = nIndex + m_nStartAddress;
+        }
+    }
+    else
+    {
+        if (!m_pMatchingAddresses || !m_pMatchingAddresses->GetAt(nIndex, result.nAddress))
             return false;
 
-        block = &m_vBlocks[nBlockIndex];
+        if (m_nSize == Nibble_Lower)
+        {
+            if (result.nAddress & 1)
+                result.nSize = Nibble_Upper;
+
+            result.nAddress >>= 1;
+        }
     }
 
-    result.nValue = GetValue(block->GetBytes(), result.nAddress - block->GetAddress(), result.nSize);
+    const Chunk* pChunk = GetChunk(result.nAddress);
+    if (pChunk == nullptr)
+        return false;
+
+    std::shared_ptr<const void> pPin;
+    result.nValue = GetValue(pChunk->Bytes(pPin), (result.nAddress - m_nStartAddress) % CHUNK_SIZE, result.nSize);
     return true;
 }
 
+size_t SearchResults::RetainedBytes() const
+{
+    size_t nBytes = m_nChunkBytes + m_vChunks.capacity() * sizeof(m_vChunks[0]);
+    if (m_pMatchingAddresses)
+        nBytes += m_pMatchingAddresses->MemoryUsage();
+
+    return nBytes;
+}
+
+// serialized format, all values little-endian:
+//   header: "RASR", version (16-bit), size (8-bit), flags (8-bit), start address, end address, number of
+//           matches, number of captured chunks (32-bit each)
+//   summary: length (varint), characters
+//   matches (unless unfiltered): each address as the difference from the previous address plus one (varint).
+//           the first is relative to the start address (shifted left by one for nibbles). if that would take
+//           more than a bit per address in the range, a bitmap of the range is written instead.
+//   chunks: each index as the difference from the previous index plus one (varint), then for each chunk
+//           Chunk::SIZE bytes, or if compressed, their PackBits encoding.
+static const unsigned char SERIALIZED_MAGIC[4] = { 'R', 'A', 'S', 'R' };
+static const unsigned int SERIALIZED_VERSION = 1;
+static const unsigned int SERIALIZED_HEADER_SIZE = 24;
+static const unsigned char SERIALIZED_UNFILTERED = 0x01;
+static const unsigned char SERIALIZED_COMPRESSED = 0x02;
+static const unsigned char SERIALIZED_BITMAP = 0x04;
+
+static void WriteUInt32(std::vector<unsigned char>& vBuffer, unsigned int nValue)
+{
+    vBuffer.push_back(static_cast<unsigned char>(nValue));
+    vBuffer.push_back(static_cast<unsigned char>(nValue >> 8));
+    vBuffer.push_back(static_cast<unsigned char>(nValue >> 16));
+    vBuffer.push_back(static_cast<unsigned char>(nValue >> 24));
+}
+
+static unsigned int ReadUInt32(const unsigned char* pBuffer)
+{
+    return pBuffer[0] | (pBuffer[1] << 8) | (pBuffer[2] << 16) | (static_cast<unsigned int>(pBuffer[3]) << 24);
+}
+
+static void WriteVarint(std::vector<unsigned char>& vBuffer, unsigned int nValue)
+{
+    while (nValue >= 0x80)
+    {
+        vBuffer.push_back(static_cast<unsigned char>(nValue | 0x80));
+        nValue >>= 7;
+    }
+
+    vBuffer.push_back(static_cast<unsigned char>(nValue));
+}
+
+static bool ReadVarint(const unsigned char*& pBuffer, const unsigned char* pEnd, unsigned int& nValue)
+{
+    nValue = 0;
+    for (unsigned int nShift = 0; nShift < 35; nShift += 7)
+    {
+        if (pBuffer == pEnd)
+            return false;
+
+        const unsigned char nByte = *pBuffer++;
+        nValue |= static_cast<unsigned int>(nByte & 0x7F) << nShift;
+        if (!(nByte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+// PackBits: a control byte n < 128 is followed by n + 1 literal bytes, n >= 128 by one byte repeated n - 125 times
+static void WritePackBits(std::vector<unsigned char>& vBuffer, const unsigned char* pBytes, unsigned int nCount)
+{
+    unsigned int i = 0;
+    while (i < nCount)
+    {
+        unsigned int nRun = 1;
+        while (i + nRun < nCount && nRun < 130 && pBytes[i + nRun] == pBytes[i])
+            ++nRun;
+
+        if (nRun >= 3)
+        {
+            vBuffer.push_back(static_cast<unsigned char>(nRun + 125));
+            vBuffer.push_back(pBytes[i]);
+            i += nRun;
+            continue;
+        }
+
+        // literals continue until the next run of three or more
+        unsigned int nLiterals = 0;
+        while (i + nLiterals < nCount && nLiterals < 128)
+        {
+            const unsigned int j = i + nLiterals;
+            if (j + 2 < nCount && pBytes[j] == pBytes[j + 1] && pBytes[j] == pBytes[j + 2])
+                break;
+
+            ++nLiterals;
+        }
+
+        vBuffer.push_back(static_cast<unsigned char>(nLiterals - 1));
+        vBuffer.insert(vBuffer.end(), pBytes + i, pBytes + i + nLiterals);
+        i += nLiterals;
+    }
+}
+
+static bool ReadPackBits(const unsigned char*& pBuffer, const unsigned char* pEnd, unsigned char* pBytes, unsigned int nCount)
+{
+    unsigned int i = 0;
+    while (i < nCount)
+    {
+        if (pBuffer == pEnd)
+            return false;
+
+        const unsigned int nControl = *pBuffer++;
+        if (nControl < 128)
+        {
+            const unsigned int nLiterals = nControl + 1;
+            if (nLiterals > nCount - i || nLiterals > static_cast<size_t>(pEnd - pBuffer))
+                return false;
+
+            memcpy(pBytes + i, pBuffer, nLiterals);
+            pBuffer += nLiterals;
+            i += nLiterals;
+        }
+        else
+        {
+            const unsigned int nRun = nControl - 125;
+            if (nRun > nCount - i || pBuffer == pEnd)
+                return false;
+
+            memset(pBytes + i, *pBuffer++, nRun);
+            i += nRun;
+        }
+    }
+
+    return true;
+}
+
+void SearchResults::Serialize(std::vector<unsigned char>& vBuffer, bool bCompress) const
+{
+    unsigned int nChunks = 0;
+    for (const auto& pChunk : m_vChunks)
+    {
+        if (pChunk)
+            ++nChunks;
+    }
+
+    const unsigned int nShift = (m_nSize == Nibble_Lower) ? 1 : 0;
+    const unsigned int nFirstAddress = m_nStartAddress << nShift;
+    const unsigned int nAddressCount = (m_nEndAddress - m_nStartAddress) << nShift;
+    const unsigned int nMatches = (m_bUnfiltered || !m_pMatchingAddresses) ? 0 : m_pMatchingAddresses->Count();
+
+    unsigned char nFlags = 0;
+    if (m_bUnfiltered)
+        nFlags |= SERIALIZED_UNFILTERED;
+    if (bCompress)
+        nFlags |= SERIALIZED_COMPRESSED;
+    if (static_cast<unsigned long long>(nMatches) * 8 > nAddressCount)
+        nFlags |= SERIALIZED_BITMAP;
+
+    vBuffer.insert(vBuffer.end(), SERIALIZED_MAGIC, SERIALIZED_MAGIC + sizeof(SERIALIZED_MAGIC));
+    vBuffer.push_back(static_cast<unsigned char>(SERIALIZED_VERSION));
+    vBuffer.push_back(static_cast<unsigned char>(SERIALIZED_VERSION >> 8));
+    vBuffer.push_back(static_cast<unsigned char>(m_nSize));
+    vBuffer.push_back(nFlags);
+    WriteUInt32(vBuffer, m_nStartAddress);
+    WriteUInt32(vBuffer, m_nEndAddress);
+    WriteUInt32(vBuffer, nMatches);
+    WriteUInt32(vBuffer, nChunks);
+
+    WriteVarint(vBuffer, static_cast<unsigned int>(m_sSummary.length()));
+    vBuffer.insert(vBuffer.end(), m_sSummary.begin(), m_sSummary.end());
+
+    if (nFlags & SERIALIZED_BITMAP)
+    {
+        const size_t nStart = vBuffer.size();
+        vBuffer.resize(nStart + (nAddressCount + 7) / 8, 0);
+        unsigned char* pBitmap = vBuffer.data() + nStart;
+        m_pMatchingAddresses->ForEach([pBitmap, nFirstAddress](unsigned int nAddress)
+        {
+            const unsigned int nOffset = nAddress - nFirstAddress;
+            pBitmap[nOffset >> 3] |= static_cast<unsigned char>(1 << (nOffset & 7));
+        });
+    }
+    else if (nMatches > 0)
+    {
+        unsigned int nPrevious = nFirstAddress;
+        m_pMatchingAddresses->ForEach([&vBuffer, &nPrevious](unsigned int nAddress)
+        {
+            WriteVarint(vBuffer, nAddress - nPrevious);
+            nPrevious = nAddress + 1;
+        });
+    }
+
+    unsigned int nPrevious = 0;
+    for (unsigned int nIndex = 0; nIndex < m_vChunks.size(); ++nIndex)
+    {
+        if (m_vChunks[nIndex])
+        {
+            WriteVarint(vBuffer, nIndex - nPrevious);
+            nPrevious = nIndex + 1;
+        }
+    }
+
+    // only the values of the matches are needed to display or filter the results, so when compressing,
+    // the bytes that aren't part of any match are zeroed so they compress better
+    const bool bMask = bCompress && !m_bUnfiltered && m_pMatchingAddresses;
+    const unsigned int nPadding = Padding(m_nSize);
+    unsigned int vBits[(CHUNK_SIZE * 2) / 32];
+    unsigned char vMasked[Chunk::SIZE];
+
+    for (unsigned int nIndex = 0; nIndex < m_vChunks.size(); ++nIndex)
+    {
+        const auto& pChunk = m_vChunks[nIndex];
+        if (!pChunk)
+            continue;
+
+        std::shared_ptr<const void> pPin;
+        const unsigned char* pBytes = pChunk->Bytes(pPin);
+        if (!bCompress)
+        {
+            vBuffer.insert(vBuffer.end(), pBytes, pBytes + Chunk::SIZE);
+            continue;
+        }
+
+        if (bMask)
+        {
+            const unsigned int nAddress = m_nStartAddress + nIndex * CHUNK_SIZE;
+            memset(vBits, 0xFF, sizeof(vBits));
+            m_pMatchingAddresses->IntersectBits(nAddress << nShift, vBits, CHUNK_SIZE << nShift);
+
+            memset(vMasked, 0, sizeof(vMasked));
+            for (unsigned int nBit = 0; nBit < (CHUNK_SIZE << nShift); ++nBit)
+            {
+                if (vBits[nBit >> 5] & (1U << (nBit & 31)))
+                    memcpy(vMasked + (nBit >> nShift), pBytes + (nBit >> nShift), nPadding + 1);
+            }
+
+            pBytes = vMasked;
+        }
+
+        WritePackBits(vBuffer, pBytes, Chunk::SIZE);
+    }
+}
+
+bool SearchResults::Deserialize(std::shared_ptr<const unsigned char> pBuffer, size_t nSize)
+{
+    m_sSummary.clear();
+    m_nSize = EightBit;
+    m_nStartAddress = m_nEndAddress = 0;
+    m_vChunks.clear();
+    m_nChunkBytes = 0;
+    m_pMatchingAddresses.reset();
+    m_bUnfiltered = false;
+
+    const unsigned char* pRead = pBuffer.get();
+    const unsigned char* pEnd = pRead + nSize;
+    if (nSize < SERIALIZED_HEADER_SIZE || memcmp(pRead, SERIALIZED_MAGIC, sizeof(SERIALIZED_MAGIC)) != 0)
+        return false;
+
+    const unsigned int nVersion = pRead[4] | (pRead[5] << 8);
+    const unsigned int nSizeMode = pRead[6];
+    const unsigned char nFlags = pRead[7];
+    const unsigned int nStartAddress = ReadUInt32(pRead + 8);
+    const unsigned int nEndAddress = ReadUInt32(pRead + 12);
+    const unsigned int nMatches = ReadUInt32(pRead + 16);
+    const unsigned int nChunks = ReadUInt32(pRead + 20);
+    pRead += SERIALIZED_HEADER_SIZE;
+
+    if (nVersion != SERIALIZED_VERSION || nSizeMode >= NumComparisonVariableSizeTypes || nEndAddress < nStartAddress)
+        return false;
+
+    const bool bUnfiltered = (nFlags & SERIALIZED_UNFILTERED) != 0;
+    const bool bCompressed = (nFlags & SERIALIZED_COMPRESSED) != 0;
+    const auto nResultSize = static_cast<ComparisonVariableSize>(nSizeMode);
+
+    // each chunk index and match takes at least a byte (or a bit in the bitmap), so counts larger than
+    // the buffer are corrupt
+    const unsigned int nChunkCount = (nEndAddress - nStartAddress + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (nChunks > nChunkCount || nChunks > nSize || nMatches / 8 > nSize)
+        return false;
+
+    unsigned int nLength;
+    if (!ReadVarint(pRead, pEnd, nLength) || nLength > static_cast<size_t>(pEnd - pRead))
+        return false;
+    std::string sSummary(reinterpret_cast<const char*>(pRead), nLength);
+    pRead += nLength;
+
+    std::shared_ptr<AddressSet> pMatchingAddresses;
+    if (!bUnfiltered)
+    {
+        const unsigned int nShift = (nResultSize == Nibble_Lower) ? 1 : 0;
+        const unsigned int nFirstAddress = nStartAddress << nShift;
+        const unsigned int nAddressCount = (nEndAddress - nStartAddress) << nShift;
+        pMatchingAddresses = std::make_shared<AddressSet>();
+        pMatchingAddresses->Reset(nFirstAddress, nAddressCount);
+
+        if (nFlags & SERIALIZED_BITMAP)
+        {
+            const unsigned int nBitmapSize = (nAddressCount + 7) / 8;
+            if (nBitmapSize > static_cast<size_t>(pEnd - pRead))
+                return false;
+
+            // AddBits expects 32-bit words, so convert a block of the bitmap at a time
+            unsigned int vBits[256];
+            for (unsigned int nOffset = 0; nOffset < nBitmapSize; nOffset += sizeof(vBits))
+            {
+                const unsigned int nBytes = std::min(static_cast<unsigned int>(sizeof(vBits)), nBitmapSize - nOffset);
+                memset(vBits, 0, sizeof(vBits));
+                for (unsigned int i = 0; i < nBytes; ++i)
+                    vBits[i >> 2] |= static_cast<unsigned int>(pRead[nOffset + i]) << ((i & 3) * 8);
+
+                pMatchingAddresses->AddBits(nFirstAddress + nOffset * 8, vBits, std::min(nBytes * 8, nAddressCount - nOffset * 8));
+            }
+
+            pRead += nBitmapSize;
+        }
+
+        const unsigned long long nLimit = static_cast<unsigned long long>(nEndAddress) << nShift;
+        unsigned long long nAddress = nFirstAddress;
+        for (unsigned int i = 0; i < nMatches && !(nFlags & SERIALIZED_BITMAP); ++i)
+        {
+            unsigned int nDelta;
+            if (!ReadVarint(pRead, pEnd, nDelta))
+                return false;
+
+            nAddress += nDelta;
+            if (nAddress >= nLimit)
+                return false;
+
+            pMatchingAddresses->Add(static_cast<unsigned int>(nAddress));
+            ++nAddress;
+        }
+
+        pMatchingAddresses->Compact();
+        if ((nFlags & SERIALIZED_BITMAP) && pMatchingAddresses->Count() != nMatches)
+            return false;
+    }
+
+    std::vector<std::shared_ptr<const Chunk>> vChunks(nChunkCount);
+    std::vector<unsigned int> vIndices(nChunks);
+    unsigned long long nIndex = 0;
+    for (auto& nChunkIndex : vIndices)
+    {
+        unsigned int nDelta;
+        if (!ReadVarint(pRead, pEnd, nDelta))
+            return false;
+
+        nIndex += nDelta;
+        if (nIndex >= nChunkCount)
+            return false;
+
+        nChunkIndex = static_cast<unsigned int>(nIndex++);
+    }
+
+    size_t nChunkBytes = 0;
+    unsigned char vBytes[Chunk::SIZE];
+    for (const auto nChunkIndex : vIndices)
+    {
+        if (bCompressed)
+        {
+            if (!ReadPackBits(pRead, pEnd, vBytes, Chunk::SIZE))
+                return false;
+
+            vChunks[nChunkIndex] = CreateChunk(vBytes, Chunk::SIZE);
+        }
+        else
+        {
+            if (static_cast<size_t>(pEnd - pRead) < Chunk::SIZE)
+                return false;
+
+            // the chunk references the buffer rather than copying it
+            vChunks[nChunkIndex] = std::make_shared<BufferChunk>(std::shared_ptr<const unsigned char>(pBuffer, pRead));
+            pRead += Chunk::SIZE;
+        }
+
+        nChunkBytes += vChunks[nChunkIndex]->HeapBytes();
+    }
+
+    m_sSummary = std::move(sSummary);
+    m_nSize = nResultSize;
+    m_nStartAddress = nStartAddress;
+    m_nEndAddress = nEndAddress;
+    m_vChunks = std::move(vChunks);
+    m_nChunkBytes = nChunkBytes;
+    m_pMatchingAddresses = std::move(pMatchingAddresses);
+    m_bUnfiltered = bUnfiltered;
+    return true;
+}
+
+bool SearchResults::Save(const std::wstring& sFilename, bool bCompress) const
+{
+    std::vector<unsigned char> vBuffer;
+    Serialize(vBuffer, bCompress);
+
+    FILE* pFile = nullptr;
+    if (_wfopen_s(&pFile, sFilename.c_str(), L"wb") != 0 || pFile == nullptr)
+        return false;
+
+    const bool bWritten = (fwrite(vBuffer.data(), 1, vBuffer.size(), pFile) == vBuffer.size());
+    return (fclose(pFile) == 0) && bWritten;
+}
+
+bool SearchResults::Load(const std::wstring& sFilename)
+{
+    HANDLE hFile = CreateFileW(sFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER nFileSize;
+    if (!GetFileSizeEx(hFile, &nFileSize) || nFileSize.QuadPart < SERIALIZED_HEADER_SIZE || nFileSize.HighPart != 0)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // the view keeps the mapping and the file open after their handles are closed
+    HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(hFile);
+    if (hMapping == nullptr)
+        return false;
+
+    const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (pView == nullptr)
+        return false;
+
+    std::shared_ptr<const unsigned char> pBuffer(static_cast<const unsigned char*>(pView),
+        [](const unsigned char* pBytes) { UnmapViewOfFile(pBytes); });
+    return Deserialize(std::move(pBuffer), nFileSize.LowPart);
+}
+
 } // namespace services
 } // namespace ra
@@ -1,9 +1,15 @@
 #pragma once
 
 #include "RA_Condition.h" // ComparisonVariableSize, ComparisonType
+#include "RA_ConditionBatch.h" // ConditionBatch::InstructionSet
+
+#include "services\AddressSet.h"
+#include "services\SearchSampler.h"
 
-#include <vector>
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace ra {
 namespace services {
@@ -31,9 +37,43 @@ public:
     /// </summary>
     /// <param name="srSource">The result set to filter.</param>
     /// <param name="nCompareType">Type of comparison to apply.</param>
-    /// <param name="nTestValue">The value to compare against.</param>
+    /// <param name="nTestValue">
+    /// The value to compare against. Signed sizes expect the sign-extended value and <see cref="ComparisonVariableSize::Float" />
+    /// expects the IEEE 754 bits.
+    /// </param>
     void Initialize(const SearchResults& srSource, ComparisonType nCompareType, unsigned int nTestValue);
 
+    enum class FilterType
+    {
+        ChangedBy,      // the value is exactly nParam more or less than the previous value
+        IncreasedBy,    // the value is exactly nParam more than the previous value
+        DecreasedBy,    // the value is exactly nParam less than the previous value
+        InRange,        // the value is between nParam and nParam2, inclusive
+        BitChanged,     // bit nParam of the value is different from the previous value
+    };
+
+    /// <summary>
+    /// Initializes a result set by applying a filter that would otherwise take several comparisons.
+    /// Each filter is evaluated in a single pass over memory.
+    /// </summary>
+    /// <param name="srSource">The result set to filter.</param>
+    /// <param name="nFilterType">Type of filter to apply.</param>
+    /// <param name="nParam">The amount of change, lower bound, or bit index (see <see cref="FilterType" />).</param>
+    /// <param name="nParam2">The upper bound for <see cref="FilterType::InRange" />. Ignored otherwise.</param>
+    void Initialize(const SearchResults& srSource, FilterType nFilterType, unsigned int nParam, unsigned int nParam2 = 0);
+
+    /// <summary>
+    /// Initializes a result set by filtering on the statistics collected by a sampler, such as how many times
+    /// each value changed. The sampler must be sampling the same size as the source results.
+    /// </summary>
+    /// <param name="srSource">The result set to filter.</param>
+    /// <param name="pSampler">The sampler whose statistics should be filtered on.</param>
+    /// <param name="nFilterType">Type of filter to apply.</param>
+    /// <param name="nParam">The number of changes, or lower bound (see <see cref="SearchSampler::FilterType" />).</param>
+    /// <param name="nParam2">The upper bound for <see cref="SearchSampler::FilterType::StayedInRange" />. Ignored otherwise.</param>
+    void Initialize(const SearchResults& srSource, const SearchSampler& pSampler, SearchSampler::FilterType nFilterType,
+        unsigned int nParam, unsigned int nParam2 = 0);
+
     /// <summary>
     /// Gets the number of matching addresses.
     /// </summary>
@@ -47,7 +87,7 @@ public:
     struct Result
     {
         unsigned int nAddress;
-        unsigned int nValue;
+        unsigned int nValue;    // sign-extended for signed sizes, IEEE 754 bits for floats
         ComparisonVariableSize nSize;
     };
 
@@ -77,78 +117,116 @@ public:
     /// <param name="nAddress">The index of the address to remove.</param>
     void ExcludeMatchingAddress(unsigned int nIndex);
 
-protected:
-    class MemBlock
+    /// <summary>
+    /// Appends the results to a buffer in a compact binary format: a versioned header, the matching addresses
+    /// as delta-encoded varints, and the captured memory.
+    /// </summary>
+    /// <param name="vBuffer">The buffer to append to.</param>
+    /// <param name="bCompress">
+    /// Run-length encodes the captured memory. Compressed results are smaller, but the memory has to be
+    /// copied out of them when they're loaded.
+    /// </param>
+    void Serialize(std::vector<unsigned char>& vBuffer, bool bCompress = true) const;
+
+    /// <summary>
+    /// Replaces the results with ones written by <see cref="Serialize" />. If the captured memory isn't
+    /// compressed, it's used in place and the buffer is held until the results (and any results filtered
+    /// from them) no longer need it.
+    /// </summary>
+    /// <returns><c>true</c> if the results were loaded, <c>false</c> if the buffer isn't valid, in which case the results are empty.</returns>
+    bool Deserialize(std::shared_ptr<const unsigned char> pBuffer, size_t nSize);
+
+    /// <summary>
+    /// Writes the results to a file. See <see cref="Serialize" />.
+    /// </summary>
+    /// <returns><c>true</c> if the file was written.</returns>
+    bool Save(const std::wstring& sFilename, bool bCompress = true) const;
+
+    /// <summary>
+    /// Replaces the results with ones written by <see cref="Save" />. The file is memory-mapped rather than
+    /// read, so it stays open while the results are using it.
+    /// </summary>
+    /// <returns><c>true</c> if the results were loaded, <c>false</c> if the file couldn't be read or isn't valid.</returns>
+    bool Load(const std::wstring& sFilename);
+
+    /// <summary>
+    /// Overrides the instruction set used by the filter kernels, which is normally detected from the CPU.
+    /// </summary>
+    static void SetInstructionSet(ConditionBatch::InstructionSet nInstructionSet);
+
+    /// <summary>
+    /// Sets the number of threads used to filter 8, 16 and 32-bit results. The results are the same
+    /// regardless of the number of threads.
+    /// </summary>
+    static void SetThreadCount(unsigned int nThreads);
+
+    /// <summary>
+    /// Gets the number of bytes of memory held by these results that aren't shared with the results they
+    /// were filtered from.
+    /// </summary>
+    size_t RetainedBytes() const;
+
+    /// <summary>
+    /// Sets the number of bytes of captured memory that can be held in the heap by all results combined.
+    /// Once exceeded, memory captured for new results is written to a temporary file and paged back in
+    /// when it's needed.
+    /// </summary>
+    static void SetMemoryBudget(size_t nBytes);
+
+    static const unsigned int CHUNK_SIZE = 1024;
+
+private:
+    // the memory captured when the results were created, split into chunks. each chunk also holds the
+    // first few bytes of the following chunk so multi-byte values never have to be read across chunks.
+    // chunks are immutable once created, so unchanged chunks can be shared with the source results.
+    // once the chunks in the heap exceed the memory budget, new chunks are written to a spill file.
+    class Chunk
     {
     public:
-        MemBlock(unsigned int nAddress, unsigned int nSize)
-            : nAddress(nAddress), nSize(nSize)
-        {
-            if (nSize > sizeof(m_vBytes))
-                m_pBytes = new unsigned char[nSize];
-        }
-
-        MemBlock(const MemBlock& other) noexcept
-            : MemBlock(other.nAddress, other.nSize)
-        {
-            if (nSize > sizeof(m_vBytes))
-                memcpy(m_pBytes, other.m_pBytes, nSize);
-        }
-
-        MemBlock(MemBlock&& other) noexcept
-        {
-            nAddress = other.nAddress;
-            nSize = other.nSize;
-
-            if (other.nSize > sizeof(m_vBytes))
-            {
-                m_pBytes = other.m_pBytes;
-                other.m_pBytes = nullptr;
-                other.nSize = 0;
-            }
-            else
-            {
-                memcpy(m_vBytes, other.m_vBytes, sizeof(m_vBytes));
-            }
-        }
-
-        ~MemBlock()
-        {
-            if (nSize > sizeof(m_vBytes))
-                delete m_pBytes;
-        }
-
-        unsigned char* GetBytes() { return (nSize > sizeof(m_vBytes)) ? m_pBytes : &m_vBytes[0]; }
-        const unsigned char* GetBytes() const { return (nSize > sizeof(m_vBytes)) ? m_pBytes : &m_vBytes[0]; }
-
-        unsigned int GetAddress() const { return nAddress; }
-        unsigned int GetSize() const { return nSize; }
-
-    private:
-        union // 8 bytes
-        {
-            unsigned char m_vBytes[8];
-            unsigned char* m_pBytes;
-        };
-
-        unsigned int nAddress; // 4 bytes
-        unsigned int nSize;    // 4 bytes
+        static const unsigned int SIZE = CHUNK_SIZE + 3;
+
+        virtual ~Chunk() = default;
+
+        // gets the bytes of the chunk. if they had to be paged in, pPin keeps them mapped until it's released.
+        virtual const unsigned char* Bytes(std::shared_ptr<const void>& pPin) const = 0;
+
+        // gets the number of bytes of the heap used by the chunk
+        virtual size_t HeapBytes() const = 0;
     };
-    static_assert(sizeof(MemBlock) == 16, "sizeof(MemBlock) is incorrect");
+    class HeapChunk;
+    class SpilledChunk;
+    class BufferChunk;
 
-    MemBlock& AddBlock(unsigned int nAddress, unsigned int nSize);
+    // copies nBytes bytes into a new chunk. the rest of the chunk is zeroed.
+    static std::shared_ptr<const Chunk> CreateChunk(const unsigned char* pBytes, unsigned int nBytes);
 
-private:
-    void ProcessBlocks(const SearchResults& srSource, std::function<bool(unsigned int nIndex, const unsigned char pMemory[], const unsigned char pPrev[])> testIndexFunction);
-    void ProcessBlocksNibbles(const SearchResults& srSource, unsigned int nTestValue, ComparisonType nCompareType);
-    void AddMatches(unsigned int nAddressBase, const unsigned char pMemory[], const std::vector<unsigned int>& vMatches);
-    void AddMatchesNibbles(unsigned int nAddressBase, const unsigned char pMemory[], const std::vector<unsigned int>& vMatches);
+    const Chunk* GetChunk(unsigned int nAddress) const;
+    unsigned int ChunkCount() const { return (m_nEndAddress - m_nStartAddress + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+
+    // sets bit (i % 32) of pBits[i / 32] for each of the nCount addresses of a chunk, starting at nAddress, that
+    // match. pPrev is the chunk's memory from the source results. for nibbles, the lower and upper nibbles of the
+    // byte at offset i are bits 2i and 2i + 1.
+    typedef std::function<void(unsigned int nAddress, const unsigned char* pMemory, const unsigned char* pPrev,
+        unsigned int nCount, unsigned int* pBits)> ChunkFilter;
+
+    void ProcessBlocks(const SearchResults& srSource, const ChunkFilter& fFilter);
+    void ReadChunks(const SearchResults& srSource, unsigned int nFirst, unsigned int nCount,
+        std::vector<unsigned char>& vMemory) const;
+    void SetChunk(const SearchResults& srSource, unsigned int nIndex, const unsigned char* pMemory);
+    void CountChunkBytes(const SearchResults& srSource);
+    void ResetMatchingAddresses(const SearchResults& srSource);
 
     std::string m_sSummary;
-    std::vector<MemBlock> m_vBlocks;
     ComparisonVariableSize m_nSize = EightBit;
 
-    std::vector<unsigned int> m_vMatchingAddresses;
+    // addresses [m_nStartAddress, m_nEndAddress) can be matched. chunk i starts at m_nStartAddress + i * CHUNK_SIZE.
+    unsigned int m_nStartAddress = 0;
+    unsigned int m_nEndAddress = 0;
+    std::vector<std::shared_ptr<const Chunk>> m_vChunks; // null for chunks without any matches
+    size_t m_nChunkBytes = 0; // bytes of the heap used by chunks allocated for these results
+
+    // shared between copies until one of them excludes an address
+    std::shared_ptr<AddressSet> m_pMatchingAddresses; // nibble addresses are (address << 1) | upper
     bool m_bUnfiltered = false;
 };
 
@@ -0,0 +1,493 @@
+#include "SearchSampler.h"
+
+#include "RA_MemManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RA_SAMPLER_X86
+#include <emmintrin.h>
+#endif
+
+ra::services::SearchSampler g_SearchSampler;
+
+namespace ra {
+namespace services {
+
+// memory is compared in groups of this many bytes, and groups without any changes are skipped
+static const unsigned int GROUP_SIZE = 64;
+
+static ConditionBatch::InstructionSet s_nInstructionSet = ConditionBatch::DetectInstructionSet();
+
+void SearchSampler::SetInstructionSet(ConditionBatch::InstructionSet nInstructionSet)
+{
+    s_nInstructionSet = nInstructionSet;
+}
+
+// reads the value at pBuffer. signed values are sign extended, and floats are returned as their bits.
+static unsigned int ReadSample(const unsigned char* pBuffer, ComparisonVariableSize nSize)
+{
+    switch (nSize)
+    {
+        case EightBit:
+            return pBuffer[0];
+        case SignedEightBit:
+            return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(pBuffer[0])));
+        case SixteenBit:
+            return pBuffer[0] | (pBuffer[1] << 8);
+        case SignedSixteenBit:
+            return static_cast<unsigned int>(static_cast<int>(static_cast<short>(pBuffer[0] | (pBuffer[1] << 8))));
+        case SixteenBitBE:
+            return (pBuffer[0] << 8) | pBuffer[1];
+        case ThirtyTwoBitBE:
+            return (static_cast<unsigned int>(pBuffer[0]) << 24) | (pBuffer[1] << 16) | (pBuffer[2] << 8) | pBuffer[3];
+        default: // ThirtyTwoBit, SignedThirtyTwoBit, Float
+            return pBuffer[0] | (pBuffer[1] << 8) | (pBuffer[2] << 16) | (static_cast<unsigned int>(pBuffer[3]) << 24);
+    }
+}
+
+// returns a negative number if nLeft is less than nRight, a positive number if it's greater, or 0 if
+// they're equal (or unordered floats)
+static int CompareSamples(unsigned int nLeft, unsigned int nRight, ComparisonVariableSize nSize)
+{
+    if (nSize == Float)
+    {
+        float fLeft, fRight;
+        memcpy(&fLeft, &nLeft, sizeof(fLeft));
+        memcpy(&fRight, &nRight, sizeof(fRight));
+        return (fLeft < fRight) ? -1 : (fLeft > fRight) ? 1 : 0;
+    }
+
+    if (IsSignedSize(nSize))
+    {
+        const int nSignedLeft = static_cast<int>(nLeft);
+        const int nSignedRight = static_cast<int>(nRight);
+        return (nSignedLeft < nSignedRight) ? -1 : (nSignedLeft > nSignedRight) ? 1 : 0;
+    }
+
+    return (nLeft < nRight) ? -1 : (nLeft > nRight) ? 1 : 0;
+}
+
+static bool GroupChanged(const unsigned char* pMemory, const unsigned char* pPrev, unsigned int nBytes)
+{
+#ifdef RA_SAMPLER_X86
+    if (nBytes == GROUP_SIZE && s_nInstructionSet != ConditionBatch::InstructionSet::Scalar)
+    {
+        __m128i vEqual = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pMemory)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrev)));
+        for (unsigned int i = 16; i < GROUP_SIZE; i += 16)
+        {
+            vEqual = _mm_and_si128(vEqual, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pMemory + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrev + i))));
+        }
+
+        return _mm_movemask_epi8(vEqual) != 0xFFFF;
+    }
+#endif
+
+    return memcmp(pMemory, pPrev, nBytes) != 0;
+}
+
+SearchSampler::~SearchSampler()
+{
+    Stop();
+}
+
+bool SearchSampler::Start(unsigned int nAddress, unsigned int nBytes, ComparisonVariableSize nSize,
+    unsigned int nInterval, unsigned int nWindow)
+{
+    Stop();
+
+    if (nSize < EightBit || nSize >= NumComparisonVariableSizeTypes)
+        return false;
+
+    if (nBytes + nAddress > g_MemManager.TotalBankSize())
+        nBytes = (nAddress < g_MemManager.TotalBankSize()) ? static_cast<unsigned int>(g_MemManager.TotalBankSize()) - nAddress : 0;
+
+    const unsigned int nPadding = BytesForSize(nSize) - 1;
+
+    std::lock_guard<std::mutex> lock(m_mtxQueue);
+    std::lock_guard<std::mutex> lockStatistics(m_mtxStatistics);
+
+    m_nStartAddress = nAddress;
+    m_nCount = (nBytes > nPadding) ? nBytes - nPadding : 0;
+    m_nBytes = m_nCount + nPadding;
+    m_nSize = nSize;
+    m_nInterval = std::max(nInterval, 1U);
+    m_nWindow = std::min(nWindow, MAX_WINDOW);
+
+    m_nCalls = 0;
+    m_nHead = 0;
+    m_nQueued = 0;
+    m_bStopping = false;
+    for (auto& vBuffer : m_vBuffers)
+        vBuffer.assign(m_nBytes, 0);
+
+    const unsigned int nWidth = BytesForSize(nSize);
+    m_vPrevious.assign(m_nBytes, 0);
+    m_vChanges.assign(m_nCount, 0);
+    m_vIncreases.assign(m_nCount, 0);
+    m_vDecreases.assign(m_nCount, 0);
+    m_vMinimum.assign(m_nCount * nWidth, 0);
+    m_vMaximum.assign(m_nCount * nWidth, 0);
+
+    const unsigned int nWords = (m_nCount + 31) / 32;
+    m_vHistory.resize(m_nWindow);
+    for (auto& pBits : m_vHistory)
+    {
+        pBits.vChanged.assign(nWords, 0);
+        pBits.vIncreased.assign(nWords, 0);
+        pBits.vDecreased.assign(nWords, 0);
+    }
+
+    m_nSamples = 0;
+    m_nDropped = 0;
+
+    m_bRunning = true;
+    m_pWorker = std::thread(&SearchSampler::Run, this);
+    return true;
+}
+
+void SearchSampler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtxQueue);
+        if (!m_pWorker.joinable())
+            return;
+
+        m_bStopping = true;
+        m_bRunning = false;
+    }
+
+    m_cvQueued.notify_all();
+    m_cvIdle.notify_all();
+    m_pWorker.join();
+}
+
+void SearchSampler::Sample()
+{
+    if (!IsRunning())
+        return;
+
+    // the memory is copied while holding the queue lock so the buffers can't be reallocated by Start. the
+    // worker only holds the lock long enough to take or return a buffer, so this never waits on a sample
+    // being processed.
+    std::lock_guard<std::mutex> lock(m_mtxQueue);
+    if (m_bStopping || (m_nCalls++ % m_nInterval) != 0)
+        return;
+
+    if (m_nQueued == RING_SIZE)
+    {
+        ++m_nDropped;
+        return;
+    }
+
+    auto& vBuffer = m_vBuffers[(m_nHead + m_nQueued) % RING_SIZE];
+    if (m_nBytes > 0)
+        g_MemManager.ActiveBankRAMRead(vBuffer.data(), m_nStartAddress, m_nBytes);
+
+    ++m_nQueued;
+    m_cvQueued.notify_one();
+}
+
+void SearchSampler::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mtxQueue);
+    m_cvIdle.wait(lock, [this]() { return m_nQueued == 0 || m_bStopping; });
+}
+
+void SearchSampler::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mtxQueue);
+    for (;;)
+    {
+        m_cvQueued.wait(lock, [this]() { return m_nQueued > 0 || m_bStopping; });
+        if (m_bStopping)
+            break;
+
+        // the emulator thread won't write to the head buffer until it's returned to the ring
+        const auto& vBuffer = m_vBuffers[m_nHead];
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> lockStatistics(m_mtxStatistics);
+            ApplySample(vBuffer);
+        }
+        lock.lock();
+
+        m_nHead = (m_nHead + 1) % RING_SIZE;
+        --m_nQueued;
+        m_cvIdle.notify_all();
+    }
+}
+
+unsigned int SearchSampler::LoadStatistic(const std::vector<unsigned char>& vValues, unsigned int nIndex) const
+{
+    // stored little-endian in the size's width
+    const unsigned int nWidth = BytesForSize(m_nSize);
+    const unsigned char* pValue = &vValues[nIndex * nWidth];
+
+    unsigned int nValue = 0;
+    for (unsigned int i = 0; i < nWidth; ++i)
+        nValue |= static_cast<unsigned int>(pValue[i]) << (i * 8);
+
+    if (nWidth == 1 && IsSignedSize(m_nSize))
+        return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(nValue)));
+    if (nWidth == 2 && IsSignedSize(m_nSize))
+        return static_cast<unsigned int>(static_cast<int>(static_cast<short>(nValue)));
+
+    return nValue;
+}
+
+void SearchSampler::StoreStatistic(std::vector<unsigned char>& vValues, unsigned int nIndex, unsigned int nValue) const
+{
+    const unsigned int nWidth = BytesForSize(m_nSize);
+    unsigned char* pValue = &vValues[nIndex * nWidth];
+    for (unsigned int i = 0; i < nWidth; ++i)
+        pValue[i] = static_cast<unsigned char>(nValue >> (i * 8));
+}
+
+void SearchSampler::ApplyChange(unsigned int nIndex, unsigned int nValue, unsigned int nPrevious, unsigned int nSample)
+{
+    if (m_vChanges[nIndex] != 0xFF)
+        ++m_vChanges[nIndex];
+
+    const int nCompare = CompareSamples(nValue, nPrevious, m_nSize);
+    if (nCompare > 0 && m_vIncreases[nIndex] != 0xFF)
+        ++m_vIncreases[nIndex];
+    else if (nCompare < 0 && m_vDecreases[nIndex] != 0xFF)
+        ++m_vDecreases[nIndex];
+
+    if (CompareSamples(nValue, LoadStatistic(m_vMinimum, nIndex), m_nSize) < 0)
+        StoreStatistic(m_vMinimum, nIndex, nValue);
+    if (CompareSamples(nValue, LoadStatistic(m_vMaximum, nIndex), m_nSize) > 0)
+        StoreStatistic(m_vMaximum, nIndex, nValue);
+
+    if (m_nWindow > 0)
+    {
+        auto& pBits = m_vHistory[nSample % m_nWindow];
+        const unsigned int nBit = 1U << (nIndex & 31);
+        pBits.vChanged[nIndex >> 5] |= nBit;
+        if (nCompare > 0)
+            pBits.vIncreased[nIndex >> 5] |= nBit;
+        else if (nCompare < 0)
+            pBits.vDecreased[nIndex >> 5] |= nBit;
+    }
+}
+
+// removes the counts for a set of changes and clears them
+static void RemoveCounts(std::vector<unsigned int>& vBits, std::vector<unsigned char>& vCounts)
+{
+    for (unsigned int nWord = 0; nWord < vBits.size(); ++nWord)
+    {
+        unsigned int nBits = vBits[nWord];
+        if (nBits == 0)
+            continue;
+
+        vBits[nWord] = 0;
+        for (unsigned int nIndex = nWord << 5; nBits != 0; ++nIndex, nBits >>= 1)
+        {
+            if (nBits & 1)
+                --vCounts[nIndex];
+        }
+    }
+}
+
+void SearchSampler::RetireSample(unsigned int nSample)
+{
+    // the slot for this sample holds the changes from m_nWindow samples ago, which are leaving the window.
+    // sample 0 is the baseline, so the slot is empty until the window has filled.
+    auto& pBits = m_vHistory[nSample % m_nWindow];
+    RemoveCounts(pBits.vChanged, m_vChanges);
+    RemoveCounts(pBits.vIncreased, m_vIncreases);
+    RemoveCounts(pBits.vDecreased, m_vDecreases);
+}
+
+#ifdef RA_SAMPLER_X86
+
+// updates the statistics for 16 eight-bit values. the counts are saturating byte adds, and the minimum
+// and maximum are unsigned byte min/max (signed values are biased into the unsigned range).
+static unsigned int ApplyChangesEightBitSSE2(const unsigned char* pMemory, const unsigned char* pPrev, bool bSigned,
+    unsigned char* pChanges, unsigned char* pIncreases, unsigned char* pDecreases, unsigned char* pMinimum,
+    unsigned char* pMaximum, unsigned int& nIncreased, unsigned int& nDecreased)
+{
+    const __m128i vValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pMemory));
+    const __m128i vPrevious = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrev));
+    const __m128i vEqual = _mm_cmpeq_epi8(vValue, vPrevious);
+    const unsigned int nChanged = ~static_cast<unsigned int>(_mm_movemask_epi8(vEqual)) & 0xFFFF;
+    if (nChanged == 0)
+    {
+        nIncreased = nDecreased = 0;
+        return 0;
+    }
+
+    // the byte compares are signed, so unsigned values are biased by the sign bit
+    const __m128i vSignedBias = _mm_set1_epi8(bSigned ? 0 : static_cast<char>(0x80));
+    const __m128i vValueSigned = _mm_xor_si128(vValue, vSignedBias);
+    const __m128i vPreviousSigned = _mm_xor_si128(vPrevious, vSignedBias);
+    const __m128i vIncreased = _mm_cmpgt_epi8(vValueSigned, vPreviousSigned);
+    const __m128i vDecreased = _mm_cmpgt_epi8(vPreviousSigned, vValueSigned);
+
+    const __m128i vOne = _mm_set1_epi8(1);
+    __m128i* pChangesVector = reinterpret_cast<__m128i*>(pChanges);
+    __m128i* pIncreasesVector = reinterpret_cast<__m128i*>(pIncreases);
+    __m128i* pDecreasesVector = reinterpret_cast<__m128i*>(pDecreases);
+    _mm_storeu_si128(pChangesVector, _mm_adds_epu8(_mm_loadu_si128(pChangesVector), _mm_andnot_si128(vEqual, vOne)));
+    _mm_storeu_si128(pIncreasesVector, _mm_adds_epu8(_mm_loadu_si128(pIncreasesVector), _mm_and_si128(vIncreased, vOne)));
+    _mm_storeu_si128(pDecreasesVector, _mm_adds_epu8(_mm_loadu_si128(pDecreasesVector), _mm_and_si128(vDecreased, vOne)));
+
+    // the byte min/max are unsigned, so signed values are biased by the sign bit
+    const __m128i vUnsignedBias = _mm_set1_epi8(bSigned ? static_cast<char>(0x80) : 0);
+    const __m128i vValueUnsigned = _mm_xor_si128(vValue, vUnsignedBias);
+    __m128i* pMinimumVector = reinterpret_cast<__m128i*>(pMinimum);
+    __m128i* pMaximumVector = reinterpret_cast<__m128i*>(pMaximum);
+    _mm_storeu_si128(pMinimumVector, _mm_xor_si128(_mm_min_epu8(_mm_xor_si128(_mm_loadu_si128(pMinimumVector),
+        vUnsignedBias), vValueUnsigned), vUnsignedBias));
+    _mm_storeu_si128(pMaximumVector, _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(_mm_loadu_si128(pMaximumVector),
+        vUnsignedBias), vValueUnsigned), vUnsignedBias));
+
+    nIncreased = static_cast<unsigned int>(_mm_movemask_epi8(vIncreased));
+    nDecreased = static_cast<unsigned int>(_mm_movemask_epi8(vDecreased));
+    return nChanged;
+}
+
+#endif
+
+void SearchSampler::ApplySample(const std::vector<unsigned char>& vMemory)
+{
+    const unsigned char* pMemory = vMemory.data();
+    const unsigned int nSample = m_nSamples.load(std::memory_order_relaxed);
+    if (nSample == 0)
+    {
+        // baseline. nothing has changed yet, but the values are the initial minimums and maximums.
+        for (unsigned int nIndex = 0; nIndex < m_nCount; ++nIndex)
+        {
+            const unsigned int nValue = ReadSample(pMemory + nIndex, m_nSize);
+            StoreStatistic(m_vMinimum, nIndex, nValue);
+            StoreStatistic(m_vMaximum, nIndex, nValue);
+        }
+
+        memcpy(m_vPrevious.data(), pMemory, m_nBytes);
+        m_nSamples.store(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (m_nWindow > 0)
+        RetireSample(nSample);
+
+    const unsigned char* pPrev = m_vPrevious.data();
+    const unsigned int nPadding = BytesForSize(m_nSize) - 1;
+#ifdef RA_SAMPLER_X86
+    const bool bVectorize = (BytesForSize(m_nSize) == 1 && s_nInstructionSet != ConditionBatch::InstructionSet::Scalar);
+#endif
+
+    unsigned int nNext = 0; // the first value that hasn't been checked
+    for (unsigned int nGroup = 0; nGroup < m_nBytes; nGroup += GROUP_SIZE)
+    {
+        const unsigned int nGroupEnd = std::min(nGroup + GROUP_SIZE, m_nBytes);
+        if (!GroupChanged(pMemory + nGroup, pPrev + nGroup, nGroupEnd - nGroup))
+            continue;
+
+        // multi-byte values starting before the group may include a changed byte
+        unsigned int nIndex = std::max(nNext, (nGroup > nPadding) ? nGroup - nPadding : 0);
+        const unsigned int nLast = std::min(nGroupEnd, m_nCount);
+
+#ifdef RA_SAMPLER_X86
+        if (bVectorize)
+        {
+            for (; nIndex + 16 <= nLast; nIndex += 16)
+            {
+                unsigned int nIncreased, nDecreased;
+                const unsigned int nChanged = ApplyChangesEightBitSSE2(pMemory + nIndex, pPrev + nIndex,
+                    IsSignedSize(m_nSize), &m_vChanges[nIndex], &m_vIncreases[nIndex], &m_vDecreases[nIndex],
+                    &m_vMinimum[nIndex], &m_vMaximum[nIndex], nIncreased, nDecreased);
+
+                if (nChanged != 0 && m_nWindow > 0)
+                {
+                    // groups start on a multiple of 16 values, so the 16 bits never cross a word
+                    auto& pBits = m_vHistory[nSample % m_nWindow];
+                    const unsigned int nShift = nIndex & 31;
+                    pBits.vChanged[nIndex >> 5] |= nChanged << nShift;
+                    pBits.vIncreased[nIndex >> 5] |= nIncreased << nShift;
+                    pBits.vDecreased[nIndex >> 5] |= nDecreased << nShift;
+                }
+            }
+        }
+#endif
+
+        for (; nIndex < nLast; ++nIndex)
+        {
+            const unsigned int nValue = ReadSample(pMemory + nIndex, m_nSize);
+            const unsigned int nPrevious = ReadSample(pPrev + nIndex, m_nSize);
+            if (nValue != nPrevious)
+                ApplyChange(nIndex, nValue, nPrevious, nSample);
+        }
+
+        nNext = std::max(nNext, nLast);
+    }
+
+    memcpy(m_vPrevious.data(), pMemory, m_nBytes);
+    m_nSamples.store(nSample + 1, std::memory_order_relaxed);
+}
+
+bool SearchSampler::GetStatistics(unsigned int nAddress, Statistics& pStatistics) const
+{
+    std::lock_guard<std::mutex> lock(m_mtxStatistics);
+    if (m_nSamples.load(std::memory_order_relaxed) == 0 || nAddress < m_nStartAddress || nAddress - m_nStartAddress >= m_nCount)
+        return false;
+
+    const unsigned int nIndex = nAddress - m_nStartAddress;
+    pStatistics.nChanges = m_vChanges[nIndex];
+    pStatistics.nIncreases = m_vIncreases[nIndex];
+    pStatistics.nDecreases = m_vDecreases[nIndex];
+    pStatistics.nMinimum = LoadStatistic(m_vMinimum, nIndex);
+    pStatistics.nMaximum = LoadStatistic(m_vMaximum, nIndex);
+    return true;
+}
+
+void SearchSampler::MatchAddresses(FilterType nFilterType, unsigned int nParam, unsigned int nParam2,
+    unsigned int nAddress, unsigned int nCount, unsigned int* pBits) const
+{
+    if (m_nSamples.load(std::memory_order_relaxed) == 0)
+        return;
+
+    for (unsigned int i = 0; i < nCount; ++i)
+    {
+        const unsigned int nIndex = nAddress + i - m_nStartAddress;
+        if (nAddress + i < m_nStartAddress || nIndex >= m_nCount)
+            continue;
+
+        bool bMatch;
+        switch (nFilterType)
+        {
+            case FilterType::ChangedExactly:
+                bMatch = (m_vChanges[nIndex] == nParam);
+                break;
+            case FilterType::ChangedAtLeast:
+                bMatch = (m_vChanges[nIndex] >= nParam);
+                break;
+            case FilterType::ChangedAtMost:
+                bMatch = (m_vChanges[nIndex] <= nParam);
+                break;
+            case FilterType::NeverIncreased:
+                bMatch = (m_vIncreases[nIndex] == 0);
+                break;
+            case FilterType::NeverDecreased:
+                bMatch = (m_vDecreases[nIndex] == 0);
+                break;
+            case FilterType::StayedInRange:
+                bMatch = (CompareSamples(LoadStatistic(m_vMinimum, nIndex), nParam, m_nSize) >= 0 &&
+                    CompareSamples(LoadStatistic(m_vMaximum, nIndex), nParam2, m_nSize) <= 0);
+                break;
+            default:
+                bMatch = false;
+                break;
+        }
+
+        if (bMatch)
+            pBits[i >> 5] |= (1U << (i & 31));
+    }
+}
+
+} // namespace services
+} // namespace ra
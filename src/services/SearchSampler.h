@@ -0,0 +1,194 @@
+#ifndef RA_SERVICES_SEARCH_SAMPLER_H
+#define RA_SERVICES_SEARCH_SAMPLER_H
+#pragma once
+
+#include "RA_Condition.h" // ComparisonVariableSize
+#include "RA_ConditionBatch.h" // ConditionBatch::InstructionSet
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ra {
+namespace services {
+
+/// <summary>
+/// Samples a range of memory in the background, counting how often each value changes and tracking
+/// the range of values it held, so search results can be filtered on how values behaved over time.
+/// </summary>
+/// <remarks>
+/// <see cref="Sample" /> is called on the emulator thread. It copies the memory into a free buffer of a
+/// small ring and returns. A worker thread compares each buffer against the previous sample and updates
+/// the counters. If the worker falls behind, samples are dropped rather than waited for.
+/// </remarks>
+class SearchSampler
+{
+public:
+    enum class FilterType
+    {
+        ChangedExactly,     // the value changed exactly nParam times
+        ChangedAtLeast,     // the value changed at least nParam times
+        ChangedAtMost,      // the value changed at most nParam times
+        NeverIncreased,     // the value never increased
+        NeverDecreased,     // the value never decreased
+        StayedInRange,      // every sampled value was between nParam and nParam2, inclusive
+    };
+
+    struct Statistics
+    {
+        unsigned int nChanges;      // samples where the value was different from the previous sample
+        unsigned int nIncreases;
+        unsigned int nDecreases;
+        unsigned int nMinimum;      // sign-extended for signed sizes, IEEE 754 bits for floats
+        unsigned int nMaximum;
+    };
+
+    // the counters are a byte per address, so a window can't be larger than the highest count
+    static const unsigned int MAX_WINDOW = 255;
+
+    SearchSampler() = default;
+    ~SearchSampler();
+    SearchSampler(const SearchSampler&) = delete;
+    SearchSampler& operator=(const SearchSampler&) = delete;
+
+    /// <summary>
+    /// Starts sampling memory, discarding any previously collected data. The first sample is the baseline
+    /// the later samples are compared against.
+    /// </summary>
+    /// <param name="nAddress">The address to start reading from.</param>
+    /// <param name="nBytes">The number of bytes to read.</param>
+    /// <param name="nSize">Size of the entries. Nibbles and bits cannot be sampled.</param>
+    /// <param name="nInterval">Sample every nInterval'th call to <see cref="Sample" />.</param>
+    /// <param name="nWindow">
+    /// Only count changes within the last nWindow samples (at most <see cref="MAX_WINDOW" />). 0 counts
+    /// every change since sampling started, saturating at 255. The minimum and maximum always cover
+    /// every sample.
+    /// </param>
+    /// <returns><c>false</c> if the size cannot be sampled.</returns>
+    bool Start(unsigned int nAddress, unsigned int nBytes, ComparisonVariableSize nSize,
+        unsigned int nInterval = 1, unsigned int nWindow = 0);
+
+    /// <summary>
+    /// Stops sampling. The collected data remains available.
+    /// </summary>
+    void Stop();
+
+    /// <summary>
+    /// Determines whether memory is being sampled.
+    /// </summary>
+    bool IsRunning() const { return m_bRunning.load(std::memory_order_relaxed); }
+
+    /// <summary>
+    /// Captures the memory for the current frame. Must be called on the emulator thread. Does nothing if
+    /// the sampler isn't running, or this isn't a frame that should be sampled.
+    /// </summary>
+    void Sample();
+
+    /// <summary>
+    /// Waits until every captured sample has been applied to the counters.
+    /// </summary>
+    void Flush();
+
+    /// <summary>
+    /// Gets the number of samples applied to the counters, including the baseline.
+    /// </summary>
+    unsigned int SampleCount() const { return m_nSamples.load(std::memory_order_relaxed); }
+
+    /// <summary>
+    /// Gets the number of samples that were skipped because the worker thread was behind.
+    /// </summary>
+    unsigned int DroppedSamples() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+    ComparisonVariableSize Size() const { return m_nSize; }
+    unsigned int Window() const { return m_nWindow; }
+
+    /// <summary>
+    /// Gets the statistics for an address.
+    /// </summary>
+    /// <returns><c>true</c> if the address has been sampled, <c>false</c> if not.</returns>
+    bool GetStatistics(unsigned int nAddress, Statistics& pStatistics) const;
+
+    /// <summary>
+    /// Sets bit (i % 32) of pBits[i / 32] for each of the nCount addresses starting at nAddress that
+    /// match the filter. Addresses that haven't been sampled never match. The caller must hold
+    /// <see cref="LockStatistics" />.
+    /// </summary>
+    void MatchAddresses(FilterType nFilterType, unsigned int nParam, unsigned int nParam2,
+        unsigned int nAddress, unsigned int nCount, unsigned int* pBits) const;
+
+    /// <summary>
+    /// Prevents the worker thread from updating the counters while the returned lock is held.
+    /// </summary>
+    std::unique_lock<std::mutex> LockStatistics() const { return std::unique_lock<std::mutex>(m_mtxStatistics); }
+
+    /// <summary>
+    /// Overrides the instruction set used to compare samples, which is normally detected from the CPU.
+    /// </summary>
+    static void SetInstructionSet(ConditionBatch::InstructionSet nInstructionSet);
+
+private:
+    static const unsigned int RING_SIZE = 4;
+
+    void Run();
+    void ApplySample(const std::vector<unsigned char>& vMemory);
+    void ApplyChange(unsigned int nIndex, unsigned int nValue, unsigned int nPrevious, unsigned int nSample);
+    void RetireSample(unsigned int nSample);
+
+    unsigned int LoadStatistic(const std::vector<unsigned char>& vValues, unsigned int nIndex) const;
+    void StoreStatistic(std::vector<unsigned char>& vValues, unsigned int nIndex, unsigned int nValue) const;
+
+    // configuration. only changed while the worker thread is stopped.
+    unsigned int m_nStartAddress = 0;
+    unsigned int m_nCount = 0;      // number of sampled addresses
+    unsigned int m_nBytes = 0;      // bytes read for each sample (m_nCount + padding)
+    ComparisonVariableSize m_nSize = EightBit;
+    unsigned int m_nInterval = 1;
+    unsigned int m_nWindow = 0;
+
+    // emulator thread
+    unsigned int m_nCalls = 0;
+
+    // ring of captured samples. slots [m_nHead, m_nHead + m_nQueued) are waiting for (or being processed
+    // by) the worker. the emulator thread only writes the slot after them.
+    std::vector<unsigned char> m_vBuffers[RING_SIZE];
+    unsigned int m_nHead = 0;
+    unsigned int m_nQueued = 0;
+    bool m_bStopping = false;
+    std::mutex m_mtxQueue;
+    std::condition_variable m_cvQueued;
+    std::condition_variable m_cvIdle;
+    std::thread m_pWorker;
+    std::atomic<bool> m_bRunning{ false };
+
+    // statistics, in place per address. counts saturate at 255. the minimum and maximum are stored in
+    // the size's width (BytesForSize bytes per address).
+    mutable std::mutex m_mtxStatistics;
+    std::vector<unsigned char> m_vPrevious;
+    std::vector<unsigned char> m_vChanges;
+    std::vector<unsigned char> m_vIncreases;
+    std::vector<unsigned char> m_vDecreases;
+    std::vector<unsigned char> m_vMinimum;
+    std::vector<unsigned char> m_vMaximum;
+
+    // when windowed, the changed/increased/decreased bits of each of the last m_nWindow samples, so their
+    // counts can be removed as they leave the window. sample i is at m_vHistory[i % m_nWindow].
+    struct SampleBits
+    {
+        std::vector<unsigned int> vChanged;
+        std::vector<unsigned int> vIncreased;
+        std::vector<unsigned int> vDecreased;
+    };
+    std::vector<SampleBits> m_vHistory;
+
+    std::atomic<unsigned int> m_nSamples{ 0 };
+    std::atomic<unsigned int> m_nDropped{ 0 };
+};
+
+} // namespace services
+} // namespace ra
+
+extern ra::services::SearchSampler g_SearchSampler;
+
+#endif // !RA_SERVICES_SEARCH_SAMPLER_H
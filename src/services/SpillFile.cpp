@@ -0,0 +1,173 @@
+#include "SpillFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ra {
+namespace services {
+
+// views must start on a multiple of the allocation granularity, which is 64K on every version of Windows
+static const unsigned int VIEW_SIZE = 64 * 1024;
+
+// the file is grown 4MB at a time, so it doesn't have to be remapped for every few slots
+static const unsigned int GROW_VIEWS = 64;
+
+static const unsigned int MAX_MAPPED_VIEWS = 16;
+
+class SpillFile::View
+{
+public:
+    View(unsigned int nIndex, unsigned char* pBytes) : m_nIndex(nIndex), m_pBytes(pBytes) {}
+    ~View() { UnmapViewOfFile(m_pBytes); }
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    unsigned int Index() const { return m_nIndex; }
+    unsigned char* Bytes() const { return m_pBytes; }
+
+private:
+    unsigned int m_nIndex;
+    unsigned char* m_pBytes;
+};
+
+SpillFile::SpillFile(unsigned int nSlotSize)
+    : m_nSlotSize(nSlotSize), m_nSlotsPerView(VIEW_SIZE / nSlotSize)
+{
+    // the file isn't created until something is written to it
+}
+
+SpillFile::~SpillFile()
+{
+    m_vMappedViews.clear();
+
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+}
+
+bool SpillFile::Grow()
+{
+    if (m_bFailed)
+        return false;
+
+    if (m_hFile == INVALID_HANDLE_VALUE)
+    {
+        wchar_t sDirectory[MAX_PATH], sPath[MAX_PATH];
+        if (GetTempPathW(MAX_PATH, sDirectory) == 0 || GetTempFileNameW(sDirectory, L"ras", 0, sPath) == 0)
+        {
+            m_bFailed = true;
+            return false;
+        }
+
+        // the file is never opened again, so it's deleted as soon as the handle is closed, even if we crash
+        m_hFile = CreateFileW(sPath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+        {
+            m_bFailed = true;
+            return false;
+        }
+    }
+
+    LARGE_INTEGER nSize;
+    nSize.QuadPart = static_cast<LONGLONG>(m_nViews + GROW_VIEWS) * VIEW_SIZE;
+    if (!SetFilePointerEx(m_hFile, nSize, nullptr, FILE_BEGIN) || !SetEndOfFile(m_hFile))
+        return false;
+
+    // a mapping can't grow, so replace it. views of the old mapping remain valid until they're unmapped.
+    HANDLE hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, nSize.HighPart, nSize.LowPart, nullptr);
+    if (hMapping == nullptr)
+        return false;
+
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+
+    m_hMapping = hMapping;
+    m_nViews += GROW_VIEWS;
+    return true;
+}
+
+std::shared_ptr<SpillFile::View> SpillFile::GetView(unsigned int nView)
+{
+    for (auto iter = m_vMappedViews.begin(); iter != m_vMappedViews.end(); ++iter)
+    {
+        if ((*iter)->Index() == nView)
+        {
+            std::rotate(m_vMappedViews.begin(), iter, iter + 1);
+            return m_vMappedViews.front();
+        }
+    }
+
+    LARGE_INTEGER nOffset;
+    nOffset.QuadPart = static_cast<LONGLONG>(nView) * VIEW_SIZE;
+    auto* pBytes = static_cast<unsigned char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ | FILE_MAP_WRITE,
+        nOffset.HighPart, nOffset.LowPart, VIEW_SIZE));
+    if (pBytes == nullptr)
+        return nullptr;
+
+    if (m_vMappedViews.size() == MAX_MAPPED_VIEWS)
+        m_vMappedViews.pop_back();
+
+    m_vMappedViews.insert(m_vMappedViews.begin(), std::make_shared<View>(nView, pBytes));
+    return m_vMappedViews.front();
+}
+
+unsigned int SpillFile::Write(const unsigned char* pBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    unsigned int nSlot;
+    if (!m_vFreeSlots.empty())
+    {
+        nSlot = m_vFreeSlots.back();
+    }
+    else
+    {
+        nSlot = m_nNextSlot;
+        if (nSlot / m_nSlotsPerView >= m_nViews && !Grow())
+            return INVALID_SLOT;
+    }
+
+    const auto pView = GetView(nSlot / m_nSlotsPerView);
+    if (pView == nullptr)
+        return INVALID_SLOT;
+
+    memcpy(pView->Bytes() + (nSlot % m_nSlotsPerView) * m_nSlotSize, pBytes, m_nSlotSize);
+
+    if (!m_vFreeSlots.empty())
+        m_vFreeSlots.pop_back();
+    else
+        ++m_nNextSlot;
+
+    return nSlot;
+}
+
+const unsigned char* SpillFile::Read(unsigned int nSlot, std::shared_ptr<const void>& pPin)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    auto pView = GetView(nSlot / m_nSlotsPerView);
+    if (pView == nullptr)
+        return nullptr;
+
+    const unsigned char* pBytes = pView->Bytes() + (nSlot % m_nSlotsPerView) * m_nSlotSize;
+    pPin = std::move(pView);
+    return pBytes;
+}
+
+void SpillFile::Free(unsigned int nSlot)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_vFreeSlots.push_back(nSlot);
+}
+
+unsigned int SpillFile::SlotCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_nNextSlot - static_cast<unsigned int>(m_vFreeSlots.size());
+}
+
+} // namespace services
+} // namespace ra
@@ -0,0 +1,81 @@
+#ifndef RA_SERVICES_SPILL_FILE_H
+#define RA_SERVICES_SPILL_FILE_H
+#pragma once
+
+#include "RA_Defs.h" // HANDLE
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ra {
+namespace services {
+
+/// <summary>
+/// Stores fixed-size slots of data in a temporary file that is read and written through memory-mapped
+/// views, for data that would otherwise use too much of the heap. The file is deleted when it's closed.
+/// </summary>
+/// <remarks>
+/// Only the most recently used views are kept mapped, so the address space used doesn't depend on the
+/// size of the file. All methods are thread safe.
+/// </remarks>
+class SpillFile
+{
+public:
+    explicit SpillFile(unsigned int nSlotSize);
+    ~SpillFile();
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    static const unsigned int INVALID_SLOT = 0xFFFFFFFF;
+
+    /// <summary>
+    /// Copies a slot's worth of bytes into an unused slot.
+    /// </summary>
+    /// <returns>The slot, or <see cref="INVALID_SLOT" /> if the file couldn't be created or grown.</returns>
+    unsigned int Write(const unsigned char* pBytes);
+
+    /// <summary>
+    /// Gets the bytes of a slot, mapping them in if necessary.
+    /// </summary>
+    /// <param name="nSlot">The slot returned by <see cref="Write" />.</param>
+    /// <param name="pPin">Keeps the bytes mapped until it's released.</param>
+    /// <returns>The bytes, or <c>nullptr</c> if they couldn't be mapped.</returns>
+    const unsigned char* Read(unsigned int nSlot, std::shared_ptr<const void>& pPin);
+
+    /// <summary>
+    /// Makes a slot available to be reused.
+    /// </summary>
+    void Free(unsigned int nSlot);
+
+    /// <summary>
+    /// Gets the number of slots that have been written and not freed.
+    /// </summary>
+    unsigned int SlotCount() const;
+
+private:
+    class View;
+
+    std::shared_ptr<View> GetView(unsigned int nView);
+    bool Grow();
+
+    unsigned int m_nSlotSize;
+    unsigned int m_nSlotsPerView;
+
+    HANDLE m_hFile = INVALID_HANDLE_VALUE;
+    HANDLE m_hMapping = nullptr;
+    unsigned int m_nViews = 0;      // views the file is large enough for
+    unsigned int m_nNextSlot = 0;   // slots below this have been used at least once
+    std::vector<unsigned int> m_vFreeSlots;
+    bool m_bFailed = false;
+
+    // the most recently used views, most recent first. views that have been dropped from the list stay
+    // mapped until the last pin on them is released.
+    std::vector<std::shared_ptr<View>> m_vMappedViews;
+    mutable std::mutex m_mtx;
+};
+
+} // namespace services
+} // namespace ra
+
+#endif // !RA_SERVICES_SPILL_FILE_H
@@ -58,6 +58,16 @@ bool JsonFileConfiguration::Load(const std::wstring& sFilename)
 
     if (doc.HasMember("Prefer Decimal"))
         SetFeatureEnabled(Feature::PreferDecimal, doc["Prefer Decimal"].GetBool());
+    if (doc.HasMember("Frame Snapshot"))
+        SetFeatureEnabled(Feature::FrameSnapshot, doc["Frame Snapshot"].GetBool());
+    if (doc.HasMember("Incremental Evaluation"))
+        SetFeatureEnabled(Feature::IncrementalEvaluation, doc["Incremental Evaluation"].GetBool());
+    if (doc.HasMember("Batch Evaluation"))
+        SetFeatureEnabled(Feature::BatchEvaluation, doc["Batch Evaluation"].GetBool());
+    if (doc.HasMember("Frame Profiler"))
+        SetFeatureEnabled(Feature::FrameProfiler, doc["Frame Profiler"].GetBool());
+    if (doc.HasMember("Value Cache"))
+        SetFeatureEnabled(Feature::ValueCache, doc["Value Cache"].GetBool());
 
     if (doc.HasMember("Num Background Threads"))
         m_nBackgroundThreads = doc["Num Background Threads"].GetUint();
@@ -111,6 +121,11 @@ void JsonFileConfiguration::Save() const
     doc.AddMember("Leaderboard Counter Display", IsFeatureEnabled(Feature::LeaderboardCounters), a);
     doc.AddMember("Leaderboard Scoreboard Display", IsFeatureEnabled(Feature::LeaderboardScoreboards), a);
     doc.AddMember("Prefer Decimal", IsFeatureEnabled(Feature::PreferDecimal), a);
+    doc.AddMember("Frame Snapshot", IsFeatureEnabled(Feature::FrameSnapshot), a);
+    doc.AddMember("Incremental Evaluation", IsFeatureEnabled(Feature::IncrementalEvaluation), a);
+    doc.AddMember("Batch Evaluation", IsFeatureEnabled(Feature::BatchEvaluation), a);
+    doc.AddMember("Frame Profiler", IsFeatureEnabled(Feature::FrameProfiler), a);
+    doc.AddMember("Value Cache", IsFeatureEnabled(Feature::ValueCache), a);
     doc.AddMember("Num Background Threads", m_nBackgroundThreads, a);
 
     if (!m_sRomDirectory.empty())
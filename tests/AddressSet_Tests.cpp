@@ -0,0 +1,206 @@
+#include "CppUnitTest.h"
+
+#include "services\AddressSet.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(AddressSet_Tests)
+{
+public:
+    static void AssertAddresses(const AddressSet& set, const std::vector<unsigned int>& vExpected)
+    {
+        Assert::AreEqual(static_cast<unsigned int>(vExpected.size()), set.Count());
+
+        unsigned int nAddress;
+        for (unsigned int i = 0; i < vExpected.size(); ++i)
+        {
+            Assert::IsTrue(set.GetAt(i, nAddress));
+            Assert::AreEqual(vExpected[i], nAddress);
+            Assert::IsTrue(set.Contains(nAddress));
+        }
+
+        Assert::IsFalse(set.GetAt(static_cast<unsigned int>(vExpected.size()), nAddress));
+    }
+
+    TEST_METHOD(TestEmpty)
+    {
+        AddressSet set;
+        set.Reset(0x100, 0x1000);
+        set.Compact();
+
+        Assert::AreEqual(0U, set.Count());
+        Assert::IsFalse(set.Contains(0x100));
+
+        unsigned int nAddress;
+        Assert::IsFalse(set.GetAt(0, nAddress));
+    }
+
+    TEST_METHOD(TestSparse)
+    {
+        AddressSet set;
+        set.Reset(0x100, 0x1000);
+        set.Add(0x105);
+        set.Add(0x180);
+        set.Add(0x10FF);
+        set.Compact();
+
+        Assert::IsFalse(set.IsDense());
+        AssertAddresses(set, { 0x105, 0x180, 0x10FF });
+        Assert::IsFalse(set.Contains(0x100));
+        Assert::IsFalse(set.Contains(0x106));
+
+        Assert::IsTrue(set.Remove(0x180));
+        Assert::IsFalse(set.Remove(0x180));
+        AssertAddresses(set, { 0x105, 0x10FF });
+    }
+
+    TEST_METHOD(TestDense)
+    {
+        AddressSet set;
+        std::vector<unsigned int> vExpected;
+        set.Reset(0x10, 5000);
+        for (unsigned int nAddress = 0x10; nAddress < 0x10 + 5000; nAddress += 3)
+        {
+            set.Add(nAddress);
+            vExpected.push_back(nAddress);
+        }
+        set.Compact();
+
+        Assert::IsTrue(set.IsDense());
+        AssertAddresses(set, vExpected);
+        Assert::IsFalse(set.Contains(0x0F));
+        Assert::IsFalse(set.Contains(0x11));
+        Assert::IsFalse(set.Contains(0x10 + 5000));
+
+        // removing updates the index for everything after it
+        Assert::IsTrue(set.Remove(0x13));
+        Assert::IsFalse(set.Remove(0x14));
+        vExpected.erase(vExpected.begin() + 1);
+        Assert::IsTrue(set.Remove(vExpected.back()));
+        vExpected.pop_back();
+        AssertAddresses(set, vExpected);
+    }
+
+    TEST_METHOD(TestAddBitsUnaligned)
+    {
+        for (unsigned int nOffset : { 0U, 1U, 17U, 31U, 32U, 45U })
+        {
+            AddressSet set;
+            set.Reset(1000, 200);
+
+            // every other address for 70 addresses
+            unsigned int vBits[3] = { 0x55555555, 0x55555555, 0x15 };
+            set.AddBits(1000 + nOffset, vBits, 70);
+            set.Compact();
+
+            std::vector<unsigned int> vExpected;
+            for (unsigned int i = 0; i < 70; i += 2)
+                vExpected.push_back(1000 + nOffset + i);
+
+            AssertAddresses(set, vExpected);
+        }
+    }
+
+    TEST_METHOD(TestIntersectBits)
+    {
+        for (bool bDense : { false, true })
+        {
+            AddressSet set;
+            set.Reset(1000, 200);
+            set.Add(1003);
+            set.Add(1040);
+            set.Add(1041);
+            set.Add(1099);
+            if (bDense)
+            {
+                for (unsigned int nAddress = 1120; nAddress < 1200; ++nAddress)
+                    set.Add(nAddress);
+            }
+            set.Compact();
+            Assert::AreEqual(bDense, set.IsDense());
+
+            // starting before the set's range
+            unsigned int vBits[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+            set.IntersectBits(990, vBits, 128);
+            Assert::AreEqual(1U << 13, vBits[0]);
+            Assert::AreEqual((1U << 18) | (1U << 19), vBits[1]);
+            Assert::AreEqual(0U, vBits[2]);
+            Assert::AreEqual(1U << 13, vBits[3]);
+
+            // starting inside the set's range at an unaligned address
+            unsigned int vBits2[3] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+            set.IntersectBits(1035, vBits2, 96);
+            Assert::AreEqual((1U << 5) | (1U << 6), vBits2[0]);
+            Assert::AreEqual(0U, vBits2[1]);
+            Assert::AreEqual((1U << 0) | (bDense ? 0xFFE00000 : 0U), vBits2[2]);
+        }
+    }
+
+    TEST_METHOD(TestCompactSharesBlocks)
+    {
+        // 16 blocks of 4096 addresses, all set
+        const unsigned int nCount = 16 * 4096;
+        std::vector<unsigned int> vBits(nCount / 32, 0xFFFFFFFF);
+
+        AddressSet previous;
+        previous.Reset(0, nCount);
+        previous.AddBits(0, vBits.data(), nCount);
+        previous.Compact();
+        const size_t nFullUsage = previous.MemoryUsage();
+
+        // only the block containing the removed address is allocated by the new set
+        vBits[100] = 0xFFFFFFFE;
+        AddressSet set;
+        set.Reset(0, nCount);
+        set.AddBits(0, vBits.data(), nCount);
+        set.Compact(&previous);
+        Assert::AreEqual(nCount - 1, set.Count());
+        Assert::IsFalse(set.Contains(3200));
+        Assert::IsTrue(previous.Contains(3200));
+        Assert::IsTrue(set.MemoryUsage() < nFullUsage / 4);
+
+        // removing from a copy doesn't affect the original
+        AddressSet copy(set);
+        Assert::IsTrue(copy.Remove(5000));
+        Assert::IsFalse(copy.Contains(5000));
+        Assert::IsTrue(set.Contains(5000));
+        Assert::AreEqual(nCount - 1, set.Count());
+        Assert::AreEqual(nCount - 2, copy.Count());
+
+        unsigned int nAddress;
+        Assert::IsTrue(copy.GetAt(4999, nAddress));
+        Assert::AreEqual(5001U, nAddress);
+        Assert::IsTrue(set.GetAt(4999, nAddress));
+        Assert::AreEqual(5000U, nAddress);
+    }
+
+    TEST_METHOD(TestGetAtLarge)
+    {
+        // a 4M address range with every address matching, as after a "not equal" filter on noisy memory
+        const unsigned int nCount = 4 * 1024 * 1024;
+        AddressSet set;
+        set.Reset(0, nCount);
+        std::vector<unsigned int> vBits(nCount / 32, 0xFFFFFFFF);
+        set.AddBits(0, vBits.data(), nCount);
+        set.Compact();
+        Assert::AreEqual(nCount, set.Count());
+
+        set.Remove(12);
+        unsigned int nAddress;
+        Assert::IsTrue(set.GetAt(11, nAddress));
+        Assert::AreEqual(11U, nAddress);
+        Assert::IsTrue(set.GetAt(12, nAddress));
+        Assert::AreEqual(13U, nAddress);
+        Assert::IsTrue(set.GetAt(nCount - 2, nAddress));
+        Assert::AreEqual(nCount - 1, nAddress);
+        Assert::IsFalse(set.GetAt(nCount - 1, nAddress));
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -0,0 +1,135 @@
+#include "CppUnitTest.h"
+
+#include "services\FrameProfiler.h"
+#include "RA_UnitTestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(FrameProfiler_Tests)
+{
+public:
+    static FrameProfiler::Clock::duration Microseconds(int nMicroseconds)
+    {
+        return std::chrono::duration_cast<FrameProfiler::Clock::duration>(std::chrono::microseconds(nMicroseconds));
+    }
+
+    TEST_METHOD(TestDisabled)
+    {
+        FrameProfiler profiler;
+        Assert::IsFalse(profiler.IsEnabled());
+
+        {
+            ScopedProfilerFrame frame(profiler);
+            ScopedProfilerSection section(profiler, FrameProfiler::Section::AchievementSet);
+        }
+
+        Assert::AreEqual(size_t(0), profiler.GetFrameStatistics().nSamples);
+        Assert::AreEqual(size_t(0), profiler.GetSectionStatistics(FrameProfiler::Section::AchievementSet).nSamples);
+    }
+
+    TEST_METHOD(TestSectionPercentiles)
+    {
+        FrameProfiler profiler;
+        profiler.SetEnabled(true);
+
+        // 1..100 microseconds
+        for (int i = 1; i <= 100; ++i)
+        {
+            profiler.BeginFrame();
+            profiler.AddSectionTime(FrameProfiler::Section::LeaderboardManager, Microseconds(i));
+            profiler.EndFrame();
+        }
+
+        const auto stats = profiler.GetSectionStatistics(FrameProfiler::Section::LeaderboardManager);
+        Assert::AreEqual(size_t(100), stats.nSamples);
+        Assert::AreEqual(50.0, stats.fP50, 0.001);
+        Assert::AreEqual(99.0, stats.fP99, 0.001);
+        Assert::AreEqual(100.0, stats.fMax, 0.001);
+
+        // sections that weren't hit still get a sample for each frame
+        Assert::AreEqual(size_t(100), profiler.GetSectionStatistics(FrameProfiler::Section::RichPresence).nSamples);
+        Assert::AreEqual(0.0, profiler.GetSectionStatistics(FrameProfiler::Section::RichPresence).fMax);
+    }
+
+    TEST_METHOD(TestRollingWindow)
+    {
+        FrameProfiler profiler;
+        profiler.SetEnabled(true);
+        profiler.SetWindowSize(10);
+
+        for (int i = 1; i <= 25; ++i)
+        {
+            profiler.BeginFrame();
+            profiler.AddSectionTime(FrameProfiler::Section::MemoryDialog, Microseconds(i));
+            profiler.EndFrame();
+        }
+
+        // only frames 16-25 remain
+        const auto stats = profiler.GetSectionStatistics(FrameProfiler::Section::MemoryDialog);
+        Assert::AreEqual(size_t(10), stats.nSamples);
+        Assert::AreEqual(20.0, stats.fP50, 0.001);
+        Assert::AreEqual(25.0, stats.fMax, 0.001);
+    }
+
+    TEST_METHOD(TestAchievementCost)
+    {
+        FrameProfiler profiler;
+        profiler.SetEnabled(true);
+
+        for (int i = 1; i <= 4; ++i)
+        {
+            profiler.BeginFrame();
+            profiler.AddAchievementCost(12, Microseconds(10 * i), 3);
+            profiler.AddAchievementCost(12, Microseconds(1), 1); // multiple evaluations in a frame are combined
+            if (i == 4)
+                profiler.AddAchievementCost(34, Microseconds(100), 7);
+            profiler.EndFrame();
+        }
+
+        const auto stats = profiler.GetAchievementStatistics(12);
+        Assert::AreEqual(size_t(4), stats.nSamples);
+        Assert::AreEqual(41.0, stats.fMax, 0.001);
+        Assert::AreEqual(4.0, profiler.GetAchievementMemoryReadStatistics(12).fMax);
+
+        // only frames where the achievement was evaluated are sampled
+        Assert::AreEqual(size_t(1), profiler.GetAchievementStatistics(34).nSamples);
+        Assert::AreEqual(size_t(0), profiler.GetAchievementStatistics(56).nSamples);
+
+        // disabling discards the data
+        profiler.SetEnabled(false);
+        Assert::AreEqual(size_t(0), profiler.GetAchievementStatistics(12).nSamples);
+    }
+
+    TEST_METHOD(TestExportJson)
+    {
+        FrameProfiler profiler;
+        profiler.SetEnabled(true);
+        profiler.SetWindowSize(4);
+
+        profiler.BeginFrame();
+        profiler.AddSectionTime(FrameProfiler::Section::AchievementSet, Microseconds(8));
+        profiler.AddAchievementCost(12, Microseconds(2), 1);
+        profiler.AddAchievementCost(34, Microseconds(6), 5);
+        profiler.EndFrame();
+
+        const std::string sJson = profiler.ExportJson();
+        Assert::AreEqual(std::string("{\"WindowSize\":4,\"Frame\":"), sJson.substr(0, 24));
+        Assert::AreNotEqual(std::string::npos, sJson.find("\"AchievementSet\":{\"p50\":8.0,\"p99\":8.0,\"max\":8.0,\"samples\":1}"));
+
+        // most expensive achievement first
+        const size_t nFirst = sJson.find("{\"ID\":34,");
+        const size_t nSecond = sJson.find("{\"ID\":12,");
+        Assert::AreNotEqual(std::string::npos, nFirst);
+        Assert::AreNotEqual(std::string::npos, nSecond);
+        Assert::IsTrue(nFirst < nSecond);
+        Assert::AreNotEqual(std::string::npos, sJson.find("\"MemoryReads\":{\"p50\":5.0,\"p99\":5.0,\"max\":5.0,\"samples\":1}"));
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
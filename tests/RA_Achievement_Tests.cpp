@@ -1,6 +1,7 @@
 #include "CppUnitTest.h"
 
 #include "RA_Achievement.h"
+#include "RA_MemManager.h"
 #include "RA_UnitTestHelpers.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -195,6 +196,49 @@ public:
         ach.ParseStateString(pIter, "user1");
         Assert::AreEqual(0U, ach.GetCondition(0, 0).CurrentHits());
     }
+
+    TEST_METHOD(TestTestDoesNotAllocate)
+    {
+        unsigned char memory[16] = { 0 };
+        InitializeMemory(memory, sizeof(memory));
+
+        const char* vDefinitions[] = {
+            "1:0xH0001=1_0xH0002<2",
+            "2:0xH0001=1_0xH0002=d0xH0002",
+            "3:0xH0001=1.30._R:0xH0002=3_P:0xH0003=2",
+            "4:A:0xH0004=0_B:0xH0005=0_0xH0006=2.20._P:0xH0007=1.2.",
+            "5:C:0xH0008=1_C:0xH0009=2_0xH000a=3.40._A:0xH000b=0_P:0xH000c=3",
+            "6:0xH000d=0.2._0xH0001=1S0x 000e>0xH000f_P:0xH0003=0SR:0xH0004=3_0xH0005!=0.50.",
+        };
+
+        std::vector<Achievement> vAchievements;
+        for (const char* sDefinition : vDefinitions)
+        {
+            vAchievements.emplace_back(AchievementSetType::Local);
+            vAchievements.back().ParseLine(sDefinition);
+        }
+
+        // the first frame compiles the conditions and builds the read plan
+        g_MemManager.BeginFrame(false);
+        for (auto& ach : vAchievements)
+            ach.Test();
+        g_MemManager.EndFrame();
+
+        AllocationCounter allocations;
+        unsigned int nSeed = 2468;
+        for (int nFrame = 0; nFrame < 10000; ++nFrame)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            memory[(nSeed >> 16) & 0x0F] = static_cast<unsigned char>((nSeed >> 20) & 0x03);
+
+            g_MemManager.BeginFrame(false);
+            for (auto& ach : vAchievements)
+                ach.Test();
+            g_MemManager.EndFrame();
+        }
+
+        Assert::AreEqual(size_t(0), allocations.Count());
+    }
 };
 
 } // namespace tests
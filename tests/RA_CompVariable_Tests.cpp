@@ -72,6 +72,12 @@ public:
         AssertParseCompVariable("0xR1234", Address, Bit_5, 0x1234U);
         AssertParseCompVariable("0xS1234", Address, Bit_6, 0x1234U);
         AssertParseCompVariable("0xT1234", Address, Bit_7, 0x1234U);
+        AssertParseCompVariable("0xI1234", Address, SixteenBitBE, 0x1234U);
+        AssertParseCompVariable("0xG1234", Address, ThirtyTwoBitBE, 0x1234U);
+        AssertParseCompVariable("0xY1234", Address, SignedEightBit, 0x1234U);
+        AssertParseCompVariable("0xZ1234", Address, SignedSixteenBit, 0x1234U);
+        AssertParseCompVariable("0xV1234", Address, SignedThirtyTwoBit, 0x1234U);
+        AssertParseCompVariable("fF1234", Address, Float, 0x1234U);
 
         // sizes (ignore case)
         AssertParseCompVariable("0Xh1234", Address, EightBit, 0x1234U);
@@ -111,6 +117,9 @@ public:
         AssertParseCompVariable("d0xR1234", DeltaMem, Bit_5, 0x1234U);
         AssertParseCompVariable("d0xS1234", DeltaMem, Bit_6, 0x1234U);
         AssertParseCompVariable("d0xT1234", DeltaMem, Bit_7, 0x1234U);
+        AssertParseCompVariable("d0xI1234", DeltaMem, SixteenBitBE, 0x1234U);
+        AssertParseCompVariable("d0xV1234", DeltaMem, SignedThirtyTwoBit, 0x1234U);
+        AssertParseCompVariable("dfF1234", DeltaMem, Float, 0x1234U);
 
         // ignores case
         AssertParseCompVariable("D0Xh1234", DeltaMem, EightBit, 0x1234U);
@@ -168,9 +177,16 @@ public:
         AssertSerialize("0xR1234");
         AssertSerialize("0xS1234");
         AssertSerialize("0xT1234");
+        AssertSerialize("0xI1234");
+        AssertSerialize("0xG1234");
+        AssertSerialize("0xY1234");
+        AssertSerialize("0xZ1234");
+        AssertSerialize("0xV1234");
+        AssertSerialize("fF1234");
 
         // delta
         AssertSerialize("d0xH1234");
+        AssertSerialize("dfF1234");
 
         // value
         AssertSerialize("123");
@@ -296,6 +312,38 @@ public:
         Assert::AreEqual(var.GetValue(), 0U);
     }
 
+    TEST_METHOD(TestVariableGetValueTyped)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0xC0, 0xBF };
+        InitializeMemory(memory, 9);
+
+        CompVariable var;
+
+        // big-endian
+        var.Set(SixteenBitBE, Address, 1U);
+        Assert::AreEqual(var.GetValue(), 0x1234U);
+
+        var.Set(ThirtyTwoBitBE, Address, 1U);
+        Assert::AreEqual(var.GetValue(), 0x1234AB56U);
+
+        // signed values are sign-extended
+        var.Set(SignedEightBit, Address, 1U);
+        Assert::AreEqual(var.GetValue(), 0x12U);
+
+        var.Set(SignedEightBit, Address, 3U);
+        Assert::AreEqual(var.GetValue(), 0xFFFFFFABU);
+
+        var.Set(SignedSixteenBit, Address, 2U);
+        Assert::AreEqual(var.GetValue(), 0xFFFFAB34U);
+
+        var.Set(SignedThirtyTwoBit, Address, 1U);
+        Assert::AreEqual(var.GetValue(), 0x56AB3412U);
+
+        // floats are truncated to an integer (-1.5 => -1)
+        var.Set(Float, Address, 5U);
+        Assert::AreEqual(var.GetValue(), 0xFFFFFFFFU);
+    }
+
     TEST_METHOD(TestVariableGetValueDelta)
     {
         unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
@@ -0,0 +1,279 @@
+#include "CppUnitTest.h"
+
+#include "RA_ConditionBatch.h"
+#include "RA_UnitTestHelpers.h"
+
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace data {
+namespace tests {
+
+TEST_CLASS(RA_ConditionBatch_Tests)
+{
+public:
+    static std::vector<ConditionBatch::InstructionSet> SupportedInstructionSets()
+    {
+        std::vector<ConditionBatch::InstructionSet> vInstructionSets;
+        vInstructionSets.push_back(ConditionBatch::InstructionSet::Scalar);
+
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        if (nDetected != ConditionBatch::InstructionSet::Scalar)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::SSE2);
+        if (nDetected == ConditionBatch::InstructionSet::AVX2)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::AVX2);
+
+        return vInstructionSets;
+    }
+
+    static bool ExpectedResult(ComparisonType nCompareType, unsigned int nLeft, unsigned int nRight)
+    {
+        switch (nCompareType)
+        {
+            case Equals:                return nLeft == nRight;
+            case LessThan:              return nLeft < nRight;
+            case LessThanOrEqual:       return nLeft <= nRight;
+            case GreaterThan:           return nLeft > nRight;
+            case GreaterThanOrEqual:    return nLeft >= nRight;
+            case NotEqualTo:            return nLeft != nRight;
+            default:                    return true;
+        }
+    }
+
+    TEST_METHOD(TestCompareLanes)
+    {
+        // every pairing of values around the signed/unsigned boundaries
+        const unsigned int vBoundaries[] = { 0U, 1U, 2U, 0x7FFFFFFEU, 0x7FFFFFFFU, 0x80000000U, 0x80000001U, 0xFFFFFFFEU, 0xFFFFFFFFU };
+        std::vector<unsigned int> vValues, vConstants;
+        for (unsigned int nLeft : vBoundaries)
+        {
+            for (unsigned int nRight : vBoundaries)
+            {
+                vValues.push_back(nLeft);
+                vConstants.push_back(nRight);
+            }
+        }
+
+        std::vector<unsigned char> vResults;
+        for (auto nInstructionSet : SupportedInstructionSets())
+        {
+            for (int nCompareType = 0; nCompareType < NumComparisonTypes; ++nCompareType)
+            {
+                // lengths that leave every possible remainder for the vector widths
+                for (size_t nCount : { vValues.size(), vValues.size() - 1, size_t(9), size_t(8), size_t(7), size_t(4), size_t(3), size_t(1) })
+                {
+                    vResults.assign(vValues.size(), 0xCC);
+                    ConditionBatch::CompareLanes(nInstructionSet, static_cast<ComparisonType>(nCompareType),
+                        vValues.data(), vConstants.data(), vResults.data(), nCount);
+
+                    for (size_t i = 0; i < nCount; ++i)
+                    {
+                        const bool bExpected = ExpectedResult(static_cast<ComparisonType>(nCompareType), vValues[i], vConstants[i]);
+                        Assert::AreEqual(bExpected ? 1 : 0, static_cast<int>(vResults[i]), Widen(COMPARISONTYPE_STR[nCompareType]).c_str());
+                    }
+
+                    // nothing past the end was written
+                    for (size_t i = nCount; i < vResults.size(); ++i)
+                        Assert::AreEqual(0xCC, static_cast<int>(vResults[i]));
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(TestAddLaneSharesComparisons)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, sizeof(memory));
+
+        g_MemManager.BeginFrame(false);
+        const unsigned int nReadIndex1 = g_MemManager.AddToReadPlan(1, EightBit);
+        const unsigned int nReadIndex2 = g_MemManager.AddToReadPlan(2, EightBit);
+
+        ConditionBatch batch;
+        const unsigned int nLane1 = batch.AddLane(nReadIndex1, Equals, 0x12);
+        const unsigned int nLane2 = batch.AddLane(nReadIndex1, GreaterThan, 0x12);
+        const unsigned int nLane3 = batch.AddLane(nReadIndex2, Equals, 0x12);
+        Assert::AreEqual(nLane1, batch.AddLane(nReadIndex1, Equals, 0x12));
+        Assert::AreEqual(size_t(3), batch.NumLanes());
+
+        Assert::IsTrue(batch.GetResult(nLane1));
+        Assert::IsFalse(batch.GetResult(nLane2));
+        Assert::IsFalse(batch.GetResult(nLane3));
+        g_MemManager.EndFrame();
+
+        // the next frame sees the new values
+        memory[1] = 0x13;
+        memory[2] = 0x12;
+        g_MemManager.BeginFrame(false);
+        Assert::IsFalse(batch.GetResult(nLane1));
+        Assert::IsTrue(batch.GetResult(nLane2));
+        Assert::IsTrue(batch.GetResult(nLane3));
+        g_MemManager.EndFrame();
+
+        // rebuilding the read plan discards the lanes
+        g_MemManager.ClearReadPlan();
+        g_MemManager.BeginFrame(false);
+        batch.AddLane(g_MemManager.AddToReadPlan(1, EightBit), Equals, 0x13);
+        Assert::AreEqual(size_t(1), batch.NumLanes());
+        g_MemManager.EndFrame();
+    }
+
+    void AssertBatchMatchesInterpreted(const char* sSerialized)
+    {
+        unsigned char memory[8] = { 0 };
+        InitializeMemory(memory, sizeof(memory));
+
+        ConditionProgram::SetBatchEvaluation(true);
+
+        for (auto nInstructionSet : SupportedInstructionSets())
+        {
+            g_ConditionBatch.SetInstructionSet(nInstructionSet);
+
+            const char* ptr;
+            ConditionSet batched, interpreted;
+            batched.ParseFromString(ptr = sSerialized);
+            interpreted.ParseFromString(ptr = sSerialized);
+
+            unsigned int nSeed = 4321;
+            for (int nFrame = 0; nFrame < 500; ++nFrame)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                memory[(nSeed >> 16) & 0x07] = static_cast<unsigned char>((nSeed >> 20) & 0x03);
+
+                bool bBatchedDirty, bBatchedReset, bInterpretedDirty, bInterpretedReset;
+                g_MemManager.BeginFrame(false);
+                const bool bBatched = batched.Test(bBatchedDirty, bBatchedReset);
+                g_MemManager.EndFrame();
+                const bool bInterpreted = interpreted.TestInterpreted(bInterpretedDirty, bInterpretedReset);
+
+                Assert::AreEqual(bInterpreted, bBatched, Widen(sSerialized).c_str());
+                Assert::AreEqual(bInterpretedDirty, bBatchedDirty, L"bDirtyConditions");
+                Assert::AreEqual(bInterpretedReset, bBatchedReset, L"bWasReset");
+
+                for (size_t nGroup = 0; nGroup < interpreted.GroupCount(); ++nGroup)
+                {
+                    const ConditionGroup& expected = interpreted.GetGroup(nGroup);
+                    const ConditionGroup& actual = batched.GetGroup(nGroup);
+                    for (size_t i = 0; i < expected.Count(); ++i)
+                        Assert::AreEqual(expected.GetAt(i).CurrentHits(), actual.GetAt(i).CurrentHits(), L"CurrentHits");
+                }
+            }
+        }
+
+        g_ConditionBatch.SetInstructionSet(ConditionBatch::DetectInstructionSet());
+        ConditionProgram::SetBatchEvaluation(false);
+    }
+
+    TEST_METHOD(TestBatchMatchesInterpreted)
+    {
+        AssertBatchMatchesInterpreted("0xH0001=1_0xH0002<2");
+        AssertBatchMatchesInterpreted("0xH0001!=0_0xH0002>=2_0xH0003<=1_0xH0004>0");
+        AssertBatchMatchesInterpreted("0xH0001=1_0xH0002=d0xH0002");
+        AssertBatchMatchesInterpreted("0xH0001=1.3._R:0xH0002=3_P:0xH0003=2");
+        AssertBatchMatchesInterpreted("A:0xH0001=0_B:0xH0002=0_0xH0003=2.2._P:0xH0004=1.2.");
+        AssertBatchMatchesInterpreted("C:0xH0001=1_C:0xH0002=2_0xH0003=3.4._A:0xH0004=0_P:0xH0005=3");
+        AssertBatchMatchesInterpreted("0xH0000=0.2._0xH0001=1S0xH0002>0xH0003_P:0xH0003=0SR:0xH0004=3_0xH0005!=0.5.");
+
+        // AddHits doesn't use the AddSource chain, but passes it on to the next condition
+        AssertBatchMatchesInterpreted("A:0xH0001=0_C:0xH0002=1_0xH0003=2");
+        AssertBatchMatchesInterpreted("A:0xH0001=0_C:0xH0002=1_C:0xH0004=0_0xH0003=2.3.");
+        AssertBatchMatchesInterpreted("B:0xH0001=0_C:0xH0002=1_P:0xH0003=0");
+    }
+
+    TEST_METHOD(TestLanesReleased)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, sizeof(memory));
+        ConditionProgram::SetBatchEvaluation(true);
+
+        // the lanes of the previous read plan are discarded when the first lane is added
+        {
+            const char* ptr;
+            ConditionSet set, set2;
+            set.ParseFromString(ptr = "0xH0001=18_0xH0002=52_0xH0003>1");
+            set2.ParseFromString(ptr = "0xH0001=18_0xH0004=0");
+
+            bool bDirty, bReset;
+            g_MemManager.BeginFrame(false);
+            Assert::IsTrue(set.Test(bDirty, bReset));
+            Assert::IsFalse(set2.Test(bDirty, bReset));
+            g_MemManager.EndFrame();
+            Assert::AreEqual(size_t(4), g_ConditionBatch.NumLanes());
+
+            // editing the set recompiles it, which releases its old lanes - the shared one is still referenced by set2
+            set.GetGroup(0).GetAt(0).CompTarget().SetValues(19, 19);
+            g_MemManager.BeginFrame(false);
+            Assert::IsFalse(set.Test(bDirty, bReset));
+            Assert::IsFalse(set2.Test(bDirty, bReset));
+            g_MemManager.EndFrame();
+            Assert::AreEqual(size_t(5), g_ConditionBatch.NumLanes());
+
+            set2.Clear();
+            g_MemManager.BeginFrame(false);
+            Assert::IsFalse(set.Test(bDirty, bReset));
+            g_MemManager.EndFrame();
+            Assert::AreEqual(size_t(3), g_ConditionBatch.NumLanes());
+
+            // the lanes that were moved to fill the gaps still produce their own results
+            memory[1] = 19;
+            g_MemManager.BeginFrame(false);
+            Assert::IsTrue(set.Test(bDirty, bReset));
+            g_MemManager.EndFrame();
+        }
+
+        // destroying the set releases the rest
+        g_MemManager.BeginFrame(false);
+        g_ConditionBatch.Evaluate();
+        g_MemManager.EndFrame();
+        Assert::AreEqual(size_t(0), g_ConditionBatch.NumLanes());
+
+        ConditionProgram::SetBatchEvaluation(false);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkConditionBatch)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkConditionBatch)
+    {
+        const char* vLabels[] = { "scalar", "SSE2", "AVX2" };
+
+        for (size_t nCount : { size_t(1000), size_t(10000), size_t(100000) })
+        {
+            std::vector<unsigned int> vValues(nCount), vConstants(nCount);
+            std::vector<unsigned char> vResults(nCount);
+            for (size_t i = 0; i < nCount; ++i)
+            {
+                vValues[i] = static_cast<unsigned int>(i * 2654435761U);
+                vConstants[i] = static_cast<unsigned int>(i * 40503U);
+            }
+
+            const int nPasses = static_cast<int>(10000000 / nCount);
+            for (auto nInstructionSet : SupportedInstructionSets())
+            {
+                unsigned int nTotal = 0;
+                const auto tStart = std::chrono::steady_clock::now();
+                for (int nPass = 0; nPass < nPasses; ++nPass)
+                {
+                    ConditionBatch::CompareLanes(nInstructionSet, static_cast<ComparisonType>(nPass % NumComparisonTypes),
+                        vValues.data(), vConstants.data(), vResults.data(), nCount);
+                    nTotal += vResults[nPass % nCount];
+                }
+                const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+                Assert::AreNotEqual(0xFFFFFFFFU, nTotal); // use the result so the loop isn't optimized away
+                const double fSeconds = std::chrono::duration<double>(tElapsed).count();
+
+                char sMessage[128];
+                sprintf_s(sMessage, sizeof(sMessage), "%zu conditions, %s: %.1f million conditions/sec", nCount,
+                    vLabels[static_cast<int>(nInstructionSet)], (static_cast<double>(nCount) * nPasses) / fSeconds / 1000000.0);
+                Logger::WriteMessage(sMessage);
+            }
+        }
+    }
+};
+
+} // namespace tests
+} // namespace data
+} // namespace ra
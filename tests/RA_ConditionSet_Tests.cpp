@@ -1,8 +1,11 @@
 #include "CppUnitTest.h"
 
 #include "RA_Condition.h"
+#include "RA_MemManager.h"
 #include "RA_UnitTestHelpers.h"
 
+#include <chrono>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace ra {
@@ -752,6 +755,407 @@ public:
         set.SetAlwaysFalse();
         AssertSetTest(set, false, false, false);
     }
+
+    void AssertCompiledMatchesInterpreted(const char* sSerialized)
+    {
+        unsigned char memory[8] = { 0 };
+        InitializeMemory(memory, sizeof(memory));
+
+        const char* ptr;
+        ConditionSet compiled, interpreted;
+        compiled.ParseFromString(ptr = sSerialized);
+        interpreted.ParseFromString(ptr = sSerialized);
+
+        unsigned int nSeed = 12345;
+        for (int nFrame = 0; nFrame < 500; ++nFrame)
+        {
+            // small values so equality comparisons and hit targets are reached regularly
+            for (auto& nByte : memory)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                nByte = static_cast<unsigned char>((nSeed >> 16) & 0x03);
+            }
+
+            bool bCompiledDirty, bCompiledReset, bInterpretedDirty, bInterpretedReset;
+            const bool bCompiled = compiled.Test(bCompiledDirty, bCompiledReset);
+            const bool bInterpreted = interpreted.TestInterpreted(bInterpretedDirty, bInterpretedReset);
+            Assert::AreEqual(bInterpreted, bCompiled, Widen(sSerialized).c_str());
+            Assert::AreEqual(bInterpretedDirty, bCompiledDirty, L"bDirtyConditions");
+            Assert::AreEqual(bInterpretedReset, bCompiledReset, L"bWasReset");
+
+            for (size_t nGroup = 0; nGroup < interpreted.GroupCount(); ++nGroup)
+            {
+                const ConditionGroup& expected = interpreted.GetGroup(nGroup);
+                const ConditionGroup& actual = compiled.GetGroup(nGroup);
+                for (size_t i = 0; i < expected.Count(); ++i)
+                {
+                    Assert::AreEqual(expected.GetAt(i).CurrentHits(), actual.GetAt(i).CurrentHits(), L"CurrentHits");
+                    Assert::AreEqual(expected.GetAt(i).CompSource().RawPreviousValue(), actual.GetAt(i).CompSource().RawPreviousValue(), L"Source delta");
+                    Assert::AreEqual(expected.GetAt(i).CompTarget().RawPreviousValue(), actual.GetAt(i).CompTarget().RawPreviousValue(), L"Target delta");
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(TestCompiledMatchesInterpreted)
+    {
+        AssertCompiledMatchesInterpreted("0xH0001=1_0xH0002=d0xH0002");
+        AssertCompiledMatchesInterpreted("0xH0001=1.3._R:0xH0002=3_P:0xH0003=2");
+        AssertCompiledMatchesInterpreted("A:0xH0001=0_B:0xH0002=0_0xH0003=2.2._P:0xH0004=1.2.");
+        AssertCompiledMatchesInterpreted("C:0xH0001=1_C:0xH0002=2_0xH0003=3.4._A:0xH0004=0_P:0xH0005=3");
+        AssertCompiledMatchesInterpreted("0xH0000=0.2._0xH0001=1Sd0xH0002>0xH0002_P:0xH0003=0SR:0xH0004=3_0xH0005!=0.5.");
+        AssertCompiledMatchesInterpreted("0xH0001=1_P:0xH0002=2_0x 0003<=0x0004S0xH0005>=1_C:0xH0006=0_P:0xH0007=1.3.");
+    }
+
+    void AssertIncrementalMatchesFull(const char* sSerialized)
+    {
+        unsigned char memory[8] = { 0 };
+        InitializeMemory(memory, sizeof(memory));
+
+        const char* ptr;
+        ConditionSet incremental, full;
+        incremental.ParseFromString(ptr = sSerialized);
+        full.ParseFromString(ptr = sSerialized);
+
+        ConditionProgram::SetIncrementalEvaluation(true);
+
+        // memory trace where most frames don't change anything
+        unsigned int nSeed = 6789;
+        for (int nFrame = 0; nFrame < 2000; ++nFrame)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            if (((nSeed >> 16) & 0x07) == 0)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                memory[(nSeed >> 16) & 0x07] = static_cast<unsigned char>((nSeed >> 20) & 0x03);
+            }
+
+            bool bIncrementalDirty, bIncrementalReset, bFullDirty, bFullReset;
+            g_MemManager.BeginFrame(false);
+            const bool bIncremental = incremental.Test(bIncrementalDirty, bIncrementalReset);
+            g_MemManager.EndFrame();
+            const bool bFull = full.TestInterpreted(bFullDirty, bFullReset);
+
+            Assert::AreEqual(bFull, bIncremental, Widen(sSerialized).c_str());
+            Assert::AreEqual(bFullDirty, bIncrementalDirty, L"bDirtyConditions");
+            Assert::AreEqual(bFullReset, bIncrementalReset, L"bWasReset");
+
+            for (size_t nGroup = 0; nGroup < full.GroupCount(); ++nGroup)
+            {
+                const ConditionGroup& expected = full.GetGroup(nGroup);
+                const ConditionGroup& actual = incremental.GetGroup(nGroup);
+                for (size_t i = 0; i < expected.Count(); ++i)
+                {
+                    Assert::AreEqual(expected.GetAt(i).CurrentHits(), actual.GetAt(i).CurrentHits(), L"CurrentHits");
+                    Assert::AreEqual(expected.GetAt(i).CompSource().RawPreviousValue(), actual.GetAt(i).CompSource().RawPreviousValue(), L"Source delta");
+                }
+            }
+        }
+
+        ConditionProgram::SetIncrementalEvaluation(false);
+    }
+
+    TEST_METHOD(TestIncrementalMatchesFull)
+    {
+        AssertIncrementalMatchesFull("0xH0001=1_0xH0002<2");
+        AssertIncrementalMatchesFull("0xH0001=1_0xH0002=d0xH0002");
+        AssertIncrementalMatchesFull("0xH0001=1.30._R:0xH0002=3_P:0xH0003=2");
+        AssertIncrementalMatchesFull("A:0xH0001=0_B:0xH0002=0_0xH0003=2_P:0xH0004=1");
+        AssertIncrementalMatchesFull("C:0xH0001=1_C:0xH0002=2_0xH0003=3.40._A:0xH0004=0_P:0xH0005=3");
+        AssertIncrementalMatchesFull("0xH0000=0_0xH0001=1Sd0xH0002>0xH0002_P:0xH0003=0SR:0xH0004=3_0xH0005!=0.50.");
+        AssertIncrementalMatchesFull("0xH0001=1_P:0xH0002=2_0x 0003<=0x0004S0xH0005>=1_C:0xH0006=0_P:0xH0007=1.3.");
+    }
+
+    TEST_METHOD(TestInterpretedDoesNotAllocate)
+    {
+        unsigned char memory[8] = { 0 };
+        InitializeMemory(memory, sizeof(memory));
+
+        ConditionSet set;
+        const char* ptr;
+        set.ParseFromString(ptr = "0xH0000=0.2._0xH0001=1SA:0xH0002=0_0xH0003>0xH0002_P:0xH0003=0SR:0xH0004=3_0xH0005!=0.5.");
+
+        // the first evaluation identifies the pause chains
+        bool bDirtyConditions, bWasReset;
+        set.TestInterpreted(bDirtyConditions, bWasReset);
+
+        AllocationCounter allocations;
+        for (int nFrame = 0; nFrame < 1000; ++nFrame)
+        {
+            memory[nFrame & 0x07] = static_cast<unsigned char>(nFrame & 0x03);
+            set.TestInterpreted(bDirtyConditions, bWasReset);
+        }
+
+        Assert::AreEqual(size_t(0), allocations.Count());
+
+    }
+
+    TEST_METHOD(TestInterpretedPauseChainsUpdated)
+    {
+        unsigned char memory[] = { 0x00, 0x01, 0x01 };
+        InitializeMemory(memory, sizeof(memory));
+
+        ConditionSet set;
+        const char* ptr;
+        set.ParseFromString(ptr = "0xH0001=1_P:0xH0002=1");
+
+        bool bDirtyConditions, bWasReset;
+        Assert::IsFalse(set.TestInterpreted(bDirtyConditions, bWasReset));
+
+        // changing a condition type through the group recalculates the pause chains
+        set.GetGroup(0).GetAt(1).SetConditionType(Condition::Standard);
+        Assert::IsTrue(set.TestInterpreted(bDirtyConditions, bWasReset));
+
+        set.GetGroup(0).Insert(0, set.GetGroup(0).GetAt(0));
+        set.GetGroup(0).GetAt(0).SetConditionType(Condition::PauseIf);
+        Assert::IsFalse(set.TestInterpreted(bDirtyConditions, bWasReset));
+
+        set.GetGroup(0).RemoveAt(0);
+        Assert::IsTrue(set.TestInterpreted(bDirtyConditions, bWasReset));
+    }
+
+    TEST_METHOD(TestReadPlanSharesReads)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        ConditionSet set;
+        const char* ptr;
+        set.ParseFromString(ptr = "0xH0001=18_0xH0001!=5_d0xH0001=0_0xH0002=52");
+
+        g_MemManager.BeginFrame(false);
+        AssertSetTest(set, true, true, false);
+        g_MemManager.EndFrame();
+
+        auto pCounters = g_MemManager.GetReadPlanCounters();
+        Assert::AreEqual(2U, pCounters.nAddresses);
+        Assert::AreEqual(4U, pCounters.nOperandReads);
+        Assert::AreEqual(2U, pCounters.nMemoryReads);
+
+        // delta is still tracked per frame
+        memory[1] = 5;
+        g_MemManager.BeginFrame(false);
+        AssertSetTest(set, false, true, false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(1U, set.GetGroup(0).GetAt(0).CurrentHits());
+        Assert::AreEqual(1U, set.GetGroup(0).GetAt(1).CurrentHits());
+        Assert::AreEqual(1U, set.GetGroup(0).GetAt(2).CurrentHits());
+
+        // a new plan forces the set to be recompiled
+        InitializeMemory(memory, 5);
+        memory[1] = 18;
+        g_MemManager.BeginFrame(false);
+        AssertSetTest(set, false, true, false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(2U, set.GetGroup(0).GetAt(0).CurrentHits());
+        Assert::AreEqual(2U, g_MemManager.GetReadPlanCounters().nAddresses);
+    }
+
+    TEST_METHOD(TestReadPlanReleased)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        {
+            ConditionSet set;
+            const char* ptr;
+            set.ParseFromString(ptr = "0xH0001=18_0xH0002=52");
+
+            ConditionSet set2;
+            set2.ParseFromString(ptr = "0xH0002=52_0xH0003=171");
+
+            g_MemManager.BeginFrame(false);
+            AssertSetTest(set, true, true, false);
+            AssertSetTest(set2, true, true, false);
+            g_MemManager.EndFrame();
+            Assert::AreEqual(3U, g_MemManager.GetReadPlanCounters().nAddresses);
+
+            // moving the set moves its references
+            ConditionSet set3(std::move(set2));
+            g_MemManager.BeginFrame(false);
+            AssertSetTest(set3, true, true, false);
+            g_MemManager.EndFrame();
+
+            // editing the set releases the entries it no longer references at the start of the next frame
+            set.GetGroup(0).GetAt(0).CompSource().SetValues(4, 4);
+            g_MemManager.BeginFrame(false);
+            AssertSetTest(set, false, true, false);
+            g_MemManager.EndFrame();
+            Assert::AreEqual(3U, g_MemManager.GetReadPlanCounters().nAddresses); // 2, 3, 4
+        }
+
+        // destroying the sets releases everything
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(0U, g_MemManager.GetReadPlanCounters().nAddresses);
+    }
+
+    TEST_METHOD(TestCompiledInvalidatedByParse)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        ConditionSet set;
+        const char* ptr;
+        set.ParseFromString(ptr = "0xH0001=18");
+        AssertSetTest(set, true, true, false);
+
+        set.ParseFromString(ptr = "0xH0001=16_0xH0002=52");
+        AssertSetTest(set, false, true, false);
+        Assert::AreEqual(0U, set.GetGroup(0).GetAt(0).CurrentHits());
+        Assert::AreEqual(1U, set.GetGroup(0).GetAt(1).CurrentHits());
+
+        ConditionSet copy;
+        copy = set;
+        memory[1] = 16;
+        AssertSetTest(copy, true, true, false);
+        Assert::AreEqual(1U, copy.GetGroup(0).GetAt(0).CurrentHits());
+        Assert::AreEqual(0U, set.GetGroup(0).GetAt(0).CurrentHits());
+    }
+
+    // exposes the compiled instruction size to the benchmark
+    class ConditionProgramLayout : public ConditionProgram
+    {
+    public:
+        static size_t InstructionSize() { return sizeof(Instruction); }
+    };
+
+    // builds a set of achievements with a spread of condition shapes over 64KB of memory
+    static size_t GenerateAchievementSets(std::vector<ConditionSet>& vSets, unsigned int& nSeed)
+    {
+        size_t nConditions = 0;
+        for (auto& set : vSets)
+        {
+            std::string sSerialized;
+            char sCondition[64];
+            const int nCount = 4 + static_cast<int>((nSeed >> 16) % 8);
+            for (int i = 0; i < nCount; ++i)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                const unsigned int nAddress = (nSeed >> 8) & 0xFFFF;
+                switch ((nSeed >> 4) & 0x07)
+                {
+                    case 0:  sprintf_s(sCondition, sizeof(sCondition), "0xH%04x>d0xH%04x", nAddress, nAddress); break;
+                    case 1:  sprintf_s(sCondition, sizeof(sCondition), "R:0xH%04x=1", nAddress); break;
+                    case 2:  sprintf_s(sCondition, sizeof(sCondition), "0x %04x=%u.10.", nAddress & 0xFFFE, nSeed & 0xFF); break;
+                    case 3:  sprintf_s(sCondition, sizeof(sCondition), "P:0xH%04x!=0", nAddress); break;
+                    default: sprintf_s(sCondition, sizeof(sCondition), "0xH%04x=%u", nAddress, nSeed & 0x03); break;
+                }
+
+                if (!sSerialized.empty())
+                    sSerialized.push_back('_');
+                sSerialized.append(sCondition);
+            }
+
+            const char* ptr = sSerialized.c_str();
+            set.ParseFromString(ptr);
+            nConditions += nCount;
+        }
+
+        return nConditions;
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkAchievementSetEvaluation)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkAchievementSetEvaluation)
+    {
+        std::vector<unsigned char> vMemory(0x10000);
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, vMemory.data(), vMemory.size());
+
+        const int nAchievements = 500;
+        std::vector<ConditionSet> vSets(nAchievements);
+        unsigned int nSeed = 1357;
+        const size_t nConditions = GenerateAchievementSets(vSets, nSeed);
+
+        const int nFrames = 2000;
+        unsigned int nTrue = 0;
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int nFrame = 0; nFrame < nFrames; ++nFrame)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            vMemory[(nSeed >> 8) & 0xFFFF] = static_cast<unsigned char>(nSeed & 0x03);
+
+            g_MemManager.BeginFrame(false);
+            for (auto& set : vSets)
+            {
+                bool bDirtyConditions, bWasReset;
+                nTrue += set.Test(bDirtyConditions, bWasReset) ? 1 : 0;
+            }
+            g_MemManager.EndFrame();
+        }
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        Assert::AreNotEqual(0xFFFFFFFFU, nTrue); // use the result so the loop isn't optimized away
+
+        char sMessage[256];
+        sprintf_s(sMessage, sizeof(sMessage), "%d achievements, %zu conditions: %.2fus per frame. Condition %zu bytes, Instruction %zu bytes (%zuKB compiled)",
+            nAchievements, nConditions, std::chrono::duration<double, std::micro>(tElapsed).count() / nFrames,
+            sizeof(Condition), ConditionProgramLayout::InstructionSize(), (nConditions * ConditionProgramLayout::InstructionSize()) / 1024);
+        Logger::WriteMessage(sMessage);
+
+        g_MemManager.ClearMemoryBanks();
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkInterpretedVsCompiled)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkInterpretedVsCompiled)
+    {
+        std::vector<unsigned char> vMemory(0x10000);
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, vMemory.data(), vMemory.size());
+
+        // same seed for both, so the two copies hold identical conditions
+        const int nAchievements = 500;
+        std::vector<ConditionSet> vInterpreted(nAchievements), vCompiled(nAchievements);
+        unsigned int nSeed = 1357;
+        const size_t nConditions = GenerateAchievementSets(vInterpreted, nSeed);
+        nSeed = 1357;
+        GenerateAchievementSets(vCompiled, nSeed);
+
+        const int nFrames = 2000;
+        unsigned int nInterpretedTrue = 0, nCompiledTrue = 0;
+        std::chrono::steady_clock::duration tInterpreted{}, tCompiled{};
+        for (int nFrame = 0; nFrame < nFrames; ++nFrame)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            vMemory[(nSeed >> 8) & 0xFFFF] = static_cast<unsigned char>(nSeed & 0x03);
+
+            auto tStart = std::chrono::steady_clock::now();
+            for (auto& set : vInterpreted)
+            {
+                bool bDirtyConditions, bWasReset;
+                nInterpretedTrue += set.TestInterpreted(bDirtyConditions, bWasReset) ? 1 : 0;
+            }
+            tInterpreted += std::chrono::steady_clock::now() - tStart;
+
+            tStart = std::chrono::steady_clock::now();
+            g_MemManager.BeginFrame(false);
+            for (auto& set : vCompiled)
+            {
+                bool bDirtyConditions, bWasReset;
+                nCompiledTrue += set.Test(bDirtyConditions, bWasReset) ? 1 : 0;
+            }
+            g_MemManager.EndFrame();
+            tCompiled += std::chrono::steady_clock::now() - tStart;
+        }
+
+        // both forms saw the same frames, so they have to agree
+        Assert::AreEqual(nInterpretedTrue, nCompiledTrue);
+
+        const double fInterpreted = std::chrono::duration<double, std::micro>(tInterpreted).count() / nFrames;
+        const double fCompiled = std::chrono::duration<double, std::micro>(tCompiled).count() / nFrames;
+        char sMessage[256];
+        sprintf_s(sMessage, sizeof(sMessage), "%d achievements, %zu conditions: interpreted %.2fus per frame, compiled %.2fus per frame (%.2fx)",
+            nAchievements, nConditions, fInterpreted, fCompiled, fCompiled > 0.0 ? fInterpreted / fCompiled : 0.0);
+        Logger::WriteMessage(sMessage);
+
+        g_MemManager.ClearMemoryBanks();
+    }
 };
 
 } // namespace tests
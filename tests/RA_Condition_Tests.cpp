@@ -288,6 +288,43 @@ public:
         AssertConditionCompare("0xX0001=0xX0002", false);
         AssertConditionCompare("0xX0000!=0xH0002", true);
     }
+
+    TEST_METHOD(TestConditionCompareSigned)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        // values
+        AssertConditionCompare("0xY0003<0", true);
+        AssertConditionCompare("0xY0003>0", false);
+        AssertConditionCompare("0xY0001>0", true);
+        AssertConditionCompare("0xY0003=4294967211", true); // -85
+        AssertConditionCompare("0xZ0002<0", true);
+        AssertConditionCompare("0xV0001>0", true);
+        AssertConditionCompare("0xV0000<0", true); // 0xAB341200
+
+        // memory
+        AssertConditionCompare("0xY0003<0xY0001", true);
+        AssertConditionCompare("0xH0003<0xH0001", false);
+        AssertConditionCompare("0xY0003<0xH0001", true);
+        AssertConditionCompare("0xI0001=0x 0001", false);
+        AssertConditionCompare("0xI0001>0x 0001", false);
+    }
+
+    TEST_METHOD(TestParseConditionFloat)
+    {
+        // conditions compare integers, so floats are rejected rather than compared by their integer part
+        for (const char* sDefinition : { "fF0005<0", "0xH0001=fF0005", "dfF0005>0", "A:fF0005=0" })
+        {
+            const char* ptr = sDefinition;
+            Condition cond;
+            Assert::IsFalse(cond.ParseFromString(ptr), Widen(sDefinition).c_str());
+        }
+
+        ConditionSet set;
+        const char* ptr;
+        Assert::IsFalse(set.ParseFromString(ptr = "0xH0001=1_fF0005<0"));
+    }
 };
 
 } // namespace tests
@@ -0,0 +1,396 @@
+#include "CppUnitTest.h"
+
+#include "RA_MemManager.h"
+#include "RA_UnitTestHelpers.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace data {
+namespace tests {
+
+TEST_CLASS(RA_MemManager_Tests)
+{
+public:
+    TEST_METHOD(TestActiveBankRAMRead)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        Assert::AreEqual(0x12U, g_MemManager.ActiveBankRAMRead(1, EightBit));
+        Assert::AreEqual(0x3412U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        Assert::AreEqual(0x56AB3412U, g_MemManager.ActiveBankRAMRead(1, ThirtyTwoBit));
+        Assert::AreEqual(0x0BU, g_MemManager.ActiveBankRAMRead(3, Nibble_Lower));
+        Assert::AreEqual(0x0AU, g_MemManager.ActiveBankRAMRead(3, Nibble_Upper));
+        Assert::AreEqual(1U, g_MemManager.ActiveBankRAMRead(3, Bit_7));
+        Assert::AreEqual(0U, g_MemManager.ActiveBankRAMRead(3, Bit_6));
+        Assert::AreEqual(0x56U, static_cast<unsigned int>(g_MemManager.ActiveBankRAMByteRead(4)));
+    }
+
+    TEST_METHOD(TestActiveBankRAMReadTyped)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0x80, 0xFF };
+        InitializeMemory(memory, 9);
+
+        Assert::AreEqual(0x1234U, g_MemManager.ActiveBankRAMRead(1, SixteenBitBE));
+        Assert::AreEqual(0x1234AB56U, g_MemManager.ActiveBankRAMRead(1, ThirtyTwoBitBE));
+        Assert::AreEqual(0x12U, g_MemManager.ActiveBankRAMRead(1, SignedEightBit));
+        Assert::AreEqual(0xFFFFFFABU, g_MemManager.ActiveBankRAMRead(3, SignedEightBit));
+        Assert::AreEqual(0x3412U, g_MemManager.ActiveBankRAMRead(1, SignedSixteenBit));
+        Assert::AreEqual(0xFFFFAB34U, g_MemManager.ActiveBankRAMRead(2, SignedSixteenBit));
+        Assert::AreEqual(0x56AB3412U, g_MemManager.ActiveBankRAMRead(1, SignedThirtyTwoBit));
+
+        // floats read as their integer part. 0xFF800000 is -infinity, which saturates
+        Assert::AreEqual(0x80000000U, g_MemManager.ActiveBankRAMRead(5, Float));
+
+        memory[7] = 0x20;
+        memory[8] = 0x41; // 10.0
+        Assert::AreEqual(10U, g_MemManager.ActiveBankRAMRead(5, Float));
+    }
+
+    TEST_METHOD(TestLoadFrameSnapshot)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        const unsigned char snapshot[] = { 0x21, 0x43 };
+        g_MemManager.LoadFrameSnapshot(1, snapshot, sizeof(snapshot));
+        Assert::IsTrue(g_MemManager.IsFrameSnapshotActive());
+
+        Assert::AreEqual(0x21U, g_MemManager.ActiveBankRAMRead(1, EightBit));
+        Assert::AreEqual(0x4321U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        Assert::AreEqual(0x04U, g_MemManager.ActiveBankRAMRead(2, Nibble_Upper));
+
+        // outside of (or straddling) the snapshot reads live memory
+        Assert::AreEqual(0xABU, g_MemManager.ActiveBankRAMRead(3, EightBit));
+        Assert::AreEqual(0xAB34U, g_MemManager.ActiveBankRAMRead(2, SixteenBit));
+
+        g_MemManager.ReleaseFrameSnapshot();
+        Assert::IsFalse(g_MemManager.IsFrameSnapshotActive());
+        Assert::AreEqual(0x3412U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+    }
+
+    TEST_METHOD(TestCaptureFrameSnapshot)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        // nothing captured yet - addresses read during the frame are remembered
+        g_MemManager.CaptureFrameSnapshot();
+        Assert::AreEqual(0U, g_MemManager.FrameSnapshotSize());
+        Assert::AreEqual(0x3412U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        Assert::AreEqual(0x56U, g_MemManager.ActiveBankRAMRead(4, EightBit));
+        Assert::AreEqual(0x0BU, g_MemManager.ActiveBankRAMRead(3, Nibble_Lower));
+        g_MemManager.ReleaseFrameSnapshot();
+
+        // 1-2 and 3-4 are adjacent and should be merged
+        memory[1] = 0x99;
+        g_MemManager.CaptureFrameSnapshot();
+        Assert::AreEqual(4U, g_MemManager.FrameSnapshotSize());
+        Assert::AreEqual(0x3499U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+
+        // changes after the capture are not seen until the next capture
+        memory[1] = 0x88;
+        memory[4] = 0x77;
+        Assert::AreEqual(0x3499U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        Assert::AreEqual(0x56U, g_MemManager.ActiveBankRAMRead(4, EightBit));
+        Assert::AreEqual(0x56AB3499U, g_MemManager.ActiveBankRAMRead(1, ThirtyTwoBit));
+        g_MemManager.ReleaseFrameSnapshot();
+
+        Assert::AreEqual(0x3488U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        g_MemManager.CaptureFrameSnapshot();
+        Assert::AreEqual(0x77U, g_MemManager.ActiveBankRAMRead(4, EightBit));
+
+        // writes update the snapshot
+        g_MemManager.ActiveBankRAMByteWrite(4, 0x66);
+        Assert::AreEqual(0x66U, g_MemManager.ActiveBankRAMRead(4, EightBit));
+        Assert::AreEqual(0x66, static_cast<int>(memory[4]));
+        g_MemManager.ReleaseFrameSnapshot();
+
+        // changing the memory banks discards the snapshot
+        InitializeMemory(memory, 5);
+        g_MemManager.CaptureFrameSnapshot();
+        Assert::AreEqual(0U, g_MemManager.FrameSnapshotSize());
+        g_MemManager.ReleaseFrameSnapshot();
+    }
+
+    TEST_METHOD(TestBlockBank)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, memory, 5);
+
+        Assert::AreEqual(0x12U, g_MemManager.ActiveBankRAMRead(1, EightBit));
+        Assert::AreEqual(0x3412U, g_MemManager.ActiveBankRAMRead(1, SixteenBit));
+        Assert::AreEqual(0x56AB3412U, g_MemManager.ActiveBankRAMRead(1, ThirtyTwoBit));
+        Assert::AreEqual(0x0AU, g_MemManager.ActiveBankRAMRead(3, Nibble_Upper));
+        Assert::AreEqual(1U, g_MemManager.ActiveBankRAMRead(3, Bit_7));
+
+        // reading past the end of memory returns 0s
+        Assert::AreEqual(0x56ABU, g_MemManager.ActiveBankRAMRead(3, ThirtyTwoBit));
+        Assert::AreEqual(0U, g_MemManager.ActiveBankRAMRead(8, EightBit));
+
+        g_MemManager.ActiveBankRAMByteWrite(2, 0x99);
+        Assert::AreEqual(0x99, static_cast<int>(memory[2]));
+
+        unsigned char buffer[4];
+        g_MemManager.ActiveBankRAMRead(buffer, 2, 3);
+        Assert::AreEqual(0x99, static_cast<int>(buffer[0]));
+        Assert::AreEqual(0xAB, static_cast<int>(buffer[1]));
+        Assert::AreEqual(0x56, static_cast<int>(buffer[2]));
+
+        g_MemManager.ClearMemoryBanks();
+    }
+
+    TEST_METHOD(TestMixedBanks)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        unsigned char memory2[] = { 0x78, 0x9A, 0xBC };
+        InitializeMemory(memory, 5);
+        g_MemManager.AddMemoryBankBlock(1, memory2, 3);
+
+        Assert::AreEqual(0x9A78U, g_MemManager.ActiveBankRAMRead(5, SixteenBit));
+        Assert::AreEqual(0x7856U, g_MemManager.ActiveBankRAMRead(4, SixteenBit));
+        Assert::AreEqual(0x9A7856ABU, g_MemManager.ActiveBankRAMRead(3, ThirtyTwoBit));
+
+        unsigned char buffer[5];
+        g_MemManager.ActiveBankRAMRead(buffer, 3, 5);
+        Assert::AreEqual(0xAB, static_cast<int>(buffer[0]));
+        Assert::AreEqual(0x56, static_cast<int>(buffer[1]));
+        Assert::AreEqual(0x78, static_cast<int>(buffer[2]));
+        Assert::AreEqual(0x9A, static_cast<int>(buffer[3]));
+        Assert::AreEqual(0xBC, static_cast<int>(buffer[4]));
+
+        g_MemManager.ActiveBankRAMByteWrite(6, 0x11);
+        Assert::AreEqual(0x11, static_cast<int>(memory2[1]));
+    }
+
+    TEST_METHOD(TestBankTable)
+    {
+        // bank sizes that aren't page aligned, including banks smaller than a page
+        const size_t vBankSizes[] = { 0x1800, 0x10, 0x7F0, 0x2000, 0x3 };
+        std::vector<std::vector<unsigned char>> vBanks;
+        std::vector<unsigned char> vExpected;
+        g_MemManager.ClearMemoryBanks();
+        for (size_t nBankSize : vBankSizes)
+        {
+            std::vector<unsigned char>& vBank = vBanks.emplace_back(nBankSize);
+            for (auto& nByte : vBank)
+            {
+                nByte = static_cast<unsigned char>(vExpected.size() * 13 + 7);
+                vExpected.push_back(nByte);
+            }
+
+            g_MemManager.AddMemoryBankBlock(vBanks.size() - 1, vBank.data(), vBank.size());
+        }
+
+        Assert::AreEqual(vExpected.size(), g_MemManager.TotalBankSize());
+        for (ra::ByteAddress nAddress = 0; nAddress < vExpected.size(); ++nAddress)
+            Assert::AreEqual(static_cast<unsigned int>(vExpected[nAddress]), g_MemManager.ActiveBankRAMRead(nAddress, EightBit));
+
+        for (ra::ByteAddress nAddress = 0; nAddress < vExpected.size() - 3; ++nAddress)
+        {
+            const unsigned int nExpected = vExpected[nAddress] | (vExpected[nAddress + 1] << 8) |
+                (vExpected[nAddress + 2] << 16) | (vExpected[nAddress + 3] << 24);
+            Assert::AreEqual(nExpected, g_MemManager.ActiveBankRAMRead(nAddress, ThirtyTwoBit));
+        }
+
+        Assert::AreEqual(0U, g_MemManager.ActiveBankRAMRead(vExpected.size(), EightBit));
+        Assert::AreEqual(0U, g_MemManager.ActiveBankRAMRead(0x100000, EightBit));
+
+        std::vector<unsigned char> vBuffer(vExpected.size() + 16);
+        g_MemManager.ActiveBankRAMRead(vBuffer.data(), 0, vBuffer.size());
+        for (size_t i = 0; i < vExpected.size(); ++i)
+            Assert::AreEqual(static_cast<int>(vExpected[i]), static_cast<int>(vBuffer[i]));
+        for (size_t i = vExpected.size(); i < vBuffer.size(); ++i)
+            Assert::AreEqual(0, static_cast<int>(vBuffer[i]));
+
+        g_MemManager.ActiveBankRAMByteWrite(0x1808, 0x42);
+        Assert::AreEqual(0x42, static_cast<int>(vBanks[1][8]));
+
+        g_MemManager.ClearMemoryBanks();
+        Assert::AreEqual(0U, g_MemManager.ActiveBankRAMRead(0, EightBit));
+    }
+
+    TEST_METHOD(TestReadPlan)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        const unsigned int nGeneration = g_MemManager.ReadPlanGeneration();
+        const unsigned int nIndex = g_MemManager.AddToReadPlan(1, SixteenBit);
+        Assert::AreEqual(nIndex, g_MemManager.AddToReadPlan(1, SixteenBit));
+        Assert::AreNotEqual(nIndex, g_MemManager.AddToReadPlan(1, EightBit));
+
+        // outside of a frame, values are read live and not counted
+        Assert::AreEqual(0x3412U, g_MemManager.ReadPlanValue(nIndex, 1, SixteenBit));
+        memory[1] = 0x11;
+        Assert::AreEqual(0x3411U, g_MemManager.ReadPlanValue(nIndex, 1, SixteenBit));
+        Assert::AreEqual(0U, g_MemManager.GetReadPlanCounters().nOperandReads);
+
+        // inside a frame, each value is only read once
+        g_MemManager.BeginFrame(false);
+        Assert::IsTrue(g_MemManager.IsFrameThread());
+        Assert::AreEqual(0x3411U, g_MemManager.ReadPlanValue(nIndex, 1, SixteenBit));
+        memory[1] = 0x22;
+        Assert::AreEqual(0x3411U, g_MemManager.ReadPlanValue(nIndex, 1, SixteenBit));
+        Assert::AreEqual(0x22U, g_MemManager.ReadPlanned(1, EightBit)); // first read of this entry in the frame
+        memory[1] = 0x33;
+        Assert::AreEqual(0x22U, g_MemManager.ReadPlanned(1, EightBit));
+        g_MemManager.EndFrame();
+        Assert::IsFalse(g_MemManager.IsFrameThread());
+
+        auto pCounters = g_MemManager.GetReadPlanCounters();
+        Assert::AreEqual(2U, pCounters.nAddresses);
+        Assert::AreEqual(4U, pCounters.nOperandReads);
+        Assert::AreEqual(2U, pCounters.nMemoryReads);
+
+        // next frame sees the new value
+        g_MemManager.BeginFrame(false);
+        Assert::AreEqual(0x3433U, g_MemManager.ReadPlanValue(nIndex, 1, SixteenBit));
+        g_MemManager.EndFrame();
+
+        // changing the banks discards the plan
+        InitializeMemory(memory, 5);
+        Assert::AreNotEqual(nGeneration, g_MemManager.ReadPlanGeneration());
+        Assert::AreEqual(0U, g_MemManager.GetReadPlanCounters().nAddresses);
+    }
+
+    TEST_METHOD(TestReadPlanRelease)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        const unsigned int nGeneration = g_MemManager.ReadPlanGeneration();
+        const unsigned int nIndex = g_MemManager.AddToReadPlan(1, EightBit);
+        Assert::AreEqual(nIndex, g_MemManager.AddToReadPlan(1, EightBit));
+        const unsigned int nIndex2 = g_MemManager.AddToReadPlan(2, EightBit);
+        Assert::AreEqual(2U, g_MemManager.GetReadPlanCounters().nAddresses);
+
+        // still referenced once
+        g_MemManager.ReleaseFromReadPlan(nIndex, nGeneration);
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(2U, g_MemManager.GetReadPlanCounters().nAddresses);
+
+        // releases are only applied at the start of a frame, and entries read in the previous frame are kept
+        g_MemManager.ReleaseFromReadPlan(nIndex, nGeneration);
+        g_MemManager.ReleaseFromReadPlan(nIndex2, nGeneration);
+        Assert::AreEqual(2U, g_MemManager.GetReadPlanCounters().nAddresses);
+        g_MemManager.BeginFrame(false);
+        Assert::AreEqual(0x34U, g_MemManager.ReadPlanned(2, EightBit));
+        g_MemManager.EndFrame();
+        Assert::AreEqual(1U, g_MemManager.GetReadPlanCounters().nAddresses);
+
+        // entries created by ReadPlanned are kept as long as they're read every frame
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(1U, g_MemManager.GetReadPlanCounters().nAddresses);
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(0U, g_MemManager.GetReadPlanCounters().nAddresses);
+
+        // discarded entries are reused
+        memory[3] = 0x77;
+        Assert::AreEqual(nIndex2, g_MemManager.AddToReadPlan(3, EightBit));
+        g_MemManager.BeginFrame(false);
+        Assert::AreEqual(0x77U, g_MemManager.ReadPlanValue(nIndex2, 3, EightBit));
+        g_MemManager.EndFrame();
+
+        // releases for an older plan are ignored
+        InitializeMemory(memory, 5);
+        const unsigned int nIndex3 = g_MemManager.AddToReadPlan(4, EightBit);
+        g_MemManager.ReleaseFromReadPlan(nIndex3, nGeneration);
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        g_MemManager.BeginFrame(false);
+        g_MemManager.EndFrame();
+        Assert::AreEqual(1U, g_MemManager.GetReadPlanCounters().nAddresses);
+    }
+
+    TEST_METHOD(TestFrameFromOtherThread)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        const unsigned int nIndex = g_MemManager.AddToReadPlan(1, EightBit);
+        g_MemManager.BeginFrame(true);
+        Assert::AreEqual(0x12U, g_MemManager.ReadPlanValue(nIndex, 1, EightBit));
+        memory[1] = 0x22;
+
+        // another thread must not see the frame's cached values or snapshot
+        bool bFrameThread = true;
+        bool bSnapshotActive = false;
+        unsigned int nValue = 0;
+        unsigned int nByte = 0;
+        std::thread pThread([&]()
+        {
+            bFrameThread = g_MemManager.IsFrameThread();
+            bSnapshotActive = g_MemManager.IsFrameSnapshotActive();
+            nValue = g_MemManager.ReadPlanValue(nIndex, 1, EightBit);
+            nByte = g_MemManager.ActiveBankRAMByteRead(1);
+        });
+        pThread.join();
+
+        Assert::IsFalse(bFrameThread);
+        Assert::IsTrue(bSnapshotActive);
+        Assert::AreEqual(0x22U, nValue);
+        Assert::AreEqual(0x22U, nByte);
+        Assert::AreEqual(0x12U, g_MemManager.ReadPlanValue(nIndex, 1, EightBit));
+
+        g_MemManager.EndFrame();
+        Assert::IsFalse(g_MemManager.IsFrameSnapshotActive());
+    }
+
+    static double BenchmarkReads(ComparisonVariableSize nSize, size_t nMemorySize)
+    {
+        const int nPasses = 16;
+        unsigned int nTotal = 0;
+
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int nPass = 0; nPass < nPasses; ++nPass)
+        {
+            for (ra::ByteAddress nAddress = 0; nAddress < nMemorySize - 4; ++nAddress)
+                nTotal += g_MemManager.ActiveBankRAMRead(nAddress, nSize);
+        }
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        Assert::AreNotEqual(0xFFFFFFFFU, nTotal); // use the result so the loop isn't optimized away
+        return std::chrono::duration<double, std::nano>(tElapsed).count() / (nPasses * (nMemorySize - 4));
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkBankReads)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkBankReads)
+    {
+        std::vector<unsigned char> vMemory(0x20000);
+        for (size_t i = 0; i < vMemory.size(); ++i)
+            vMemory[i] = static_cast<unsigned char>(i * 7);
+
+        const ComparisonVariableSize vSizes[] = { EightBit, SixteenBit, ThirtyTwoBit };
+        const char* vLabels[] = { "8-bit", "16-bit", "32-bit" };
+        for (int i = 0; i < 3; ++i)
+        {
+            InitializeMemory(vMemory.data(), vMemory.size());
+            const double fCallback = BenchmarkReads(vSizes[i], vMemory.size());
+
+            g_MemManager.ClearMemoryBanks();
+            g_MemManager.AddMemoryBankBlock(0, vMemory.data(), vMemory.size());
+            const double fBlock = BenchmarkReads(vSizes[i], vMemory.size());
+
+            char sMessage[128];
+            sprintf_s(sMessage, sizeof(sMessage), "%s reads: callback bank %.2fns, block bank %.2fns", vLabels[i], fCallback, fBlock);
+            Logger::WriteMessage(sMessage);
+        }
+
+        g_MemManager.ClearMemoryBanks();
+    }
+};
+
+} // namespace tests
+} // namespace data
+} // namespace ra
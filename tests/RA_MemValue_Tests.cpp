@@ -3,6 +3,8 @@
 #include "RA_MemValue.h"
 #include "RA_UnitTestHelpers.h"
 
+#include <chrono>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace ra {
@@ -16,6 +18,8 @@ public:
     const Clause& GetMemValue(size_t index) const { return m_vClauses[index]; }
     bool IsAddition(size_t index) const { return m_vClauses[index].GetOperation() == ClauseOperation::Addition; }
     bool IsMaximum(size_t index) const { return m_vClauses[index].GetOperation() == ClauseOperation::Maximum; }
+    bool IsFixedPoint() const { return m_bFixedPoint; }
+    unsigned int GetDoubleValue() const { return MemValue::GetDoubleValue(); }
 
     class ClauseHarness : public Clause
     {
@@ -30,6 +34,7 @@ public:
         bool GetInvertBit() const { return m_bInvertBit; }
         unsigned int GetSecondAddress() const { return m_nSecondAddress; }
         ComparisonVariableSize GetSecondVarSize() const { return m_nSecondVarSize; }
+        long long GetNumerator() const { return m_nNumerator; }
     };
 };
 
@@ -91,6 +96,26 @@ TEST_CLASS(RA_MemValue_Tests)
         Assert::AreEqual(dExpectedValue, value.GetValue(), wsSerialized.c_str());
     }
 
+    void AssertRational(const char* sSerialized, long long nExpectedNumerator, long long nExpectedDenominator)
+    {
+        std::wstring wsSerialized = Widen(sSerialized);
+        MemValueHarness::ClauseHarness value;
+        Assert::AreEqual("", value.ParseFromString(sSerialized));
+
+        Assert::IsTrue(value.IsRational(), wsSerialized.c_str());
+        Assert::AreEqual(nExpectedNumerator, value.GetNumerator(), wsSerialized.c_str());
+        Assert::AreEqual(nExpectedDenominator, value.GetDenominator(), wsSerialized.c_str());
+    }
+
+    void AssertNotRational(const char* sSerialized)
+    {
+        std::wstring wsSerialized = Widen(sSerialized);
+        MemValueHarness::ClauseHarness value;
+        Assert::AreEqual("", value.ParseFromString(sSerialized));
+
+        Assert::IsFalse(value.IsRational(), wsSerialized.c_str());
+    }
+
 public:
     TEST_METHOD(TestClauseParseFromString)
     {
@@ -168,6 +193,120 @@ public:
         AssertGetValue("0xH01*~0xH02", 0x12 * 0x34); // ~ only applies to bit sized secondary memory addresses
     }
 
+    TEST_METHOD(TestClauseGetValueTyped)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0xC0, 0xBF };
+        InitializeMemory(memory, 9);
+
+        AssertGetValue("0xI01", 0x1234);
+        AssertGetValue("0xY03", -0x55);
+        AssertGetValue("0xY03*2", -0xAA);
+        AssertGetValue("0xH01*0xY03", 0x12 * -0x55);
+        AssertGetValue("fF05", -1.5);                 // floats keep their fraction
+        AssertGetValue("fF05*3", -4.5);
+    }
+
+    TEST_METHOD(TestClauseParseFromStringRational)
+    {
+        AssertRational("0xH1234", 1, 1);
+        AssertRational("0xH1234*3", 3, 1);
+        AssertRational("0xH1234*0.5", 1, 2);
+        AssertRational("0xH1234*-1", -1, 1);
+        AssertRational("0xH1234*1.25", 5, 4);
+        AssertRational("0xH1234*0.10", 1, 10);
+        AssertRational("B0xH1234*0.3", 3, 10);
+        AssertRational("0xH1234*0xH2345", 1, 1);
+        AssertRational("0xY1234*0xV2345", 1, 1);
+
+        AssertNotRational("0xH1234*1e2");
+        AssertNotRational("0xH1234*0.0000000001"); // too many digits
+        AssertNotRational("fF1234*2");             // floats have fractions
+    }
+
+    TEST_METHOD(TestFixedPointMatchesDouble)
+    {
+        // modifiers that are exact as doubles, so the integer evaluation has to give the same results
+        const char* vExpressions[] = {
+            "0xH0001*100_0xH0002*0.5_0xL0003",
+            "0xH0001_0xY0003",
+            "0xY0003*-2_0xZ0004*0.125",
+            "0xH0001_0xH0004*3$0xH0002*0xL0003",
+            "0xX0001*0.25_0xX0005*0.75",
+            "0xX0001*0xX0005",
+            "0xY0001*0xZ0004_0xH0002*~0xT0003",
+            "B0xH0001*2_v-1",
+            "0xH0001*-1_0xH0002*1.5$v10",
+            "0xH0001*0.5_0xH0002*0.5_0xH0003*0.5",
+            "0xV0001*0.5_0xX0005",
+        };
+
+        unsigned char memory[16];
+        InitializeMemory(memory, sizeof(memory));
+
+        unsigned int nSeed = 12345;
+        for (const char* sExpression : vExpressions)
+        {
+            std::wstring wsExpression = Widen(sExpression);
+            MemValueHarness value;
+            Assert::AreEqual("", value.ParseFromString(sExpression));
+            Assert::IsTrue(value.IsFixedPoint(), wsExpression.c_str());
+
+            for (int nPass = 0; nPass < 10000; ++nPass)
+            {
+                for (auto& nByte : memory)
+                {
+                    nSeed = nSeed * 1103515245 + 12345;
+                    nByte = static_cast<unsigned char>(nSeed >> 16);
+                }
+
+                Assert::AreEqual(value.GetDoubleValue(), value.GetValue(), wsExpression.c_str());
+            }
+        }
+    }
+
+    TEST_METHOD(TestFixedPointExact)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0xC0, 0xBF };
+        InitializeMemory(memory, 9);
+
+        // 100 * 0.29 is 28.999999999999996 as a double
+        MemValueHarness value;
+        Assert::AreEqual("", value.ParseFromString("v100*0.29"));
+        Assert::IsTrue(value.IsFixedPoint());
+        Assert::AreEqual(29U, value.GetValue());
+        Assert::AreEqual(28U, value.GetDoubleValue());
+
+        // fractions add up before the total is truncated
+        MemValueHarness value2;
+        Assert::AreEqual("", value2.ParseFromString("v1*0.3_v1*0.3_v1*0.4"));
+        Assert::AreEqual(1U, value2.GetValue());
+
+        // floats, and totals that could overflow, are evaluated as doubles
+        MemValueHarness value3;
+        Assert::AreEqual("", value3.ParseFromString("fF05*3_v5"));
+        Assert::IsFalse(value3.IsFixedPoint());
+        Assert::AreEqual(static_cast<unsigned int>(-4.5 + 5), value3.GetValue());
+
+        MemValueHarness value4;
+        Assert::AreEqual("", value4.ParseFromString("0xV0001*0xV0005_0xV0001*0xV0005_0xV0001*0xV0005"));
+        Assert::IsFalse(value4.IsFixedPoint());
+    }
+
+    TEST_METHOD(TestAdditionSigned)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        MemValueHarness set;
+        Assert::AreEqual("", set.ParseFromString("0xH0001_0xY0003"));
+        Assert::AreEqual(0x12U - 0x55U, set.GetValue());
+
+        // negative totals wrap like they would in a condition
+        MemValueHarness set2;
+        Assert::AreEqual("", set2.ParseFromString("0xY0003"));
+        Assert::AreEqual(static_cast<unsigned int>(-0x55), set2.GetValue());
+    }
+
     TEST_METHOD(TestAdditionSimple)
     {
         unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
@@ -263,6 +402,81 @@ public:
         Assert::AreEqual(0x34U * 0xBU, set.GetValue());
     }
 
+    TEST_METHOD(TestFrameCache)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        MemValue value, same, different;
+        Assert::AreEqual("", value.ParseFromString("0xH0001*2_0xH0002"));
+        Assert::AreEqual("", same.ParseFromString("0xH0001*2_0xH0002"));
+        Assert::AreEqual("", different.ParseFromString("0xH0001*3_0xH0002"));
+
+        MemValue::AdvanceFrame(true);
+        MemValue::ResetCacheCounters();
+
+        Assert::AreEqual(0x12U * 2 + 0x34U, value.GetValue());
+        Assert::AreEqual(0x12U * 2 + 0x34U, same.GetValue());
+        Assert::AreEqual(0x12U * 3 + 0x34U, different.GetValue());
+
+        auto pCounters = MemValue::GetCacheCounters();
+        Assert::AreEqual(1U, pCounters.nHits);
+        Assert::AreEqual(2U, pCounters.nMisses);
+        Assert::AreEqual(static_cast<size_t>(2U), pCounters.nEntries);
+
+        // values don't change until the next frame
+        memory[1] = 0x20;
+        Assert::AreEqual(0x12U * 2 + 0x34U, same.GetValue());
+
+        MemValue::AdvanceFrame(true);
+        Assert::AreEqual(0x20U * 2 + 0x34U, same.GetValue());
+        Assert::AreEqual(0x20U * 2 + 0x34U, value.GetValue());
+
+        pCounters = MemValue::GetCacheCounters();
+        Assert::AreEqual(3U, pCounters.nHits);
+        Assert::AreEqual(3U, pCounters.nMisses);
+
+        // when the cache is disabled, every call reads memory
+        MemValue::AdvanceFrame(false);
+        memory[1] = 0x30;
+        Assert::AreEqual(0x30U * 2 + 0x34U, value.GetValue());
+        Assert::AreEqual(3U, MemValue::GetCacheCounters().nMisses);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkGetValue)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkGetValue)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0xC0, 0xBF };
+        InitializeMemory(memory, 9);
+
+        // the second expression doesn't read memory, so it only measures the arithmetic
+        for (const char* sExpression : { "0xH0001*100_0xH0002*0.5_0xL0003_0xX0005*0.25$0xY0003*-2", "v18*100_v52*0.5_v11_v3000*0.25$v-85*-2" })
+        {
+            MemValueHarness value;
+            Assert::AreEqual("", value.ParseFromString(sExpression));
+
+            const int nIterations = 1000000;
+            unsigned int nTotal = 0;
+            auto tStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < nIterations; ++i)
+                nTotal += value.GetDoubleValue();
+            const auto tDouble = std::chrono::steady_clock::now() - tStart;
+
+            tStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < nIterations; ++i)
+                nTotal += value.GetValue();
+            const auto tFixed = std::chrono::steady_clock::now() - tStart;
+
+            char sMessage[160];
+            sprintf_s(sMessage, sizeof(sMessage), "%s: double %.1fns, fixed point %.1fns per value (%u)", sExpression,
+                std::chrono::duration<double, std::nano>(tDouble).count() / nIterations,
+                std::chrono::duration<double, std::nano>(tFixed).count() / nIterations, nTotal);
+            Logger::WriteMessage(sMessage);
+        }
+    }
+
     TEST_METHOD(TestFormatValue)
     {
         Assert::AreEqual("12345", MemValue::FormatValue(12345, MemValue::Format::Value).c_str());
@@ -276,6 +490,25 @@ public:
         Assert::AreEqual("00:05.75", MemValue::FormatValue(345, MemValue::Format::TimeFrames).c_str());
     }
 
+    TEST_METHOD(TestFormatValueBuffer)
+    {
+        // values above 0x7FFFFFFF are formatted as signed, as they were when sprintf was used
+        Assert::AreEqual("0", MemValue::FormatValue(0, MemValue::Format::Value).c_str());
+        Assert::AreEqual("-1", MemValue::FormatValue(0xFFFFFFFF, MemValue::Format::Value).c_str());
+        Assert::AreEqual("-00001", MemValue::FormatValue(0xFFFFFFFF, MemValue::Format::Other).c_str());
+        Assert::AreEqual("-2147483648 Points", MemValue::FormatValue(0x80000000, MemValue::Format::Score).c_str());
+        Assert::AreEqual("71582788:15", MemValue::FormatValue(0xFFFFFFFF, MemValue::Format::TimeSecs).c_str());
+        Assert::AreEqual("1193046:28.25", MemValue::FormatValue(0xFFFFFFFF, MemValue::Format::TimeFrames).c_str());
+
+        char buffer[MemValue::FORMAT_BUFFER_SIZE];
+        Assert::AreEqual(static_cast<size_t>(13U), MemValue::FormatValue(buffer, sizeof(buffer), 12345, MemValue::Format::Score));
+        Assert::AreEqual("012345 Points", buffer);
+
+        // truncated to fit
+        Assert::AreEqual(static_cast<size_t>(3U), MemValue::FormatValue(buffer, 4, 12345, MemValue::Format::Value));
+        Assert::AreEqual("123", buffer);
+    }
+
     TEST_METHOD(TestParseMemValueFormat)
     {
         Assert::AreEqual(MemValue::Format::Value, MemValue::ParseFormat("VALUE"));
@@ -1,14 +1,25 @@
 #include "CppUnitTest.h"
 
+#include "RA_MemManager.h"
 #include "RA_RichPresence.h"
 #include "RA_UnitTestHelpers.h"
 
+#include <chrono>
+#include <map>
+#include <thread>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace ra {
 namespace data {
 namespace tests {
 
+class RichPresenceHarness : public RA_RichPresenceInterpreter
+{
+public:
+    using RA_RichPresenceInterpreter::Lookup;
+};
+
 TEST_CLASS(RA_RichPresence_Tests)
 {
 public:
@@ -397,6 +408,363 @@ public:
         memory[0] = 2; // no entry
         Assert::AreEqual("@", rp.GetRichPresenceString().c_str());
     }
+
+    TEST_METHOD(TestLookupDense)
+    {
+        RichPresenceHarness::Lookup lookup("Location");
+        lookup.AddLookupData(10, "Ten");
+        lookup.AddLookupData(11, "Eleven");
+        lookup.AddLookupData(13, "Thirteen");
+        lookup.AddLookupData(11, "Also Eleven"); // later entries replace earlier ones
+        lookup.SetDefault("Default");
+        lookup.Freeze();
+
+        Assert::IsTrue(lookup.IsDense());
+        Assert::AreEqual(static_cast<size_t>(3U), lookup.NumItems());
+        Assert::AreEqual(std::string("Ten"), std::string(lookup.GetText(10)));
+        Assert::AreEqual(std::string("Also Eleven"), std::string(lookup.GetText(11)));
+        Assert::AreEqual(std::string("Default"), std::string(lookup.GetText(12))); // hole
+        Assert::AreEqual(std::string("Thirteen"), std::string(lookup.GetText(13)));
+        Assert::AreEqual(std::string("Default"), std::string(lookup.GetText(9)));
+        Assert::AreEqual(std::string("Default"), std::string(lookup.GetText(14)));
+        Assert::AreEqual(std::string("Default"), std::string(lookup.GetText(0xFFFFFFFF)));
+    }
+
+    TEST_METHOD(TestLookupSparse)
+    {
+        RichPresenceHarness::Lookup lookup("Location");
+        lookup.AddLookupData(1, "One");
+        lookup.AddLookupData(100000, "Shared");
+        lookup.AddLookupData(0x80000000, "Shared");
+        lookup.AddLookupData(0xFFFFFFFF, "Max");
+        lookup.Freeze();
+
+        Assert::IsFalse(lookup.IsDense());
+        Assert::AreEqual(static_cast<size_t>(4U), lookup.NumItems());
+        Assert::AreEqual(std::string("One"), std::string(lookup.GetText(1)));
+        Assert::AreEqual(std::string("Shared"), std::string(lookup.GetText(100000)));
+        Assert::AreEqual(std::string("Shared"), std::string(lookup.GetText(0x80000000)));
+        Assert::AreEqual(std::string("Max"), std::string(lookup.GetText(0xFFFFFFFF)));
+        Assert::AreEqual(std::string(""), std::string(lookup.GetText(0)));
+        Assert::AreEqual(std::string(""), std::string(lookup.GetText(2)));
+        Assert::AreEqual(std::string(""), std::string(lookup.GetText(0xFFFFFFFE)));
+    }
+
+    TEST_METHOD(TestLookupEmpty)
+    {
+        RichPresenceHarness::Lookup lookup("Location");
+        lookup.SetDefault("Default");
+        lookup.Freeze();
+
+        Assert::AreEqual(static_cast<size_t>(0U), lookup.NumItems());
+        Assert::AreEqual(std::string("Default"), std::string(lookup.GetText(0)));
+    }
+
+    TEST_METHOD(TestLookupLargeValues)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString("Lookup:Location\n0x3412=Low\n0x56AB3412=Mid\n0xAB341200=High\n*=Other\n\nDisplay:\nAt @Location(0x 0001) @Location(0xX0001) @Location(0xX0000)");
+
+        Assert::AreEqual("At Low Mid High", rp.GetRichPresenceString().c_str());
+
+        memory[1] = 0x13;
+        Assert::AreEqual("At Other Other Other", rp.GetRichPresenceString().c_str());
+    }
+
+    TEST_METHOD(TestParseErrors)
+    {
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString("Lookup:Location\n0=Zero\nOne\n\nFormat:Points\nType=VALUE\n\n"
+            "Display:\n?BANANA?Nothing\n?0xH0000=0?@Unknown(0xH0000) here\n?0xH0000=1?@Location(0xH0000\n@Location(0xH0000 junk) there");
+
+        const auto& vErrors = rp.GetParseErrors();
+        Assert::AreEqual(static_cast<size_t>(6U), vErrors.size());
+        Assert::AreEqual(3U, vErrors.at(0).nLine);
+        Assert::AreEqual(std::string("Lookup entry without '='"), vErrors.at(0).sMessage);
+        Assert::AreEqual(6U, vErrors.at(1).nLine);
+        Assert::AreEqual(std::string("Format without FormatType: Points"), vErrors.at(1).sMessage);
+        Assert::AreEqual(9U, vErrors.at(2).nLine);
+        Assert::AreEqual(std::string("Invalid condition: BANANA"), vErrors.at(2).sMessage);
+        Assert::AreEqual(10U, vErrors.at(3).nLine);
+        Assert::AreEqual(std::string("Unknown macro: Unknown"), vErrors.at(3).sMessage);
+        Assert::AreEqual(11U, vErrors.at(4).nLine);
+        Assert::AreEqual(std::string("Unterminated macro"), vErrors.at(4).sMessage);
+        Assert::AreEqual(12U, vErrors.at(5).nLine);
+        Assert::AreEqual(std::string("Invalid value: 0xH0000 junk"), vErrors.at(5).sMessage);
+
+        // errors don't prevent the rest of the script from being used
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+        Assert::AreEqual(" here", rp.GetRichPresenceString().c_str());
+
+        memory[0] = 2;
+        Assert::AreEqual(" there", rp.GetRichPresenceString().c_str());
+
+        rp.ParseFromString("Lookup:Location\n0=Zero\n\nDisplay:\n?0xH0000=0?At @Location(0xH0000)\n");
+        Assert::AreEqual(static_cast<size_t>(1U), rp.GetParseErrors().size());
+        Assert::AreEqual(5U, rp.GetParseErrors().at(0).nLine);
+        Assert::AreEqual(std::string("No default display string"), rp.GetParseErrors().at(0).sMessage);
+        Assert::IsFalse(rp.Enabled());
+
+        rp.ParseFromString("");
+        Assert::AreEqual(static_cast<size_t>(0U), rp.GetParseErrors().size());
+        Assert::IsFalse(rp.Enabled());
+    }
+
+    TEST_METHOD(TestParseWithoutNullTerminator)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        // only the first part of the buffer is the script
+        const std::string sBuffer = "Lookup:Location\n0=Zero\n1=One\n\nDisplay:\nAt @Location(0xH0000) // comment\nNOT PART OF THE SCRIPT";
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString(std::string_view(sBuffer.data(), sBuffer.find("NOT") - 1));
+
+        Assert::AreEqual(static_cast<size_t>(0U), rp.GetParseErrors().size());
+        Assert::AreEqual("At Zero", rp.GetRichPresenceString().c_str());
+
+        memory[0] = 1;
+        Assert::AreEqual("At One", rp.GetRichPresenceString().c_str());
+    }
+
+    TEST_METHOD(TestGetRichPresenceStringBuffer)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString("Format:Points\nFormatType=VALUE\n\nLookup:Location\n0=Zero\n1=One\n2=Ones\n\nDisplay:\n@Location(0xH0000) @Points(0xH0001) Points");
+
+        std::string sBuffer;
+        Assert::IsTrue(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("Zero 18 Points"), sBuffer);
+        Assert::IsFalse(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("Zero 18 Points"), sBuffer);
+
+        memory[1] = 19; // same length
+        Assert::IsTrue(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("Zero 19 Points"), sBuffer);
+
+        memory[0] = 1; // shorter
+        Assert::IsTrue(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("One 19 Points"), sBuffer);
+
+        memory[0] = 2; // the previous string is a prefix of the new one
+        Assert::IsTrue(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("Ones 19 Points"), sBuffer);
+        Assert::IsFalse(rp.GetRichPresenceString(sBuffer));
+
+        // a buffer that was rendered into by something else is updated
+        sBuffer = "Ones 19 Points and more";
+        Assert::IsTrue(rp.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string("Ones 19 Points"), sBuffer);
+
+        RA_RichPresenceInterpreter rpEmpty;
+        Assert::IsTrue(rpEmpty.GetRichPresenceString(sBuffer));
+        Assert::AreEqual(std::string(), sBuffer);
+        Assert::IsFalse(rpEmpty.GetRichPresenceString(sBuffer));
+    }
+
+    TEST_METHOD(TestGetRichPresenceStringDoesNotAllocate)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString("Format:Points\nFormatType=VALUE\n\nLookup:Location\n0=Zero\n1=One\n2=Ones\n\nDisplay:\n"
+            "?0xH0002=0?Nowhere\n@Location(0xH0000) @Points(0xH0001) Points");
+
+        // the first render compiles the conditions and grows the buffer to the longest string
+        std::string sBuffer;
+        memory[0] = 2;
+        memory[1] = 200;
+        rp.GetRichPresenceString(sBuffer);
+        Assert::AreEqual(std::string("Ones 200 Points"), sBuffer);
+
+        AllocationCounter allocations;
+        for (int i = 0; i < 100; ++i)
+        {
+            memory[0] = static_cast<unsigned char>(i % 3); // lookup
+            memory[1] = static_cast<unsigned char>(i);     // format
+            rp.GetRichPresenceString(sBuffer);             // changed
+            rp.GetRichPresenceString(sBuffer);             // unchanged
+
+            memory[2] = static_cast<unsigned char>((i & 1) ? 0 : 0x34); // switches to the conditional display
+            rp.GetRichPresenceString(sBuffer);
+        }
+
+        Assert::AreEqual(size_t(0), allocations.Count());
+        Assert::AreEqual(std::string("Nowhere"), sBuffer);
+    }
+
+    TEST_METHOD(TestGetRichPresenceStringFromTwoThreads)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        // the emulator thread (through the dialog) and the http thread render the same interpreter. each round
+        // the conditions have to be compiled by whichever thread gets there first.
+        RA_RichPresenceInterpreter rp;
+        for (int nRound = 0; nRound < 50; ++nRound)
+        {
+            rp.ParseFromString("Lookup:Location\n0=Zero\n1=One\n\nDisplay:\n"
+                "?0xH0001=1_0xH0002=2?Never\n?0xH0000=0_0xH0001=18SR:0xH0003=0?At @Location(0xH0000)\nDefault");
+            if (nRound & 1)
+                g_MemManager.ClearReadPlan();
+
+            bool bMatched[2] = { false, false };
+            auto pRender = [&rp, &bMatched](int nThread)
+            {
+                std::string sBuffer;
+                bool bMatch = true;
+                for (int i = 0; i < 100; ++i)
+                {
+                    rp.GetRichPresenceString(sBuffer);
+                    bMatch &= (sBuffer == "At Zero");
+                }
+                bMatched[nThread] = bMatch;
+            };
+
+            std::thread pThread1(pRender, 0);
+            std::thread pThread2(pRender, 1);
+            pThread1.join();
+            pThread2.join();
+
+            Assert::IsTrue(bMatched[0]);
+            Assert::IsTrue(bMatched[1]);
+        }
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkGetRichPresenceString)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkGetRichPresenceString)
+    {
+        unsigned char memory[] = { 0x01, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        RA_RichPresenceInterpreter rp;
+        rp.ParseFromString("Format:Points\nFormatType=SCORE\n\nFormat:Time\nFormatType=FRAMES\n\nLookup:Location\n0=Zero\n1=One\n\n"
+            "Display:\nIn @Location(0xH0000) with @Points(0x 0001), @Time(0xH0003) elapsed");
+
+        const int nIterations = 1000000;
+        size_t nTotal = 0;
+        auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nIterations; ++i)
+            nTotal += rp.GetRichPresenceString().length();
+        const auto tString = std::chrono::steady_clock::now() - tStart;
+
+        std::string sBuffer;
+        tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nIterations; ++i)
+        {
+            rp.GetRichPresenceString(sBuffer);
+            nTotal += sBuffer.length();
+        }
+        const auto tBuffer = std::chrono::steady_clock::now() - tStart;
+
+        char sMessage[160];
+        sprintf_s(sMessage, sizeof(sMessage), "%s: string %.1fns, buffer %.1fns per call (%zu)", sBuffer.c_str(),
+            std::chrono::duration<double, std::nano>(tString).count() / nIterations,
+            std::chrono::duration<double, std::nano>(tBuffer).count() / nIterations, nTotal);
+        Logger::WriteMessage(sMessage);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkParseFromString)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkParseFromString)
+    {
+        // ten lookups of 2000 entries each, with comments, and a display string for each lookup
+        std::string sScript = "// generated script\nFormat:Points\nFormatType=VALUE\n\n";
+        for (int nLookup = 0; nLookup < 10; ++nLookup)
+        {
+            sScript += "Lookup:Lookup" + std::to_string(nLookup) + "\r\n";
+            for (int i = 0; i < 2000; ++i)
+            {
+                sScript += (i % 2) ? std::to_string(i * 3) : "0x" + std::to_string(i * 3);
+                sScript += "=Entry number " + std::to_string(i);
+                if (i % 10 == 0)
+                    sScript += " // every tenth entry has a comment";
+                sScript += "\r\n";
+            }
+            sScript += "*=Unknown\r\n\r\n";
+        }
+
+        sScript += "Display:\n";
+        for (int nLookup = 0; nLookup < 10; ++nLookup)
+        {
+            const std::string sLookup = std::to_string(nLookup);
+            sScript += "?0xH000" + sLookup + "=1?In @Lookup" + sLookup + "(0x 000" + sLookup + ") with @Points(0xH0001*2) points\n";
+        }
+        sScript += "Nowhere\n";
+
+        const int nIterations = 50;
+        RA_RichPresenceInterpreter rp;
+        const auto tStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < nIterations; ++i)
+            rp.ParseFromString(sScript.c_str());
+        const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        char sMessage[160];
+        sprintf_s(sMessage, sizeof(sMessage), "%zu bytes: %.2fms per parse",
+            sScript.length(), std::chrono::duration<double, std::milli>(tElapsed).count() / nIterations);
+        Logger::WriteMessage(sMessage);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkLookup)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkLookup)
+    {
+        const unsigned int nEntries = 10000;
+        for (unsigned int nStride : { 1U, 7919U })
+        {
+            std::map<unsigned int, std::string> mLookup;
+            for (unsigned int i = 0; i < nEntries; ++i)
+                mLookup[i * nStride] = "Item " + std::to_string(i);
+
+            RichPresenceHarness::Lookup lookup("Items");
+            for (const auto& pair : mLookup)
+                lookup.AddLookupData(pair.first, pair.second);
+            lookup.Freeze();
+
+            // half of the values looked up are in the table
+            const int nIterations = 100;
+            size_t nTotal = 0;
+            auto tStart = std::chrono::steady_clock::now();
+            for (int j = 0; j < nIterations; ++j)
+            {
+                for (unsigned int i = 0; i < nEntries * 2; ++i)
+                {
+                    const auto iter = mLookup.find((i * 4099 % (nEntries * 2)) * nStride / 2);
+                    if (iter != mLookup.end())
+                        nTotal += iter->second.length();
+                }
+            }
+            const auto tMap = std::chrono::steady_clock::now() - tStart;
+
+            tStart = std::chrono::steady_clock::now();
+            for (int j = 0; j < nIterations; ++j)
+            {
+                for (unsigned int i = 0; i < nEntries * 2; ++i)
+                    nTotal += lookup.GetText((i * 4099 % (nEntries * 2)) * nStride / 2).length();
+            }
+            const auto tFrozen = std::chrono::steady_clock::now() - tStart;
+
+            const double nLookups = static_cast<double>(nIterations) * nEntries * 2;
+            char sMessage[160];
+            sprintf_s(sMessage, sizeof(sMessage), "%s: map %.1fns, frozen %.1fns per lookup (%zu)",
+                lookup.IsDense() ? "dense" : "sparse",
+                std::chrono::duration<double, std::nano>(tMap).count() / nLookups,
+                std::chrono::duration<double, std::nano>(tFrozen).count() / nLookups, nTotal);
+            Logger::WriteMessage(sMessage);
+        }
+    }
 };
 
 } // namespace tests
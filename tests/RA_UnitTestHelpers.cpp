@@ -2,6 +2,11 @@
 
 #include "RA_MemManager.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
 static unsigned char* g_pMemoryBuffer;
 static size_t g_nMemorySize;
 
@@ -27,3 +32,57 @@ void InitializeMemory(unsigned char* pMemory, size_t nMemorySize)
     g_MemManager.ClearMemoryBanks();
     g_MemManager.AddMemoryBank(0, ReadMemory, SetMemory, nMemorySize);
 }
+
+// replaces the global allocator for the test module so allocations can be counted
+static thread_local size_t g_nAllocations = 0;
+static std::atomic<size_t> g_nHeapBytes{ 0 };
+static std::atomic<size_t> g_nPeakHeapBytes{ 0 };
+
+void* operator new(size_t nSize)
+{
+    ++g_nAllocations;
+
+    void* pMemory = malloc(nSize ? nSize : 1);
+    if (!pMemory)
+        throw std::bad_alloc();
+
+    const size_t nHeapBytes = (g_nHeapBytes += _msize(pMemory));
+    size_t nPeak = g_nPeakHeapBytes.load();
+    while (nHeapBytes > nPeak && !g_nPeakHeapBytes.compare_exchange_weak(nPeak, nHeapBytes))
+        continue;
+
+    return pMemory;
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    if (pMemory)
+    {
+        g_nHeapBytes -= _msize(pMemory);
+        free(pMemory);
+    }
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+    operator delete(pMemory);
+}
+
+AllocationCounter::AllocationCounter() : m_nStart(g_nAllocations)
+{
+}
+
+size_t AllocationCounter::Count() const
+{
+    return g_nAllocations - m_nStart;
+}
+
+HeapMonitor::HeapMonitor() : m_nStart(g_nHeapBytes)
+{
+    g_nPeakHeapBytes = m_nStart;
+}
+
+size_t HeapMonitor::PeakBytes() const
+{
+    return g_nPeakHeapBytes - m_nStart;
+}
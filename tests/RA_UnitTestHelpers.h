@@ -44,3 +44,25 @@ template<> static std::wstring ToString<MemValue::Format>(const MemValue::Format
 
 // Loads memory into the MemoryManager
 void InitializeMemory(unsigned char* pMemory, size_t szMemorySize);
+
+// Counts the heap allocations made by the current thread while it exists
+class AllocationCounter
+{
+public:
+    AllocationCounter();
+    size_t Count() const;
+
+private:
+    size_t m_nStart;
+};
+
+// Tracks the peak number of bytes allocated from the heap by all threads while it exists
+class HeapMonitor
+{
+public:
+    HeapMonitor();
+    size_t PeakBytes() const;
+
+private:
+    size_t m_nStart;
+};
@@ -1,8 +1,13 @@
 #include "CppUnitTest.h"
 
 #include "services\SearchResults.h"
+#include "RA_MemManager.h"
 #include "RA_UnitTestHelpers.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <memory>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -13,6 +18,7 @@ namespace tests {
 
 const unsigned int MAX_BLOCK_SIZE = 256 * 1024; // assert: matches value in SearchResults.cpp
 const unsigned int BIG_BLOCK_SIZE = MAX_BLOCK_SIZE + MAX_BLOCK_SIZE + (MAX_BLOCK_SIZE / 2);
+const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024; // assert: matches value in SearchResults.cpp
 
 TEST_CLASS(SearchResults_Tests)
 {
@@ -740,6 +746,1229 @@ public:
         Assert::AreEqual(ComparisonVariableSize::SixteenBit, result.nSize);
         Assert::AreEqual(0xFFFEU, result.nValue);
     }
+
+    static unsigned int ReadReference(const std::vector<unsigned char>& vMemory, unsigned int nAddress, ComparisonVariableSize nSize)
+    {
+        switch (nSize)
+        {
+            case EightBit:
+                return vMemory[nAddress];
+            case SixteenBit:
+                return vMemory[nAddress] | (vMemory[nAddress + 1] << 8);
+            case SixteenBitBE:
+                return (vMemory[nAddress] << 8) | vMemory[nAddress + 1];
+            case ThirtyTwoBitBE:
+                return (vMemory[nAddress] << 24) | (vMemory[nAddress + 1] << 16) | (vMemory[nAddress + 2] << 8) | vMemory[nAddress + 3];
+            case SignedEightBit:
+                return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(vMemory[nAddress])));
+            case SignedSixteenBit:
+                return static_cast<unsigned int>(static_cast<int>(static_cast<short>(vMemory[nAddress] | (vMemory[nAddress + 1] << 8))));
+            default: // ThirtyTwoBit, SignedThirtyTwoBit, Float
+                return vMemory[nAddress] | (vMemory[nAddress + 1] << 8) | (vMemory[nAddress + 2] << 16) | (vMemory[nAddress + 3] << 24);
+        }
+    }
+
+    static float AsFloat(unsigned int nBits)
+    {
+        float fValue;
+        memcpy(&fValue, &nBits, sizeof(fValue));
+        return fValue;
+    }
+
+    template<typename T>
+    static bool CompareReference(T nLeft, T nRight, ComparisonType nCompareType)
+    {
+        switch (nCompareType)
+        {
+            case Equals:                return nLeft == nRight;
+            case LessThan:              return nLeft < nRight;
+            case LessThanOrEqual:       return nLeft <= nRight;
+            case GreaterThan:           return nLeft > nRight;
+            case GreaterThanOrEqual:    return nLeft >= nRight;
+            case NotEqualTo:            return nLeft != nRight;
+            default:                    return false;
+        }
+    }
+
+    static bool CompareReference(unsigned int nLeft, unsigned int nRight, ComparisonType nCompareType, ComparisonVariableSize nSize)
+    {
+        if (nSize == Float)
+            return CompareReference(AsFloat(nLeft), AsFloat(nRight), nCompareType);
+        if (IsSignedSize(nSize))
+            return CompareReference(static_cast<int>(nLeft), static_cast<int>(nRight), nCompareType);
+        return CompareReference(nLeft, nRight, nCompareType);
+    }
+
+    static void AssertMatches(SearchResults& results, const std::vector<unsigned int>& vExpected,
+        const std::vector<unsigned char>& vMemory, ComparisonVariableSize nSize, const wchar_t* sMessage)
+    {
+        Assert::AreEqual(static_cast<unsigned int>(vExpected.size()), results.MatchingAddressCount(), sMessage);
+        for (unsigned int i = 0; i < vExpected.size(); ++i)
+        {
+            SearchResults::Result result;
+            Assert::IsTrue(results.GetMatchingAddress(i, result), sMessage);
+            Assert::AreEqual(vExpected[i], result.nAddress, sMessage);
+            Assert::AreEqual(ReadReference(vMemory, vExpected[i], nSize), result.nValue, sMessage);
+        }
+    }
+
+    // filters twice - once from unfiltered results, and once from filtered results - and compares against a
+    // straightforward evaluation of every address
+    void AssertFilterMatchesReference(ComparisonVariableSize nSize, unsigned int nSeed,
+        const std::function<bool(unsigned int nValue, unsigned int nPrevious)>& fExpected,
+        const std::function<void(SearchResults& results, const SearchResults& source)>& fFilter)
+    {
+        const unsigned int nMemorySize = 2048 + 37; // not a multiple of the vector sizes
+        const unsigned int nPadding = BytesForSize(nSize) - 1;
+        std::vector<unsigned char> vMemory(nMemorySize), vPrevious;
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        // mostly small values so the comparisons see plenty of equal values, plus some large ones for the sign bits
+        auto fRandomize = [&vMemory, &nSeed]()
+        {
+            for (auto& nByte : vMemory)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                const unsigned int nRandom = nSeed >> 16;
+                nByte = (nRandom & 0x100) ? static_cast<unsigned char>(nRandom) : static_cast<unsigned char>((nRandom & 0x01) ? 0x80 : 0);
+            }
+        };
+
+        fRandomize();
+        auto pResults = std::make_unique<SearchResults>();
+        pResults->Initialize(0U, nMemorySize, nSize);
+
+        std::vector<unsigned int> vExpected;
+        for (unsigned int nAddress = 0; nAddress < nMemorySize - nPadding; ++nAddress)
+            vExpected.push_back(nAddress);
+
+        for (int nPass = 0; nPass < 2; ++nPass)
+        {
+            vPrevious = vMemory;
+            fRandomize();
+
+            std::vector<unsigned int> vFiltered;
+            for (auto nAddress : vExpected)
+            {
+                if (fExpected(ReadReference(vMemory, nAddress, nSize), ReadReference(vPrevious, nAddress, nSize)))
+                    vFiltered.push_back(nAddress);
+            }
+            vExpected.swap(vFiltered);
+
+            auto pFiltered = std::make_unique<SearchResults>();
+            fFilter(*pFiltered, *pResults);
+
+            AssertMatches(*pFiltered, vExpected, vMemory, nSize, Widen(COMPARISONVARIABLESIZE_STR[nSize]).c_str());
+            pResults = std::move(pFiltered);
+        }
+    }
+
+    void AssertFilterMatchesReference(ComparisonVariableSize nSize, ComparisonType nCompareType, bool bPrevious, unsigned int nTestValue)
+    {
+        AssertFilterMatchesReference(nSize, 97531 + nCompareType * 7 + nSize,
+            [nSize, nCompareType, bPrevious, nTestValue](unsigned int nValue, unsigned int nPrevious)
+            {
+                return CompareReference(nValue, bPrevious ? nPrevious : nTestValue, nCompareType, nSize);
+            },
+            [nCompareType, bPrevious, nTestValue](SearchResults& results, const SearchResults& source)
+            {
+                if (bPrevious)
+                    results.Initialize(source, nCompareType);
+                else
+                    results.Initialize(source, nCompareType, nTestValue);
+            });
+    }
+
+    TEST_METHOD(TestFilterKernelsMatchReference)
+    {
+        std::vector<ConditionBatch::InstructionSet> vInstructionSets = { ConditionBatch::InstructionSet::Scalar };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        if (nDetected != ConditionBatch::InstructionSet::Scalar)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::SSE2);
+        if (nDetected == ConditionBatch::InstructionSet::AVX2)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::AVX2);
+
+        for (auto nInstructionSet : vInstructionSets)
+        {
+            SearchResults::SetInstructionSet(nInstructionSet);
+
+            for (auto nSize : { EightBit, SixteenBit, ThirtyTwoBit })
+            {
+                for (int nCompareType = 0; nCompareType < NumComparisonTypes; ++nCompareType)
+                {
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), true, 0);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x80);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x8000);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x80000000);
+                }
+            }
+
+            for (auto nSize : { SixteenBitBE, ThirtyTwoBitBE, SignedEightBit, SignedSixteenBit, SignedThirtyTwoBit, Float })
+            {
+                for (int nCompareType = 0; nCompareType < NumComparisonTypes; ++nCompareType)
+                {
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), true, 0);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x80);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0xFFFFFF80);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x80000000);
+                    AssertFilterMatchesReference(nSize, static_cast<ComparisonType>(nCompareType), false, 0x3F800000); // 1.0f
+                }
+            }
+        }
+
+        SearchResults::SetInstructionSet(nDetected);
+    }
+
+    void AssertFilterMatchesReference(ComparisonVariableSize nSize, SearchResults::FilterType nFilterType,
+        unsigned int nParam, unsigned int nParam2)
+    {
+        const unsigned int nMask = (BytesForSize(nSize) == 4) ? 0xFFFFFFFF : (1U << (BytesForSize(nSize) * 8)) - 1;
+        AssertFilterMatchesReference(nSize, 13579 + static_cast<unsigned int>(nFilterType) * 7 + nSize,
+            [nSize, nFilterType, nParam, nParam2, nMask](unsigned int nValue, unsigned int nPrevious)
+            {
+                if (nSize == Float)
+                {
+                    const float fValue = AsFloat(nValue), fPrevious = AsFloat(nPrevious), fParam = AsFloat(nParam);
+                    switch (nFilterType)
+                    {
+                        case SearchResults::FilterType::ChangedBy:
+                            return (fValue - fPrevious == fParam || fPrevious - fValue == fParam);
+                        case SearchResults::FilterType::IncreasedBy:
+                            return (fValue - fPrevious == fParam);
+                        case SearchResults::FilterType::DecreasedBy:
+                            return (fPrevious - fValue == fParam);
+                        case SearchResults::FilterType::InRange:
+                            return (fValue >= fParam && fValue <= AsFloat(nParam2));
+                        default:
+                            break;
+                    }
+                }
+
+                switch (nFilterType)
+                {
+                    case SearchResults::FilterType::ChangedBy:
+                        return nParam <= nMask && (((nValue - nPrevious) & nMask) == nParam || ((nPrevious - nValue) & nMask) == nParam);
+                    case SearchResults::FilterType::IncreasedBy:
+                        return nParam <= nMask && ((nValue - nPrevious) & nMask) == nParam;
+                    case SearchResults::FilterType::DecreasedBy:
+                        return nParam <= nMask && ((nPrevious - nValue) & nMask) == nParam;
+                    case SearchResults::FilterType::InRange:
+                        if (IsSignedSize(nSize))
+                            return static_cast<int>(nValue) >= static_cast<int>(nParam) && static_cast<int>(nValue) <= static_cast<int>(nParam2);
+                        return nValue >= nParam && nValue <= nParam2;
+                    case SearchResults::FilterType::BitChanged:
+                        return nParam < 32 && ((((nValue ^ nPrevious) & nMask) >> nParam) & 1);
+                    default:
+                        return false;
+                }
+            },
+            [nFilterType, nParam, nParam2](SearchResults& results, const SearchResults& source)
+            {
+                results.Initialize(source, nFilterType, nParam, nParam2);
+            });
+    }
+
+    TEST_METHOD(TestFusedFilterKernelsMatchReference)
+    {
+        std::vector<ConditionBatch::InstructionSet> vInstructionSets = { ConditionBatch::InstructionSet::Scalar };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        if (nDetected != ConditionBatch::InstructionSet::Scalar)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::SSE2);
+
+        for (auto nInstructionSet : vInstructionSets)
+        {
+            SearchResults::SetInstructionSet(nInstructionSet);
+
+            for (auto nSize : { EightBit, SixteenBit, ThirtyTwoBit })
+            {
+                for (auto nFilterType : { SearchResults::FilterType::ChangedBy, SearchResults::FilterType::IncreasedBy,
+                    SearchResults::FilterType::DecreasedBy })
+                {
+                    AssertFilterMatchesReference(nSize, nFilterType, 0, 0);
+                    AssertFilterMatchesReference(nSize, nFilterType, 0x80, 0);
+                    AssertFilterMatchesReference(nSize, nFilterType, 0x100, 0);
+                }
+
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0, 0x40);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x80, 0x80);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x7F, 0x8000);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x8000, 0xFFFFFFFF);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x81, 0x80);
+
+                for (unsigned int nBit : { 0U, 7U, 15U, 31U, 32U })
+                    AssertFilterMatchesReference(nSize, SearchResults::FilterType::BitChanged, nBit, 0);
+            }
+
+            for (auto nSize : { SixteenBitBE, ThirtyTwoBitBE, SignedEightBit, SignedSixteenBit, SignedThirtyTwoBit })
+            {
+                for (auto nFilterType : { SearchResults::FilterType::ChangedBy, SearchResults::FilterType::IncreasedBy,
+                    SearchResults::FilterType::DecreasedBy })
+                {
+                    AssertFilterMatchesReference(nSize, nFilterType, 0x80, 0);
+                    AssertFilterMatchesReference(nSize, nFilterType, 0x100, 0);
+                }
+
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0, 0x40);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0xFFFFFF80, 0x7F);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x80000000, 0xFFFFFFFF);
+                AssertFilterMatchesReference(nSize, SearchResults::FilterType::InRange, 0x8000, 0x7FFFFFFF);
+
+                for (unsigned int nBit : { 0U, 7U, 15U, 31U })
+                    AssertFilterMatchesReference(nSize, SearchResults::FilterType::BitChanged, nBit, 0);
+            }
+
+            for (auto nFilterType : { SearchResults::FilterType::ChangedBy, SearchResults::FilterType::IncreasedBy,
+                SearchResults::FilterType::DecreasedBy })
+            {
+                AssertFilterMatchesReference(Float, nFilterType, 0, 0);
+                AssertFilterMatchesReference(Float, nFilterType, 0x3F800000, 0); // 1.0f
+            }
+
+            AssertFilterMatchesReference(Float, SearchResults::FilterType::InRange, 0xBF800000, 0x3F800000); // -1.0f to 1.0f
+            AssertFilterMatchesReference(Float, SearchResults::FilterType::BitChanged, 31, 0);
+        }
+
+        SearchResults::SetInstructionSet(nDetected);
+    }
+
+    // like AssertFilterMatchesReference, but in the nibble address space. a nibble is filtered if either
+    // nibble of its byte matched the previous filter.
+    void AssertNibbleFilterMatchesReference(unsigned int nSeed,
+        const std::function<bool(unsigned int nValue, unsigned int nPrevious)>& fExpected,
+        const std::function<void(SearchResults& results, const SearchResults& source)>& fFilter)
+    {
+        const unsigned int nMemorySize = 2048 + 37; // not a multiple of the vector sizes
+        std::vector<unsigned char> vMemory(nMemorySize), vPrevious;
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        auto fRandomize = [&vMemory, &nSeed]()
+        {
+            for (auto& nByte : vMemory)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                const unsigned int nRandom = nSeed >> 16;
+                nByte = (nRandom & 0x100) ? static_cast<unsigned char>(nRandom) : static_cast<unsigned char>((nRandom & 0x01) ? 0x80 : 0);
+            }
+        };
+
+        auto fNibble = [](const std::vector<unsigned char>& vBytes, unsigned int nNibble)
+        {
+            return (nNibble & 1) ? (vBytes[nNibble >> 1] >> 4) : (vBytes[nNibble >> 1] & 0x0FU);
+        };
+
+        fRandomize();
+        auto pResults = std::make_unique<SearchResults>();
+        pResults->Initialize(0U, nMemorySize, Nibble_Lower);
+
+        std::vector<unsigned int> vExpected;
+        for (unsigned int nNibble = 0; nNibble < nMemorySize * 2; ++nNibble)
+            vExpected.push_back(nNibble);
+
+        for (int nPass = 0; nPass < 2; ++nPass)
+        {
+            vPrevious = vMemory;
+            fRandomize();
+
+            std::vector<bool> vCandidates(nMemorySize);
+            for (auto nNibble : vExpected)
+                vCandidates[nNibble >> 1] = true;
+
+            vExpected.clear();
+            for (unsigned int nNibble = 0; nNibble < nMemorySize * 2; ++nNibble)
+            {
+                if (vCandidates[nNibble >> 1] && fExpected(fNibble(vMemory, nNibble), fNibble(vPrevious, nNibble)))
+                    vExpected.push_back(nNibble);
+            }
+
+            auto pFiltered = std::make_unique<SearchResults>();
+            fFilter(*pFiltered, *pResults);
+
+            Assert::AreEqual(static_cast<unsigned int>(vExpected.size()), pFiltered->MatchingAddressCount());
+            for (unsigned int i = 0; i < vExpected.size(); ++i)
+            {
+                SearchResults::Result result;
+                Assert::IsTrue(pFiltered->GetMatchingAddress(i, result));
+                Assert::AreEqual(vExpected[i] >> 1, result.nAddress);
+                Assert::AreEqual((vExpected[i] & 1) ? Nibble_Upper : Nibble_Lower, result.nSize);
+                Assert::AreEqual(fNibble(vMemory, vExpected[i]), result.nValue);
+            }
+
+            pResults = std::move(pFiltered);
+        }
+    }
+
+    TEST_METHOD(TestNibbleKernelsMatchReference)
+    {
+        std::vector<ConditionBatch::InstructionSet> vInstructionSets = { ConditionBatch::InstructionSet::Scalar };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        if (nDetected != ConditionBatch::InstructionSet::Scalar)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::SSE2);
+
+        for (auto nInstructionSet : vInstructionSets)
+        {
+            SearchResults::SetInstructionSet(nInstructionSet);
+
+            for (int i = 0; i < NumComparisonTypes; ++i)
+            {
+                const auto nCompareType = static_cast<ComparisonType>(i);
+                AssertNibbleFilterMatchesReference(24680 + i,
+                    [nCompareType](unsigned int nValue, unsigned int nPrevious) { return CompareReference(nValue, nPrevious, nCompareType); },
+                    [nCompareType](SearchResults& results, const SearchResults& source) { results.Initialize(source, nCompareType); });
+
+                // only the lower nibble of the constant is used
+                for (unsigned int nTestValue : { 0U, 8U, 0x1FU })
+                {
+                    AssertNibbleFilterMatchesReference(24680 + i * 7 + nTestValue,
+                        [nCompareType, nTestValue](unsigned int nValue, unsigned int) { return CompareReference(nValue, nTestValue & 0x0F, nCompareType); },
+                        [nCompareType, nTestValue](SearchResults& results, const SearchResults& source) { results.Initialize(source, nCompareType, nTestValue); });
+                }
+            }
+
+            const std::pair<SearchResults::FilterType, std::pair<unsigned int, unsigned int>> vFilters[] = {
+                { SearchResults::FilterType::ChangedBy, { 0, 0 } },
+                { SearchResults::FilterType::ChangedBy, { 3, 0 } },
+                { SearchResults::FilterType::ChangedBy, { 0x10, 0 } },
+                { SearchResults::FilterType::IncreasedBy, { 1, 0 } },
+                { SearchResults::FilterType::IncreasedBy, { 8, 0 } },
+                { SearchResults::FilterType::DecreasedBy, { 1, 0 } },
+                { SearchResults::FilterType::DecreasedBy, { 0x0F, 0 } },
+                { SearchResults::FilterType::InRange, { 2, 9 } },
+                { SearchResults::FilterType::InRange, { 9, 2 } },
+                { SearchResults::FilterType::InRange, { 8, 0xFF } },
+                { SearchResults::FilterType::BitChanged, { 0, 0 } },
+                { SearchResults::FilterType::BitChanged, { 3, 0 } },
+                { SearchResults::FilterType::BitChanged, { 4, 0 } },
+            };
+
+            for (const auto& pFilter : vFilters)
+            {
+                const auto nFilterType = pFilter.first;
+                const unsigned int nParam = pFilter.second.first, nParam2 = pFilter.second.second;
+                AssertNibbleFilterMatchesReference(13579 + static_cast<unsigned int>(nFilterType) * 7 + nParam,
+                    [nFilterType, nParam, nParam2](unsigned int nValue, unsigned int nPrevious)
+                    {
+                        switch (nFilterType)
+                        {
+                            case SearchResults::FilterType::ChangedBy:
+                                return nParam <= 0x0F && (((nValue - nPrevious) & 0x0F) == nParam || ((nPrevious - nValue) & 0x0F) == nParam);
+                            case SearchResults::FilterType::IncreasedBy:
+                                return nParam <= 0x0F && ((nValue - nPrevious) & 0x0F) == nParam;
+                            case SearchResults::FilterType::DecreasedBy:
+                                return nParam <= 0x0F && ((nPrevious - nValue) & 0x0F) == nParam;
+                            case SearchResults::FilterType::InRange:
+                                return nValue >= nParam && nValue <= nParam2;
+                            case SearchResults::FilterType::BitChanged:
+                                return ((((nValue ^ nPrevious) & 0x0F) >> nParam) & 1) != 0;
+                            default:
+                                return false;
+                        }
+                    },
+                    [nFilterType, nParam, nParam2](SearchResults& results, const SearchResults& source)
+                    {
+                        results.Initialize(source, nFilterType, nParam, nParam2);
+                    });
+            }
+        }
+
+        SearchResults::SetInstructionSet(nDetected);
+    }
+
+    TEST_METHOD(TestInitializeFromResultsEightBitChangedBy)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(0U, 5U, ComparisonVariableSize::EightBit);
+
+        memory[1] = 0x15;
+        memory[2] = 0x31;
+        memory[3] = 0xAC;
+        memory[4] = 0x59;
+        SearchResults results;
+        results.Initialize(results1, SearchResults::FilterType::ChangedBy, 3);
+        Assert::AreEqual(std::string("Filtering for CHANGED BY 3..."), results.Summary());
+
+        Assert::AreEqual(3U, results.MatchingAddressCount());
+        Assert::IsFalse(results.ContainsAddress(0U));
+        Assert::IsTrue(results.ContainsAddress(1U));
+        Assert::IsTrue(results.ContainsAddress(2U));
+        Assert::IsFalse(results.ContainsAddress(3U));
+        Assert::IsTrue(results.ContainsAddress(4U));
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(1U, result));
+        Assert::AreEqual(2U, result.nAddress);
+        Assert::AreEqual(0x31U, result.nValue);
+    }
+
+    TEST_METHOD(TestInitializeFromResultsEightBitIncreasedBy)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xFF, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(0U, 5U, ComparisonVariableSize::EightBit);
+
+        memory[1] = 0x14;
+        memory[2] = 0x32;
+        memory[3] = 0x01; // wraps around
+        SearchResults results;
+        results.Initialize(results1, SearchResults::FilterType::IncreasedBy, 2);
+        Assert::AreEqual(std::string("Filtering for INCREASED BY 2..."), results.Summary());
+
+        Assert::AreEqual(2U, results.MatchingAddressCount());
+        Assert::IsTrue(results.ContainsAddress(1U));
+        Assert::IsTrue(results.ContainsAddress(3U));
+
+        SearchResults results2;
+        results2.Initialize(results1, SearchResults::FilterType::DecreasedBy, 2);
+        Assert::AreEqual(std::string("Filtering for DECREASED BY 2..."), results2.Summary());
+
+        Assert::AreEqual(1U, results2.MatchingAddressCount());
+        Assert::IsTrue(results2.ContainsAddress(2U));
+    }
+
+    TEST_METHOD(TestInitializeFromResultsSixteenBitInRange)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(0U, 5U, ComparisonVariableSize::SixteenBit);
+        Assert::AreEqual(4U, results1.MatchingAddressCount());
+
+        // 0x1200, 0x3412, 0xAB34, 0x56AB
+        SearchResults results;
+        results.Initialize(results1, SearchResults::FilterType::InRange, 0x3412, 0x56AB);
+        Assert::AreEqual(std::string("Filtering for BETWEEN 13330 AND 22187..."), results.Summary());
+
+        Assert::AreEqual(2U, results.MatchingAddressCount());
+        Assert::IsTrue(results.ContainsAddress(1U));
+        Assert::IsTrue(results.ContainsAddress(3U));
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(1U, result));
+        Assert::AreEqual(3U, result.nAddress);
+        Assert::AreEqual(0x56ABU, result.nValue);
+    }
+
+    TEST_METHOD(TestInitializeFromResultsSixteenBitBEEqualsConstant)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(0U, 5U, ComparisonVariableSize::SixteenBitBE);
+        Assert::AreEqual(4U, results1.MatchingAddressCount());
+
+        SearchResults results;
+        results.Initialize(results1, ComparisonType::Equals, 0x1234U);
+        Assert::AreEqual(std::string("Filtering for EQUAL 4660..."), results.Summary());
+
+        Assert::AreEqual(1U, results.MatchingAddressCount());
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(0U, result));
+        Assert::AreEqual(1U, result.nAddress);
+        Assert::AreEqual(ComparisonVariableSize::SixteenBitBE, result.nSize);
+        Assert::AreEqual(0x1234U, result.nValue);
+    }
+
+    TEST_METHOD(TestInitializeFromResultsSignedEightBitLessThanConstant)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(0U, 5U, ComparisonVariableSize::SignedEightBit);
+
+        SearchResults results;
+        results.Initialize(results1, ComparisonType::LessThan, 0U);
+        Assert::AreEqual(std::string("Filtering for LESS THAN 0..."), results.Summary());
+
+        Assert::AreEqual(1U, results.MatchingAddressCount());
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(0U, result));
+        Assert::AreEqual(3U, result.nAddress);
+        Assert::AreEqual(static_cast<unsigned int>(-0x55), result.nValue);
+
+        SearchResults results2;
+        results2.Initialize(results1, SearchResults::FilterType::InRange, static_cast<unsigned int>(-100), 0x12U);
+        Assert::AreEqual(std::string("Filtering for BETWEEN -100 AND 18..."), results2.Summary());
+        Assert::AreEqual(3U, results2.MatchingAddressCount());
+        Assert::IsTrue(results2.ContainsAddress(0U));
+        Assert::IsTrue(results2.ContainsAddress(1U));
+        Assert::IsTrue(results2.ContainsAddress(3U));
+    }
+
+    TEST_METHOD(TestInitializeFromResultsFloatGreaterThanConstant)
+    {
+        // 1.5f, -2.0f, 0.25f
+        unsigned char memory[] = { 0x00, 0x00, 0xC0, 0x3F, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x80, 0x3E };
+        InitializeMemory(memory, 12);
+
+        SearchResults results1;
+        results1.Initialize(0U, 12U, ComparisonVariableSize::Float);
+
+        SearchResults results;
+        results.Initialize(results1, ComparisonType::GreaterThan, 0x3E000000U); // 0.125f
+        Assert::AreEqual(std::string("Filtering for GREATER THAN 0.125..."), results.Summary());
+
+        Assert::AreEqual(2U, results.MatchingAddressCount());
+        Assert::IsTrue(results.ContainsAddress(0U));
+        Assert::IsTrue(results.ContainsAddress(8U));
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(0U, result));
+        Assert::AreEqual(0x3FC00000U, result.nValue);
+
+        memory[2] = 0x40;
+        memory[3] = 0x40; // 3.0f
+        SearchResults results2;
+        results2.Initialize(results1, SearchResults::FilterType::IncreasedBy, 0x3FC00000U); // 1.5f
+        Assert::AreEqual(std::string("Filtering for INCREASED BY 1.5..."), results2.Summary());
+        Assert::AreEqual(1U, results2.MatchingAddressCount());
+        Assert::IsTrue(results2.ContainsAddress(0U));
+    }
+
+    TEST_METHOD(TestInitializeFromResultsFourBitBitChanged)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults results1;
+        results1.Initialize(1U, 3U, ComparisonVariableSize::Nibble_Lower);
+
+        memory[1] = 0x16; // lower nibble bit 2 changed
+        memory[2] = 0x74; // upper nibble bit 2 changed
+        memory[3] = 0xA9; // lower nibble bit 1 changed
+        SearchResults results;
+        results.Initialize(results1, SearchResults::FilterType::BitChanged, 2);
+        Assert::AreEqual(std::string("Filtering for BIT 2 CHANGED..."), results.Summary());
+
+        Assert::AreEqual(2U, results.MatchingAddressCount());
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(0U, result));
+        Assert::AreEqual(1U, result.nAddress);
+        Assert::AreEqual(ComparisonVariableSize::Nibble_Lower, result.nSize);
+        Assert::AreEqual(6U, result.nValue);
+
+        Assert::IsTrue(results.GetMatchingAddress(1U, result));
+        Assert::AreEqual(2U, result.nAddress);
+        Assert::AreEqual(ComparisonVariableSize::Nibble_Upper, result.nSize);
+        Assert::AreEqual(7U, result.nValue);
+    }
+
+    TEST_METHOD(TestUnchangedChunksShared)
+    {
+        const unsigned int nMemorySize = SearchResults::CHUNK_SIZE * 64;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>(i);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, EightBit);
+        Assert::IsTrue(unfiltered.RetainedBytes() >= nMemorySize);
+
+        // only one chunk changes, so the other 63 are shared with the unfiltered results
+        vMemory[SearchResults::CHUNK_SIZE * 5 + 7] = 0xEE;
+        SearchResults filtered;
+        filtered.Initialize(unfiltered, LessThan, 0xF0);
+        Assert::AreEqual(nMemorySize - (nMemorySize / 256) * 0x10, filtered.MatchingAddressCount());
+        Assert::IsTrue(filtered.RetainedBytes() < nMemorySize / 4);
+
+        // the values are captured when filtering, not shared with the source
+        SearchResults::Result result;
+        Assert::IsTrue(filtered.GetMatchingAddress(SearchResults::CHUNK_SIZE * 5 + 7 - 0x10 * 20, result));
+        Assert::AreEqual(SearchResults::CHUNK_SIZE * 5 + 7, result.nAddress);
+        Assert::AreEqual(0xEEU, result.nValue);
+    }
+
+    TEST_METHOD(TestSpilledSearchStaysUnderHeapCap)
+    {
+        // 64MB of memory, but only 2MB of captured memory can be kept in the heap
+        const unsigned int nMemorySize = 64 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, vMemory.data(), nMemorySize);
+        SearchResults::SetMemoryBudget(2 * 1024 * 1024);
+
+        {
+            HeapMonitor heap;
+
+            SearchResults unfiltered;
+            unfiltered.Initialize(0U, nMemorySize, EightBit);
+
+            SearchResults filtered;
+            filtered.Initialize(unfiltered, Equals, 0x12);
+            Assert::IsTrue(filtered.MatchingAddressCount() > nMemorySize / 512);
+
+            // a few hundred changes, each in a different chunk
+            for (unsigned int i = 0; i < nMemorySize; i += 100000)
+                vMemory[i] ^= 0x5A;
+
+            SearchResults changed;
+            changed.Initialize(unfiltered, NotEqualTo);
+            Assert::AreEqual((nMemorySize + 99999) / 100000, changed.MatchingAddressCount());
+
+            char sMessage[64];
+            sprintf_s(sMessage, sizeof(sMessage), "peak heap: %.1fMB", heap.PeakBytes() / (1024.0 * 1024.0));
+            Logger::WriteMessage(sMessage);
+            Assert::IsTrue(heap.PeakBytes() < 16 * 1024 * 1024);
+
+            // the values are paged back in from the spill file
+            SearchResults::Result result;
+            for (unsigned int nIndex = 0; nIndex < filtered.MatchingAddressCount(); nIndex += 997)
+            {
+                Assert::IsTrue(filtered.GetMatchingAddress(nIndex, result));
+                Assert::AreEqual(0x12U, result.nValue);
+            }
+
+            for (unsigned int nIndex = 0; nIndex < changed.MatchingAddressCount(); ++nIndex)
+            {
+                Assert::IsTrue(changed.GetMatchingAddress(nIndex, result));
+                Assert::AreEqual(nIndex * 100000, result.nAddress);
+                Assert::AreEqual(static_cast<unsigned int>(vMemory[result.nAddress]), result.nValue);
+            }
+
+            for (unsigned int nAddress = 1; nAddress < nMemorySize; nAddress += 65537)
+            {
+                Assert::IsTrue(unfiltered.GetMatchingAddress(nAddress, result));
+                Assert::AreEqual(static_cast<unsigned int>(vMemory[nAddress] ^ ((nAddress % 100000) ? 0 : 0x5A)), result.nValue);
+            }
+        }
+
+        SearchResults::SetMemoryBudget(DEFAULT_MEMORY_BUDGET);
+    }
+
+    static SearchResults RoundTrip(const SearchResults& results, bool bCompress)
+    {
+        std::vector<unsigned char> vBuffer;
+        results.Serialize(vBuffer, bCompress);
+
+        auto pBuffer = std::shared_ptr<unsigned char>(new unsigned char[vBuffer.size()], std::default_delete<unsigned char[]>());
+        memcpy(pBuffer.get(), vBuffer.data(), vBuffer.size());
+
+        SearchResults loaded;
+        Assert::IsTrue(loaded.Deserialize(pBuffer, vBuffer.size()));
+        Assert::AreEqual(results.Summary(), loaded.Summary());
+        return loaded;
+    }
+
+    TEST_METHOD(TestSerializeUnfiltered)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56, 0x00, 0x00, 0x00, 0x00, 0xFF };
+        InitializeMemory(memory, sizeof(memory));
+
+        for (auto nSize : { EightBit, SixteenBit, ThirtyTwoBitBE, Nibble_Lower })
+        {
+            SearchResults unfiltered;
+            unfiltered.Initialize(0U, sizeof(memory), nSize);
+
+            for (bool bCompress : { false, true })
+            {
+                auto loaded = RoundTrip(unfiltered, bCompress);
+                AssertSameResults(unfiltered, loaded);
+                Assert::IsTrue(loaded.ContainsAddress(3));
+            }
+        }
+    }
+
+    TEST_METHOD(TestSerializeFiltered)
+    {
+        const unsigned int nMemorySize = SearchResults::CHUNK_SIZE * 40 + 17;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, EightBit);
+
+        // sparse and dense matches, and a chunk without any matches
+        SearchResults sparse;
+        sparse.Initialize(unfiltered, Equals, 0x12);
+        for (unsigned int i = 0; i < nMemorySize; i += 3)
+            vMemory[i] ^= 0x40;
+        memset(vMemory.data() + SearchResults::CHUNK_SIZE * 7, 0, SearchResults::CHUNK_SIZE);
+        SearchResults dense;
+        dense.Initialize(unfiltered, NotEqualTo);
+        dense.ExcludeAddress(3);
+
+        for (bool bCompress : { false, true })
+        {
+            auto loadedSparse = RoundTrip(sparse, bCompress);
+            Assert::IsFalse(loadedSparse.ContainsAddress(0));
+            AssertSameResults(sparse, loadedSparse);
+
+            auto loadedDense = RoundTrip(dense, bCompress);
+            Assert::IsFalse(loadedDense.ContainsAddress(3));
+            AssertSameResults(dense, loadedDense);
+
+            // loaded results can be filtered further
+            SearchResults filtered, loadedFiltered;
+            filtered.Initialize(dense, LessThan, 0x40);
+            loadedFiltered.Initialize(loadedDense, LessThan, 0x40);
+            AssertSameResults(filtered, loadedFiltered);
+        }
+    }
+
+    TEST_METHOD(TestSerializeNibbles)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, 5U, Nibble_Lower);
+        SearchResults filtered;
+        filtered.Initialize(unfiltered, GreaterThan, 2U);
+        Assert::AreEqual(6U, filtered.MatchingAddressCount());
+
+        auto loaded = RoundTrip(filtered, true);
+        AssertSameResults(filtered, loaded);
+    }
+
+    TEST_METHOD(TestSerializeCompressedIsSmaller)
+    {
+        // mostly zero memory, as for most systems
+        const unsigned int nMemorySize = 64 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; i += 50)
+            vMemory[i] = static_cast<unsigned char>(i);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, EightBit);
+
+        std::vector<unsigned char> vRaw, vCompressed;
+        unfiltered.Serialize(vRaw, false);
+        unfiltered.Serialize(vCompressed, true);
+        Assert::IsTrue(vRaw.size() > nMemorySize);
+        Assert::IsTrue(vCompressed.size() < nMemorySize / 8);
+    }
+
+    TEST_METHOD(TestDeserializeInvalid)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, 5U, EightBit);
+        SearchResults filtered;
+        filtered.Initialize(unfiltered, GreaterThan, 0x20);
+
+        for (bool bCompress : { false, true })
+        {
+            std::vector<unsigned char> vBuffer;
+            filtered.Serialize(vBuffer, bCompress);
+            auto pBuffer = std::shared_ptr<unsigned char>(new unsigned char[vBuffer.size()], std::default_delete<unsigned char[]>());
+
+            // every truncation is rejected and leaves the results empty
+            for (size_t nSize = 0; nSize < vBuffer.size(); ++nSize)
+            {
+                memcpy(pBuffer.get(), vBuffer.data(), nSize);
+                SearchResults loaded;
+                Assert::IsFalse(loaded.Deserialize(pBuffer, nSize));
+                Assert::AreEqual(0U, loaded.MatchingAddressCount());
+            }
+
+            // unknown version
+            memcpy(pBuffer.get(), vBuffer.data(), vBuffer.size());
+            pBuffer.get()[4] = 99;
+            SearchResults loaded;
+            Assert::IsFalse(loaded.Deserialize(pBuffer, vBuffer.size()));
+
+            // bad magic
+            memcpy(pBuffer.get(), vBuffer.data(), vBuffer.size());
+            pBuffer.get()[0] = 'X';
+            Assert::IsFalse(loaded.Deserialize(pBuffer, vBuffer.size()));
+        }
+    }
+
+    TEST_METHOD(TestSaveLoad)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, 5U, EightBit);
+        SearchResults filtered;
+        filtered.Initialize(unfiltered, GreaterThan, 0x20);
+
+        const std::wstring sFilename = L"SearchResults_Tests.rasr";
+        for (bool bCompress : { false, true })
+        {
+            Assert::IsTrue(filtered.Save(sFilename, bCompress));
+            {
+                SearchResults loaded;
+                Assert::IsTrue(loaded.Load(sFilename));
+                AssertSameResults(filtered, loaded);
+            }
+            _wremove(sFilename.c_str());
+        }
+
+        SearchResults loaded;
+        Assert::IsFalse(loaded.Load(sFilename));
+    }
+
+    TEST_METHOD(TestCopyExcludeDoesNotModifyOriginal)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, 5U, EightBit);
+
+        SearchResults filtered;
+        filtered.Initialize(unfiltered, GreaterThan, 0x20);
+        Assert::AreEqual(3U, filtered.MatchingAddressCount());
+
+        SearchResults copy(filtered);
+        copy.ExcludeMatchingAddress(1);
+        Assert::AreEqual(2U, copy.MatchingAddressCount());
+        Assert::IsFalse(copy.ContainsAddress(3U));
+
+        Assert::AreEqual(3U, filtered.MatchingAddressCount());
+        Assert::IsTrue(filtered.ContainsAddress(3U));
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkSearchHistory)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkSearchHistory)
+    {
+        // 50 "equal to last value" steps on an 8MB system where some bytes change between each step
+        const unsigned int nMemorySize = 8 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+
+        for (int nChanges : { 200, 2000 })
+        {
+            for (unsigned int i = 0; i < nMemorySize; ++i)
+                vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+            InitializeMemory(vMemory.data(), nMemorySize);
+
+            std::vector<SearchResults> vPages(1);
+            vPages.reserve(51);
+            vPages.front().Initialize(0U, nMemorySize, EightBit);
+
+            unsigned int nSeed = 13579;
+            size_t nTotal = vPages.front().RetainedBytes();
+            for (int nStep = 1; nStep <= 50; ++nStep)
+            {
+                for (int i = 0; i < nChanges; ++i)
+                {
+                    nSeed = nSeed * 1103515245 + 12345;
+                    vMemory[(nSeed >> 8) % nMemorySize]++;
+                }
+
+                vPages.emplace_back();
+                vPages.back().Initialize(vPages[vPages.size() - 2], Equals);
+                nTotal += vPages.back().RetainedBytes();
+
+                if (nStep % 10 == 0)
+                {
+                    char sMessage[128];
+                    sprintf_s(sMessage, sizeof(sMessage), "%d changes/step, page %d: %u matches, %zu bytes retained", nChanges,
+                        nStep, vPages.back().MatchingAddressCount(), vPages.back().RetainedBytes());
+                    Logger::WriteMessage(sMessage);
+                }
+            }
+
+            char sMessage[128];
+            sprintf_s(sMessage, sizeof(sMessage), "%d changes/step: %.1fMB total for 51 pages", nChanges, nTotal / (1024.0 * 1024.0));
+            Logger::WriteMessage(sMessage);
+        }
+    }
+
+    static void AssertSameResults(SearchResults& expected, SearchResults& actual)
+    {
+        Assert::AreEqual(expected.MatchingAddressCount(), actual.MatchingAddressCount());
+        Assert::AreNotEqual(0U, expected.MatchingAddressCount());
+
+        SearchResults::Result expectedResult, actualResult;
+        for (unsigned int i = 0; i < expected.MatchingAddressCount(); ++i)
+        {
+            Assert::IsTrue(expected.GetMatchingAddress(i, expectedResult));
+            Assert::IsTrue(actual.GetMatchingAddress(i, actualResult));
+            Assert::AreEqual(expectedResult.nAddress, actualResult.nAddress);
+            Assert::AreEqual(expectedResult.nValue, actualResult.nValue);
+        }
+    }
+
+    TEST_METHOD(TestParallelFilterMatchesSerial)
+    {
+        // several unfiltered blocks, the last one partial
+        const unsigned int nMemorySize = MAX_BLOCK_SIZE * 3 + 1234;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        unsigned int nSeed = 24680;
+        auto fRandomize = [&vMemory, &nSeed]()
+        {
+            for (auto& nByte : vMemory)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                if ((nSeed >> 16) & 0x03)
+                    nByte = static_cast<unsigned char>(nSeed >> 24);
+            }
+        };
+
+        for (auto nSize : { EightBit, SixteenBit, ThirtyTwoBit })
+        {
+            fRandomize();
+
+            SearchResults serialUnfiltered, parallelUnfiltered;
+            serialUnfiltered.Initialize(0U, nMemorySize, nSize);
+            parallelUnfiltered.Initialize(0U, nMemorySize, nSize);
+
+            fRandomize();
+
+            SearchResults serial, parallel;
+            SearchResults::SetThreadCount(1);
+            serial.Initialize(serialUnfiltered, NotEqualTo);
+            SearchResults::SetThreadCount(4);
+            parallel.Initialize(parallelUnfiltered, NotEqualTo);
+
+            // filter the filtered results, which have many small blocks
+            fRandomize();
+
+            SearchResults serial2, parallel2;
+            SearchResults::SetThreadCount(1);
+            serial2.Initialize(serial, GreaterThan, 0x40);
+            SearchResults::SetThreadCount(4);
+            parallel2.Initialize(parallel, GreaterThan, 0x40);
+
+            AssertSameResults(serial, parallel);
+            AssertSameResults(serial2, parallel2);
+        }
+
+        SearchResults::SetThreadCount(1);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkParallelFilter)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkParallelFilter)
+    {
+        // 8MB synthetic RAM image, as for N64
+        const unsigned int nMemorySize = 8 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, EightBit);
+
+        double fSerial = 0.0;
+        for (unsigned int nThreads : { 1U, 2U, 4U, 8U })
+        {
+            SearchResults::SetThreadCount(nThreads);
+
+            const int nPasses = 10;
+            unsigned int nMatches = 0;
+            const auto tStart = std::chrono::steady_clock::now();
+            for (int nPass = 0; nPass < nPasses; ++nPass)
+            {
+                SearchResults filtered;
+                filtered.Initialize(unfiltered, LessThan, 0x80);
+                nMatches += filtered.MatchingAddressCount();
+            }
+            const double fElapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count() / nPasses;
+            if (nThreads == 1)
+                fSerial = fElapsed;
+
+            char sMessage[128];
+            sprintf_s(sMessage, sizeof(sMessage), "%u threads: %.2fms per filter (%.2fx, %u matches)", nThreads,
+                fElapsed, fSerial / fElapsed, nMatches);
+            Logger::WriteMessage(sMessage);
+        }
+
+        SearchResults::SetThreadCount(1);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkFilter)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkFilter)
+    {
+        // 4MB synthetic RAM image
+        const unsigned int nMemorySize = 4 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        const char* vLabels[] = { "scalar", "SSE2", "AVX2" };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        for (int nInstructionSet = 0; nInstructionSet <= static_cast<int>(nDetected); ++nInstructionSet)
+        {
+            SearchResults::SetInstructionSet(static_cast<ConditionBatch::InstructionSet>(nInstructionSet));
+
+            for (auto nSize : { EightBit, SixteenBit, ThirtyTwoBit })
+            {
+                SearchResults unfiltered;
+                unfiltered.Initialize(0U, nMemorySize, nSize);
+
+                const int nPasses = 10;
+                unsigned int nMatches = 0;
+                const auto tStart = std::chrono::steady_clock::now();
+                for (int nPass = 0; nPass < nPasses; ++nPass)
+                {
+                    SearchResults filtered;
+                    filtered.Initialize(unfiltered, GreaterThan, 0xF0);
+                    nMatches += filtered.MatchingAddressCount();
+
+                    SearchResults changed;
+                    changed.Initialize(unfiltered, NotEqualTo);
+                    nMatches += changed.MatchingAddressCount();
+                }
+                const auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+                char sMessage[128];
+                sprintf_s(sMessage, sizeof(sMessage), "%s %s: %.2fms per filter (%u matches)", vLabels[nInstructionSet],
+                    COMPARISONVARIABLESIZE_STR[nSize], std::chrono::duration<double, std::milli>(tElapsed).count() / (nPasses * 2), nMatches);
+                Logger::WriteMessage(sMessage);
+            }
+        }
+
+        SearchResults::SetInstructionSet(nDetected);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkNibbleFilter)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkNibbleFilter)
+    {
+        // 4MB synthetic RAM image
+        const unsigned int nMemorySize = 4 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, Nibble_Lower);
+        SearchResults source;
+        source.Initialize(unfiltered, GreaterThan, 0x03);
+
+        // evaluates each nibble and looks its byte up in the source, as the filters did before the nibble kernels
+        const int nPasses = 10;
+        unsigned int nMatches = 0;
+        auto tStart = std::chrono::steady_clock::now();
+        for (int nPass = 0; nPass < nPasses; ++nPass)
+        {
+            for (unsigned int i = 0; i < nMemorySize; ++i)
+            {
+                if ((vMemory[i] & 0x0F) < 0x0C && source.ContainsAddress(i))
+                    ++nMatches;
+                if ((vMemory[i] >> 4) < 0x0C && source.ContainsAddress(i))
+                    ++nMatches;
+            }
+        }
+        auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+        char sMessage[128];
+        sprintf_s(sMessage, sizeof(sMessage), "per-address: %.2fms per filter (%u matches)",
+            std::chrono::duration<double, std::milli>(tElapsed).count() / nPasses, nMatches);
+        Logger::WriteMessage(sMessage);
+
+        const char* vLabels[] = { "scalar", "SSE2" };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        const int nLastInstructionSet = std::min(static_cast<int>(nDetected), static_cast<int>(ConditionBatch::InstructionSet::SSE2));
+        for (int nInstructionSet = 0; nInstructionSet <= nLastInstructionSet; ++nInstructionSet)
+        {
+            SearchResults::SetInstructionSet(static_cast<ConditionBatch::InstructionSet>(nInstructionSet));
+
+            nMatches = 0;
+            tStart = std::chrono::steady_clock::now();
+            for (int nPass = 0; nPass < nPasses; ++nPass)
+            {
+                SearchResults filtered;
+                filtered.Initialize(source, LessThan, 0x0C);
+                nMatches += filtered.MatchingAddressCount();
+            }
+            tElapsed = std::chrono::steady_clock::now() - tStart;
+
+            sprintf_s(sMessage, sizeof(sMessage), "%s: %.2fms per filter (%u matches)", vLabels[nInstructionSet],
+                std::chrono::duration<double, std::milli>(tElapsed).count() / nPasses, nMatches);
+            Logger::WriteMessage(sMessage);
+        }
+
+        SearchResults::SetInstructionSet(nDetected);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkSerialize)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkSerialize)
+    {
+        // 8MB of memory where a quarter of the bytes are in use, as for N64
+        const unsigned int nMemorySize = 8 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = ((i & 0x30) == 0) ? static_cast<unsigned char>((i * 2654435761U) >> 24) : 0;
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, vMemory.data(), nMemorySize);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, nMemorySize, EightBit);
+        SearchResults sparse;
+        sparse.Initialize(unfiltered, Equals, 0x12);
+        SearchResults dense;
+        dense.Initialize(unfiltered, LessThan, 0x80);
+
+        const std::pair<const char*, SearchResults*> vResults[] = { { "sparse", &sparse }, { "dense", &dense } };
+        for (const auto& pResults : vResults)
+        {
+            SearchResults& results = *pResults.second;
+
+            // naive text dump: one "address value" line per match
+            auto tStart = std::chrono::steady_clock::now();
+            std::string sText;
+            SearchResults::Result result;
+            char sLine[32];
+            for (unsigned int nIndex = 0; results.GetMatchingAddress(nIndex, result); ++nIndex)
+            {
+                sprintf_s(sLine, sizeof(sLine), "%06x %02x\n", result.nAddress, result.nValue);
+                sText.append(sLine);
+            }
+            const double fText = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+            char sMessage[160];
+            sprintf_s(sMessage, sizeof(sMessage), "%s (%u matches): text %.2fMB in %.1fms", pResults.first,
+                results.MatchingAddressCount(), sText.size() / (1024.0 * 1024.0), fText);
+            Logger::WriteMessage(sMessage);
+
+            for (bool bCompress : { false, true })
+            {
+                std::vector<unsigned char> vBuffer;
+                tStart = std::chrono::steady_clock::now();
+                results.Serialize(vBuffer, bCompress);
+                const double fSave = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+                auto pBuffer = std::shared_ptr<unsigned char>(new unsigned char[vBuffer.size()], std::default_delete<unsigned char[]>());
+                memcpy(pBuffer.get(), vBuffer.data(), vBuffer.size());
+                SearchResults loaded;
+                tStart = std::chrono::steady_clock::now();
+                Assert::IsTrue(loaded.Deserialize(pBuffer, vBuffer.size()));
+                const double fLoad = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+                sprintf_s(sMessage, sizeof(sMessage), "%s %s: %.2fMB, save %.1fms (%.0fMB/s), load %.1fms", pResults.first,
+                    bCompress ? "compressed" : "uncompressed", vBuffer.size() / (1024.0 * 1024.0), fSave,
+                    vBuffer.size() / (1024.0 * 1024.0) / (fSave / 1000.0), fLoad);
+                Logger::WriteMessage(sMessage);
+            }
+        }
+    }
 };
 
 } // namespace tests
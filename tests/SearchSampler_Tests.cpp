@@ -0,0 +1,482 @@
+#include "CppUnitTest.h"
+
+#include "services\SearchResults.h"
+#include "services\SearchSampler.h"
+#include "RA_MemManager.h"
+#include "RA_UnitTestHelpers.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(SearchSampler_Tests)
+{
+public:
+    // samples and waits for the sample to be processed, so no samples are dropped
+    static void SampleAndFlush(SearchSampler& sampler)
+    {
+        sampler.Sample();
+        sampler.Flush();
+    }
+
+    static SearchSampler::Statistics GetStatistics(const SearchSampler& sampler, unsigned int nAddress)
+    {
+        SearchSampler::Statistics pStatistics;
+        Assert::IsTrue(sampler.GetStatistics(nAddress, pStatistics));
+        return pStatistics;
+    }
+
+    static void AssertStatistics(const SearchSampler& sampler, unsigned int nAddress, unsigned int nChanges,
+        unsigned int nIncreases, unsigned int nDecreases, unsigned int nMinimum, unsigned int nMaximum)
+    {
+        const auto pStatistics = GetStatistics(sampler, nAddress);
+        Assert::AreEqual(nChanges, pStatistics.nChanges, L"nChanges");
+        Assert::AreEqual(nIncreases, pStatistics.nIncreases, L"nIncreases");
+        Assert::AreEqual(nDecreases, pStatistics.nDecreases, L"nDecreases");
+        Assert::AreEqual(nMinimum, pStatistics.nMinimum, L"nMinimum");
+        Assert::AreEqual(nMaximum, pStatistics.nMaximum, L"nMaximum");
+    }
+
+    TEST_METHOD(TestNotStarted)
+    {
+        SearchSampler sampler;
+        Assert::IsFalse(sampler.IsRunning());
+        sampler.Sample();
+        sampler.Flush();
+        Assert::AreEqual(0U, sampler.SampleCount());
+
+        SearchSampler::Statistics pStatistics;
+        Assert::IsFalse(sampler.GetStatistics(0U, pStatistics));
+    }
+
+    TEST_METHOD(TestUnsupportedSize)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsFalse(sampler.Start(0U, 5U, Nibble_Lower));
+        Assert::IsFalse(sampler.Start(0U, 5U, Bit_3));
+        Assert::IsFalse(sampler.IsRunning());
+    }
+
+    TEST_METHOD(TestEightBit)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, EightBit));
+        Assert::IsTrue(sampler.IsRunning());
+        SampleAndFlush(sampler);
+
+        memory[1] = 0x13;
+        memory[3] = 0x01;
+        SampleAndFlush(sampler);
+
+        memory[1] = 0x11;
+        SampleAndFlush(sampler);
+
+        SampleAndFlush(sampler); // nothing changed
+
+        memory[1] = 0x12;
+        memory[4] = 0xFF;
+        SampleAndFlush(sampler);
+
+        Assert::AreEqual(5U, sampler.SampleCount());
+        Assert::AreEqual(0U, sampler.DroppedSamples());
+
+        AssertStatistics(sampler, 0U, 0, 0, 0, 0x00, 0x00);
+        AssertStatistics(sampler, 1U, 3, 2, 1, 0x11, 0x13);
+        AssertStatistics(sampler, 2U, 0, 0, 0, 0x34, 0x34);
+        AssertStatistics(sampler, 3U, 1, 0, 1, 0x01, 0xAB);
+        AssertStatistics(sampler, 4U, 1, 1, 0, 0x56, 0xFF);
+
+        SearchSampler::Statistics pStatistics;
+        Assert::IsFalse(sampler.GetStatistics(5U, pStatistics));
+
+        sampler.Stop();
+        Assert::IsFalse(sampler.IsRunning());
+
+        // stopping keeps the statistics, but stops sampling
+        memory[0] = 0x01;
+        SampleAndFlush(sampler);
+        Assert::AreEqual(5U, sampler.SampleCount());
+        AssertStatistics(sampler, 1U, 3, 2, 1, 0x11, 0x13);
+    }
+
+    TEST_METHOD(TestSixteenBit)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, SixteenBit));
+        SampleAndFlush(sampler);
+
+        // a byte change affects both of the values it's part of
+        memory[2] = 0x35;
+        SampleAndFlush(sampler);
+
+        AssertStatistics(sampler, 0U, 0, 0, 0, 0x1200, 0x1200);
+        AssertStatistics(sampler, 1U, 1, 1, 0, 0x3412, 0x3512);
+        AssertStatistics(sampler, 2U, 1, 1, 0, 0xAB34, 0xAB35);
+        AssertStatistics(sampler, 3U, 0, 0, 0, 0x56AB, 0x56AB);
+
+        SearchSampler::Statistics pStatistics;
+        Assert::IsFalse(sampler.GetStatistics(4U, pStatistics));
+    }
+
+    TEST_METHOD(TestSignedEightBit)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, SignedEightBit));
+        SampleAndFlush(sampler);
+
+        memory[1] = 0xF0; // 18 => -16
+        SampleAndFlush(sampler);
+
+        AssertStatistics(sampler, 1U, 1, 0, 1, 0xFFFFFFF0, 0x12);
+        AssertStatistics(sampler, 3U, 0, 0, 0, 0xFFFFFFAB, 0xFFFFFFAB);
+    }
+
+    TEST_METHOD(TestWindow)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, EightBit, 1, 2));
+        Assert::AreEqual(2U, sampler.Window());
+        SampleAndFlush(sampler);
+
+        memory[1]++;
+        SampleAndFlush(sampler);
+        memory[1]++;
+        memory[2]--;
+        SampleAndFlush(sampler);
+        AssertStatistics(sampler, 1U, 2, 2, 0, 0x12, 0x14);
+        AssertStatistics(sampler, 2U, 1, 0, 1, 0x33, 0x34);
+
+        // the first change leaves the window
+        SampleAndFlush(sampler);
+        AssertStatistics(sampler, 1U, 1, 1, 0, 0x12, 0x14);
+        AssertStatistics(sampler, 2U, 1, 0, 1, 0x33, 0x34);
+
+        // the minimum and maximum cover every sample
+        SampleAndFlush(sampler);
+        AssertStatistics(sampler, 1U, 0, 0, 0, 0x12, 0x14);
+        AssertStatistics(sampler, 2U, 0, 0, 0, 0x33, 0x34);
+    }
+
+    TEST_METHOD(TestInterval)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, EightBit, 3));
+        for (int i = 0; i < 7; ++i)
+        {
+            memory[0] = static_cast<unsigned char>(i);
+            SampleAndFlush(sampler);
+        }
+
+        // frames 0, 3 and 6
+        Assert::AreEqual(3U, sampler.SampleCount());
+        AssertStatistics(sampler, 0U, 2, 2, 0, 0, 6);
+    }
+
+    TEST_METHOD(TestDropsSamplesWhenBehind)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, EightBit));
+
+        {
+            // prevent the worker from processing the samples
+            const auto pLock = sampler.LockStatistics();
+            for (int i = 0; i < 6; ++i)
+                sampler.Sample();
+
+            Assert::AreEqual(2U, sampler.DroppedSamples());
+        }
+
+        sampler.Flush();
+        Assert::AreEqual(4U, sampler.SampleCount());
+    }
+
+    // compares the statistics for random memory against a straightforward evaluation of every address
+    void AssertMatchesReference(ComparisonVariableSize nSize, unsigned int nWindow)
+    {
+        const unsigned int nMemorySize = 1000 + 37; // not a multiple of the group size
+        const unsigned int nCount = nMemorySize - (BytesForSize(nSize) - 1);
+        std::vector<unsigned char> vMemory(nMemorySize);
+        InitializeMemory(vMemory.data(), nMemorySize);
+
+        unsigned int nSeed = 24680 + nSize * 7 + nWindow;
+        auto fRandom = [&nSeed]()
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            return nSeed >> 16;
+        };
+
+        for (auto& nByte : vMemory)
+            nByte = static_cast<unsigned char>(fRandom());
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, nMemorySize, nSize, 1, nWindow));
+        SampleAndFlush(sampler);
+
+        std::vector<std::vector<SearchSampler::Statistics>> vFrames; // per-frame changes
+        std::vector<SearchSampler::Statistics> vTotals(nCount);
+        for (unsigned int i = 0; i < nCount; ++i)
+        {
+            SearchSampler::Statistics& pTotal = vTotals[i];
+            pTotal.nChanges = pTotal.nIncreases = pTotal.nDecreases = 0;
+            pTotal.nMinimum = pTotal.nMaximum = ReadValue(vMemory, i, nSize);
+        }
+
+        for (int nFrame = 0; nFrame < 12; ++nFrame)
+        {
+            std::vector<unsigned char> vPrevious = vMemory;
+
+            // change a few bytes, mostly clustered so some groups are skipped entirely
+            const unsigned int nChanges = (nFrame == 5) ? nMemorySize : 40;
+            for (unsigned int i = 0; i < nChanges; ++i)
+            {
+                const unsigned int nRandom = fRandom();
+                const unsigned int nAddress = (nChanges == nMemorySize) ? i : (nRandom % 200) + ((nFrame & 1) ? 600 : 0);
+                vMemory[nAddress] = static_cast<unsigned char>(vMemory[nAddress] + ((nRandom & 0x100) ? 1 : 0xFF));
+            }
+
+            SampleAndFlush(sampler);
+
+            std::vector<SearchSampler::Statistics> vChanges(nCount);
+            for (unsigned int i = 0; i < nCount; ++i)
+            {
+                const unsigned int nValue = ReadValue(vMemory, i, nSize);
+                const unsigned int nPrevious = ReadValue(vPrevious, i, nSize);
+                SearchSampler::Statistics& pChange = vChanges[i];
+                pChange.nChanges = (nValue != nPrevious) ? 1 : 0;
+                pChange.nIncreases = IsGreater(nValue, nPrevious, nSize) ? 1 : 0;
+                pChange.nDecreases = IsGreater(nPrevious, nValue, nSize) ? 1 : 0;
+
+                SearchSampler::Statistics& pTotal = vTotals[i];
+                if (IsGreater(pTotal.nMinimum, nValue, nSize))
+                    pTotal.nMinimum = nValue;
+                if (IsGreater(nValue, pTotal.nMaximum, nSize))
+                    pTotal.nMaximum = nValue;
+            }
+            vFrames.push_back(std::move(vChanges));
+        }
+
+        const size_t nFirstFrame = (nWindow == 0 || nWindow > vFrames.size()) ? 0 : vFrames.size() - nWindow;
+        for (unsigned int i = 0; i < nCount; ++i)
+        {
+            SearchSampler::Statistics& pTotal = vTotals[i];
+            for (size_t nFrame = nFirstFrame; nFrame < vFrames.size(); ++nFrame)
+            {
+                pTotal.nChanges += vFrames[nFrame][i].nChanges;
+                pTotal.nIncreases += vFrames[nFrame][i].nIncreases;
+                pTotal.nDecreases += vFrames[nFrame][i].nDecreases;
+            }
+
+            const auto pStatistics = GetStatistics(sampler, i);
+            const std::wstring sMessage = Widen(COMPARISONVARIABLESIZE_STR[nSize]) + L" @" + std::to_wstring(i);
+            Assert::AreEqual(pTotal.nChanges, pStatistics.nChanges, sMessage.c_str());
+            Assert::AreEqual(pTotal.nIncreases, pStatistics.nIncreases, sMessage.c_str());
+            Assert::AreEqual(pTotal.nDecreases, pStatistics.nDecreases, sMessage.c_str());
+            Assert::AreEqual(pTotal.nMinimum, pStatistics.nMinimum, sMessage.c_str());
+            Assert::AreEqual(pTotal.nMaximum, pStatistics.nMaximum, sMessage.c_str());
+        }
+    }
+
+    static unsigned int ReadValue(const std::vector<unsigned char>& vMemory, unsigned int nAddress, ComparisonVariableSize nSize)
+    {
+        switch (nSize)
+        {
+            case EightBit:
+                return vMemory[nAddress];
+            case SignedEightBit:
+                return static_cast<unsigned int>(static_cast<int>(static_cast<signed char>(vMemory[nAddress])));
+            case SixteenBit:
+                return vMemory[nAddress] | (vMemory[nAddress + 1] << 8);
+            case SixteenBitBE:
+                return (vMemory[nAddress] << 8) | vMemory[nAddress + 1];
+            case SignedSixteenBit:
+                return static_cast<unsigned int>(static_cast<int>(static_cast<short>(vMemory[nAddress] | (vMemory[nAddress + 1] << 8))));
+            default:
+                return vMemory[nAddress] | (vMemory[nAddress + 1] << 8) | (vMemory[nAddress + 2] << 16) | (vMemory[nAddress + 3] << 24);
+        }
+    }
+
+    static bool IsGreater(unsigned int nLeft, unsigned int nRight, ComparisonVariableSize nSize)
+    {
+        if (nSize == Float)
+        {
+            float fLeft, fRight;
+            memcpy(&fLeft, &nLeft, sizeof(fLeft));
+            memcpy(&fRight, &nRight, sizeof(fRight));
+            return fLeft > fRight;
+        }
+
+        if (IsSignedSize(nSize))
+            return static_cast<int>(nLeft) > static_cast<int>(nRight);
+
+        return nLeft > nRight;
+    }
+
+    TEST_METHOD(TestMatchesReference)
+    {
+        std::vector<ConditionBatch::InstructionSet> vInstructionSets = { ConditionBatch::InstructionSet::Scalar };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        if (nDetected != ConditionBatch::InstructionSet::Scalar)
+            vInstructionSets.push_back(ConditionBatch::InstructionSet::SSE2);
+
+        for (auto nInstructionSet : vInstructionSets)
+        {
+            SearchSampler::SetInstructionSet(nInstructionSet);
+
+            for (auto nSize : { EightBit, SignedEightBit, SixteenBit, SixteenBitBE, SignedSixteenBit, ThirtyTwoBit, Float })
+            {
+                AssertMatchesReference(nSize, 0);
+                AssertMatchesReference(nSize, 4);
+            }
+        }
+
+        SearchSampler::SetInstructionSet(nDetected);
+    }
+
+    TEST_METHOD(TestFilterResults)
+    {
+        unsigned char memory[] = { 0x00, 0x12, 0x34, 0xAB, 0x56 };
+        InitializeMemory(memory, 5);
+
+        SearchResults unfiltered;
+        unfiltered.Initialize(0U, 5U, EightBit);
+
+        SearchSampler sampler;
+        Assert::IsTrue(sampler.Start(0U, 5U, EightBit));
+        SampleAndFlush(sampler);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            memory[1]++;
+            memory[2] += (i == 1) ? 0 : 1;
+            memory[3] -= 2;
+            SampleAndFlush(sampler);
+        }
+
+        SearchResults results;
+        results.Initialize(unfiltered, sampler, SearchSampler::FilterType::ChangedExactly, 3);
+        Assert::AreEqual(std::string("Filtering for CHANGED 3 TIMES IN 4 SAMPLES..."), results.Summary());
+        Assert::AreEqual(2U, results.MatchingAddressCount());
+        Assert::IsTrue(results.ContainsAddress(1U));
+        Assert::IsTrue(results.ContainsAddress(3U));
+
+        SearchResults::Result result;
+        Assert::IsTrue(results.GetMatchingAddress(0U, result));
+        Assert::AreEqual(1U, result.nAddress);
+        Assert::AreEqual(0x15U, result.nValue);
+
+        SearchResults results2;
+        results2.Initialize(unfiltered, sampler, SearchSampler::FilterType::NeverDecreased, 0);
+        Assert::AreEqual(std::string("Filtering for NEVER DECREASED IN 4 SAMPLES..."), results2.Summary());
+        Assert::AreEqual(4U, results2.MatchingAddressCount());
+        Assert::IsFalse(results2.ContainsAddress(3U));
+
+        // filtering filtered results
+        SearchResults results3;
+        results3.Initialize(results2, sampler, SearchSampler::FilterType::ChangedAtLeast, 1);
+        Assert::AreEqual(2U, results3.MatchingAddressCount());
+        Assert::IsTrue(results3.ContainsAddress(1U));
+        Assert::IsTrue(results3.ContainsAddress(2U));
+
+        SearchResults results4;
+        results4.Initialize(unfiltered, sampler, SearchSampler::FilterType::StayedInRange, 0x10, 0x40);
+        Assert::AreEqual(std::string("Filtering for ALWAYS BETWEEN 16 AND 64 IN 4 SAMPLES..."), results4.Summary());
+        Assert::AreEqual(2U, results4.MatchingAddressCount());
+        Assert::IsTrue(results4.ContainsAddress(1U));
+        Assert::IsTrue(results4.ContainsAddress(2U));
+
+        // statistics for another size don't apply
+        SearchResults sixteenBit;
+        sixteenBit.Initialize(0U, 5U, SixteenBit);
+        SearchResults results5;
+        results5.Initialize(sixteenBit, sampler, SearchSampler::FilterType::ChangedAtMost, 10);
+        Assert::AreEqual(0U, results5.MatchingAddressCount());
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(BenchmarkSample)
+        TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(BenchmarkSample)
+    {
+        // 2MB synthetic RAM image at 60 samples per second
+        const unsigned int nMemorySize = 2 * 1024 * 1024;
+        std::vector<unsigned char> vMemory(nMemorySize);
+        for (unsigned int i = 0; i < nMemorySize; ++i)
+            vMemory[i] = static_cast<unsigned char>((i * 2654435761U) >> 24);
+
+        // exposed directly, as most emulators do, so the capture is a copy rather than a callback per byte
+        g_MemManager.ClearMemoryBanks();
+        g_MemManager.AddMemoryBankBlock(0, vMemory.data(), nMemorySize);
+
+        const char* vLabels[] = { "scalar", "SSE2" };
+        const auto nDetected = ConditionBatch::DetectInstructionSet();
+        for (int nInstructionSet = 0; nInstructionSet <= std::min(static_cast<int>(nDetected), 1); ++nInstructionSet)
+        {
+            SearchSampler::SetInstructionSet(static_cast<ConditionBatch::InstructionSet>(nInstructionSet));
+
+            for (unsigned int nChanges : { 2000U, nMemorySize })
+            {
+                SearchSampler sampler;
+                sampler.Start(0U, nMemorySize, EightBit, 1, 60);
+                SampleAndFlush(sampler);
+
+                const int nFrames = 120;
+                unsigned int nSeed = 13579;
+                double fCapture = 0.0, fTotal = 0.0;
+                for (int nFrame = 0; nFrame < nFrames; ++nFrame)
+                {
+                    for (unsigned int i = 0; i < nChanges; ++i)
+                    {
+                        nSeed = nSeed * 1103515245 + 12345;
+                        vMemory[(nChanges == nMemorySize) ? i : (nSeed >> 8) % nMemorySize] += 3;
+                    }
+
+                    const auto tStart = std::chrono::steady_clock::now();
+                    sampler.Sample();
+                    const auto tCaptured = std::chrono::steady_clock::now();
+                    sampler.Flush();
+                    const auto tEnd = std::chrono::steady_clock::now();
+
+                    fCapture += std::chrono::duration<double, std::milli>(tCaptured - tStart).count();
+                    fTotal += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+                }
+
+                char sMessage[128];
+                sprintf_s(sMessage, sizeof(sMessage), "%s, %u changes: %.3fms capture, %.3fms per sample (%u dropped)",
+                    vLabels[nInstructionSet], nChanges, fCapture / nFrames, fTotal / nFrames, sampler.DroppedSamples());
+                Logger::WriteMessage(sMessage);
+            }
+        }
+
+        SearchSampler::SetInstructionSet(nDetected);
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra
@@ -0,0 +1,101 @@
+#include "CppUnitTest.h"
+
+#include "services\SpillFile.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ra {
+namespace services {
+namespace tests {
+
+TEST_CLASS(SpillFile_Tests)
+{
+public:
+    static std::vector<unsigned char> MakeSlot(unsigned int nSize, unsigned int nSeed)
+    {
+        std::vector<unsigned char> vBytes(nSize);
+        for (unsigned int i = 0; i < nSize; ++i)
+            vBytes[i] = static_cast<unsigned char>(i * 7 + nSeed);
+
+        return vBytes;
+    }
+
+    TEST_METHOD(TestWriteRead)
+    {
+        SpillFile file(100);
+        const auto vFirst = MakeSlot(100, 1);
+        const auto vSecond = MakeSlot(100, 2);
+
+        const unsigned int nFirst = file.Write(vFirst.data());
+        const unsigned int nSecond = file.Write(vSecond.data());
+        Assert::AreNotEqual(SpillFile::INVALID_SLOT, nFirst);
+        Assert::AreNotEqual(SpillFile::INVALID_SLOT, nSecond);
+        Assert::AreNotEqual(nFirst, nSecond);
+        Assert::AreEqual(2U, file.SlotCount());
+
+        std::shared_ptr<const void> pPin;
+        const unsigned char* pBytes = file.Read(nFirst, pPin);
+        Assert::IsNotNull(pBytes);
+        Assert::IsTrue(memcmp(vFirst.data(), pBytes, 100) == 0);
+
+        pBytes = file.Read(nSecond, pPin);
+        Assert::IsNotNull(pBytes);
+        Assert::IsTrue(memcmp(vSecond.data(), pBytes, 100) == 0);
+    }
+
+    TEST_METHOD(TestFreedSlotReused)
+    {
+        SpillFile file(100);
+        const auto vBytes = MakeSlot(100, 3);
+
+        const unsigned int nFirst = file.Write(vBytes.data());
+        file.Write(vBytes.data());
+        file.Free(nFirst);
+        Assert::AreEqual(1U, file.SlotCount());
+
+        const auto vReplacement = MakeSlot(100, 4);
+        Assert::AreEqual(nFirst, file.Write(vReplacement.data()));
+        Assert::AreEqual(2U, file.SlotCount());
+
+        std::shared_ptr<const void> pPin;
+        Assert::IsTrue(memcmp(vReplacement.data(), file.Read(nFirst, pPin), 100) == 0);
+    }
+
+    TEST_METHOD(TestManyViews)
+    {
+        // 8MB of slots, which is more views than are kept mapped and requires the file to grow
+        const unsigned int nSlotSize = 1027;
+        const unsigned int nSlots = 8 * 1024;
+        SpillFile file(nSlotSize);
+
+        std::vector<unsigned int> vSlots;
+        for (unsigned int i = 0; i < nSlots; ++i)
+        {
+            const auto vBytes = MakeSlot(nSlotSize, i);
+            vSlots.push_back(file.Write(vBytes.data()));
+            Assert::AreNotEqual(SpillFile::INVALID_SLOT, vSlots.back());
+        }
+
+        // a pinned view remains readable after it's been dropped from the mapped views
+        std::shared_ptr<const void> pFirstPin;
+        const unsigned char* pFirst = file.Read(vSlots.front(), pFirstPin);
+
+        for (unsigned int i = 0; i < nSlots; i += 13)
+        {
+            const auto vBytes = MakeSlot(nSlotSize, i);
+            std::shared_ptr<const void> pPin;
+            const unsigned char* pBytes = file.Read(vSlots[i], pPin);
+            Assert::IsNotNull(pBytes);
+            Assert::IsTrue(memcmp(vBytes.data(), pBytes, nSlotSize) == 0);
+        }
+
+        const auto vFirst = MakeSlot(nSlotSize, 0);
+        Assert::IsTrue(memcmp(vFirst.data(), pFirst, nSlotSize) == 0);
+    }
+};
+
+} // namespace tests
+} // namespace services
+} // namespace ra